@@ -0,0 +1,77 @@
+/*
+ Copyright (C) AC SOFTWARE SP. Z O.O.
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+*/
+
+
+// Compares throughput of bit by bit and table driven CRC16 over 4 KB section,
+// which is calculated on every state save.
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <chrono>
+#include <vector>
+
+#include <supla/crc16.h>
+
+namespace {
+
+const size_t SectionSize = 4096;
+const int Rounds = 20000;
+
+uint16_t bitwiseCrc(const std::vector<uint8_t> &data) {
+  uint16_t crc = 0xFFFF;
+  for (uint8_t byte : data) {
+    crc = crc16_update(crc, byte);
+  }
+  return crc;
+}
+
+uint16_t tableCrc(const std::vector<uint8_t> &data) {
+  return crc16_update_block(0xFFFF, data.data(), data.size());
+}
+
+void benchmark(const char *name,
+               uint16_t (*calculate)(const std::vector<uint8_t> &),
+               std::vector<uint8_t> data) {
+  uint16_t result = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < Rounds; i++) {
+    // data changes between rounds, so calls are not optimized out
+    data[i % SectionSize] ^= result;
+    result = calculate(data);
+  }
+  auto end = std::chrono::steady_clock::now();
+  double seconds = std::chrono::duration<double>(end - start).count();
+
+  printf("%-8s %8.1f MB/s %8.2f us/section (crc %04X)\n",
+         name,
+         SectionSize * Rounds / seconds / 1e6,
+         seconds * 1e6 / Rounds,
+         result);
+}
+
+}  // namespace
+
+int main() {
+  std::vector<uint8_t> data(SectionSize);
+  for (size_t i = 0; i < data.size(); i++) {
+    data[i] = i * 131 + 7;
+  }
+
+  benchmark("bitwise", bitwiseCrc, data);
+  benchmark("table", tableCrc, data);
+  return 0;
+}
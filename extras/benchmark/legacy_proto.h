@@ -0,0 +1,39 @@
+/*
+ Copyright (C) AC SOFTWARE SP. Z O.O.
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+*/
+
+#ifndef _legacy_proto_h
+#define _legacy_proto_h
+
+#include <supla-common/proto.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void *legacy_sproto_init(void);
+void legacy_sproto_free(void *spd_ptr);
+char legacy_sproto_out_buffer_append(void *spd_ptr, TSuplaDataPacket *sdp);
+unsigned _supla_int_t legacy_sproto_pop_out_data(
+    void *spd_ptr, char *buffer, unsigned _supla_int_t buffer_size);
+char legacy_sproto_in_buffer_append(void *spd_ptr, char *data,
+                                    unsigned _supla_int_t data_size);
+char legacy_sproto_pop_in_sdp(void *spd_ptr, TSuplaDataPacket *sdp);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,180 @@
+/*
+ Copyright (C) AC SOFTWARE SP. Z O.O.
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+*/
+
+// Compares packets/s and heap allocations of sproto in/out buffers with the
+// previous realloc based implementation (legacy_proto.c).
+//
+// Both implementations are compiled with ESP8266 buffer limits. malloc,
+// realloc and free are wrapped by the linker (-Wl,--wrap), so calls made from
+// C sources are counted.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <chrono>
+#include <vector>
+
+#include <supla-common/proto.h>
+
+#include "legacy_proto.h"
+
+namespace {
+unsigned long allocations = 0;
+};
+
+extern "C" {
+void *__real_malloc(size_t size);
+void *__real_realloc(void *ptr, size_t size);
+
+void *__wrap_malloc(size_t size) {
+  allocations++;
+  return __real_malloc(size);
+}
+
+void *__wrap_realloc(void *ptr, size_t size) {
+  allocations++;
+  return __real_realloc(ptr, size);
+}
+}
+
+struct Implementation {
+  const char *name;
+  void *(*init)(void);
+  void (*free)(void *);
+  char (*inAppend)(void *, char *, unsigned _supla_int_t);
+  char (*popInSdp)(void *, TSuplaDataPacket *);
+  char (*outAppend)(void *, TSuplaDataPacket *);
+  unsigned _supla_int_t (*popOutData)(void *, char *, unsigned _supla_int_t);
+};
+
+const Implementation implementations[] = {
+    {"realloc", legacy_sproto_init, legacy_sproto_free,
+     legacy_sproto_in_buffer_append, legacy_sproto_pop_in_sdp,
+     legacy_sproto_out_buffer_append, legacy_sproto_pop_out_data},
+    {"ring", sproto_init, sproto_free, sproto_in_buffer_append,
+     sproto_pop_in_sdp, sproto_out_buffer_append, sproto_pop_out_data},
+};
+
+// Size of single data_read()/data_write() call, as SRPC_BUFFER_SIZE on ESP
+const unsigned ChunkSize = 1024;
+const int Rounds = 20000;
+
+std::vector<char> buildStream(unsigned dataSize, int packetsPerRead) {
+  std::vector<char> stream;
+  void *spd = sproto_init();
+  TSuplaDataPacket sdp;
+  std::vector<char> data(dataSize, 'x');
+  for (int i = 0; i < packetsPerRead; i++) {
+    sproto_sdp_init(spd, &sdp);
+    sproto_set_data(&sdp, data.data(), dataSize, 100);
+    const char *raw = reinterpret_cast<const char *>(&sdp);
+    stream.insert(stream.end(), raw,
+                  raw + sizeof(TSuplaDataPacket) - SUPLA_MAX_DATA_SIZE +
+                      dataSize);
+    stream.insert(stream.end(), sproto_tag, sproto_tag + SUPLA_TAG_SIZE);
+  }
+  sproto_free(spd);
+  return stream;
+}
+
+void report(const char *test, const Implementation &impl, unsigned dataSize,
+            long packets, double seconds, unsigned long allocs) {
+  printf("%-4s %-8s data %4u B: %10.0f packets/s, %6.3f allocations/packet\n",
+         test, impl.name, dataSize, packets / seconds,
+         static_cast<double>(allocs) / packets);
+}
+
+// Several packets arrive in one read, as when server answers a burst of
+// requests. Each read is appended and all complete packets are popped.
+void benchmarkIn(const Implementation &impl, unsigned dataSize,
+                 int packetsPerRead) {
+  std::vector<char> stream = buildStream(dataSize, packetsPerRead);
+  TSuplaDataPacket sdp;
+  long packets = 0;
+
+  void *spd = impl.init();
+  allocations = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (int round = 0; round < Rounds; round++) {
+    for (size_t offset = 0; offset < stream.size(); offset += ChunkSize) {
+      unsigned size = stream.size() - offset;
+      if (size > ChunkSize) {
+        size = ChunkSize;
+      }
+      impl.inAppend(spd, &stream[offset], size);
+      while (impl.popInSdp(spd, &sdp) == SUPLA_RESULT_TRUE) {
+        packets++;
+      }
+    }
+  }
+  auto end = std::chrono::steady_clock::now();
+  unsigned long allocs = allocations;
+  impl.free(spd);
+
+  report("in", impl, dataSize, packets,
+         std::chrono::duration<double>(end - start).count(), allocs);
+}
+
+// Several packets are queued and written in ChunkSize pieces
+void benchmarkOut(const Implementation &impl, unsigned dataSize,
+                  int packetsPerWrite) {
+  void *spd = impl.init();
+  TSuplaDataPacket sdp;
+  std::vector<char> data(dataSize, 'x');
+  char buffer[ChunkSize];
+  long packets = 0;
+
+  sproto_sdp_init(spd, &sdp);
+  sproto_set_data(&sdp, data.data(), dataSize, 100);
+
+  allocations = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (int round = 0; round < Rounds; round++) {
+    for (int i = 0; i < packetsPerWrite; i++) {
+      if (impl.outAppend(spd, &sdp) == SUPLA_RESULT_TRUE) {
+        packets++;
+      }
+    }
+    while (impl.popOutData(spd, buffer, sizeof(buffer)) > 0) {
+    }
+  }
+  auto end = std::chrono::steady_clock::now();
+  unsigned long allocs = allocations;
+  impl.free(spd);
+
+  report("out", impl, dataSize, packets,
+         std::chrono::duration<double>(end - start).count(), allocs);
+}
+
+int main() {
+  struct {
+    unsigned dataSize;
+    int packetsPerChunk;
+  } cases[] = {{9, 16}, {32, 8}, {128, 6}, {512, 3}};
+
+  for (auto &c : cases) {
+    for (auto &impl : implementations) {
+      benchmarkIn(impl, c.dataSize, c.packetsPerChunk);
+    }
+  }
+  for (auto &c : cases) {
+    for (auto &impl : implementations) {
+      benchmarkOut(impl, c.dataSize, c.packetsPerChunk);
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,245 @@
+/*
+ Copyright (C) AC SOFTWARE SP. Z O.O.
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+*/
+
+
+// Counts storage bus traffic per state save for Eeprom (ESP8266 EEPROM
+// library) and FramSpi, with current block transfers and with previous byte
+// by byte implementations.
+//
+// Libraries are replaced by stand-ins from storage_doubles, which count
+// EEPROM library calls and flash sector writes, or FRAM SPI transactions and
+// bytes sent on the bus.
+
+#include <stdio.h>
+#include <string.h>
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include <EEPROM.h>
+
+#include <supla/element.h>
+#include <supla/storage/eeprom.h>
+#include <supla/storage/fram_spi.h>
+
+EEPROMClass EEPROM;
+FramBus framBus;
+
+namespace {
+
+const int ElementCount = 10;
+const int ElementStateSize = 16;
+
+// Byte by byte transfers, as before
+class LegacyEeprom : public Supla::Eeprom {
+ protected:
+  int readStorage(unsigned int offset,
+                  unsigned char *buf,
+                  int size,
+                  bool logs) override {
+    (void)(logs);
+    for (int i = 0; i < size; i++) {
+      buf[i] = EEPROM.read(offset + i);
+    }
+    return size;
+  }
+
+  int writeStorage(unsigned int offset,
+                   const unsigned char *buf,
+                   int size) override {
+    dataChanged = true;
+    for (int i = 0; i < size; i++) {
+      EEPROM.write(offset + i, buf[i]);
+    }
+    return size;
+  }
+};
+
+class LegacyFramSpi : public Supla::FramSpi {
+ public:
+  LegacyFramSpi() : Supla::FramSpi(10) {
+  }
+
+ protected:
+  int readStorage(unsigned int offset,
+                  unsigned char *buf,
+                  int size,
+                  bool logs) override {
+    (void)(logs);
+    for (int i = 0; i < size; i++) {
+      buf[i] = fram.read8(offset + i);
+    }
+    return size;
+  }
+};
+
+class CurrentFramSpi : public Supla::FramSpi {
+ public:
+  CurrentFramSpi() : Supla::FramSpi(10) {
+  }
+};
+
+class StateElement : public Supla::Element {
+ public:
+  explicit StateElement(bool tracking) {
+    memset(state, 0, sizeof(state));
+    if (tracking) {
+      enableStateChangeTracking();
+    }
+  }
+
+  void change() {
+    state[0]++;
+    markStateChanged();
+  }
+
+  void onSaveState() override {
+    Supla::Storage::WriteState(state, sizeof(state));
+  }
+
+  void onLoadState() override {
+    Supla::Storage::ReadState(state, sizeof(state));
+  }
+
+  unsigned char state[ElementStateSize];
+};
+
+struct Backend {
+  const char *name;
+  const char *counters;
+  std::function<Supla::Storage *()> create;
+  std::function<void()> clear;
+  std::function<void(unsigned long *, unsigned long *)> read;
+};
+
+void saveState(const std::vector<std::unique_ptr<StateElement>> &elements) {
+  Supla::Storage::PrepareState();
+  for (auto &element : elements) {
+    Supla::Storage::SaveElementState(element.get());
+  }
+  Supla::Storage::FinalizeSaveState();
+}
+
+void report(const Backend &backend,
+            const char *phase,
+            unsigned long *first,
+            unsigned long *second) {
+  unsigned long currentFirst = 0;
+  unsigned long currentSecond = 0;
+  backend.read(&currentFirst, &currentSecond);
+  printf("%-14s %-22s %8lu %8lu\n",
+         backend.name,
+         phase,
+         currentFirst - *first,
+         currentSecond - *second);
+  *first = currentFirst;
+  *second = currentSecond;
+}
+
+void run(const Backend &backend, bool tracking) {
+  backend.clear();
+  std::vector<std::unique_ptr<StateElement>> elements;
+  for (int i = 0; i < ElementCount; i++) {
+    elements.emplace_back(new StateElement(tracking));
+  }
+
+  unsigned long first = 0;
+  unsigned long second = 0;
+  backend.read(&first, &second);
+
+  {
+    std::unique_ptr<Supla::Storage> storage(backend.create());
+    storage->init();
+    saveState(elements);
+    report(backend, "first save", &first, &second);
+  }
+
+  std::unique_ptr<Supla::Storage> storage(backend.create());
+  storage->init();
+  Supla::Storage::PrepareState(true);
+  for (auto &element : elements) {
+    Supla::Storage::SaveElementState(element.get());
+  }
+  if (Supla::Storage::FinalizeSaveState()) {
+    Supla::Storage::PrepareState();
+    for (auto &element : elements) {
+      Supla::Storage::LoadElementState(element.get());
+    }
+  }
+  report(backend, "boot", &first, &second);
+
+  elements[3]->change();
+  saveState(elements);
+  report(backend,
+         tracking ? "save, 1 changed" : "save, 1 changed, full",
+         &first,
+         &second);
+
+  saveState(elements);
+  report(backend,
+         tracking ? "save, no change" : "save, no change, full",
+         &first,
+         &second);
+}
+
+}  // namespace
+
+int main() {
+  Backend backends[] = {
+      {"eeprom/legacy",
+       "calls   sectors",
+       []() { return new LegacyEeprom; },
+       []() { memset(EEPROM.data, 0xFF, sizeof(EEPROM.data)); },
+       [](unsigned long *calls, unsigned long *sectors) {
+         *calls = EEPROM.accesses;
+         *sectors = EEPROM.sectorWrites;
+       }},
+      {"eeprom/block",
+       "calls   sectors",
+       []() { return new Supla::Eeprom; },
+       []() { memset(EEPROM.data, 0xFF, sizeof(EEPROM.data)); },
+       [](unsigned long *calls, unsigned long *sectors) {
+         *calls = EEPROM.accesses;
+         *sectors = EEPROM.sectorWrites;
+       }},
+      {"fram/legacy",
+       "SPI xfers   bytes",
+       []() { return new LegacyFramSpi; },
+       []() { memset(framBus.memory, 0xFF, sizeof(framBus.memory)); },
+       [](unsigned long *transactions, unsigned long *bytes) {
+         *transactions = framBus.transactions;
+         *bytes = framBus.bytes;
+       }},
+      {"fram/block",
+       "SPI xfers   bytes",
+       []() { return new CurrentFramSpi; },
+       []() { memset(framBus.memory, 0xFF, sizeof(framBus.memory)); },
+       [](unsigned long *transactions, unsigned long *bytes) {
+         *transactions = framBus.transactions;
+         *bytes = framBus.bytes;
+       }},
+  };
+
+  printf("%d elements with %d bytes of state\n", ElementCount,
+         ElementStateSize);
+  for (auto &backend : backends) {
+    printf("\n%-14s %-22s %s\n", "backend", "phase", backend.counters);
+    run(backend, true);
+    run(backend, false);
+  }
+  return 0;
+}
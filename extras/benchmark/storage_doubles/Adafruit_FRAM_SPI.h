@@ -0,0 +1,83 @@
+/*
+ Copyright (C) AC SOFTWARE SP. Z O.O.
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+*/
+
+
+// Adafruit FRAM SPI library stand-in for storage_benchmark. Memory is shared
+// by all instances, so it is kept between simulated reboots. Each call is
+// counted as one SPI transaction (CS low, opcode, 2 address bytes, data).
+
+#ifndef _storage_benchmark_adafruit_fram_spi_h
+#define _storage_benchmark_adafruit_fram_spi_h
+
+#include <stdint.h>
+#include <string.h>
+
+#include <cstddef>
+
+struct FramBus {
+  uint8_t memory[8192];
+  unsigned long transactions;
+  unsigned long bytes;
+
+  void transaction(size_t dataBytes, size_t headerBytes = 3) {
+    transactions++;
+    bytes += headerBytes + dataBytes;
+  }
+};
+
+extern FramBus framBus;
+
+class Adafruit_FRAM_SPI {
+ public:
+  explicit Adafruit_FRAM_SPI(int8_t cs) {
+    (void)(cs);
+  }
+
+  Adafruit_FRAM_SPI(int8_t clk, int8_t miso, int8_t mosi, int8_t cs) {
+    (void)(clk);
+    (void)(miso);
+    (void)(mosi);
+    (void)(cs);
+  }
+
+  bool begin() {
+    return true;
+  }
+
+  void writeEnable(bool enable) {
+    (void)(enable);
+    framBus.transaction(0, 1);
+  }
+
+  uint8_t read8(uint32_t addr) {
+    framBus.transaction(1);
+    return framBus.memory[addr];
+  }
+
+  bool read(uint32_t addr, uint8_t *values, size_t count) {
+    framBus.transaction(count);
+    memcpy(values, framBus.memory + addr, count);
+    return true;
+  }
+
+  bool write(uint32_t addr, uint8_t *values, size_t count) {
+    framBus.transaction(count);
+    memcpy(framBus.memory + addr, values, count);
+    return true;
+  }
+};
+
+#endif
@@ -0,0 +1,80 @@
+/*
+ Copyright (C) AC SOFTWARE SP. Z O.O.
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+*/
+
+
+// ESP8266 EEPROM library stand-in for storage_benchmark. Content is kept in
+// RAM, as in the original. Accesses and flash sector writes are counted.
+
+#ifndef _storage_benchmark_eeprom_h
+#define _storage_benchmark_eeprom_h
+
+#include <stdint.h>
+#include <string.h>
+
+#include <cstddef>
+
+class EEPROMClass {
+ public:
+  void begin(size_t newSize) {
+    size = newSize < sizeof(data) ? newSize : sizeof(data);
+  }
+
+  uint8_t read(int address) {
+    accesses++;
+    return data[address];
+  }
+
+  void write(int address, uint8_t value) {
+    accesses++;
+    if (data[address] != value) {
+      data[address] = value;
+      dirty = true;
+    }
+  }
+
+  uint8_t *getDataPtr() {
+    accesses++;
+    dirty = true;
+    return data;
+  }
+
+  const uint8_t *getConstDataPtr() const {
+    accesses++;
+    return data;
+  }
+
+  size_t length() {
+    return size;
+  }
+
+  bool commit() {
+    if (dirty) {
+      sectorWrites++;
+      dirty = false;
+    }
+    return true;
+  }
+
+  uint8_t data[4096];
+  size_t size = 0;
+  bool dirty = false;
+  mutable unsigned long accesses = 0;
+  unsigned long sectorWrites = 0;
+};
+
+extern EEPROMClass EEPROM;
+
+#endif
@@ -0,0 +1,107 @@
+/*
+ Copyright (C) AC SOFTWARE SP. Z O.O.
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+*/
+
+
+// Minimal Arduino API for native Linux builds. Time functions use monotonic
+// clock, pins are kept in memory and Serial prints to stdout.
+
+#ifndef _linux_arduino_h
+#define _linux_arduino_h
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <string>
+
+typedef std::string String;
+
+#define LSBFIRST 0
+#define MSBFIRST 1
+#define INPUT 0
+#define OUTPUT 1
+#define INPUT_PULLUP 2
+#define HIGH 1
+#define LOW 0
+
+#define DEC 10
+#define HEX 16
+#define OCT 8
+#define BIN 2
+
+#define F(string_literal) string_literal
+
+void digitalWrite(uint8_t pin, uint8_t val);
+int digitalRead(uint8_t pin);
+void analogWrite(uint8_t pin, int val);
+int analogRead(uint8_t pin);
+void pinMode(uint8_t pin, uint8_t mode);
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+void yield();
+long map(long, long, long, long, long);
+long random(long max);
+long random(long min, long max);
+
+class LinuxSerial {
+ public:
+  void begin(unsigned long) {
+  }
+
+  int printf(const char *format, ...)
+      __attribute__((format(printf, 2, 3)));
+
+  int print(const String &s) {
+    return fprintf(stdout, "%s", s.c_str());
+  }
+  int print(const char s[]) {
+    return fprintf(stdout, "%s", s);
+  }
+  int print(char c) {
+    return fprintf(stdout, "%c", c);
+  }
+  int print(unsigned char value, int base = DEC) {
+    return print(static_cast<unsigned long>(value), base);
+  }
+  int print(int value, int base = DEC) {
+    return print(static_cast<long>(value), base);
+  }
+  int print(unsigned int value, int base = DEC) {
+    return print(static_cast<unsigned long>(value), base);
+  }
+  int print(long value, int base = DEC);
+  int print(unsigned long value, int base = DEC);
+  int print(double value, int digits = 2);
+
+  template <typename T>
+  int println(T value) {
+    int size = print(value);
+    return size + println();
+  }
+  template <typename T>
+  int println(T value, int format) {
+    int size = print(value, format);
+    return size + println();
+  }
+  int println() {
+    return fputc('\n', stdout) == EOF ? 0 : 1;
+  }
+};
+
+extern LinuxSerial Serial;
+
+#endif
@@ -0,0 +1,166 @@
+/*
+ Copyright (C) AC SOFTWARE SP. Z O.O.
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+*/
+
+
+#include <stdarg.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "Arduino.h"
+
+LinuxSerial Serial;
+
+namespace {
+// Virtual pins. Outputs written by relays and LEDs can be read back by
+// simulated inputs.
+const int pinCount = 256;
+int pinValues[pinCount] = {};
+uint8_t pinModes[pinCount] = {};
+
+uint64_t monotonicUs() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<uint64_t>(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+}
+
+// millis() counts from process start, like on MCU. SUPLA_LINUX_MILLIS_OFFSET
+// environment variable moves the starting point, i.e. to check behavior
+// around 32 bit millis() overflow without waiting 49 days.
+const uint64_t startUs = monotonicUs();
+
+uint64_t millisOffset() {
+  static uint64_t offset = [] {
+    const char *value = getenv("SUPLA_LINUX_MILLIS_OFFSET");
+    return value ? strtoull(value, nullptr, 10) : 0;
+  }();
+  return offset;
+}
+
+void sleepUs(uint64_t us) {
+  struct timespec ts;
+  ts.tv_sec = us / 1000000;
+  ts.tv_nsec = (us % 1000000) * 1000;
+  while (nanosleep(&ts, &ts) == -1) {
+  }
+}
+};  // namespace
+
+// unsigned long is 64 bit on Linux, so values are truncated to 32 bits to
+// overflow as on MCU
+unsigned long millis() {
+  return static_cast<uint32_t>((monotonicUs() - startUs) / 1000 +
+                               millisOffset());
+}
+
+unsigned long micros() {
+  return static_cast<uint32_t>(monotonicUs() - startUs +
+                               millisOffset() * 1000);
+}
+
+void delay(unsigned long ms) {
+  if (ms == 0) {
+    return;
+  }
+  sleepUs(static_cast<uint64_t>(ms) * 1000);
+}
+
+void delayMicroseconds(unsigned int us) {
+  sleepUs(us);
+}
+
+void yield() {
+}
+
+void digitalWrite(uint8_t pin, uint8_t val) {
+  pinValues[pin] = val ? HIGH : LOW;
+}
+
+int digitalRead(uint8_t pin) {
+  return pinValues[pin];
+}
+
+void analogWrite(uint8_t pin, int val) {
+  pinValues[pin] = val;
+}
+
+int analogRead(uint8_t pin) {
+  return pinValues[pin];
+}
+
+void pinMode(uint8_t pin, uint8_t mode) {
+  pinModes[pin] = mode;
+  if (mode == INPUT_PULLUP) {
+    pinValues[pin] = HIGH;
+  }
+}
+
+long map(long x, long inMin, long inMax, long outMin, long outMax) {
+  return (x - inMin) * (outMax - outMin) / (inMax - inMin) + outMin;
+}
+
+long random(long max) {
+  if (max <= 0) {
+    return 0;
+  }
+  return ::random() % max;
+}
+
+long random(long min, long max) {
+  if (min >= max) {
+    return min;
+  }
+  return random(max - min) + min;
+}
+
+int LinuxSerial::printf(const char *format, ...) {
+  va_list args;
+  va_start(args, format);
+  int size = vfprintf(stdout, format, args);
+  va_end(args);
+  return size;
+}
+
+int LinuxSerial::print(long value, int base) {
+  if (base == DEC) {
+    return fprintf(stdout, "%ld", value);
+  }
+  return print(static_cast<unsigned long>(value), base);
+}
+
+int LinuxSerial::print(unsigned long value, int base) {
+  switch (base) {
+    case HEX:
+      return fprintf(stdout, "%lX", value);
+    case OCT:
+      return fprintf(stdout, "%lo", value);
+    case BIN: {
+      char buf[sizeof(value) * 8 + 1];
+      int pos = sizeof(buf) - 1;
+      buf[pos] = '\0';
+      do {
+        buf[--pos] = '0' + (value & 1);
+        value >>= 1;
+      } while (value);
+      return print(buf + pos);
+    }
+    default:
+      return fprintf(stdout, "%lu", value);
+  }
+}
+
+int LinuxSerial::print(double value, int digits) {
+  return fprintf(stdout, "%.*f", digits, value);
+}
@@ -0,0 +1,39 @@
+/*
+ Copyright (C) AC SOFTWARE SP. Z O.O.
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+*/
+
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+
+#include <supla-common/log.h>
+
+void supla_log(int __pri, const char *__fmt, ...) {
+  if (__pri == LOG_DEBUG && getenv("SUPLA_LINUX_QUIET") != nullptr) {
+    return;
+  }
+
+  struct timeval now;
+  gettimeofday(&now, nullptr);
+  fprintf(stdout, "%ld.%03ld ", now.tv_sec, now.tv_usec / 1000);
+
+  va_list args;
+  va_start(args, __fmt);
+  vfprintf(stdout, __fmt, args);
+  va_end(args);
+  fputc('\n', stdout);
+}
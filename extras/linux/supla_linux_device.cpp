@@ -0,0 +1,178 @@
+/*
+ Copyright (C) AC SOFTWARE SP. Z O.O.
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+*/
+
+
+// SuplaDevice running as native Linux process, with virtual relays and
+// simulated sensors. Usage:
+//   supla_linux_device -s server -e email -g GUID -a AUTHKEY [-p port]
+//       [-r relays] [-t thermometers] [-f storage_file] [-w max_sleep_ms]
+//       [-n] [-q]
+// GUID and AUTHKEY are given as 32 hex digits. -n disables SSL, -q disables
+// debug logs. -w limits sleep between iterations (20 ms by default), 0 makes
+// main loop busy.
+
+#include <Arduino.h>
+#include <getopt.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <SuplaDevice.h>
+#include <supla/control/virtual_relay.h>
+#include <supla/network/linux_network.h>
+#include <supla/sensor/thermometer.h>
+#include <supla/sensor/virtual_binary.h>
+#include <supla/storage/file_storage.h>
+
+namespace {
+// Temperature follows slow sine wave, different for each sensor
+class SimulatedThermometer : public Supla::Sensor::Thermometer {
+ public:
+  explicit SimulatedThermometer(int number) : number(number) {
+  }
+
+  double getValue() {
+    double phase = millis() / 600000.0 * 2 * M_PI + number;
+    return 21.0 + 3.0 * sin(phase);
+  }
+
+ protected:
+  int number;
+};
+
+bool parseHex(const char *text, char *out, int size) {
+  if (text == nullptr || strlen(text) != static_cast<size_t>(size) * 2) {
+    return false;
+  }
+  for (int i = 0; i < size; i++) {
+    char byte[3] = {text[2 * i], text[2 * i + 1], '\0'};
+    char *end = nullptr;
+    out[i] = static_cast<char>(strtoul(byte, &end, 16));
+    if (*end != '\0') {
+      return false;
+    }
+  }
+  return true;
+}
+
+void usage(const char *name) {
+  fprintf(stderr,
+          "Usage: %s -s server -e email -g GUID -a AUTHKEY [-p port]\n"
+          "          [-r relays] [-t thermometers] [-f storage_file]\n"
+          "          [-w max_sleep_ms] [-n] [-q]\n",
+          name);
+}
+};  // namespace
+
+int main(int argc, char **argv) {
+  const char *server = nullptr;
+  const char *email = nullptr;
+  const char *storageFile = nullptr;
+  char guid[SUPLA_GUID_SIZE] = {};
+  char authKey[SUPLA_AUTHKEY_SIZE] = {};
+  bool guidSet = false;
+  bool authKeySet = false;
+  bool useSsl = true;
+  int port = -1;
+  int relayCount = 2;
+  int thermometerCount = 1;
+  int maxSleepMs = 20;
+
+  int opt;
+  while ((opt = getopt(argc, argv, "s:e:g:a:p:r:t:f:w:nq")) != -1) {
+    switch (opt) {
+      case 's':
+        server = optarg;
+        break;
+      case 'e':
+        email = optarg;
+        break;
+      case 'g':
+        guidSet = parseHex(optarg, guid, SUPLA_GUID_SIZE);
+        break;
+      case 'a':
+        authKeySet = parseHex(optarg, authKey, SUPLA_AUTHKEY_SIZE);
+        break;
+      case 'p':
+        port = atoi(optarg);
+        break;
+      case 'r':
+        relayCount = atoi(optarg);
+        break;
+      case 't':
+        thermometerCount = atoi(optarg);
+        break;
+      case 'f':
+        storageFile = optarg;
+        break;
+      case 'w':
+        maxSleepMs = atoi(optarg);
+        break;
+      case 'n':
+        useSsl = false;
+        break;
+      case 'q':
+        setenv("SUPLA_LINUX_QUIET", "1", 1);
+        break;
+      default:
+        usage(argv[0]);
+        return 1;
+    }
+  }
+
+  if (server == nullptr || email == nullptr || !guidSet || !authKeySet) {
+    usage(argv[0]);
+    return 1;
+  }
+
+  // Logs are visible immediately also when output is redirected
+  setvbuf(stdout, nullptr, _IOLBF, 0);
+
+  Supla::LinuxNetwork network;
+  network.enableSSL(useSsl);
+
+  Supla::FileStorage *storage = nullptr;
+  if (storageFile) {
+    storage = new Supla::FileStorage(storageFile);
+  }
+
+  for (int i = 0; i < relayCount; i++) {
+    new Supla::Control::VirtualRelay();
+  }
+  for (int i = 0; i < thermometerCount; i++) {
+    new SimulatedThermometer(i);
+  }
+  // Binary sensor, which state can be changed by actions
+  new Supla::Sensor::VirtualBinary();
+
+  if (port != -1) {
+    SuplaDevice.setServerPort(port);
+  }
+  SuplaDevice.setName("Supla Linux device");
+  if (maxSleepMs > 0) {
+    SuplaDevice.setLowPowerMode(true, maxSleepMs);
+  }
+
+  if (!SuplaDevice.begin(guid, server, email, authKey)) {
+    delete storage;
+    return 1;
+  }
+
+  for (;;) {
+    SuplaDevice.iterate();
+  }
+}
@@ -0,0 +1,432 @@
+/*
+ Copyright (C) AC SOFTWARE SP. Z O.O.
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+*/
+
+
+#include "server_standin.h"
+
+#include <algorithm>
+#include <errno.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <supla-common/log.h>
+#include <supla-common/srpc.h>
+
+// Time limit for sending data to device with full socket buffer
+#define SERVER_STANDIN_WRITE_TIMEOUT_MS 1000
+// Limit of packets handled for one device in one iterate() call, so a single
+// device can't starve others
+#define SERVER_STANDIN_PACKETS_PER_ITERATE 64
+
+void LatencyRecorder::add(uint64_t us) {
+  samples.push_back(us);
+  sorted = false;
+}
+
+void LatencyRecorder::clear() {
+  samples.clear();
+  sorted = true;
+}
+
+size_t LatencyRecorder::count() const {
+  return samples.size();
+}
+
+uint64_t LatencyRecorder::percentile(double p) const {
+  if (samples.empty()) {
+    return 0;
+  }
+  if (!sorted) {
+    std::sort(samples.begin(), samples.end());
+    sorted = true;
+  }
+  size_t index = static_cast<size_t>(p / 100.0 * (samples.size() - 1) + 0.5);
+  return samples[index];
+}
+
+uint64_t LatencyRecorder::average() const {
+  if (samples.empty()) {
+    return 0;
+  }
+  uint64_t sum = 0;
+  for (auto sample : samples) {
+    sum += sample;
+  }
+  return sum / samples.size();
+}
+
+void LatencyRecorder::print(const char *name) const {
+  printf("%-24s n=%-7zu min=%-8llu avg=%-8llu p50=%-8llu p99=%-8llu "
+         "max=%llu [us]\n",
+         name,
+         count(),
+         static_cast<unsigned long long>(percentile(0)),
+         static_cast<unsigned long long>(average()),
+         static_cast<unsigned long long>(percentile(50)),
+         static_cast<unsigned long long>(percentile(99)),
+         static_cast<unsigned long long>(percentile(100)));
+}
+
+ServerStandin::ServerStandin()
+    : listenFd(-1),
+      port(0),
+      echoMode(false),
+      echoCommandLimit(0),
+      nextSenderId(1),
+      valueChangedCount(0),
+      commandCount(0),
+      commandResultCount(0),
+      pingCount(0) {
+}
+
+ServerStandin::~ServerStandin() {
+  for (auto device : devices) {
+    device->closed = true;
+  }
+  removeClosedDevices();
+  if (listenFd >= 0) {
+    close(listenFd);
+  }
+}
+
+uint64_t ServerStandin::nowUs() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<uint64_t>(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+}
+
+bool ServerStandin::begin(int listenPort) {
+  listenFd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if (listenFd < 0) {
+    return false;
+  }
+  int reuse = 1;
+  setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+  struct sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_ANY);
+  addr.sin_port = htons(listenPort);
+  socklen_t len = sizeof(addr);
+  if (bind(listenFd, reinterpret_cast<sockaddr *>(&addr), len) != 0 ||
+      listen(listenFd, 128) != 0 ||
+      getsockname(listenFd, reinterpret_cast<sockaddr *>(&addr), &len) != 0) {
+    supla_log(LOG_ERR, "Server: can't listen on port %d (%s)", listenPort,
+              strerror(errno));
+    close(listenFd);
+    listenFd = -1;
+    return false;
+  }
+  port = ntohs(addr.sin_port);
+  supla_log(LOG_INFO, "Server: listening on port %d", port);
+  return true;
+}
+
+int ServerStandin::getPort() const {
+  return port;
+}
+
+void ServerStandin::iterate(int timeoutMs) {
+  std::vector<struct pollfd> fds(devices.size() + 1);
+  fds[0].fd = listenFd;
+  fds[0].events = POLLIN;
+  for (size_t i = 0; i < devices.size(); i++) {
+    fds[i + 1].fd = devices[i]->fd;
+    fds[i + 1].events = POLLIN;
+    // commands queued outside of srpc callbacks are sent without waiting
+    if (hasPendingOutput(devices[i])) {
+      timeoutMs = 0;
+    }
+  }
+
+  if (poll(fds.data(), fds.size(), timeoutMs) < 0) {
+    return;
+  }
+
+  if (fds[0].revents) {
+    acceptConnections();
+  }
+  for (size_t i = 0; i + 1 < fds.size(); i++) {
+    if (fds[i + 1].revents || hasPendingOutput(devices[i])) {
+      handleDevice(devices[i]);
+    }
+  }
+  removeClosedDevices();
+}
+
+bool ServerStandin::hasPendingOutput(Device *device) {
+  return srpc_output_dataexists(device->srpc) == SUPLA_RESULT_TRUE ||
+         srpc_out_queue_item_count(device->srpc) > 0;
+}
+
+void ServerStandin::acceptConnections() {
+  for (;;) {
+    int fd = accept4(listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (fd < 0) {
+      return;
+    }
+    int noDelay = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+
+    Device *device = new Device;
+    memset(device, 0, sizeof(Device));
+    device->server = this;
+    device->fd = fd;
+    device->connectedUs = nowUs();
+
+    TsrpcParams params;
+    srpc_params_init(&params);
+    params.data_read = &ServerStandin::dataRead;
+    params.data_write = &ServerStandin::dataWrite;
+    params.on_remote_call_received = &ServerStandin::onRemoteCall;
+    params.user_params = device;
+    device->srpc = srpc_init(&params);
+
+    devices.push_back(device);
+  }
+}
+
+void ServerStandin::handleDevice(Device *device) {
+  for (int i = 0; i < SERVER_STANDIN_PACKETS_PER_ITERATE && !device->closed;
+       i++) {
+    if (srpc_iterate(device->srpc) == SUPLA_RESULT_FALSE) {
+      device->closed = true;
+      break;
+    }
+    if (srpc_input_packet_available(device->srpc) != SUPLA_RESULT_TRUE &&
+        !hasPendingOutput(device)) {
+      break;
+    }
+  }
+}
+
+void ServerStandin::removeClosedDevices() {
+  for (auto it = devices.begin(); it != devices.end();) {
+    Device *device = *it;
+    if (device->closed) {
+      supla_log(LOG_DEBUG, "Server: device \"%s\" disconnected", device->name);
+      srpc_free(device->srpc);
+      close(device->fd);
+      delete device;
+      it = devices.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+_supla_int_t ServerStandin::dataRead(void *buf,
+                                     _supla_int_t count,
+                                     void *userParams) {
+  Device *device = static_cast<Device *>(userParams);
+  ssize_t size = recv(device->fd, buf, count, 0);
+  if (size < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+    return -1;
+  }
+  if (size <= 0) {
+    device->closed = true;
+    return 0;
+  }
+  return size;
+}
+
+_supla_int_t ServerStandin::dataWrite(void *buf,
+                                      _supla_int_t count,
+                                      void *userParams) {
+  Device *device = static_cast<Device *>(userParams);
+  const char *data = static_cast<const char *>(buf);
+  _supla_int_t sent = 0;
+  // srpc drops whole buffer after write, so all data is sent here
+  while (sent < count && !device->closed) {
+    ssize_t size = send(device->fd, data + sent, count - sent, MSG_NOSIGNAL);
+    if (size > 0) {
+      sent += size;
+      continue;
+    }
+    struct pollfd pfd = {device->fd, POLLOUT, 0};
+    if ((size < 0 && errno != EAGAIN && errno != EWOULDBLOCK) ||
+        poll(&pfd, 1, SERVER_STANDIN_WRITE_TIMEOUT_MS) <= 0) {
+      device->closed = true;
+    }
+  }
+  return sent;
+}
+
+void ServerStandin::onRemoteCall(void *srpc,
+                                 unsigned _supla_int_t rrId,
+                                 unsigned _supla_int_t callType,
+                                 void *userParams,
+                                 unsigned char protoVersion) {
+  (void)(srpc);
+  (void)(rrId);
+  (void)(callType);
+  Device *device = static_cast<Device *>(userParams);
+  device->server->handleCall(device, protoVersion);
+}
+
+void ServerStandin::handleCall(Device *device, unsigned char protoVersion) {
+  TsrpcReceivedData rd;
+  if (srpc_getdata(device->srpc, &rd, 0) != SUPLA_RESULT_TRUE) {
+    return;
+  }
+
+  switch (rd.call_type) {
+    case SUPLA_DS_CALL_REGISTER_DEVICE_E: {
+      TDS_SuplaRegisterDevice_E *reg = rd.data.ds_register_device_e;
+      // answer with protocol version used by device
+      srpc_set_proto_version(device->srpc, protoVersion);
+      device->channelCount = reg->channel_count;
+      for (int i = 0; i < reg->channel_count; i++) {
+        if (reg->channels[i].Number < SUPLA_CHANNELMAXCOUNT) {
+          device->channelType[reg->channels[i].Number] = reg->channels[i].Type;
+        }
+      }
+      snprintf(device->name, sizeof(device->name), "%s", reg->Name);
+
+      TSD_SuplaRegisterDeviceResult result;
+      memset(&result, 0, sizeof(result));
+      result.result_code = SUPLA_RESULTCODE_TRUE;
+      result.activity_timeout = 120;
+      result.version = SUPLA_PROTO_VERSION;
+      result.version_min = SUPLA_PROTO_VERSION_MIN;
+      srpc_sd_async_registerdevice_result(device->srpc, &result);
+
+      device->registered = true;
+      registration.add(nowUs() - device->connectedUs);
+      supla_log(LOG_DEBUG,
+                "Server: registered device \"%s\" with %d channels",
+                device->name,
+                device->channelCount);
+      break;
+    }
+    case SUPLA_DS_CALL_DEVICE_CHANNEL_VALUE_CHANGED:
+    case SUPLA_DS_CALL_DEVICE_CHANNEL_VALUE_CHANGED_B:
+    case SUPLA_DS_CALL_DEVICE_CHANNEL_VALUE_CHANGED_C:
+      valueChangedCount++;
+      break;
+    case SUPLA_DS_CALL_CHANNEL_SET_VALUE_RESULT: {
+      TDS_SuplaChannelNewValueResult *result =
+          rd.data.ds_channel_new_value_result;
+      int channel = result->ChannelNumber;
+      if (channel < SUPLA_CHANNELMAXCOUNT &&
+          device->commandSentUs[channel] != 0) {
+        roundTrip.add(nowUs() - device->commandSentUs[channel]);
+        device->commandSentUs[channel] = 0;
+        commandResultCount++;
+        if (echoMode &&
+            (echoCommandLimit == 0 || commandCount < echoCommandLimit)) {
+          int index = static_cast<int>(
+              std::find(devices.begin(), devices.end(), device) -
+              devices.begin());
+          sendSetValue(index, channel, !device->commandValue[channel]);
+        }
+      }
+      break;
+    }
+    case SUPLA_DCS_CALL_PING_SERVER:
+      pingCount++;
+      srpc_sdc_async_ping_server_result(device->srpc);
+      break;
+    case SUPLA_DCS_CALL_SET_ACTIVITY_TIMEOUT: {
+      TSDC_SuplaSetActivityTimeoutResult result;
+      result.activity_timeout =
+          rd.data.dcs_set_activity_timeout->activity_timeout;
+      result.min = 10;
+      result.max = 240;
+      srpc_dcs_async_set_activity_timeout_result(device->srpc, &result);
+      break;
+    }
+    default:
+      break;
+  }
+
+  srpc_rd_free(&rd);
+}
+
+int ServerStandin::getConnectedCount() const {
+  return devices.size();
+}
+
+int ServerStandin::getRegisteredCount() const {
+  int count = 0;
+  for (auto device : devices) {
+    if (device->registered) {
+      count++;
+    }
+  }
+  return count;
+}
+
+ServerStandin::Device *ServerStandin::getDevice(int index) {
+  if (index < 0 || index >= static_cast<int>(devices.size())) {
+    return nullptr;
+  }
+  return devices[index];
+}
+
+bool ServerStandin::isRelay(int deviceIndex, int channel) {
+  Device *device = getDevice(deviceIndex);
+  return device != nullptr && channel >= 0 &&
+         channel < SUPLA_CHANNELMAXCOUNT &&
+         device->channelType[channel] == SUPLA_CHANNELTYPE_RELAY;
+}
+
+bool ServerStandin::sendSetValue(int deviceIndex, int channel, bool on) {
+  Device *device = getDevice(deviceIndex);
+  if (device == nullptr || !device->registered || channel < 0 ||
+      channel >= SUPLA_CHANNELMAXCOUNT) {
+    return false;
+  }
+
+  TSD_SuplaChannelNewValue value;
+  memset(&value, 0, sizeof(value));
+  value.SenderID = nextSenderId++;
+  value.ChannelNumber = channel;
+  value.value[0] = on ? 1 : 0;
+
+  device->commandSentUs[channel] = nowUs();
+  device->commandValue[channel] = value.value[0];
+  commandCount++;
+  return srpc_sd_async_set_channel_value(device->srpc, &value) > 0;
+}
+
+void ServerStandin::setEchoMode(bool enabled, uint64_t commandLimit) {
+  echoMode = enabled;
+  echoCommandLimit = commandLimit;
+}
+
+uint64_t ServerStandin::getValueChangedCount() const {
+  return valueChangedCount;
+}
+
+uint64_t ServerStandin::getCommandCount() const {
+  return commandCount;
+}
+
+uint64_t ServerStandin::getCommandResultCount() const {
+  return commandResultCount;
+}
+
+uint64_t ServerStandin::getPingCount() const {
+  return pingCount;
+}
@@ -0,0 +1,127 @@
+/*
+ Copyright (C) AC SOFTWARE SP. Z O.O.
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+*/
+
+
+#ifndef _server_standin_h
+#define _server_standin_h
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vector>
+
+#include <supla-common/proto.h>
+
+// Collects latency samples in microseconds
+class LatencyRecorder {
+ public:
+  void add(uint64_t us);
+  void clear();
+  size_t count() const;
+  // Returns sample at given percentile (0-100)
+  uint64_t percentile(double p) const;
+  uint64_t average() const;
+  void print(const char *name) const;
+
+ protected:
+  mutable std::vector<uint64_t> samples;
+  mutable bool sorted = true;
+};
+
+// Minimal Supla server for tests and benchmarks of devices. It listens on
+// unencrypted TCP port, registers every device which connects, answers pings
+// and activity timeout requests, and can send set value commands to relay
+// channels. In echo mode next command is sent to a channel as soon as the
+// device reports result of the previous one.
+class ServerStandin {
+ public:
+  struct Device {
+    ServerStandin *server;
+    int fd;
+    void *srpc;
+    bool closed;
+    bool registered;
+    uint64_t connectedUs;
+    int channelCount;
+    char name[SUPLA_DEVICE_NAME_MAXSIZE];
+    _supla_int_t channelType[SUPLA_CHANNELMAXCOUNT];
+    // time when command was sent to channel, 0 when there is no command
+    // waiting for result
+    uint64_t commandSentUs[SUPLA_CHANNELMAXCOUNT];
+    char commandValue[SUPLA_CHANNELMAXCOUNT];
+  };
+
+  ServerStandin();
+  ~ServerStandin();
+
+  // Starts listening on given port. Port 0 selects free port, which is
+  // returned by getPort().
+  bool begin(int port);
+  int getPort() const;
+
+  // Accepts new connections and handles all received packets. Waits up to
+  // timeoutMs for network activity.
+  void iterate(int timeoutMs);
+
+  int getConnectedCount() const;
+  int getRegisteredCount() const;
+  Device *getDevice(int index);
+
+  bool isRelay(int deviceIndex, int channel);
+  // Sends set value command to relay channel
+  bool sendSetValue(int deviceIndex, int channel, bool on);
+  void setEchoMode(bool enabled, uint64_t commandLimit = 0);
+
+  uint64_t getValueChangedCount() const;
+  uint64_t getCommandCount() const;
+  uint64_t getCommandResultCount() const;
+  uint64_t getPingCount() const;
+
+  // Time from TCP accept to registration result sent
+  LatencyRecorder registration;
+  // Time from set value command to device's result
+  LatencyRecorder roundTrip;
+
+  static uint64_t nowUs();
+
+ protected:
+  static _supla_int_t dataRead(void *buf, _supla_int_t count, void *device);
+  static _supla_int_t dataWrite(void *buf, _supla_int_t count, void *device);
+  static void onRemoteCall(void *srpc,
+                           unsigned _supla_int_t rrId,
+                           unsigned _supla_int_t callType,
+                           void *device,
+                           unsigned char protoVersion);
+
+  void acceptConnections();
+  void handleDevice(Device *device);
+  bool hasPendingOutput(Device *device);
+  void handleCall(Device *device, unsigned char protoVersion);
+  void removeClosedDevices();
+
+  int listenFd;
+  int port;
+  bool echoMode;
+  uint64_t echoCommandLimit;
+  _supla_int_t nextSenderId;
+  uint64_t valueChangedCount;
+  uint64_t commandCount;
+  uint64_t commandResultCount;
+  uint64_t pingCount;
+  std::vector<Device *> devices;
+};
+
+#endif
@@ -0,0 +1,222 @@
+/*
+ Copyright (C) AC SOFTWARE SP. Z O.O.
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+*/
+
+
+// End to end benchmark of device SRPC handling. Devices are started as
+// separate supla_linux_device processes (with the same SRPC configuration as
+// on ESP8266/ESP32) and connect to ServerStandin running in this process.
+// Measured:
+// - registration time: TCP accept -> registration result sent by server,
+// - set value round trip: command sent -> result received from device, with
+//   next command sent to the channel as soon as previous result is received,
+// - value update throughput: channel value changes received by server while
+//   relays are toggled, including updates which arrive after last command
+//   result (devices send them in bursts).
+//
+// Usage:
+//   srpc_server_benchmark [-d devices] [-r relays] [-n commands]
+//       [-w device_max_sleep_ms] [-b supla_linux_device_path]
+
+#include <getopt.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <spawn.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+
+#include "server_standin.h"
+
+extern char **environ;
+
+namespace {
+const uint64_t registrationTimeoutUs = 20000000;
+const uint64_t commandTimeoutUs = 60000000;
+// value updates are collected until none is received for this time
+const uint64_t valueUpdateQuietUs = 1000000;
+
+pid_t spawnDevice(const char *path,
+                  int index,
+                  int port,
+                  int relays,
+                  int maxSleepMs) {
+  char guid[SUPLA_GUID_SIZE * 2 + 1];
+  snprintf(guid, sizeof(guid), "5350424e%024x", index + 1);
+  std::string portArg = std::to_string(port);
+  std::string relaysArg = std::to_string(relays);
+  std::string sleepArg = std::to_string(maxSleepMs);
+
+  const char *args[] = {path,
+                        "-s", "127.0.0.1",
+                        "-p", portArg.c_str(),
+                        "-e", "benchmark@localhost",
+                        "-g", guid,
+                        "-a", "00112233445566778899aabbccddeeff",
+                        "-r", relaysArg.c_str(),
+                        "-t", "0",
+                        "-w", sleepArg.c_str(),
+                        "-n", "-q",
+                        nullptr};
+
+  posix_spawn_file_actions_t actions;
+  posix_spawn_file_actions_init(&actions);
+  posix_spawn_file_actions_addopen(
+      &actions, STDOUT_FILENO, "/dev/null", O_WRONLY, 0);
+
+  pid_t pid = -1;
+  if (posix_spawn(&pid, path, &actions, nullptr,
+                  const_cast<char **>(args), environ) != 0) {
+    pid = -1;
+  }
+  posix_spawn_file_actions_destroy(&actions);
+  return pid;
+}
+};  // namespace
+
+int main(int argc, char **argv) {
+  int deviceCount = 4;
+  int relayCount = 4;
+  int commandCount = 4000;
+  int maxSleepMs = 1;
+  const char *devicePath = SUPLA_LINUX_DEVICE_PATH;
+
+  int opt;
+  while ((opt = getopt(argc, argv, "d:r:n:w:b:")) != -1) {
+    switch (opt) {
+      case 'd':
+        deviceCount = atoi(optarg);
+        break;
+      case 'r':
+        relayCount = atoi(optarg);
+        break;
+      case 'n':
+        commandCount = atoi(optarg);
+        break;
+      case 'w':
+        maxSleepMs = atoi(optarg);
+        break;
+      case 'b':
+        devicePath = optarg;
+        break;
+      default:
+        fprintf(stderr,
+                "Usage: %s [-d devices] [-r relays] [-n commands]\n"
+                "          [-w device_max_sleep_ms] "
+                "[-b supla_linux_device_path]\n",
+                argv[0]);
+        return 1;
+    }
+  }
+  setenv("SUPLA_LINUX_QUIET", "1", 1);
+
+  ServerStandin server;
+  if (!server.begin(0)) {
+    return 1;
+  }
+
+  printf("devices: %d, relays per device: %d, commands: %d\n",
+         deviceCount, relayCount, commandCount);
+
+  // Registration
+  std::vector<pid_t> pids;
+  uint64_t start = ServerStandin::nowUs();
+  for (int i = 0; i < deviceCount; i++) {
+    pid_t pid = spawnDevice(
+        devicePath, i, server.getPort(), relayCount, maxSleepMs);
+    if (pid < 0) {
+      fprintf(stderr, "Can't start %s\n", devicePath);
+      break;
+    }
+    pids.push_back(pid);
+  }
+
+  int result = 0;
+  while (server.getRegisteredCount() < deviceCount &&
+         ServerStandin::nowUs() - start < registrationTimeoutUs) {
+    server.iterate(10);
+  }
+  uint64_t registrationTime = ServerStandin::nowUs() - start;
+  if (server.getRegisteredCount() < deviceCount) {
+    fprintf(stderr, "Only %d devices registered\n",
+            server.getRegisteredCount());
+    result = 1;
+  } else {
+    printf("all devices registered in %llu ms (including process start)\n",
+           static_cast<unsigned long long>(registrationTime / 1000));
+    server.registration.print("registration");
+
+    // Set value round trips
+    uint64_t valueChangedAtStart = server.getValueChangedCount();
+    server.setEchoMode(true, commandCount);
+    start = ServerStandin::nowUs();
+    for (int i = 0; i < server.getConnectedCount(); i++) {
+      for (int channel = 0; channel < SUPLA_CHANNELMAXCOUNT; channel++) {
+        if (server.isRelay(i, channel) &&
+            server.getCommandCount() < static_cast<uint64_t>(commandCount)) {
+          server.sendSetValue(i, channel, true);
+        }
+      }
+    }
+    while (server.getCommandResultCount() < server.getCommandCount() &&
+           ServerStandin::nowUs() - start < commandTimeoutUs) {
+      server.iterate(10);
+    }
+    double seconds = (ServerStandin::nowUs() - start) / 1000000.0;
+
+    server.roundTrip.print("set value round trip");
+    printf("commands: %llu in %.2f s (%.0f/s)\n",
+           static_cast<unsigned long long>(server.getCommandResultCount()),
+           seconds,
+           server.getCommandResultCount() / seconds);
+
+    // Value updates
+    uint64_t valueChanged = server.getValueChangedCount();
+    uint64_t lastValueChangeUs = ServerStandin::nowUs();
+    while (ServerStandin::nowUs() - lastValueChangeUs < valueUpdateQuietUs &&
+           ServerStandin::nowUs() - start < commandTimeoutUs) {
+      server.iterate(10);
+      if (server.getValueChangedCount() != valueChanged) {
+        valueChanged = server.getValueChangedCount();
+        lastValueChangeUs = ServerStandin::nowUs();
+      }
+    }
+    valueChanged -= valueChangedAtStart;
+    seconds = (lastValueChangeUs - start) / 1000000.0;
+    printf("value updates: %llu in %.2f s (%.0f/s)\n",
+           static_cast<unsigned long long>(valueChanged),
+           seconds,
+           valueChanged / seconds);
+    if (server.getCommandResultCount() < server.getCommandCount()) {
+      fprintf(stderr, "Missing results for %llu commands\n",
+              static_cast<unsigned long long>(server.getCommandCount() -
+                                              server.getCommandResultCount()));
+      result = 1;
+    }
+  }
+
+  for (auto pid : pids) {
+    kill(pid, SIGTERM);
+  }
+  for (auto pid : pids) {
+    waitpid(pid, nullptr, 0);
+  }
+  return result;
+}
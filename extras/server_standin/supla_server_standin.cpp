@@ -0,0 +1,95 @@
+/*
+ Copyright (C) AC SOFTWARE SP. Z O.O.
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+*/
+
+
+// Standalone server stand-in. Usage:
+//   supla_server_standin [-p port] [-c command_interval_ms] [-v]
+// With -c all relays of registered devices are toggled periodically. -v
+// enables debug logs.
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "server_standin.h"
+
+int main(int argc, char **argv) {
+  int port = 2015;
+  int commandIntervalMs = 0;
+  bool verbose = false;
+
+  int opt;
+  while ((opt = getopt(argc, argv, "p:c:v")) != -1) {
+    switch (opt) {
+      case 'p':
+        port = atoi(optarg);
+        break;
+      case 'c':
+        commandIntervalMs = atoi(optarg);
+        break;
+      case 'v':
+        verbose = true;
+        break;
+      default:
+        fprintf(stderr,
+                "Usage: %s [-p port] [-c command_interval_ms] [-v]\n",
+                argv[0]);
+        return 1;
+    }
+  }
+  setvbuf(stdout, nullptr, _IOLBF, 0);
+  if (!verbose) {
+    setenv("SUPLA_LINUX_QUIET", "1", 1);
+  }
+
+  ServerStandin server;
+  if (!server.begin(port)) {
+    return 1;
+  }
+
+  uint64_t lastCommandUs = ServerStandin::nowUs();
+  uint64_t lastStatsUs = lastCommandUs;
+  bool relayState = false;
+
+  for (;;) {
+    server.iterate(10);
+    uint64_t now = ServerStandin::nowUs();
+
+    if (commandIntervalMs > 0 &&
+        now - lastCommandUs >= commandIntervalMs * 1000ULL) {
+      lastCommandUs = now;
+      relayState = !relayState;
+      for (int i = 0; i < server.getConnectedCount(); i++) {
+        for (int channel = 0; channel < SUPLA_CHANNELMAXCOUNT; channel++) {
+          if (server.isRelay(i, channel)) {
+            server.sendSetValue(i, channel, relayState);
+          }
+        }
+      }
+    }
+
+    if (now - lastStatsUs >= 10000000) {
+      lastStatsUs = now;
+      printf("devices: %d registered: %d value updates: %llu pings: %llu\n",
+             server.getConnectedCount(),
+             server.getRegisteredCount(),
+             static_cast<unsigned long long>(server.getValueChangedCount()),
+             static_cast<unsigned long long>(server.getPingCount()));
+      server.registration.print("registration");
+      server.roundTrip.print("set value round trip");
+    }
+  }
+}
@@ -30,7 +30,7 @@ class ActionHandlerMock : public Supla::ActionHandler {
 
 
 TEST(ChannelElementTests, ActionDelegationToChannel) {
-  ASSERT_EQ(Supla::LocalAction::getClientListPtr(), nullptr);
+  ASSERT_EQ(Supla::LocalAction::getClientCount(), 0);
   Supla::ChannelElement element;
 
   ActionHandlerMock mock1;
@@ -55,7 +55,7 @@ TEST(ChannelElementTests, ActionDelegationToChannel) {
 }
 
 TEST(ChannelElementTests, ActionDelegationToConditions) {
-  ASSERT_EQ(Supla::LocalAction::getClientListPtr(), nullptr);
+  ASSERT_EQ(Supla::LocalAction::getClientCount(), 0);
 
   ActionHandlerMock mock1;
   ActionHandlerMock mock2;
@@ -17,12 +17,15 @@
 #include <gtest/gtest.h>
 
 #include <supla/channel.h>
+#include <supla/channel_extended.h>
 #include <gmock/gmock.h>
 #include <srpc_mock.h>
 #include <supla/events.h>
 #include <supla/actions.h>
 #include <supla/correction.h>
 
+#include <thread>
+
 
 class ActionHandlerMock : public Supla::ActionHandler {
  public:
@@ -295,6 +298,131 @@ TEST(ChannelTests, SendUpdateTest) {
   EXPECT_FALSE(channel.isUpdateReady());
 }
 
+TEST(ChannelTests, SendPendingUpdatesRoundRobin) {
+  Supla::Channel ch0;
+  Supla::Channel ch1;
+  Supla::Channel ch2;
+  Supla::Channel ch3;
+  SrpcMock srpc;
+
+  EXPECT_EQ(Supla::Channel::getChannelByNumber(2), &ch2);
+  EXPECT_EQ(Supla::Channel::getChannelByNumber(4), nullptr);
+  EXPECT_EQ(Supla::Channel::getChannelByNumber(-1), nullptr);
+
+  EXPECT_EQ(Supla::Channel::sendPendingUpdates(nullptr, 8), 0);
+
+  ch0.setNewValue(true);
+  ch1.setNewValue(true);
+  ch3.setNewValue(true);
+
+  {
+    ::testing::InSequence seq;
+    EXPECT_CALL(srpc, valueChanged(nullptr, 0, _, 0, 0));
+    EXPECT_CALL(srpc, valueChanged(nullptr, 1, _, 0, 0));
+    // next call starts after channel 1
+    EXPECT_CALL(srpc, valueChanged(nullptr, 3, _, 0, 0));
+    EXPECT_CALL(srpc, valueChanged(nullptr, 1, _, 0, 0));
+    // next call starts after channel 1, so channel 2 is sent before 0
+    EXPECT_CALL(srpc, valueChanged(nullptr, 2, _, 0, 0));
+    EXPECT_CALL(srpc, valueChanged(nullptr, 0, _, 0, 0));
+  }
+
+  // budget limits number of sent messages
+  EXPECT_EQ(Supla::Channel::sendPendingUpdates(nullptr, 2), 2);
+  EXPECT_FALSE(ch1.isUpdateReady());
+  EXPECT_TRUE(ch3.isUpdateReady());
+
+  ch1.setNewValue(false);
+  EXPECT_EQ(Supla::Channel::sendPendingUpdates(nullptr, 8), 2);
+
+  ch0.setNewValue(false);
+  ch2.setNewValue(true);
+  EXPECT_EQ(Supla::Channel::sendPendingUpdates(nullptr, 8), 2);
+  EXPECT_EQ(Supla::Channel::sendPendingUpdates(nullptr, 8), 0);
+}
+
+TEST(ChannelTests, ExtendedChannelDoesNotExceedBudget) {
+  Supla::Channel ch0;
+  Supla::ChannelExtended ch1;
+  SrpcMock srpc;
+
+  EXPECT_CALL(srpc, valueChanged(nullptr, 0, _, 0, 0)).Times(1);
+  EXPECT_CALL(srpc, valueChanged(nullptr, 1, _, 0, 0)).Times(2);
+
+  // nothing was sent yet, so extended channel is sent with budget set to 1
+  ch1.setNewValue(true);
+  EXPECT_EQ(Supla::Channel::sendPendingUpdates(nullptr, 1), 2);
+  EXPECT_FALSE(ch1.isUpdateReady());
+
+  // extended channel needs two messages, so it waits for next burst
+  ch0.setNewValue(true);
+  ch1.setNewValue(false);
+  EXPECT_EQ(Supla::Channel::sendPendingUpdates(nullptr, 2), 1);
+  EXPECT_TRUE(ch1.isUpdateReady());
+  EXPECT_EQ(Supla::Channel::sendPendingUpdates(nullptr, 2), 2);
+  EXPECT_FALSE(ch1.isUpdateReady());
+}
+
+TEST(ChannelTests, DirtyChannelsBitmap) {
+  Supla::Channel channels[40];
+  SrpcMock srpc;
+
+  EXPECT_FALSE(Supla::Channel::hasPendingUpdates());
+
+  channels[39].setNewValue(true);
+  channels[5].setNewValue(true);
+  channels[33].setNewValue(true);
+  EXPECT_TRUE(Supla::Channel::hasPendingUpdates());
+
+  // clearing update flag removes channel from bitmap
+  channels[33].clearUpdateReady();
+
+  {
+    ::testing::InSequence seq;
+    EXPECT_CALL(srpc, valueChanged(nullptr, 5, _, 0, 0));
+    EXPECT_CALL(srpc, valueChanged(nullptr, 39, _, 0, 0));
+    // wraps around to the beginning of the bitmap
+    EXPECT_CALL(srpc, valueChanged(nullptr, 31, _, 0, 0));
+    EXPECT_CALL(srpc, valueChanged(nullptr, 32, _, 0, 0));
+  }
+
+  EXPECT_EQ(Supla::Channel::sendPendingUpdates(nullptr, 8), 2);
+  EXPECT_FALSE(Supla::Channel::hasPendingUpdates());
+
+  channels[32].setNewValue(true);
+  channels[31].setNewValue(true);
+  EXPECT_EQ(Supla::Channel::sendPendingUpdates(nullptr, 8), 2);
+  EXPECT_FALSE(Supla::Channel::hasPendingUpdates());
+}
+
+class TimerUpdatedChannel : public Supla::Channel {
+ public:
+  using Supla::Channel::setUpdateReady;
+};
+
+TEST(ChannelTests, DirtyBitsOfOneWordAreUpdatedConcurrently) {
+  TimerUpdatedChannel ch0;
+  TimerUpdatedChannel ch1;
+  SrpcMock srpc;
+
+  // ch1 is updated from "timer" thread, while loop updates ch0 bit in the
+  // same bitmap word
+  auto toggle = [](TimerUpdatedChannel *channel) {
+    for (int i = 0; i < 100000; i++) {
+      channel->setUpdateReady();
+      channel->clearUpdateReady();
+    }
+    channel->setUpdateReady();
+  };
+  std::thread timer(toggle, &ch1);
+  toggle(&ch0);
+  timer.join();
+
+  EXPECT_CALL(srpc, valueChanged(nullptr, _, _, 0, 0)).Times(2);
+  EXPECT_EQ(Supla::Channel::sendPendingUpdates(nullptr, 8), 2);
+  EXPECT_FALSE(Supla::Channel::hasPendingUpdates());
+}
+
 TEST(ChannelTests, BoolChannelWithLocalActions) {
   Supla::Channel ch1;
 
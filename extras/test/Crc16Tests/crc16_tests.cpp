@@ -0,0 +1,42 @@
+/*
+ Copyright (C) AC SOFTWARE SP. Z O.O.
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+*/
+
+#include <gtest/gtest.h>
+
+#include <supla/crc16.h>
+
+TEST(Crc16Tests, CheckValue) {
+  const char data[] = "123456789";
+  EXPECT_EQ(crc16_update_block(0xFFFF, data, 9), 0x4B37);
+}
+
+TEST(Crc16Tests, BlockMatchesBitwiseUpdate) {
+  unsigned char data[300];
+  for (unsigned int i = 0; i < sizeof(data); i++) {
+    data[i] = i * 37 + 11;
+  }
+
+  uint16_t crc = 0xFFFF;
+  for (unsigned int i = 0; i < sizeof(data); i++) {
+    crc = crc16_update(crc, data[i]);
+  }
+  EXPECT_EQ(crc16_update_block(0xFFFF, data, sizeof(data)), crc);
+
+  // calculation split into parts gives the same result
+  uint16_t split = crc16_update_block(0xFFFF, data, 100);
+  split = crc16_update_block(split, data + 100, sizeof(data) - 100);
+  EXPECT_EQ(split, crc);
+}
@@ -0,0 +1,247 @@
+/*
+ Copyright (C) AC SOFTWARE SP. Z O.O.
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+*/
+
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <string.h>
+
+#include <SuplaDevice.h>
+#include <supla/channel.h>
+#include <supla/device_context.h>
+#include <supla/element.h>
+#include <supla/event_queue.h>
+#include <supla/io.h>
+#include <supla/local_action.h>
+#include <srpc_mock.h>
+#include <timer_mock.h>
+
+class ActionHandlerMock : public Supla::ActionHandler {
+ public:
+  MOCK_METHOD(void, handleAction, (int, int), (override));
+};
+
+class ElementWithChannel : public Supla::Element {
+ public:
+  Supla::Channel *getChannel() override {
+    return &channel;
+  }
+  Supla::Channel channel;
+};
+
+class TimerElement : public Supla::Element {
+ public:
+  TimerElement() {
+    declareHook(Supla::HOOK_ON_TIMER);
+    declareHook(Supla::HOOK_ON_FAST_TIMER);
+  }
+  void onTimer() override {
+    timerCalls++;
+  }
+  void onFastTimer() override {
+    fastTimerCalls++;
+  }
+  int timerCalls = 0;
+  int fastTimerCalls = 0;
+};
+
+class DeviceContextTests : public ::testing::Test {
+ protected:
+  virtual void SetUp() {
+    memset(&(Supla::Channel::reg_dev), 0, sizeof(Supla::Channel::reg_dev));
+  }
+  virtual void TearDown() {
+    Supla::DeviceContext::setCurrent(nullptr);
+    memset(&(Supla::Channel::reg_dev), 0, sizeof(Supla::Channel::reg_dev));
+  }
+};
+
+TEST_F(DeviceContextTests, DefaultContextIsCurrent) {
+  auto defaultContext = Supla::DeviceContext::defaultContext();
+  EXPECT_EQ(Supla::DeviceContext::current(), defaultContext);
+  EXPECT_EQ(&(Supla::Channel::reg_dev), &(defaultContext->regDev));
+
+  Supla::DeviceContext context;
+  {
+    Supla::DeviceContext::Scope scope(&context);
+    EXPECT_EQ(Supla::DeviceContext::current(), &context);
+    {
+      Supla::DeviceContext::Scope nested(nullptr);
+      EXPECT_EQ(Supla::DeviceContext::current(), defaultContext);
+    }
+    EXPECT_EQ(Supla::DeviceContext::current(), &context);
+  }
+  EXPECT_EQ(Supla::DeviceContext::current(), defaultContext);
+
+  Supla::DeviceContext::setCurrent(&context);
+  EXPECT_EQ(Supla::DeviceContext::current(), &context);
+  Supla::DeviceContext::setCurrent(nullptr);
+  EXPECT_EQ(Supla::DeviceContext::current(), defaultContext);
+}
+
+TEST_F(DeviceContextTests, ElementsAndChannelsAreSeparated) {
+  Supla::DeviceContext context1;
+  Supla::DeviceContext context2;
+
+  ElementWithChannel defaultElement;
+  Supla::DeviceContext::setCurrent(&context1);
+  ElementWithChannel element1a;
+  ElementWithChannel element1b;
+  Supla::DeviceContext::setCurrent(&context2);
+  ElementWithChannel element2;
+  Supla::DeviceContext::setCurrent(nullptr);
+
+  EXPECT_EQ(defaultElement.getChannelNumber(), 0);
+  EXPECT_EQ(element1a.getChannelNumber(), 0);
+  EXPECT_EQ(element1b.getChannelNumber(), 1);
+  EXPECT_EQ(element2.getChannelNumber(), 0);
+  EXPECT_EQ(Supla::Channel::reg_dev.channel_count, 1);
+  EXPECT_EQ(context1.regDev.channel_count, 2);
+  EXPECT_EQ(context2.regDev.channel_count, 1);
+
+  EXPECT_EQ(Supla::Element::begin(), &defaultElement);
+  EXPECT_EQ(Supla::Element::begin()->next(), nullptr);
+  EXPECT_EQ(Supla::Channel::getChannelByNumber(0), &defaultElement.channel);
+
+  {
+    Supla::DeviceContext::Scope scope(&context1);
+    EXPECT_EQ(Supla::Element::begin(), &element1a);
+    EXPECT_EQ(Supla::Element::last(), &element1b);
+    EXPECT_EQ(Supla::Element::getElementByChannelNumber(1), &element1b);
+    EXPECT_EQ(Supla::Channel::getChannelByNumber(0), &element1a.channel);
+  }
+  {
+    Supla::DeviceContext::Scope scope(&context2);
+    EXPECT_EQ(Supla::Element::begin(), &element2);
+    EXPECT_EQ(Supla::Element::getElementByChannelNumber(1), nullptr);
+  }
+
+  // value change is tracked in context of channel
+  element1b.channel.setNewValue(true);
+  EXPECT_FALSE(Supla::Channel::hasPendingUpdates());
+  EXPECT_EQ(context1.regDev.channels[1].value[0], 1);
+  {
+    Supla::DeviceContext::Scope scope(&context1);
+    EXPECT_TRUE(Supla::Channel::hasPendingUpdates());
+  }
+}
+
+TEST_F(DeviceContextTests, ElementRemovedFromItsContext) {
+  Supla::DeviceContext context;
+  Supla::DeviceContext::setCurrent(&context);
+  auto element1 = new Supla::Element;
+  Supla::Element element2;
+  Supla::DeviceContext::setCurrent(nullptr);
+
+  // destructor doesn't depend on current context
+  delete element1;
+  EXPECT_EQ(context.firstElement, &element2);
+  EXPECT_EQ(context.lastElement, &element2);
+  EXPECT_EQ(Supla::Element::begin(), nullptr);
+}
+
+TEST_F(DeviceContextTests, IoAndEventQueueArePerContext) {
+  Supla::DeviceContext context;
+  Supla::Io defaultIo;
+  Supla::Io *contextIo = nullptr;
+  {
+    Supla::DeviceContext::Scope scope(&context);
+    contextIo = new Supla::Io;
+    EXPECT_EQ(Supla::Io::Instance(), contextIo);
+  }
+  EXPECT_EQ(Supla::Io::Instance(), &defaultIo);
+  delete contextIo;
+  EXPECT_EQ(context.io, nullptr);
+  EXPECT_EQ(Supla::Io::Instance(), &defaultIo);
+
+  Supla::LocalAction trigger;
+  ActionHandlerMock mock;
+  trigger.addAction(1, mock, 2);
+  {
+    Supla::DeviceContext::Scope scope(&context);
+    EXPECT_TRUE(Supla::EventQueue::post(&trigger, 2));
+    EXPECT_FALSE(Supla::EventQueue::isEmpty());
+  }
+  EXPECT_TRUE(Supla::EventQueue::isEmpty());
+
+  EXPECT_CALL(mock, handleAction(2, 1));
+  {
+    Supla::DeviceContext::Scope scope(&context);
+    Supla::EventQueue::dispatch();
+    EXPECT_TRUE(Supla::EventQueue::isEmpty());
+  }
+}
+
+TEST_F(DeviceContextTests, SuplaDeviceUsesItsContext) {
+  Supla::DeviceContext context;
+  SuplaDeviceClass device(&context);
+  SuplaDeviceClass defaultDevice;
+
+  EXPECT_EQ(device.getContext(), &context);
+  EXPECT_EQ(defaultDevice.getContext(),
+            Supla::DeviceContext::defaultContext());
+
+  device.setName("Second device");
+  device.setServer("second.supla.org");
+  EXPECT_STREQ(context.regDev.Name, "Second device");
+  EXPECT_STREQ(context.regDev.ServerName, "second.supla.org");
+  EXPECT_EQ(Supla::Channel::reg_dev.Name[0], '\0');
+  EXPECT_EQ(Supla::Channel::reg_dev.ServerName[0], '\0');
+}
+
+TEST_F(DeviceContextTests, TimersDriveEachStartedDevice) {
+  ::testing::NiceMock<TimerMock> timer;
+  ::testing::NiceMock<SrpcMock> srpc;
+  Supla::DeviceContext context1;
+  Supla::DeviceContext context2;
+  Supla::DeviceContext context3;
+  Supla::DeviceContext::setCurrent(&context1);
+  TimerElement element1;
+  Supla::DeviceContext::setCurrent(&context2);
+  TimerElement element2;
+  Supla::DeviceContext::setCurrent(nullptr);
+
+  SuplaDeviceClass device1(&context1);
+  SuplaDeviceClass device2(&context2);
+  EXPECT_FALSE(SuplaDeviceClass::IsTimerHookUsed(Supla::HOOK_ON_TIMER));
+
+  // timers are initialized again by each begin(), for all started devices
+  EXPECT_CALL(timer, initTimers()).Times(3);
+  device1.begin();
+  EXPECT_TRUE(SuplaDeviceClass::IsTimerHookUsed(Supla::HOOK_ON_TIMER));
+  SuplaDeviceClass::OnTimer();
+  EXPECT_EQ(element1.timerCalls, 1);
+  EXPECT_EQ(element2.timerCalls, 0);
+
+  device2.begin();
+  SuplaDeviceClass::OnTimer();
+  SuplaDeviceClass::OnFastTimer();
+  EXPECT_EQ(element1.timerCalls, 2);
+  EXPECT_EQ(element2.timerCalls, 1);
+  EXPECT_EQ(element1.fastTimerCalls, 1);
+  EXPECT_EQ(element2.fastTimerCalls, 1);
+
+  {
+    // destroyed device is not driven by timers
+    SuplaDeviceClass device3(&context3);
+    device3.begin();
+  }
+  SuplaDeviceClass::OnTimer();
+  EXPECT_EQ(element1.timerCalls, 3);
+  EXPECT_EQ(element2.timerCalls, 2);
+  EXPECT_EQ(Supla::DeviceContext::current(),
+            Supla::DeviceContext::defaultContext());
+}
@@ -194,3 +194,142 @@ TEST_F(ElementTests, ChannelElementMethods) {
 
 
 
+
+TEST_F(ElementTests, ChannelIndexLookup) {
+  ElementWithChannel el0;
+  Supla::Element noChannel;
+  ElementWithChannel el1;
+
+  EXPECT_EQ(Supla::Element::last(), &el1);
+
+  Supla::Element::buildChannelIndex();
+  EXPECT_EQ(Supla::Element::getElementByChannelNumber(0), &el0);
+  EXPECT_EQ(Supla::Element::getElementByChannelNumber(1), &el1);
+  EXPECT_EQ(Supla::Element::getElementByChannelNumber(2), nullptr);
+  EXPECT_EQ(Supla::Element::getElementByChannelNumber(-1), &noChannel);
+
+  // Adding new element invalidates index, so lookup still finds it
+  auto el2 = new ElementWithChannel;
+  EXPECT_EQ(Supla::Element::getElementByChannelNumber(2), el2);
+  Supla::Element::buildChannelIndex();
+  EXPECT_EQ(Supla::Element::getElementByChannelNumber(2), el2);
+
+  delete el2;
+  EXPECT_EQ(Supla::Element::getElementByChannelNumber(2), nullptr);
+  EXPECT_EQ(Supla::Element::last(), &el1);
+}
+
+class ElementWithFastTimer : public Supla::Element {
+  public:
+    ElementWithFastTimer() {
+      declareHook(Supla::HOOK_ON_FAST_TIMER);
+    }
+};
+
+class ElementWithTimers : public Supla::Element {
+  public:
+    ElementWithTimers() {
+      declareHook(Supla::HOOK_ON_TIMER);
+      declareHook(Supla::HOOK_ON_FAST_TIMER);
+    }
+};
+
+TEST_F(ElementTests, HookLists) {
+  Supla::Element el0;
+  ElementWithFastTimer el1;
+  auto el2 = new ElementWithTimers;
+
+  EXPECT_TRUE(el0.isHookDeclared(Supla::HOOK_ON_SAVE_STATE));
+  EXPECT_FALSE(el1.isHookDeclared(Supla::HOOK_ON_TIMER));
+  EXPECT_TRUE(el1.isHookDeclared(Supla::HOOK_ON_FAST_TIMER));
+
+  Supla::Element::buildHookLists();
+
+  // element without declared hooks is on all lists
+  EXPECT_EQ(Supla::Element::begin(Supla::HOOK_ITERATE_ALWAYS), &el0);
+  EXPECT_EQ(el0.next(Supla::HOOK_ITERATE_ALWAYS), nullptr);
+  EXPECT_EQ(Supla::Element::begin(Supla::HOOK_ON_SAVE_STATE), &el0);
+  EXPECT_EQ(el0.next(Supla::HOOK_ON_SAVE_STATE), nullptr);
+
+  EXPECT_EQ(Supla::Element::begin(Supla::HOOK_ON_TIMER), &el0);
+  EXPECT_EQ(el0.next(Supla::HOOK_ON_TIMER), el2);
+  EXPECT_EQ(el2->next(Supla::HOOK_ON_TIMER), nullptr);
+
+  EXPECT_EQ(Supla::Element::begin(Supla::HOOK_ON_FAST_TIMER), &el0);
+  EXPECT_EQ(el0.next(Supla::HOOK_ON_FAST_TIMER), &el1);
+  EXPECT_EQ(el1.next(Supla::HOOK_ON_FAST_TIMER), el2);
+  EXPECT_EQ(el2->next(Supla::HOOK_ON_FAST_TIMER), nullptr);
+
+  delete el2;
+  EXPECT_EQ(el0.next(Supla::HOOK_ON_TIMER), nullptr);
+  EXPECT_EQ(el1.next(Supla::HOOK_ON_FAST_TIMER), nullptr);
+}
+
+class LibrarySensor : public Supla::Element {
+  public:
+    LibrarySensor() {
+      declareHook(Supla::HOOK_NONE);
+    }
+};
+
+class SketchSensor : public LibrarySensor {
+  public:
+    void iterateAlways() override {
+    }
+};
+
+TEST_F(ElementTests, OverriddenHookOfSubclassIsCalled) {
+  LibrarySensor el0;
+  SketchSensor el1;
+
+  EXPECT_FALSE(el1.isHookDeclared(Supla::HOOK_ITERATE_ALWAYS));
+  EXPECT_TRUE(el1.isHookOverridden(Supla::HOOK_ITERATE_ALWAYS));
+  EXPECT_FALSE(el1.isHookOverridden(Supla::HOOK_ON_TIMER));
+
+  Supla::Element::buildHookLists();
+  EXPECT_EQ(Supla::Element::begin(Supla::HOOK_ITERATE_ALWAYS), &el1);
+  EXPECT_EQ(el1.next(Supla::HOOK_ITERATE_ALWAYS), nullptr);
+  EXPECT_EQ(Supla::Element::begin(Supla::HOOK_ON_TIMER), nullptr);
+}
+
+TEST_F(ElementTests, ElementCreatedAfterBuildIsAddedToHookLists) {
+  ElementWithFastTimer el0;
+  Supla::Element::buildHookLists();
+
+  ElementWithTimers el1;
+  EXPECT_EQ(el0.next(Supla::HOOK_ON_FAST_TIMER), nullptr);
+
+  Supla::Element::updateHookLists();
+  EXPECT_EQ(Supla::Element::begin(Supla::HOOK_ON_FAST_TIMER), &el0);
+  EXPECT_EQ(el0.next(Supla::HOOK_ON_FAST_TIMER), &el1);
+  EXPECT_EQ(Supla::Element::begin(Supla::HOOK_ON_TIMER), &el1);
+  EXPECT_EQ(el1.next(Supla::HOOK_ON_TIMER), nullptr);
+
+  // element already on lists isn't added again
+  Supla::Element::updateHookLists();
+  EXPECT_EQ(el1.next(Supla::HOOK_ON_FAST_TIMER), nullptr);
+}
+
+class TrackedElement : public Supla::Element {
+  public:
+    TrackedElement() {
+      enableStateChangeTracking();
+    }
+    void onSaveState() override {
+    }
+};
+
+class SketchTrackedElement : public TrackedElement {
+  public:
+    void onSaveState() override {
+      TrackedElement::onSaveState();
+    }
+};
+
+TEST_F(ElementTests, StateTrackingIsDisabledForOverriddenSaveState) {
+  TrackedElement el0;
+  SketchTrackedElement el1;
+
+  EXPECT_TRUE(el0.isStateChangeTracked());
+  EXPECT_FALSE(el1.isStateChangeTracked());
+}
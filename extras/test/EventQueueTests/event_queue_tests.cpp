@@ -0,0 +1,145 @@
+/*
+ Copyright (C) AC SOFTWARE SP. Z O.O.
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+*/
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <supla/local_action.h>
+#include <supla/event_queue.h>
+
+#include <thread>
+
+using ::testing::_;
+
+class ActionHandlerMock : public Supla::ActionHandler {
+ public:
+  MOCK_METHOD(void, handleAction, (int, int), (override));
+};
+
+class EventQueueTests : public ::testing::Test {
+  protected:
+    virtual void SetUp() {
+      Supla::EventQueue::clear();
+    }
+    virtual void TearDown() {
+      Supla::EventQueue::leaveTimerContext();
+      Supla::EventQueue::clear();
+    }
+};
+
+TEST_F(EventQueueTests, ActionsFromTimerAreDeferred) {
+  Supla::LocalAction trigger;
+  ActionHandlerMock mock;
+
+  trigger.addAction(1, mock, 2);
+  trigger.addAction(3, mock, 4);
+
+  Supla::EventQueue::enterTimerContext();
+  EXPECT_TRUE(Supla::EventQueue::isTimerContext());
+  trigger.runAction(2);
+  trigger.runAction(4);
+  // event without clients is not queued
+  trigger.runAction(5);
+  Supla::EventQueue::leaveTimerContext();
+  EXPECT_FALSE(Supla::EventQueue::isTimerContext());
+  EXPECT_FALSE(Supla::EventQueue::isEmpty());
+
+  ::testing::Mock::VerifyAndClearExpectations(&mock);
+
+  {
+    ::testing::InSequence seq;
+    EXPECT_CALL(mock, handleAction(2, 1));
+    EXPECT_CALL(mock, handleAction(4, 3));
+  }
+
+  Supla::EventQueue::dispatch();
+  EXPECT_TRUE(Supla::EventQueue::isEmpty());
+}
+
+TEST_F(EventQueueTests, ImmediateDispatchFromTimer) {
+  Supla::LocalAction trigger;
+  ActionHandlerMock mock;
+
+  trigger.addAction(1, mock, 2);
+  trigger.setImmediateDispatch(true);
+
+  EXPECT_CALL(mock, handleAction(2, 1));
+
+  Supla::EventQueue::enterTimerContext();
+  trigger.runAction(2);
+  Supla::EventQueue::leaveTimerContext();
+
+  EXPECT_TRUE(Supla::EventQueue::isEmpty());
+}
+
+TEST_F(EventQueueTests, FullQueueDropsEventsFromTimer) {
+  Supla::LocalAction trigger;
+  ActionHandlerMock mock;
+
+  trigger.addAction(1, mock, 2);
+  uint16_t overflowCount = Supla::EventQueue::getOverflowCount();
+
+  // handlers are never called from timer context, even when queue is full
+  EXPECT_CALL(mock, handleAction(_, _)).Times(0);
+  Supla::EventQueue::enterTimerContext();
+  for (int i = 0; i < SUPLA_EVENT_QUEUE_SIZE + 2; i++) {
+    trigger.runAction(2);
+  }
+  Supla::EventQueue::leaveTimerContext();
+  ::testing::Mock::VerifyAndClearExpectations(&mock);
+  EXPECT_EQ(Supla::EventQueue::getOverflowCount(), overflowCount + 2);
+
+  EXPECT_CALL(mock, handleAction(2, 1)).Times(SUPLA_EVENT_QUEUE_SIZE);
+  Supla::EventQueue::dispatch();
+  EXPECT_TRUE(Supla::EventQueue::isEmpty());
+}
+
+TEST_F(EventQueueTests, DestroyedTriggerIsRemovedFromQueue) {
+  Supla::LocalAction trigger;
+  ActionHandlerMock mock;
+  trigger.addAction(1, mock, 2);
+
+  Supla::EventQueue::enterTimerContext();
+  {
+    Supla::LocalAction removed;
+    removed.addAction(3, mock, 4);
+    removed.runAction(4);
+    trigger.runAction(2);
+    removed.runAction(4);
+  }
+  Supla::EventQueue::leaveTimerContext();
+
+  EXPECT_CALL(mock, handleAction(2, 1)).Times(1);
+  Supla::EventQueue::dispatch();
+  EXPECT_TRUE(Supla::EventQueue::isEmpty());
+}
+
+TEST_F(EventQueueTests, TimerContextIsPerThread) {
+  Supla::LocalAction trigger;
+  ActionHandlerMock mock;
+  trigger.addAction(1, mock, 2);
+
+  Supla::EventQueue::enterTimerContext();
+  // action run by other thread (i.e. loop() while timer thread is in
+  // onTimer()) is executed immediately
+  EXPECT_CALL(mock, handleAction(2, 1)).Times(1);
+  std::thread loop([&trigger]() {
+    EXPECT_FALSE(Supla::EventQueue::isTimerContext());
+    trigger.runAction(2);
+  });
+  loop.join();
+  Supla::EventQueue::leaveTimerContext();
+  EXPECT_TRUE(Supla::EventQueue::isEmpty());
+}
@@ -0,0 +1,81 @@
+/*
+ Copyright (C) AC SOFTWARE SP. Z O.O.
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+*/
+
+
+#include <gtest/gtest.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <supla/storage/file_storage.h>
+
+class FileStorageTests : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    snprintf(path, sizeof(path), "/tmp/supla_file_storage_XXXXXX");
+    int fd = mkstemp(path);
+    ASSERT_GE(fd, 0);
+    close(fd);
+  }
+
+  void TearDown() override {
+    unlink(path);
+  }
+
+  char path[64];
+};
+
+TEST_F(FileStorageTests, StateIsKeptBetweenInstances) {
+  unsigned char state[] = {1, 2, 3, 4, 5, 6, 7};
+
+  {
+    Supla::FileStorage storage(path);
+    ASSERT_TRUE(storage.init());
+    Supla::Storage::PrepareState();
+    EXPECT_TRUE(Supla::Storage::WriteState(state, sizeof(state)));
+    Supla::Storage::FinalizeSaveState();
+    storage.commit();
+  }
+
+  Supla::FileStorage storage(path);
+  ASSERT_TRUE(storage.init());
+
+  // dry run validates stored section size, as in SuplaDeviceClass::begin()
+  EXPECT_TRUE(Supla::Storage::PrepareState(true));
+  Supla::Storage::WriteState(state, sizeof(state));
+  EXPECT_TRUE(Supla::Storage::FinalizeSaveState());
+
+  unsigned char readState[sizeof(state)] = {};
+  Supla::Storage::PrepareState();
+  EXPECT_TRUE(Supla::Storage::ReadState(readState, sizeof(readState)));
+  EXPECT_EQ(0, memcmp(state, readState, sizeof(state)));
+}
+
+TEST_F(FileStorageTests, NewFileHasNoValidState) {
+  Supla::FileStorage storage(path, 256);
+  ASSERT_TRUE(storage.init());
+
+  unsigned char state[] = {1, 2, 3};
+  EXPECT_TRUE(Supla::Storage::PrepareState(true));
+  Supla::Storage::WriteState(state, sizeof(state));
+  EXPECT_FALSE(Supla::Storage::FinalizeSaveState());
+}
+
+TEST_F(FileStorageTests, InitFailsForInvalidPath) {
+  Supla::FileStorage storage("/nonexistent_dir/storage.bin");
+  EXPECT_FALSE(storage.init());
+}
@@ -175,3 +175,37 @@ TEST(LocalActionTests, FourItemsTestsWithCalls) {
   delete b3;
   delete b4;
 }
+
+TEST(LocalActionTests, ActionsAreCalledInOrderOfAdding) {
+  ::testing::InSequence seq;
+  auto b1 = new Supla::LocalAction;
+  ActionHandlerMock mock1;
+  ActionHandlerMock mock2;
+
+  int event1 = 1;
+  int event2 = 2;
+  int bigEvent1 = 40;
+  int bigEvent2 = 41;
+
+  EXPECT_CALL(mock1, handleAction(event1, 1));
+  EXPECT_CALL(mock2, handleAction(event1, 2));
+  EXPECT_CALL(mock1, handleAction(event1, 3));
+  EXPECT_CALL(mock2, handleAction(event2, 4));
+  EXPECT_CALL(mock1, handleAction(bigEvent2, 6));
+
+  b1->addAction(1, mock1, event1);
+  b1->addAction(4, mock2, event2);
+  b1->addAction(2, mock2, event1);
+  b1->addAction(5, mock1, bigEvent1);
+  b1->addAction(3, mock1, event1);
+  b1->addAction(6, mock1, bigEvent2);
+  EXPECT_EQ(Supla::LocalAction::getClientCount(), 6);
+
+  b1->runAction(event1);
+  b1->runAction(event2);
+  b1->runAction(bigEvent2);
+  b1->runAction(3);
+
+  delete b1;
+  EXPECT_EQ(Supla::LocalAction::getClientCount(), 0);
+}
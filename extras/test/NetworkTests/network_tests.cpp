@@ -0,0 +1,225 @@
+/*
+ Copyright (C) AC SOFTWARE SP. Z O.O.
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+*/
+
+#include <arduino_mock.h>
+#include <gtest/gtest.h>
+#include <supla/network/network.h>
+
+#include <string>
+#include <vector>
+
+class RecordingNetwork : public Supla::Network {
+ public:
+  RecordingNetwork() : Supla::Network(nullptr) {
+  }
+  int read(void *, int) override {
+    return -1;
+  }
+  int write(void *buf, int count) override {
+    writes.push_back(std::string(static_cast<char *>(buf), count));
+    return count;
+  }
+  int connect(const char *, int) override {
+    return 1;
+  }
+  bool connected() override {
+    return true;
+  }
+  void disconnect() override {
+    disconnects++;
+  }
+  void setup() override {
+  }
+  bool isReady() override {
+    return true;
+  }
+
+  std::vector<std::string> writes;
+  int disconnects = 0;
+};
+
+TEST(NetworkTests, PacketAndTagAreSentWithOneWrite) {
+  RecordingNetwork net;
+  char packet[] = "packet";
+  char tag[] = "SUPLA";
+
+  TsrpcDataVector vec[2];
+  vec[0].buf = packet;
+  vec[0].count = 6;
+  vec[1].buf = tag;
+  vec[1].count = 5;
+
+  EXPECT_EQ(Supla::Network::WriteV(vec, 2), 11);
+  EXPECT_EQ(Supla::Network::WriteV(vec, 2), 11);
+  EXPECT_TRUE(net.writes.empty());
+
+  EXPECT_EQ(Supla::Network::Flush(), 22);
+  ASSERT_EQ(net.writes.size(), 1);
+  EXPECT_EQ(net.writes[0], "packetSUPLApacketSUPLA");
+
+  // nothing left to send
+  EXPECT_EQ(Supla::Network::Flush(), 0);
+  EXPECT_EQ(net.writes.size(), 1);
+}
+
+TEST(NetworkTests, FullBufferIsFlushedBeforeNextWrite) {
+  RecordingNetwork net;
+  std::string first(SUPLA_NETWORK_TX_BUFFER_SIZE - 4, 'a');
+  std::string second(8, 'b');
+
+  Supla::Network::Write(&first[0], first.size());
+  Supla::Network::Write(&second[0], second.size());
+  ASSERT_EQ(net.writes.size(), 1);
+  EXPECT_EQ(net.writes[0], first);
+
+  Supla::Network::Flush();
+  ASSERT_EQ(net.writes.size(), 2);
+  EXPECT_EQ(net.writes[1], second);
+}
+
+TEST(NetworkTests, DataBiggerThanBufferIsWrittenDirectly) {
+  RecordingNetwork net;
+  std::string small(4, 's');
+  std::string big(SUPLA_NETWORK_TX_BUFFER_SIZE + 1, 'b');
+
+  Supla::Network::Write(&small[0], small.size());
+  EXPECT_EQ(Supla::Network::Write(&big[0], big.size()), big.size());
+  ASSERT_EQ(net.writes.size(), 2);
+  EXPECT_EQ(net.writes[0], small);
+  EXPECT_EQ(net.writes[1], big);
+}
+
+TEST(NetworkTests, DisconnectDropsBufferedData) {
+  RecordingNetwork net;
+  char data[] = "value";
+
+  Supla::Network::Write(data, 5);
+  Supla::Network::Disconnect();
+  EXPECT_EQ(Supla::Network::Flush(), 0);
+  EXPECT_TRUE(net.writes.empty());
+}
+
+class PhasedNetwork : public RecordingNetwork {
+ public:
+  Supla::ConnectPhaseResult runConnectPhase(
+      Supla::ConnectPhase phase) override {
+    phases.push_back(phase);
+    if (phase == Supla::CONNECT_DNS && dnsPolls-- > 0) {
+      return Supla::CONNECT_PHASE_IN_PROGRESS;
+    }
+    if (phase == Supla::CONNECT_TLS) {
+      return Supla::CONNECT_PHASE_NEXT;
+    }
+    if (phase == failedPhase) {
+      return Supla::CONNECT_PHASE_FAILED;
+    }
+    return Supla::CONNECT_PHASE_DONE;
+  }
+
+  int dnsPolls = 0;
+  int failedPhase = Supla::CONNECT_IDLE;
+  std::vector<int> phases;
+};
+
+TEST(NetworkTests, ConnectPhasesAreExecutedInSeparateIterations) {
+  PhasedNetwork net;
+  net.dnsPolls = 2;
+
+  net.beginConnect("supla.org", 2016);
+  EXPECT_TRUE(net.isConnecting());
+
+  EXPECT_EQ(net.pollConnect(0), 0);
+  EXPECT_EQ(net.pollConnect(10), 0);
+  // DNS finished, TCP is started in next call
+  EXPECT_EQ(net.pollConnect(20), 0);
+  EXPECT_TRUE(net.isConnecting());
+  EXPECT_EQ(net.pollConnect(3000), 0);
+  // TLS is not used
+  EXPECT_EQ(net.pollConnect(3010), 1);
+  EXPECT_FALSE(net.isConnecting());
+
+  std::vector<int> expected = {Supla::CONNECT_DNS,
+                               Supla::CONNECT_DNS,
+                               Supla::CONNECT_DNS,
+                               Supla::CONNECT_TCP,
+                               Supla::CONNECT_TLS};
+  EXPECT_EQ(net.phases, expected);
+}
+
+TEST(NetworkTests, ConnectPhaseTimeout) {
+  PhasedNetwork net;
+  net.dnsPolls = 1000;
+
+  net.beginConnect("supla.org", 2016);
+  EXPECT_EQ(net.pollConnect(100), 0);
+  EXPECT_EQ(net.pollConnect(100 + SUPLA_CONNECT_DNS_TIMEOUT_MS - 1), 0);
+  EXPECT_EQ(net.disconnects, 0);
+  EXPECT_LT(net.pollConnect(100 + SUPLA_CONNECT_DNS_TIMEOUT_MS), 0);
+  EXPECT_FALSE(net.isConnecting());
+  // partially established connection is closed
+  EXPECT_EQ(net.disconnects, 1);
+}
+
+TEST(NetworkTests, FailedConnectPhaseClosesConnection) {
+  PhasedNetwork net;
+  net.failedPhase = Supla::CONNECT_TCP;
+
+  net.beginConnect("supla.org", 2016);
+  EXPECT_EQ(net.pollConnect(0), 0);
+  EXPECT_EQ(net.disconnects, 0);
+  EXPECT_LT(net.pollConnect(10), 0);
+  EXPECT_FALSE(net.isConnecting());
+  EXPECT_EQ(net.disconnects, 1);
+}
+
+class LegacyNetwork : public RecordingNetwork {
+ public:
+  int connect(const char *server, int port) override {
+    connectCalls++;
+    lastServer = server;
+    lastPort = port;
+    return result;
+  }
+
+  int connectCalls = 0;
+  int result = 1;
+  std::string lastServer;
+  int lastPort = 0;
+};
+
+class TimeStub : public TimeInterface {
+ public:
+  unsigned long millis() override {
+    return 0;
+  }
+};
+
+TEST(NetworkTests, NetworkWithoutPhasesUsesBlockingConnect) {
+  TimeStub time;
+  LegacyNetwork net;
+
+  Supla::Network::BeginConnect("supla.org");
+  EXPECT_EQ(Supla::Network::PollConnect(0), 1);
+  EXPECT_EQ(net.connectCalls, 1);
+  EXPECT_EQ(net.lastServer, "supla.org");
+  EXPECT_EQ(net.lastPort, -1);
+
+  net.result = 0;
+  Supla::Network::BeginConnect("supla.org", 2015);
+  EXPECT_LT(Supla::Network::PollConnect(0), 0);
+  EXPECT_EQ(net.connectCalls, 2);
+  EXPECT_FALSE(Supla::Network::IsConnecting());
+}
@@ -0,0 +1,76 @@
+/*
+ Copyright (C) AC SOFTWARE SP. Z O.O.
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+*/
+
+// proto.c is built here with input buffer smaller than the biggest packet,
+// as on AVR (see CMakeLists.txt)
+
+#include <gtest/gtest.h>
+#include <supla-common/proto.h>
+
+#include <vector>
+
+namespace {
+
+const unsigned HeaderSize = sizeof(TSuplaDataPacket) - SUPLA_MAX_DATA_SIZE;
+const unsigned BufferSize = 1024;
+
+// Appends serialized packet (with closing tag) to stream
+void appendPacket(void *spd, std::vector<char> *stream, int callType,
+                  unsigned dataSize) {
+  TSuplaDataPacket sdp;
+  sproto_sdp_init(spd, &sdp);
+  std::vector<char> data(dataSize, 'D');
+  sproto_set_data(&sdp, data.data(), dataSize, callType);
+  const char *raw = reinterpret_cast<const char *>(&sdp);
+  stream->insert(stream->end(), raw, raw + HeaderSize + dataSize);
+  stream->insert(stream->end(), sproto_tag, sproto_tag + SUPLA_TAG_SIZE);
+}
+
+}  // namespace
+
+TEST(ProtoSmallBufferTests, PacketLongerThanBufferIsRejected) {
+  void *spd = sproto_init();
+  std::vector<char> stream;
+  const unsigned dataSize = BufferSize;
+  ASSERT_LE(dataSize, SUPLA_MAX_DATA_SIZE);
+  appendPacket(spd, &stream, 1, dataSize);
+
+  // packet can't be completed, so it is reported as soon as its header is
+  // received, instead of waiting for the buffer to fill up
+  ASSERT_EQ(SUPLA_RESULT_TRUE,
+            sproto_in_buffer_append(spd, stream.data(),
+                                    HeaderSize + SUPLA_TAG_SIZE));
+  EXPECT_EQ(SUPLA_RESULT_TRUE, sproto_in_dataexists(spd));
+  EXPECT_EQ(SUPLA_RESULT_TRUE, sproto_in_packet_available(spd));
+
+  TSuplaDataPacket scratch;
+  TSuplaDataPacket *sdp = nullptr;
+  EXPECT_EQ(SUPLA_RESULT_BUFFER_OVERFLOW,
+            sproto_peek_in_sdp(spd, &sdp, &scratch));
+  EXPECT_EQ(SUPLA_RESULT_FALSE, sproto_in_dataexists(spd));
+  EXPECT_EQ(SUPLA_RESULT_FALSE, sproto_in_packet_available(spd));
+
+  // the biggest packet which fits in buffer is received
+  stream.clear();
+  appendPacket(spd, &stream, 2, BufferSize - HeaderSize - SUPLA_TAG_SIZE);
+  ASSERT_EQ(stream.size(), BufferSize);
+  ASSERT_EQ(SUPLA_RESULT_TRUE,
+            sproto_in_buffer_append(spd, stream.data(), stream.size()));
+  EXPECT_EQ(SUPLA_RESULT_TRUE, sproto_in_packet_available(spd));
+  ASSERT_EQ(SUPLA_RESULT_TRUE, sproto_peek_in_sdp(spd, &sdp, &scratch));
+  EXPECT_EQ(sdp->call_type, 2u);
+  sproto_free(spd);
+}
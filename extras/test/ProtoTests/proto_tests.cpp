@@ -0,0 +1,260 @@
+/*
+ Copyright (C) AC SOFTWARE SP. Z O.O.
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+*/
+
+#include <gtest/gtest.h>
+#include <string.h>
+#include <supla-common/proto.h>
+
+#include <set>
+#include <vector>
+
+namespace {
+
+const unsigned HeaderSize = sizeof(TSuplaDataPacket) - SUPLA_MAX_DATA_SIZE;
+
+// Appends serialized packet (with closing tag) to stream
+void appendPacket(void *spd, std::vector<char> *stream, int callType,
+                  unsigned dataSize) {
+  TSuplaDataPacket sdp;
+  sproto_sdp_init(spd, &sdp);
+  std::vector<char> data(dataSize);
+  for (unsigned i = 0; i < dataSize; i++) {
+    data[i] = static_cast<char>(callType + i);
+  }
+  sproto_set_data(&sdp, data.data(), dataSize, callType);
+  const char *raw = reinterpret_cast<const char *>(&sdp);
+  stream->insert(stream->end(), raw, raw + HeaderSize + dataSize);
+  stream->insert(stream->end(), sproto_tag, sproto_tag + SUPLA_TAG_SIZE);
+}
+
+}  // namespace
+
+TEST(ProtoTests, PacketsSplitAcrossReadsAndBufferWrap) {
+  void *spd = sproto_init();
+  ASSERT_NE(spd, nullptr);
+
+  std::vector<char> stream;
+  const int packetCount = 1000;
+  for (int i = 0; i < packetCount; i++) {
+    appendPacket(spd, &stream, i, 100 + i % 7);
+  }
+
+  // Reads don't end on packet boundary, so buffer is never empty and data
+  // wraps around the end of ring buffer many times
+  TSuplaDataPacket sdp;
+  int received = 0;
+  size_t offset = 0;
+  while (offset < stream.size()) {
+    size_t chunk = std::min<size_t>(997, stream.size() - offset);
+    ASSERT_EQ(SUPLA_RESULT_TRUE,
+              sproto_in_buffer_append(spd, &stream[offset], chunk));
+    offset += chunk;
+
+    while (sproto_pop_in_sdp(spd, &sdp) == SUPLA_RESULT_TRUE) {
+      EXPECT_EQ(sdp.call_type, received);
+      ASSERT_EQ(sdp.data_size, 100u + received % 7);
+      for (unsigned i = 0; i < sdp.data_size; i++) {
+        ASSERT_EQ(sdp.data[i], static_cast<char>(received + i));
+      }
+      received++;
+    }
+  }
+
+  EXPECT_EQ(received, packetCount);
+  EXPECT_EQ(SUPLA_RESULT_FALSE, sproto_in_dataexists(spd));
+  sproto_free(spd);
+}
+
+TEST(ProtoTests, InvalidTagClearsInBuffer) {
+  void *spd = sproto_init();
+  char garbage[] = "HELLO WORLD";
+  TSuplaDataPacket sdp;
+
+  ASSERT_EQ(SUPLA_RESULT_TRUE,
+            sproto_in_buffer_append(spd, garbage, sizeof(garbage)));
+  EXPECT_EQ(SUPLA_RESULT_DATA_ERROR, sproto_pop_in_sdp(spd, &sdp));
+  EXPECT_EQ(SUPLA_RESULT_FALSE, sproto_in_dataexists(spd));
+
+  std::vector<char> stream;
+  appendPacket(spd, &stream, 5, 10);
+  // broken closing tag
+  stream.back() = 'X';
+  ASSERT_EQ(SUPLA_RESULT_TRUE,
+            sproto_in_buffer_append(spd, stream.data(), stream.size()));
+  EXPECT_EQ(SUPLA_RESULT_DATA_ERROR, sproto_pop_in_sdp(spd, &sdp));
+  EXPECT_EQ(SUPLA_RESULT_FALSE, sproto_in_dataexists(spd));
+  sproto_free(spd);
+}
+
+TEST(ProtoTests, InBufferOverflow) {
+  void *spd = sproto_init();
+  std::vector<char> data(1024, 'S');
+
+  char result = SUPLA_RESULT_TRUE;
+  int appended = 0;
+  while (result == SUPLA_RESULT_TRUE && appended < 1024) {
+    result = sproto_in_buffer_append(spd, data.data(), data.size());
+    appended++;
+  }
+  EXPECT_EQ(SUPLA_RESULT_BUFFER_OVERFLOW, result);
+  sproto_free(spd);
+}
+
+TEST(ProtoTests, OutBufferWrapsAround) {
+  void *spd = sproto_init();
+  TSuplaDataPacket sdp;
+  std::vector<char> expected;
+  std::vector<char> sent;
+  char buffer[333];
+
+  for (int i = 0; i < 500; i++) {
+    sproto_sdp_init(spd, &sdp);
+    char data[50];
+    memset(data, i, sizeof(data));
+    sproto_set_data(&sdp, data, 20 + i % 30, i);
+    ASSERT_EQ(SUPLA_RESULT_TRUE, sproto_out_buffer_append(spd, &sdp));
+
+    const char *raw = reinterpret_cast<const char *>(&sdp);
+    expected.insert(expected.end(), raw, raw + HeaderSize + sdp.data_size);
+    expected.insert(expected.end(), sproto_tag, sproto_tag + SUPLA_TAG_SIZE);
+
+    unsigned size = sproto_pop_out_data(spd, buffer, sizeof(buffer) / 2);
+    sent.insert(sent.end(), buffer, buffer + size);
+  }
+
+  unsigned size = 0;
+  while ((size = sproto_pop_out_data(spd, buffer, sizeof(buffer))) > 0) {
+    sent.insert(sent.end(), buffer, buffer + size);
+  }
+
+  EXPECT_EQ(SUPLA_RESULT_FALSE, sproto_out_dataexists(spd));
+  EXPECT_EQ(sent, expected);
+  sproto_free(spd);
+}
+
+TEST(ProtoTests, ReadDirectlyIntoInBufferAndPeekInPlace) {
+  void *spd = sproto_init();
+  std::vector<char> stream;
+  std::set<size_t> packetEnds;
+  const int packetCount = 1000;
+  for (int i = 0; i < packetCount; i++) {
+    appendPacket(spd, &stream, i, 40 + i % 5);
+    packetEnds.insert(stream.size());
+  }
+
+  TSuplaDataPacket scratch;
+  TSuplaDataPacket *sdp = nullptr;
+  int received = 0;
+  int inPlace = 0;
+  size_t offset = 0;
+  while (received < packetCount) {
+    unsigned _supla_int_t freeSize = 0;
+    char *buffer = sproto_in_buffer_reserve(spd, &freeSize);
+    size_t size = std::min<size_t>(freeSize, stream.size() - offset);
+    size = std::min<size_t>(size, 101);
+    // reads don't end on packet boundary, so buffer never gets empty and
+    // packets wrap around its end
+    if (size > 1 && offset + size < stream.size() &&
+        packetEnds.count(offset + size)) {
+      size--;
+    }
+    memcpy(buffer, &stream[offset], size);
+    sproto_in_buffer_commit(spd, size);
+    offset += size;
+
+    while (sproto_peek_in_sdp(spd, &sdp, &scratch) == SUPLA_RESULT_TRUE) {
+      ASSERT_EQ(sdp->call_type, received);
+      ASSERT_EQ(sdp->data_size, 40u + received % 5);
+      for (unsigned i = 0; i < sdp->data_size; i++) {
+        ASSERT_EQ(sdp->data[i], static_cast<char>(received + i));
+      }
+      if (sdp != &scratch) {
+        inPlace++;
+      }
+      received++;
+      sproto_release_in_sdp(spd);
+    }
+  }
+
+  // only packets which wrap around the end of buffer are copied
+  EXPECT_GT(inPlace, packetCount - 10);
+  EXPECT_LT(inPlace, packetCount);
+  EXPECT_EQ(SUPLA_RESULT_FALSE, sproto_in_dataexists(spd));
+  sproto_free(spd);
+}
+
+TEST(ProtoTests, PeekedPacketIsNotPendingData) {
+  void *spd = sproto_init();
+  std::vector<char> stream;
+  appendPacket(spd, &stream, 1, 10);
+
+  ASSERT_EQ(SUPLA_RESULT_TRUE,
+            sproto_in_buffer_append(spd, stream.data(), stream.size()));
+  EXPECT_EQ(SUPLA_RESULT_TRUE, sproto_in_dataexists(spd));
+
+  TSuplaDataPacket scratch;
+  TSuplaDataPacket *sdp = nullptr;
+  ASSERT_EQ(SUPLA_RESULT_TRUE, sproto_peek_in_sdp(spd, &sdp, &scratch));
+  EXPECT_NE(sdp, &scratch);
+  EXPECT_EQ(SUPLA_RESULT_FALSE, sproto_in_dataexists(spd));
+
+  // payload of packet received to empty buffer is aligned
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(sdp->data) % 4, 0u);
+
+  sproto_release_in_sdp(spd);
+  EXPECT_EQ(SUPLA_RESULT_FALSE, sproto_in_dataexists(spd));
+  EXPECT_EQ(SUPLA_RESULT_FALSE, sproto_peek_in_sdp(spd, &sdp, &scratch));
+  sproto_free(spd);
+}
+
+TEST(ProtoTests, PartialPacketIsNotAvailable) {
+  void *spd = sproto_init();
+  std::vector<char> stream;
+  appendPacket(spd, &stream, 1, 10);
+  appendPacket(spd, &stream, 2, 20);
+  size_t firstSize = HeaderSize + 10 + SUPLA_TAG_SIZE;
+
+  // every prefix of the first packet is pending data, but not a packet
+  for (size_t i = 0; i < firstSize; i++) {
+    ASSERT_EQ(SUPLA_RESULT_TRUE, sproto_in_buffer_append(spd, &stream[i], 1));
+    EXPECT_EQ(SUPLA_RESULT_TRUE, sproto_in_dataexists(spd));
+    EXPECT_EQ(i + 1 == firstSize ? SUPLA_RESULT_TRUE : SUPLA_RESULT_FALSE,
+              sproto_in_packet_available(spd));
+  }
+
+  // peeked packet is skipped, second one is checked
+  ASSERT_EQ(SUPLA_RESULT_TRUE,
+            sproto_in_buffer_append(spd, &stream[firstSize], HeaderSize));
+  TSuplaDataPacket scratch;
+  TSuplaDataPacket *sdp = nullptr;
+  ASSERT_EQ(SUPLA_RESULT_TRUE, sproto_peek_in_sdp(spd, &sdp, &scratch));
+  EXPECT_EQ(SUPLA_RESULT_FALSE, sproto_in_packet_available(spd));
+  ASSERT_EQ(SUPLA_RESULT_TRUE,
+            sproto_in_buffer_append(spd, &stream[firstSize + HeaderSize],
+                                    stream.size() - firstSize - HeaderSize));
+  EXPECT_EQ(SUPLA_RESULT_TRUE, sproto_in_packet_available(spd));
+
+  ASSERT_EQ(SUPLA_RESULT_TRUE, sproto_peek_in_sdp(spd, &sdp, &scratch));
+  EXPECT_EQ(sdp->call_type, 2u);
+  EXPECT_EQ(SUPLA_RESULT_FALSE, sproto_in_packet_available(spd));
+
+  // invalid data has to be handled, so it is reported as available
+  char garbage[SUPLA_TAG_SIZE] = {'X', 'X', 'X', 'X', 'X'};
+  ASSERT_EQ(SUPLA_RESULT_TRUE,
+            sproto_in_buffer_append(spd, garbage, sizeof(garbage)));
+  EXPECT_EQ(SUPLA_RESULT_TRUE, sproto_in_packet_available(spd));
+  sproto_free(spd);
+}
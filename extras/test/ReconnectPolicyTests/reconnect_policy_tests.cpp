@@ -0,0 +1,89 @@
+/*
+ Copyright (C) AC SOFTWARE SP. Z O.O.
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+*/
+
+#include <gtest/gtest.h>
+#include <supla/reconnect_policy.h>
+
+TEST(ReconnectPolicyTests, DelayIsBoundedByGrowingCeiling) {
+  Supla::ReconnectPolicy policy;
+  char guid[16] = {1, 2, 3};
+  policy.seed(guid, sizeof(guid));
+  policy.configure(1000, 16000, 2);
+
+  unsigned long ceiling = 1000;
+  for (int attempt = 0; attempt < 20; attempt++) {
+    EXPECT_LE(policy.nextDelayMs(), ceiling);
+    EXPECT_EQ(policy.getFailedAttempts(), attempt + 1);
+    ceiling = ceiling * 2 > 16000 ? 16000 : ceiling * 2;
+  }
+}
+
+TEST(ReconnectPolicyTests, ResetStartsFromBase) {
+  Supla::ReconnectPolicy policy;
+  policy.configure(1000, 60000, 3);
+
+  for (int i = 0; i < 10; i++) {
+    policy.nextDelayMs();
+  }
+  policy.reset();
+  EXPECT_EQ(policy.getFailedAttempts(), 0);
+  for (int i = 0; i < 50; i++) {
+    policy.reset();
+    EXPECT_LE(policy.nextDelayMs(), 1000);
+  }
+}
+
+TEST(ReconnectPolicyTests, CapIsReachedAndDelaysAreSpread) {
+  Supla::ReconnectPolicy policy;
+  policy.configure(100, 5000, 2);
+
+  for (int i = 0; i < 10; i++) {
+    policy.nextDelayMs();
+  }
+
+  // full jitter - delays cover whole [0, cap] range
+  unsigned long minDelay = 5000;
+  unsigned long maxDelay = 0;
+  for (int i = 0; i < 1000; i++) {
+    unsigned long delayMs = policy.nextDelayMs();
+    EXPECT_LE(delayMs, 5000);
+    if (delayMs < minDelay) minDelay = delayMs;
+    if (delayMs > maxDelay) maxDelay = delayMs;
+  }
+  EXPECT_LT(minDelay, 500);
+  EXPECT_GT(maxDelay, 4500);
+}
+
+TEST(ReconnectPolicyTests, DevicesWithDifferentGuidUseDifferentDelays) {
+  Supla::ReconnectPolicy first;
+  Supla::ReconnectPolicy second;
+  Supla::ReconnectPolicy sameAsFirst;
+  char guid1[16] = {1};
+  char guid2[16] = {2};
+  first.seed(guid1, sizeof(guid1));
+  sameAsFirst.seed(guid1, sizeof(guid1));
+  second.seed(guid2, sizeof(guid2));
+
+  int differentDelays = 0;
+  for (int i = 0; i < 10; i++) {
+    unsigned long delayMs = first.nextDelayMs();
+    EXPECT_EQ(delayMs, sameAsFirst.nextDelayMs());
+    if (delayMs != second.nextDelayMs()) {
+      differentDelays++;
+    }
+  }
+  EXPECT_GE(differentDelays, 9);
+}
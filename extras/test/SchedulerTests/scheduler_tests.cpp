@@ -0,0 +1,119 @@
+/*
+ Copyright (C) AC SOFTWARE SP. Z O.O.
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+*/
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <arduino_mock.h>
+#include <supla/scheduler.h>
+
+using ::testing::Return;
+
+class TaskMock : public Supla::ScheduledTask {
+ public:
+  MOCK_METHOD(void, runTask, (), (override));
+};
+
+class SelfReschedulingTask : public Supla::ScheduledTask {
+ public:
+  SelfReschedulingTask() : counter(0) {
+  }
+  void runTask() override {
+    counter++;
+    scheduleTask(0);
+  }
+  int counter;
+};
+
+TEST(SchedulerTests, TasksAreSortedByDeadline) {
+  TaskMock t1;
+  TaskMock t2;
+  TaskMock t3;
+  uint32_t delay = 0;
+
+  EXPECT_FALSE(Supla::Scheduler::getTimeToNextTask(0, &delay));
+
+  t1.scheduleTaskAt(300);
+  t2.scheduleTaskAt(100);
+  t3.scheduleTaskAt(200);
+  EXPECT_TRUE(t1.isTaskScheduled());
+  EXPECT_EQ(Supla::Scheduler::first(), &t2);
+
+  EXPECT_TRUE(Supla::Scheduler::getTimeToNextTask(40, &delay));
+  EXPECT_EQ(delay, 60);
+  EXPECT_TRUE(Supla::Scheduler::getTimeToNextTask(150, &delay));
+  EXPECT_EQ(delay, 0);
+
+  {
+    ::testing::InSequence seq;
+    EXPECT_CALL(t2, runTask());
+    EXPECT_CALL(t3, runTask());
+  }
+  Supla::Scheduler::runDueTasks(99);
+  Supla::Scheduler::runDueTasks(250);
+  EXPECT_FALSE(t2.isTaskScheduled());
+  EXPECT_TRUE(t1.isTaskScheduled());
+
+  t1.cancelTask();
+  EXPECT_FALSE(t1.isTaskScheduled());
+  EXPECT_EQ(Supla::Scheduler::first(), nullptr);
+  Supla::Scheduler::runDueTasks(1000);
+}
+
+TEST(SchedulerTests, PeriodicTask) {
+  TaskMock task;
+
+  task.scheduleTaskAt(100, 100);
+
+  EXPECT_CALL(task, runTask()).Times(3);
+  Supla::Scheduler::runDueTasks(100);
+  EXPECT_EQ(task.getTaskDeadline(), 200);
+  Supla::Scheduler::runDueTasks(150);
+  Supla::Scheduler::runDueTasks(210);
+  EXPECT_EQ(task.getTaskDeadline(), 300);
+  // missed periods are not executed one after another
+  Supla::Scheduler::runDueTasks(1050);
+  EXPECT_EQ(task.getTaskDeadline(), 1150);
+  EXPECT_TRUE(task.isTaskScheduled());
+}
+
+TEST(SchedulerTests, DeadlineAfterMillisOverflow) {
+  TaskMock t1;
+  TaskMock t2;
+
+  t1.scheduleTaskAt(10);
+  t2.scheduleTaskAt(0xFFFFFFF0);
+  EXPECT_EQ(Supla::Scheduler::first(), &t2);
+
+  EXPECT_CALL(t2, runTask());
+  Supla::Scheduler::runDueTasks(0xFFFFFFF5);
+  EXPECT_CALL(t1, runTask());
+  Supla::Scheduler::runDueTasks(20);
+}
+
+TEST(SchedulerTests, TaskRescheduledForNowRunsInNextIteration) {
+  TimeInterfaceMock time;
+  SelfReschedulingTask task;
+
+  EXPECT_CALL(time, millis()).WillRepeatedly(Return(500));
+
+  task.scheduleTaskAt(500);
+  Supla::Scheduler::runDueTasks(500);
+  EXPECT_EQ(task.counter, 1);
+  EXPECT_EQ(task.getTaskDeadline(), 501);
+  Supla::Scheduler::runDueTasks(501);
+  EXPECT_EQ(task.counter, 2);
+  task.cancelTask();
+}
@@ -0,0 +1,202 @@
+/*
+ Copyright (C) AC SOFTWARE SP. Z O.O.
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+*/
+
+// srpc.c is built here as on server: received packets wait in in_queue until
+// srpc_getdata() is called (see CMakeLists.txt)
+
+#include <gtest/gtest.h>
+#include <string.h>
+#include <supla-common/proto.h>
+#include <supla-common/srpc.h>
+
+#include <algorithm>
+#include <vector>
+
+namespace {
+
+const unsigned HeaderSize = sizeof(TSuplaDataPacket) - SUPLA_MAX_DATA_SIZE;
+const unsigned QueueSize = 10;  // default SRPC_QUEUE_SIZE
+
+class SrpcQueueTests : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    spd = sproto_init();
+    ASSERT_NE(spd, nullptr);
+
+    TsrpcParams params;
+    srpc_params_init(&params);
+    params.data_read = &SrpcQueueTests::dataRead;
+    params.data_write = &SrpcQueueTests::dataWrite;
+    params.on_remote_call_received = &SrpcQueueTests::onRemoteCall;
+    params.user_params = this;
+    srpc = srpc_init(&params);
+    ASSERT_NE(srpc, nullptr);
+  }
+
+  void TearDown() override {
+    srpc_free(srpc);
+    sproto_free(spd);
+  }
+
+  // Sends calcfg result with rr_id and dataSize bytes of data, which are
+  // filled with values based on rr_id
+  void sendResult(unsigned rrId, unsigned dataSize) {
+    TDS_DeviceCalCfgResult result = {};
+    result.ReceiverID = rrId;
+    result.DataSize = dataSize;
+    for (unsigned i = 0; i < dataSize; i++) {
+      result.Data[i] = static_cast<char>(rrId + i);
+    }
+
+    TSuplaDataPacket sdp;
+    sproto_sdp_init(spd, &sdp);
+    sproto_set_data(&sdp, reinterpret_cast<char *>(&result),
+                    sizeof(result) - SUPLA_CALCFG_DATA_MAXSIZE + dataSize,
+                    SUPLA_DS_CALL_DEVICE_CALCFG_RESULT);
+    sdp.rr_id = rrId;
+
+    const char *raw = reinterpret_cast<const char *>(&sdp);
+    input.assign(raw, raw + HeaderSize + sdp.data_size);
+    input.insert(input.end(), sproto_tag, sproto_tag + SUPLA_TAG_SIZE);
+    inputOffset = 0;
+
+    // one packet is received per iteration
+    srpc_iterate(srpc);
+    ASSERT_EQ(inputOffset, input.size());
+  }
+
+  // Pops packet with given rr_id (or the first one for 0) and checks that it
+  // is the one sent with sendResult(expectedRrId, dataSize)
+  void expectResult(unsigned rrId, unsigned expectedRrId, unsigned dataSize) {
+    TsrpcReceivedData rd = {};
+    ASSERT_EQ(srpc_getdata(srpc, &rd, rrId), SUPLA_RESULT_TRUE);
+    EXPECT_EQ(rd.call_type, SUPLA_DS_CALL_DEVICE_CALCFG_RESULT);
+    EXPECT_EQ(rd.rr_id, expectedRrId);
+    ASSERT_NE(rd.data.ds_device_calcfg_result, nullptr);
+    EXPECT_EQ(rd.data.ds_device_calcfg_result->ReceiverID, expectedRrId);
+    ASSERT_EQ(rd.data.ds_device_calcfg_result->DataSize, dataSize);
+    for (unsigned i = 0; i < dataSize; i++) {
+      ASSERT_EQ(rd.data.ds_device_calcfg_result->Data[i],
+                static_cast<char>(expectedRrId + i));
+    }
+    srpc_rd_free(&rd);
+  }
+
+  void expectEmpty() {
+    TsrpcReceivedData rd = {};
+    EXPECT_EQ(srpc_getdata(srpc, &rd, 0), SUPLA_RESULT_FALSE);
+  }
+
+  static _supla_int_t dataRead(void *buf, _supla_int_t count, void *user) {
+    auto test = static_cast<SrpcQueueTests *>(user);
+    size_t size = std::min<size_t>(count, test->input.size() -
+                                              test->inputOffset);
+    if (size == 0) {
+      return -1;
+    }
+    memcpy(buf, test->input.data() + test->inputOffset, size);
+    test->inputOffset += size;
+    return size;
+  }
+
+  static _supla_int_t dataWrite(void *buf, _supla_int_t count, void *user) {
+    return count;
+  }
+
+  static void onRemoteCall(void *srpc, unsigned _supla_int_t rr_id,
+                           unsigned _supla_int_t call_type, void *user,
+                           unsigned char proto_version) {
+    static_cast<SrpcQueueTests *>(user)->queuedCalls++;
+  }
+
+  void *spd = nullptr;
+  void *srpc = nullptr;
+  std::vector<char> input;
+  size_t inputOffset = 0;
+  int queuedCalls = 0;
+};
+
+}  // namespace
+
+TEST_F(SrpcQueueTests, PacketIsPoppedByRrIdFromTheMiddle) {
+  sendResult(1, 10);
+  sendResult(2, 20);
+  sendResult(3, 30);
+  EXPECT_EQ(queuedCalls, 3);
+
+  expectResult(2, 2, 20);
+  expectResult(0, 1, 10);
+  expectResult(0, 3, 30);
+  expectEmpty();
+}
+
+TEST_F(SrpcQueueTests, ItemPoppedFromTheMiddleIsReclaimed) {
+  for (unsigned i = 1; i <= QueueSize; i++) {
+    sendResult(i, i);
+  }
+  EXPECT_EQ(queuedCalls, QueueSize);
+
+  // queue is full, so packet is dropped
+  sendResult(100, 1);
+  EXPECT_EQ(queuedCalls, QueueSize);
+
+  // popping from the middle makes room for the next packet
+  expectResult(5, 5, 5);
+  sendResult(101, 101);
+  EXPECT_EQ(queuedCalls, QueueSize + 1);
+
+  // and for the next ones, when the last and the first item are popped
+  expectResult(101, 101, 101);
+  expectResult(1, 1, 1);
+  sendResult(102, 102);
+  sendResult(103, 103);
+  EXPECT_EQ(queuedCalls, QueueSize + 3);
+
+  for (unsigned i = 2; i <= QueueSize; i++) {
+    if (i != 5) {
+      expectResult(0, i, i);
+    }
+  }
+  expectResult(0, 102, 102);
+  expectResult(0, 103, 103);
+  expectEmpty();
+}
+
+TEST_F(SrpcQueueTests, PacketsWrapAroundQueueBuffer) {
+  // a few packets are kept in queue, while many more pass through it, so
+  // they are stored across the end of queue buffer many times
+  const unsigned packetCount = 2000;
+  const unsigned kept = 4;
+  const unsigned maxSize = SUPLA_CALCFG_DATA_MAXSIZE + 1;
+  for (unsigned i = 1; i <= packetCount; i++) {
+    sendResult(i, i % maxSize);
+    if (i > kept) {
+      unsigned popped = i - kept;
+      if (popped % 3 == 0) {
+        // packet from the middle is taken and queued again at the end
+        expectResult(popped + 2, popped + 2, (popped + 2) % maxSize);
+        sendResult(popped + 2, (popped + 2) % maxSize);
+      }
+      expectResult(popped, popped, popped % maxSize);
+    }
+  }
+
+  for (unsigned i = packetCount - kept + 1; i <= packetCount; i++) {
+    expectResult(i, i, i % maxSize);
+  }
+  expectEmpty();
+  EXPECT_EQ(queuedCalls, packetCount + (packetCount - kept) / 3);
+}
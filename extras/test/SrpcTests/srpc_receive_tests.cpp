@@ -0,0 +1,278 @@
+/*
+ Copyright (C) AC SOFTWARE SP. Z O.O.
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+*/
+
+// srpc.c is built here as on devices: without in/out queues and with
+// received data arena instead of malloc (see CMakeLists.txt)
+
+#include <gtest/gtest.h>
+#include <string.h>
+#include <supla-common/proto.h>
+#include <supla-common/srpc.h>
+
+#include <algorithm>
+#include <vector>
+
+namespace {
+
+const unsigned HeaderSize = sizeof(TSuplaDataPacket) - SUPLA_MAX_DATA_SIZE;
+
+struct ReceivedCall {
+  char result;
+  unsigned call_type;
+  unsigned rr_id;
+  unsigned char data_source;
+  std::vector<char> data;
+};
+
+class SrpcReceiveTests : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    spd = sproto_init();
+    ASSERT_NE(spd, nullptr);
+
+    TsrpcParams params;
+    srpc_params_init(&params);
+    params.data_read = &SrpcReceiveTests::dataRead;
+    params.data_write = &SrpcReceiveTests::dataWrite;
+    params.on_remote_call_received = &SrpcReceiveTests::onRemoteCall;
+    params.user_params = this;
+    srpc = srpc_init(&params);
+    ASSERT_NE(srpc, nullptr);
+  }
+
+  void TearDown() override {
+    for (auto &rd : keptData) {
+      srpc_rd_free(&rd);
+    }
+    srpc_free(srpc);
+    sproto_free(spd);
+  }
+
+  // Appends serialized packet (with closing tag) to input stream
+  void appendPacket(unsigned callType, void *data, unsigned dataSize) {
+    TSuplaDataPacket sdp;
+    sproto_sdp_init(spd, &sdp);
+    sproto_set_data(&sdp, static_cast<char *>(data), dataSize, callType);
+    const char *raw = reinterpret_cast<const char *>(&sdp);
+    input.insert(input.end(), raw, raw + HeaderSize + dataSize);
+    input.insert(input.end(), sproto_tag, sproto_tag + SUPLA_TAG_SIZE);
+  }
+
+  void appendNewValue(unsigned senderId, unsigned char channel) {
+    TSD_SuplaChannelNewValue value = {};
+    value.SenderID = senderId;
+    value.ChannelNumber = channel;
+    value.DurationMS = senderId * 3;
+    for (int i = 0; i < SUPLA_CHANNELVALUE_SIZE; i++) {
+      value.value[i] = static_cast<char>(senderId + i);
+    }
+    appendPacket(SUPLA_SD_CALL_CHANNEL_SET_VALUE, &value, sizeof(value));
+  }
+
+  // Calls srpc_iterate until all input is read and processed
+  void iterateAll() {
+    for (int i = 0; i < 100000; i++) {
+      size_t before = calls.size();
+      srpc_iterate(srpc);
+      if (inputOffset >= input.size() && calls.size() == before &&
+          srpc_input_dataexists(srpc) != SUPLA_RESULT_TRUE) {
+        return;
+      }
+    }
+    FAIL() << "input is not processed";
+  }
+
+  static _supla_int_t dataRead(void *buf, _supla_int_t count, void *user) {
+    auto test = static_cast<SrpcReceiveTests *>(user);
+    size_t size = std::min<size_t>(count, test->input.size() -
+                                              test->inputOffset);
+    size = std::min(size, test->readSize);
+    if (size == 0) {
+      // no data on nonblocking socket
+      return -1;
+    }
+    memcpy(buf, test->input.data() + test->inputOffset, size);
+    test->inputOffset += size;
+    return size;
+  }
+
+  static _supla_int_t dataWrite(void *buf, _supla_int_t count, void *user) {
+    return count;
+  }
+
+  static void onRemoteCall(void *srpc, unsigned _supla_int_t rr_id,
+                           unsigned _supla_int_t call_type, void *user,
+                           unsigned char proto_version) {
+    auto test = static_cast<SrpcReceiveTests *>(user);
+    TsrpcReceivedData rd = {};
+    ReceivedCall call = {};
+    call.result = srpc_getdata(srpc, &rd, 0);
+    call.call_type = rd.call_type;
+    call.rr_id = rd.rr_id;
+    call.data_source = rd.data_source;
+    if (call.result == SUPLA_RESULT_TRUE) {
+      const char *data = reinterpret_cast<const char *>(rd.data.dcs_ping);
+      call.data.assign(data, data + test->payloadSize(rd));
+    }
+    test->calls.push_back(call);
+
+    if (test->keepData && call.result == SUPLA_RESULT_TRUE) {
+      test->keptData.push_back(rd);
+    } else {
+      srpc_rd_free(&rd);
+    }
+  }
+
+  unsigned payloadSize(const TsrpcReceivedData &rd) {
+    switch (rd.call_type) {
+      case SUPLA_SD_CALL_CHANNEL_SET_VALUE:
+        return sizeof(TSD_SuplaChannelNewValue);
+      case SUPLA_DCS_CALL_GET_USER_LOCALTIME_RESULT:
+        return sizeof(TSDC_UserLocalTimeResult) - SUPLA_TIMEZONE_MAXSIZE +
+               rd.data.sdc_user_localtime_result->timezoneSize;
+    }
+    return 0;
+  }
+
+  void expectNewValue(const ReceivedCall &call, unsigned senderId,
+                      unsigned char channel) {
+    ASSERT_EQ(call.result, SUPLA_RESULT_TRUE);
+    EXPECT_EQ(call.call_type, SUPLA_SD_CALL_CHANNEL_SET_VALUE);
+    ASSERT_EQ(call.data.size(), sizeof(TSD_SuplaChannelNewValue));
+    TSD_SuplaChannelNewValue value;
+    memcpy(&value, call.data.data(), sizeof(value));
+    EXPECT_EQ(value.SenderID, senderId);
+    EXPECT_EQ(value.ChannelNumber, channel);
+    EXPECT_EQ(value.DurationMS, senderId * 3);
+    for (int i = 0; i < SUPLA_CHANNELVALUE_SIZE; i++) {
+      EXPECT_EQ(value.value[i], static_cast<char>(senderId + i));
+    }
+  }
+
+  void *spd = nullptr;
+  void *srpc = nullptr;
+  std::vector<char> input;
+  size_t inputOffset = 0;
+  size_t readSize = 1024;
+  bool keepData = false;
+  std::vector<ReceivedCall> calls;
+  std::vector<TsrpcReceivedData> keptData;
+};
+
+}  // namespace
+
+TEST_F(SrpcReceiveTests, AlignedPayloadIsUsedInPlace) {
+  appendNewValue(10, 2);
+  appendNewValue(11, 3);
+  iterateAll();
+
+  ASSERT_EQ(calls.size(), 2);
+  EXPECT_EQ(calls[0].data_source, SRPC_RD_DATA_IN_PLACE);
+  EXPECT_EQ(calls[1].data_source, SRPC_RD_DATA_IN_PLACE);
+  expectNewValue(calls[0], 10, 2);
+  expectNewValue(calls[1], 11, 3);
+}
+
+TEST_F(SrpcReceiveTests, PayloadShorterThanStructureIsCopied) {
+  TSDC_UserLocalTimeResult time = {};
+  time.year = 2021;
+  time.hour = 12;
+  time.timezoneSize = 4;
+  memcpy(time.timezone, "UTC", 4);
+  unsigned timeSize =
+      sizeof(time) - SUPLA_TIMEZONE_MAXSIZE + time.timezoneSize;
+  appendPacket(SUPLA_DCS_CALL_GET_USER_LOCALTIME_RESULT, &time, timeSize);
+  // bytes after short payload belong to this packet
+  appendNewValue(20, 5);
+  iterateAll();
+
+  ASSERT_EQ(calls.size(), 2);
+  ASSERT_EQ(calls[0].result, SUPLA_RESULT_TRUE);
+  EXPECT_EQ(calls[0].call_type, SUPLA_DCS_CALL_GET_USER_LOCALTIME_RESULT);
+  EXPECT_EQ(calls[0].data_source, SRPC_RD_DATA_ARENA);
+  ASSERT_EQ(calls[0].data.size(), timeSize);
+  EXPECT_EQ(memcmp(calls[0].data.data(), &time, timeSize), 0);
+  expectNewValue(calls[1], 20, 5);
+}
+
+TEST_F(SrpcReceiveTests, PacketsWrappingAroundInputBufferAreCopied) {
+  // reads don't end on packet boundary, so input buffer is rarely empty and
+  // packets wrap around its end
+  readSize = 100;
+  const unsigned packetCount = 2000;
+  for (unsigned i = 0; i < packetCount; i++) {
+    appendNewValue(i, i % 256);
+  }
+  iterateAll();
+
+  ASSERT_EQ(calls.size(), packetCount);
+  int inPlace = 0;
+  int copied = 0;
+  for (unsigned i = 0; i < packetCount; i++) {
+    expectNewValue(calls[i], i, i % 256);
+    if (calls[i].data_source == SRPC_RD_DATA_IN_PLACE) {
+      inPlace++;
+    } else {
+      EXPECT_EQ(calls[i].data_source, SRPC_RD_DATA_ARENA);
+      copied++;
+    }
+  }
+  EXPECT_GT(inPlace, 0);
+  EXPECT_GT(copied, 0);
+  // only packets split by the end of buffer are copied
+  EXPECT_LT(copied, inPlace);
+}
+
+TEST_F(SrpcReceiveTests, CopiedDataIsRejectedWhenArenaIsFull) {
+  TSDC_UserLocalTimeResult time = {};
+  time.timezoneSize = 4;
+  memcpy(time.timezone, "UTC", 4);
+  unsigned timeSize =
+      sizeof(time) - SUPLA_TIMEZONE_MAXSIZE + time.timezoneSize;
+
+  // data isn't released, so the only arena slot stays in use
+  keepData = true;
+  appendPacket(SUPLA_DCS_CALL_GET_USER_LOCALTIME_RESULT, &time, timeSize);
+  time.hour = 1;
+  appendPacket(SUPLA_DCS_CALL_GET_USER_LOCALTIME_RESULT, &time, timeSize);
+  iterateAll();
+
+  ASSERT_EQ(calls.size(), 2);
+  EXPECT_EQ(calls[0].result, SUPLA_RESULT_TRUE);
+  EXPECT_EQ(calls[0].data_source, SRPC_RD_DATA_ARENA);
+  EXPECT_EQ(calls[1].result, SUPLA_RESULT_DATA_ERROR);
+  ASSERT_EQ(keptData.size(), 1);
+
+  // aligned payload doesn't need arena slot
+  appendNewValue(30, 1);
+  iterateAll();
+  ASSERT_EQ(calls.size(), 3);
+  EXPECT_EQ(calls[2].data_source, SRPC_RD_DATA_IN_PLACE);
+  expectNewValue(calls[2], 30, 1);
+
+  // slot is reused after srpc_rd_free()
+  srpc_rd_free(&keptData[0]);
+  keptData.clear();
+  keepData = false;
+  time.hour = 2;
+  appendPacket(SUPLA_DCS_CALL_GET_USER_LOCALTIME_RESULT, &time, timeSize);
+  iterateAll();
+
+  ASSERT_EQ(calls.size(), 4);
+  ASSERT_EQ(calls[3].result, SUPLA_RESULT_TRUE);
+  EXPECT_EQ(calls[3].data_source, SRPC_RD_DATA_ARENA);
+  EXPECT_EQ(memcmp(calls[3].data.data(), &time, timeSize), 0);
+}
@@ -0,0 +1,381 @@
+/*
+ Copyright (C) AC SOFTWARE SP. Z O.O.
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+*/
+
+#include <gtest/gtest.h>
+#include <string.h>
+
+#include <supla/element.h>
+#include <supla/storage/storage.h>
+
+namespace {
+
+class RamStorage : public Supla::Storage {
+ public:
+  explicit RamStorage(unsigned char *data)
+      : data(data), readBytes(0), writtenBytes(0), commits(0) {
+  }
+
+  void commit() override {
+    commits++;
+  }
+
+  int readStorage(unsigned int offset,
+                  unsigned char *buf,
+                  int size,
+                  bool logs = true) override {
+    (void)(logs);
+    memcpy(buf, data + offset, size);
+    readBytes += size;
+    return size;
+  }
+
+  int writeStorage(unsigned int offset,
+                   const unsigned char *buf,
+                   int size) override {
+    memcpy(data + offset, buf, size);
+    writtenBytes += size;
+    return size;
+  }
+
+  void resetCounters() {
+    readBytes = 0;
+    writtenBytes = 0;
+    commits = 0;
+  }
+
+  unsigned char *data;
+  int readBytes;
+  int writtenBytes;
+  int commits;
+};
+
+class StateElement : public Supla::Element {
+ public:
+  explicit StateElement(bool tracking) : value(0), saves(0) {
+    if (tracking) {
+      enableStateChangeTracking();
+    }
+  }
+
+  void setValue(uint32_t newValue) {
+    value = newValue;
+    markStateChanged();
+  }
+
+  void onSaveState() override {
+    saves++;
+    Supla::Storage::WriteState(reinterpret_cast<unsigned char *>(&value),
+                               sizeof(value));
+  }
+
+  void onLoadState() override {
+    Supla::Storage::ReadState(reinterpret_cast<unsigned char *>(&value),
+                              sizeof(value));
+  }
+
+  uint32_t value;
+  int saves;
+};
+
+void saveState(Supla::Element *first, Supla::Element *second) {
+  Supla::Storage::PrepareState();
+  Supla::Storage::SaveElementState(first);
+  Supla::Storage::SaveElementState(second);
+  Supla::Storage::FinalizeSaveState();
+}
+
+// startup sequence from SuplaDeviceClass::begin()
+bool loadState(Supla::Element *first, Supla::Element *second) {
+  Supla::Storage::PrepareState(true);
+  Supla::Storage::SaveElementState(first);
+  Supla::Storage::SaveElementState(second);
+  if (!Supla::Storage::FinalizeSaveState()) {
+    return false;
+  }
+  Supla::Storage::PrepareState();
+  Supla::Storage::LoadElementState(first);
+  Supla::Storage::LoadElementState(second);
+  return true;
+}
+
+void replaceValue(unsigned char *data,
+                  unsigned int size,
+                  uint32_t value,
+                  uint32_t newValue) {
+  for (unsigned int i = 0; i + sizeof(value) <= size; i++) {
+    if (memcmp(data + i, &value, sizeof(value)) == 0) {
+      memcpy(data + i, &newValue, sizeof(newValue));
+    }
+  }
+}
+
+const unsigned int kCopyHeaderSize = sizeof(Supla::StateCopyHeader);
+
+}  // namespace
+
+class StorageTests : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    memset(data, 0xFF, sizeof(data));
+  }
+
+  unsigned char data[128];
+};
+
+TEST_F(StorageTests, OnlyChangedElementIsWrittenWithoutReadBack) {
+  RamStorage storage(data);
+  ASSERT_TRUE(storage.init());
+  StateElement first(true);
+  StateElement second(true);
+
+  // first save creates state section, second one fills the other copy
+  saveState(&first, &second);
+  saveState(&first, &second);
+  EXPECT_EQ(first.saves, 2);
+  EXPECT_EQ(second.saves, 2);
+
+  storage.resetCounters();
+  second.setValue(0x12345678);
+  saveState(&first, &second);
+  // data of unchanged element is collected only to calculate CRC, which is
+  // written with element data
+  EXPECT_EQ(first.saves, 3);
+  EXPECT_EQ(second.saves, 3);
+  EXPECT_EQ(storage.readBytes, 0);
+  EXPECT_EQ(storage.writtenBytes, sizeof(uint32_t) + kCopyHeaderSize);
+  EXPECT_EQ(storage.commits, 1);
+
+  // change is written to the other copy as well
+  storage.resetCounters();
+  saveState(&first, &second);
+  EXPECT_EQ(storage.readBytes, 0);
+  EXPECT_EQ(storage.writtenBytes, sizeof(uint32_t) + kCopyHeaderSize);
+  EXPECT_EQ(storage.commits, 1);
+
+  storage.resetCounters();
+  saveState(&first, &second);
+  EXPECT_EQ(storage.readBytes, 0);
+  EXPECT_EQ(storage.writtenBytes, 0);
+  EXPECT_EQ(storage.commits, 0);
+
+  // written value is placed at element's offset in state section
+  StateElement loaded(true);
+  Supla::Storage::PrepareState();
+  Supla::Storage::LoadElementState(&loaded);
+  Supla::Storage::LoadElementState(&loaded);
+  EXPECT_EQ(loaded.value, 0x12345678);
+
+  // CRC calculated from RAM matches stored copies
+  first.setValue(9);
+  saveState(&first, &second);
+  RamStorage restarted(data);
+  ASSERT_TRUE(restarted.init());
+  StateElement firstLoaded(true);
+  StateElement secondLoaded(true);
+  ASSERT_TRUE(loadState(&firstLoaded, &secondLoaded));
+  EXPECT_EQ(firstLoaded.value, 9);
+  EXPECT_EQ(secondLoaded.value, 0x12345678);
+}
+
+TEST_F(StorageTests, UntrackedElementIsAlwaysWritten) {
+  RamStorage storage(data);
+  ASSERT_TRUE(storage.init());
+  StateElement tracked(true);
+  StateElement untracked(false);
+
+  saveState(&tracked, &untracked);
+  saveState(&tracked, &untracked);
+
+  // untracked element is written without checking storage content
+  storage.resetCounters();
+  saveState(&tracked, &untracked);
+  saveState(&tracked, &untracked);
+  EXPECT_EQ(storage.readBytes, 0);
+  EXPECT_EQ(storage.writtenBytes, 2 * (sizeof(uint32_t) + kCopyHeaderSize));
+}
+
+TEST_F(StorageTests, CorruptedCopyFallsBackToPreviousOne) {
+  {
+    RamStorage storage(data);
+    ASSERT_TRUE(storage.init());
+    StateElement first(true);
+    StateElement second(true);
+    first.setValue(1);
+    second.setValue(2);
+    saveState(&first, &second);
+    second.setValue(5);
+    saveState(&first, &second);
+  }
+
+  {
+    RamStorage storage(data);
+    ASSERT_TRUE(storage.init());
+    StateElement first(false);
+    StateElement second(false);
+    ASSERT_TRUE(loadState(&first, &second));
+    EXPECT_EQ(second.value, 5);
+  }
+
+  // corrupt value of the second element in newer copy
+  replaceValue(data, sizeof(data), 5, 6);
+
+  {
+    RamStorage storage(data);
+    ASSERT_TRUE(storage.init());
+    StateElement first(false);
+    StateElement second(false);
+    ASSERT_TRUE(loadState(&first, &second));
+    EXPECT_EQ(first.value, 1);
+    EXPECT_EQ(second.value, 2);
+  }
+
+  // corrupt older copy too
+  replaceValue(data, sizeof(data), 2, 3);
+
+  RamStorage storage(data);
+  ASSERT_TRUE(storage.init());
+  StateElement first(false);
+  StateElement second(false);
+  EXPECT_FALSE(loadState(&first, &second));
+}
+
+TEST_F(StorageTests, InterruptedSaveKeepsPreviousState) {
+  {
+    RamStorage storage(data);
+    ASSERT_TRUE(storage.init());
+    StateElement first(true);
+    StateElement second(true);
+    first.setValue(1);
+    second.setValue(2);
+    saveState(&first, &second);
+    saveState(&first, &second);
+
+    // power loss before copy header is written
+    second.setValue(7);
+    Supla::Storage::PrepareState();
+    Supla::Storage::SaveElementState(&first);
+    Supla::Storage::SaveElementState(&second);
+  }
+
+  RamStorage storage(data);
+  ASSERT_TRUE(storage.init());
+  StateElement first(false);
+  StateElement second(false);
+  ASSERT_TRUE(loadState(&first, &second));
+  EXPECT_EQ(first.value, 1);
+  EXPECT_EQ(second.value, 2);
+}
+
+TEST_F(StorageTests, SavesAlternateBetweenCopies) {
+  for (uint32_t i = 1; i <= 5; i++) {
+    RamStorage storage(data);
+    ASSERT_TRUE(storage.init());
+    StateElement first(true);
+    StateElement second(true);
+    if (i > 1) {
+      ASSERT_TRUE(loadState(&first, &second));
+      EXPECT_EQ(second.value, i - 1);
+    }
+    second.setValue(i);
+    saveState(&first, &second);
+  }
+
+  // both copies are valid, newer one has higher generation
+  Supla::StateCopyHeader header[2];
+  unsigned int copyOffset = sizeof(Supla::Preamble) +
+                            sizeof(Supla::SectionPreamble);
+  memcpy(&header[0], data + copyOffset, sizeof(header[0]));
+  copyOffset += kCopyHeaderSize + 2 * sizeof(uint32_t);
+  memcpy(&header[1], data + copyOffset, sizeof(header[1]));
+  EXPECT_EQ(header[0].generation, 5);
+  EXPECT_EQ(header[1].generation, 4);
+  EXPECT_EQ(data[copyOffset + kCopyHeaderSize + sizeof(uint32_t)], 4);
+}
+
+TEST_F(StorageTests, LegacyStateSectionIsConverted) {
+  Supla::Preamble preamble;
+  memcpy(preamble.suplaTag, "SUPLA", 5);
+  preamble.version = 1;
+  preamble.sectionsCount = 1;
+  Supla::SectionPreamble section;
+  section.type = STORAGE_SECTION_TYPE_ELEMENT_STATE;
+  section.size = 2 * sizeof(uint32_t);
+  section.crc1 = 0;
+  section.crc2 = 0;
+  uint32_t values[2] = {11, 12};
+  memcpy(data, &preamble, sizeof(preamble));
+  memcpy(data + sizeof(preamble), &section, sizeof(section));
+  memcpy(data + sizeof(preamble) + sizeof(section), values, sizeof(values));
+
+  {
+    RamStorage storage(data);
+    ASSERT_TRUE(storage.init());
+    StateElement first(true);
+    StateElement second(true);
+    ASSERT_TRUE(loadState(&first, &second));
+    EXPECT_EQ(first.value, 11);
+    EXPECT_EQ(second.value, 12);
+    saveState(&first, &second);
+  }
+
+  memcpy(&section, data + sizeof(preamble), sizeof(section));
+  EXPECT_EQ(section.type, STORAGE_SECTION_TYPE_ELEMENT_STATE_AB);
+
+  RamStorage storage(data);
+  ASSERT_TRUE(storage.init());
+  StateElement first(true);
+  StateElement second(true);
+  ASSERT_TRUE(loadState(&first, &second));
+  EXPECT_EQ(first.value, 11);
+  EXPECT_EQ(second.value, 12);
+}
+
+TEST_F(StorageTests, LoadedStateIsNotWrittenAgain) {
+  {
+    RamStorage storage(data);
+    ASSERT_TRUE(storage.init());
+    StateElement first(true);
+    StateElement second(true);
+    first.setValue(1);
+    second.setValue(2);
+    saveState(&first, &second);
+    saveState(&first, &second);
+  }
+
+  RamStorage storage(data);
+  ASSERT_TRUE(storage.init());
+  StateElement first(true);
+  StateElement second(true);
+
+  ASSERT_TRUE(loadState(&first, &second));
+  EXPECT_EQ(first.value, 1);
+  EXPECT_EQ(second.value, 2);
+
+  // after restart inactive copy is refreshed once, only its header changes
+  storage.resetCounters();
+  saveState(&first, &second);
+  EXPECT_EQ(storage.writtenBytes, kCopyHeaderSize);
+  EXPECT_FALSE(first.isStateChanged());
+
+  storage.resetCounters();
+  saveState(&first, &second);
+  EXPECT_EQ(storage.writtenBytes, 0);
+
+  first.setValue(3);
+  saveState(&first, &second);
+  EXPECT_EQ(storage.readBytes, 0);
+  EXPECT_EQ(storage.writtenBytes, sizeof(uint32_t) + kCopyHeaderSize);
+}
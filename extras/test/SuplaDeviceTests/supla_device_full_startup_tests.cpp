@@ -42,13 +42,13 @@ class SuplaDeviceTests : public ::testing::Test {
 
 };
 
-class TimeInterfaceStub : public TimeInterface {
+class TimeInterfaceStepStub : public TimeInterface {
   public:
     virtual unsigned long millis() override {
-      static unsigned long value = 0;
       value += 1000;
       return value;
     }
+    unsigned long value = 0;
 };
 
 class StorageMock2: public Supla::Storage {
@@ -99,7 +99,7 @@ class SuplaDeviceTestsFullStartup : public SuplaDeviceTests {
     SrpcMock srpc;
     NetworkMock net;
     TimerMock timer;
-    TimeInterfaceStub time;
+    TimeInterfaceStepStub time;
     SuplaDeviceClass sd;
     ElementMock el1;
     ElementMock el2;
@@ -133,26 +133,51 @@ using ::testing::AtLeast;
 
 TEST_F(SuplaDeviceTestsFullStartup, NoNetworkShouldCallSetupAgain) {
   EXPECT_CALL(net, isReady()).WillRepeatedly(Return(false));
-  EXPECT_CALL(net, setup()).Times(2);
+  // interface bring up is polled while network is not ready
+  EXPECT_CALL(net, iterate()).Times(AtLeast(1));
+  std::vector<unsigned long> setups;
+  EXPECT_CALL(net, setup()).WillRepeatedly([&]() {
+    setups.push_back(time.value);
+  });
   EXPECT_CALL(el1, iterateAlways()).Times(AtLeast(1));
   EXPECT_CALL(el2, iterateAlways()).Times(AtLeast(1));
 
-  for (int i = 0; i < 50*30; i++) sd.iterate();
+  unsigned long start = time.value;
+  while (time.value - start < 5 * SUPLA_NETWORK_RESTART_MS) sd.iterate();
   EXPECT_EQ(sd.getCurrentStatus(), STATUS_NETWORK_DISCONNECTED);
+
+  // network is set up again after each minute without connection
+  ASSERT_GE(setups.size(), 2);
+  EXPECT_GT(setups[0] - start, SUPLA_NETWORK_RESTART_MS);
+  for (size_t i = 1; i < setups.size(); i++) {
+    EXPECT_GT(setups[i] - setups[i - 1], SUPLA_NETWORK_RESTART_MS);
+  }
 }
 
 TEST_F(SuplaDeviceTestsFullStartup, FailedConnectionShouldSetupNetworkAgain) {
   EXPECT_CALL(net, isReady()).WillRepeatedly(Return(true));
   EXPECT_CALL(net, connected()).WillRepeatedly(Return(false));
   EXPECT_CALL(net, connect(_, _)).WillRepeatedly(Return(0));
+  EXPECT_CALL(net, iterate()).Times(AtLeast(1));
   EXPECT_CALL(net, disconnect()).Times(AtLeast(1));
 
-  EXPECT_CALL(net, setup()).Times(1);
+  std::vector<unsigned long> setups;
+  EXPECT_CALL(net, setup()).WillRepeatedly([&]() {
+    setups.push_back(time.value);
+  });
   EXPECT_CALL(el1, iterateAlways()).Times(AtLeast(1));
   EXPECT_CALL(el2, iterateAlways()).Times(AtLeast(1));
 
-  for (int i = 0; i < 2*31; i++) sd.iterate();
+  unsigned long start = time.value;
+  while (time.value - start < 3 * SUPLA_NETWORK_RESTART_MS) sd.iterate();
   EXPECT_EQ(sd.getCurrentStatus(), STATUS_SERVER_DISCONNECTED);
+
+  // network is set up again after a minute of failed attempts, regardless of
+  // their number limited by reconnect backoff
+  ASSERT_GE(setups.size(), 1);
+  EXPECT_GT(setups[0] - start, SUPLA_NETWORK_RESTART_MS);
+  EXPECT_LE(setups[0] - start,
+            SUPLA_NETWORK_RESTART_MS + SUPLA_RECONNECT_CAP_MS);
 }
 
 TEST_F(SuplaDeviceTestsFullStartup, SrpcFailureShouldCallDisconnect) {
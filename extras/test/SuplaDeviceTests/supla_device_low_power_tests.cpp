@@ -0,0 +1,274 @@
+/*
+ Copyright (C) AC SOFTWARE SP. Z O.O.
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+*/
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <arduino_mock.h>
+#include <srpc_mock.h>
+#include <timer_mock.h>
+#include <SuplaDevice.h>
+#include <supla/element.h>
+#include <supla/scheduler.h>
+
+#include <iostream>
+
+using ::testing::_;
+using ::testing::NiceMock;
+using ::testing::Return;
+
+// Simulated clock. Time advances only when device is sleeping or when
+// simulation loop adds time spent on active work.
+class SimulatedTime : public TimeInterface {
+ public:
+  SimulatedTime() : now(0) {
+  }
+  unsigned long millis() override {
+    return now;
+  }
+  unsigned long now;
+};
+
+class SimulatedNetwork : public Supla::Network {
+ public:
+  SimulatedNetwork() : Supla::Network(nullptr) {
+  }
+  int read(void *, int) override {
+    return 0;
+  }
+  int write(void *, int count) override {
+    return count;
+  }
+  int connect(const char *, int) override {
+    isConnected = true;
+    return 1;
+  }
+  bool connected() override {
+    return isConnected;
+  }
+  void disconnect() override {
+    isConnected = false;
+  }
+  void setup() override {
+  }
+  bool isReady() override {
+    return true;
+  }
+  bool isConnected = false;
+};
+
+// Element reading sensor every 10 s from scheduler, like thermometers
+class PeriodicSensor : public Supla::Element, public Supla::ScheduledTask {
+ public:
+  PeriodicSensor() : readCount(0) {
+    declareHook(Supla::HOOK_NONE);
+    scheduleTaskAt(10000, 10000);
+  }
+  void runTask() override {
+    readCount++;
+  }
+  int readCount;
+};
+
+class SuplaDeviceLowPowerTests : public ::testing::Test {
+ protected:
+  virtual void SetUp() {
+    Supla::Channel::lastCommunicationTimeMs = 0;
+    memset(&(Supla::Channel::reg_dev), 0, sizeof(Supla::Channel::reg_dev));
+  }
+  virtual void TearDown() {
+    Supla::Channel::lastCommunicationTimeMs = 0;
+    memset(&(Supla::Channel::reg_dev), 0, sizeof(Supla::Channel::reg_dev));
+  }
+
+  // Runs device for simulated durationMs. Each iterate() call is assumed to
+  // take 1 ms of active CPU time. Returns duty cycle in %.
+  double simulate(bool lowPowerMode, unsigned long durationMs) {
+    NiceMock<SrpcMock> srpc;
+    NiceMock<TimerMock> timer;
+    SimulatedTime time;
+    SimulatedNetwork net;
+    SuplaDeviceClass sd;
+    PeriodicSensor sensor;
+    int dummy = 0;
+    unsigned long activeMs = 0;
+    unsigned long sleepMs = 0;
+    int pingCount = 0;
+
+    ON_CALL(srpc, srpc_init(_)).WillByDefault(Return(&dummy));
+    ON_CALL(srpc, srpc_iterate(_)).WillByDefault(Return(SUPLA_RESULT_TRUE));
+    // server replies to each ping immediately
+    ON_CALL(srpc, srpc_dcs_async_ping_server(_))
+        .WillByDefault([&](void *) {
+          pingCount++;
+          net.updateLastSent();
+          net.updateLastResponse();
+          return 1;
+        });
+    ON_CALL(timer, lightSleep(_)).WillByDefault([&](unsigned long ms) {
+      time.now += ms;
+      sleepMs += ms;
+    });
+    EXPECT_CALL(timer, initTimers());
+
+    char GUID[SUPLA_GUID_SIZE] = {1};
+    char AUTHKEY[SUPLA_AUTHKEY_SIZE] = {2};
+    EXPECT_TRUE(
+        sd.begin(GUID, "supla.rulez", "superman@supla.org", AUTHKEY));
+    sd.setLowPowerMode(lowPowerMode);
+
+    // timers are not needed by any element
+    EXPECT_EQ(Supla::Element::begin(Supla::HOOK_ON_TIMER), nullptr);
+    EXPECT_EQ(Supla::Element::begin(Supla::HOOK_ON_FAST_TIMER), nullptr);
+
+    sd.iterate();
+    TSD_SuplaRegisterDeviceResult registerResult{};
+    registerResult.result_code = SUPLA_RESULTCODE_TRUE;
+    registerResult.activity_timeout = ACTIVITY_TIMEOUT;
+    registerResult.version = 12;
+    registerResult.version_min = 1;
+    sd.onRegisterResult(&registerResult);
+    EXPECT_EQ(sd.getCurrentStatus(), STATUS_REGISTERED_AND_READY);
+
+    while (time.now < durationMs) {
+      sd.iterate();
+      time.now++;
+      activeMs++;
+    }
+
+    EXPECT_EQ(sd.getCurrentStatus(), STATUS_REGISTERED_AND_READY);
+    // sensor was read every 10 s
+    EXPECT_GE(sensor.readCount, durationMs / 10000 - 1);
+    EXPECT_LE(sensor.readCount, durationMs / 10000);
+    // keep alive is sent every (ACTIVITY_TIMEOUT - 5) s
+    EXPECT_GE(pingCount, durationMs / ((ACTIVITY_TIMEOUT - 5) * 1000) - 1);
+
+    double dutyCycle = 100.0 * activeMs / (activeMs + sleepMs);
+    std::cout << "Low power mode " << (lowPowerMode ? "on" : "off")
+              << ": active " << activeMs << " ms, sleep " << sleepMs
+              << " ms, duty cycle " << dutyCycle << " %" << std::endl;
+    return dutyCycle;
+  }
+};
+
+TEST_F(SuplaDeviceLowPowerTests, DutyCycleSimulation) {
+  const unsigned long tenMinutes = 10 * 60 * 1000;
+  double dutyCycleOff = simulate(false, tenMinutes);
+  double dutyCycleOn = simulate(true, tenMinutes);
+
+  RecordProperty("DutyCycleLowPowerOffPercent",
+                 std::to_string(dutyCycleOff));
+  RecordProperty("DutyCycleLowPowerOnPercent", std::to_string(dutyCycleOn));
+
+  EXPECT_DOUBLE_EQ(dutyCycleOff, 100.0);
+  // device wakes up at least once per second (default max sleep time), for
+  // sensor reads and for keep alive pings
+  EXPECT_LT(dutyCycleOn, 0.5);
+}
+
+TEST_F(SuplaDeviceLowPowerTests, WakeupIsLimitedByIterateAlwaysElements) {
+  NiceMock<SrpcMock> srpc;
+  NiceMock<TimerMock> timer;
+  SimulatedTime time;
+  SimulatedNetwork net;
+  SuplaDeviceClass sd;
+  PeriodicSensor sensor;
+  Supla::Element pollingElement;
+  int dummy = 0;
+
+  ON_CALL(srpc, srpc_init(_)).WillByDefault(Return(&dummy));
+  char GUID[SUPLA_GUID_SIZE] = {1};
+  char AUTHKEY[SUPLA_AUTHKEY_SIZE] = {2};
+  EXPECT_TRUE(sd.begin(GUID, "supla.rulez", "superman@supla.org", AUTHKEY));
+  sd.setLowPowerMode(true, 5000);
+
+  // not registered yet - network requires constant activity
+  EXPECT_EQ(sd.getTimeToNextWakeup(0), 0);
+
+  TSD_SuplaRegisterDeviceResult registerResult{};
+  registerResult.result_code = SUPLA_RESULTCODE_TRUE;
+  registerResult.activity_timeout = ACTIVITY_TIMEOUT;
+  registerResult.version = 12;
+  registerResult.version_min = 1;
+  sd.onRegisterResult(&registerResult);
+
+  // element without declared hooks implements iterateAlways()
+  EXPECT_EQ(sd.getTimeToNextWakeup(0),
+            LOW_POWER_ITERATE_ALWAYS_PERIOD_MS);
+}
+
+// Network which reports readiness of socket, like LinuxNetwork
+class ReadinessNetwork : public SimulatedNetwork {
+ public:
+  bool hasData() override {
+    return pendingData;
+  }
+  bool waitForData(unsigned long timeoutMs) override {
+    waitTimeMs += timeoutMs;
+    return true;
+  }
+  bool pendingData = false;
+  unsigned long waitTimeMs = 0;
+};
+
+TEST_F(SuplaDeviceLowPowerTests, SrpcIsIteratedOnlyWhenDataIsPending) {
+  NiceMock<SrpcMock> srpc;
+  NiceMock<TimerMock> timer;
+  SimulatedTime time;
+  ReadinessNetwork net;
+  SuplaDeviceClass sd;
+  int dummy = 0;
+
+  ON_CALL(srpc, srpc_init(_)).WillByDefault(Return(&dummy));
+  char GUID[SUPLA_GUID_SIZE] = {1};
+  char AUTHKEY[SUPLA_AUTHKEY_SIZE] = {2};
+  EXPECT_TRUE(sd.begin(GUID, "supla.rulez", "superman@supla.org", AUTHKEY));
+
+  EXPECT_CALL(srpc, srpc_iterate(_)).Times(0);
+  EXPECT_CALL(srpc, srpc_ds_async_registerdevice_e(_, _)).Times(1);
+  sd.iterate();
+  time.now += 1000;
+  sd.iterate();
+  EXPECT_EQ(sd.getCurrentStatus(), STATUS_REGISTER_IN_PROGRESS);
+  ::testing::Mock::VerifyAndClearExpectations(&srpc);
+
+  // data on socket
+  net.pendingData = true;
+  EXPECT_CALL(srpc, srpc_iterate(_)).WillOnce(Return(SUPLA_RESULT_TRUE));
+  sd.iterate();
+  ::testing::Mock::VerifyAndClearExpectations(&srpc);
+
+  // next packet left in SRPC input buffer
+  net.pendingData = false;
+  EXPECT_CALL(srpc, srpc_input_packet_available(_))
+      .WillRepeatedly(Return(SUPLA_RESULT_TRUE));
+  EXPECT_CALL(srpc, srpc_iterate(_)).WillOnce(Return(SUPLA_RESULT_TRUE));
+  sd.iterate();
+  ::testing::Mock::VerifyAndClearExpectations(&srpc);
+
+  TSD_SuplaRegisterDeviceResult registerResult{};
+  registerResult.result_code = SUPLA_RESULTCODE_TRUE;
+  registerResult.activity_timeout = ACTIVITY_TIMEOUT;
+  registerResult.version = 12;
+  registerResult.version_min = 1;
+  sd.onRegisterResult(&registerResult);
+
+  // in low power mode device waits on network instead of sleeping
+  sd.setLowPowerMode(true, 500);
+  EXPECT_CALL(srpc, srpc_iterate(_)).Times(0);
+  EXPECT_CALL(timer, lightSleep(_)).Times(0);
+  sd.iterate();
+  EXPECT_EQ(net.waitTimeMs, 500);
+}
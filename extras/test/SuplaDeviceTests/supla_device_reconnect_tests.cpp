@@ -0,0 +1,265 @@
+/*
+ Copyright (C) AC SOFTWARE SP. Z O.O.
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+*/
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <arduino_mock.h>
+#include <srpc_mock.h>
+#include <timer_mock.h>
+#include <SuplaDevice.h>
+
+#include <algorithm>
+#include <iostream>
+#include <map>
+#include <vector>
+
+using ::testing::_;
+using ::testing::NiceMock;
+using ::testing::Return;
+
+namespace {
+
+class SimulatedTime : public TimeInterface {
+ public:
+  unsigned long millis() override {
+    return now;
+  }
+  unsigned long now = 0;
+};
+
+// Server which is down until serverUpAtMs. When restartAtMs is set, server
+// closes all connections at that time and doesn't accept new ones for
+// restartDurationMs. Each connection attempt is recorded.
+class ServerNetwork : public Supla::Network {
+ public:
+  ServerNetwork(SimulatedTime *time,
+                unsigned long serverUpAtMs,
+                unsigned long restartAtMs = 0,
+                unsigned long restartDurationMs = 0)
+      : Supla::Network(nullptr),
+        time(time),
+        serverUpAtMs(serverUpAtMs),
+        restartAtMs(restartAtMs),
+        restartDurationMs(restartDurationMs) {
+  }
+  int read(void *, int) override {
+    return -1;
+  }
+  int write(void *, int count) override {
+    return count;
+  }
+  int connect(const char *, int) override {
+    attempts.push_back(time->now);
+    isConnected = time->now >= serverUpAtMs && !isRestarting();
+    return isConnected ? 1 : 0;
+  }
+  bool connected() override {
+    if (isRestarting()) {
+      isConnected = false;
+    }
+    return isConnected;
+  }
+  void disconnect() override {
+    isConnected = false;
+  }
+  void setup() override {
+    setups.push_back(time->now);
+  }
+  bool isReady() override {
+    return true;
+  }
+
+  bool isRestarting() {
+    return restartAtMs != 0 && time->now >= restartAtMs &&
+           time->now < restartAtMs + restartDurationMs;
+  }
+
+  SimulatedTime *time;
+  unsigned long serverUpAtMs;
+  unsigned long restartAtMs;
+  unsigned long restartDurationMs;
+  bool isConnected = false;
+  std::vector<unsigned long> attempts;
+  std::vector<unsigned long> setups;
+};
+
+}  // namespace
+
+class SuplaDeviceReconnectTests : public ::testing::Test {
+ protected:
+  virtual void SetUp() {
+    memset(&(Supla::Channel::reg_dev), 0, sizeof(Supla::Channel::reg_dev));
+  }
+  virtual void TearDown() {
+    memset(&(Supla::Channel::reg_dev), 0, sizeof(Supla::Channel::reg_dev));
+  }
+
+  // Runs one device, which starts together with all other devices (i.e.
+  // after power outage) while server is down, or is connected when server
+  // restarts. Returns times of connection attempts. Times of network setup
+  // are stored in "setups" when it is given.
+  std::vector<unsigned long> simulateDevice(
+      int deviceId,
+      unsigned long serverUpAtMs,
+      unsigned long durationMs,
+      unsigned long restartAtMs = 0,
+      unsigned long restartDurationMs = 0,
+      std::vector<unsigned long> *setups = nullptr) {
+    NiceMock<SrpcMock> srpc;
+    NiceMock<TimerMock> timer;
+    SimulatedTime time;
+    ServerNetwork net(&time, serverUpAtMs, restartAtMs, restartDurationMs);
+    SuplaDeviceClass sd;
+    int dummy = 0;
+
+    ON_CALL(srpc, srpc_init(_)).WillByDefault(Return(&dummy));
+    ON_CALL(srpc, srpc_iterate(_)).WillByDefault(Return(SUPLA_RESULT_TRUE));
+    ON_CALL(srpc, srpc_ds_async_registerdevice_e(_, _))
+        .WillByDefault([&](void *, TDS_SuplaRegisterDevice_E *) {
+          TSD_SuplaRegisterDeviceResult result{};
+          result.result_code = SUPLA_RESULTCODE_TRUE;
+          result.activity_timeout = ACTIVITY_TIMEOUT;
+          sd.onRegisterResult(&result);
+          return 1;
+        });
+    // server replies to each ping once it is up
+    ON_CALL(srpc, srpc_dcs_async_ping_server(_)).WillByDefault([&](void *) {
+      net.updateLastSent();
+      net.updateLastResponse();
+      return 1;
+    });
+
+    char GUID[SUPLA_GUID_SIZE] = {};
+    GUID[0] = deviceId & 0xFF;
+    GUID[1] = (deviceId >> 8) & 0xFF;
+    char AUTHKEY[SUPLA_AUTHKEY_SIZE] = {2};
+    EXPECT_TRUE(sd.begin(GUID, "supla.rulez", "superman@supla.org", AUTHKEY));
+
+    while (time.now < durationMs) {
+      sd.iterate();
+      time.now += 10;
+    }
+
+    EXPECT_EQ(sd.getCurrentStatus(), STATUS_REGISTERED_AND_READY);
+    if (setups) {
+      *setups = net.setups;
+    }
+    return net.attempts;
+  }
+};
+
+TEST_F(SuplaDeviceReconnectTests, ReconnectAttemptsOfManyDevicesAreSpread) {
+  const int deviceCount = 100;
+  const unsigned long serverUpAtMs = 60000;
+  const unsigned long durationMs = 180000;
+
+  // number of connection attempts in each second of simulation
+  std::map<unsigned long, int> attemptsPerSecond;
+  std::vector<unsigned long> firstSuccess;
+  int totalAttempts = 0;
+
+  for (int id = 1; id <= deviceCount; id++) {
+    auto attempts = simulateDevice(id, serverUpAtMs, durationMs);
+    ASSERT_FALSE(attempts.empty());
+    // all devices start at the same time
+    EXPECT_EQ(attempts.front(), 0);
+    for (auto ms : attempts) {
+      attemptsPerSecond[ms / 1000]++;
+    }
+    totalAttempts += attempts.size();
+    // device stops trying after first successful attempt
+    EXPECT_GE(attempts.back(), serverUpAtMs);
+    firstSuccess.push_back(attempts.back());
+  }
+
+  // first retries are drawn from [0, base] range, so they are still dense
+  int peakAfterStart = 0;
+  for (auto &bucket : attemptsPerSecond) {
+    if (bucket.first >= 10 && bucket.second > peakAfterStart) {
+      peakAfterStart = bucket.second;
+    }
+  }
+  std::sort(firstSuccess.begin(), firstSuccess.end());
+  unsigned long spreadMs = firstSuccess.back() - firstSuccess.front();
+
+  std::cout << deviceCount << " devices, " << totalAttempts
+            << " connection attempts, first attempt of all devices at 0 s, "
+            << "peak after 10 s: " << peakAfterStart << " attempts/s, "
+            << "reconnections after server start spread over " << spreadMs
+            << " ms" << std::endl;
+  for (unsigned long second = 0; second < durationMs / 1000; second += 10) {
+    int count = 0;
+    for (unsigned long s = second; s < second + 10; s++) {
+      count += attemptsPerSecond[s];
+    }
+    std::cout << "  " << second << "-" << second + 9 << " s: " << count
+              << std::endl;
+  }
+  RecordProperty("PeakAttemptsPerSecond", std::to_string(peakAfterStart));
+  RecordProperty("ReconnectionSpreadMs", std::to_string(spreadMs));
+
+  // devices which started together don't hit the server together later
+  EXPECT_LT(peakAfterStart, deviceCount / 4);
+  // server is not flooded with registrations when it comes back
+  EXPECT_GT(spreadMs, 20000);
+  // backoff limits number of attempts while server is down
+  EXPECT_LT(totalAttempts, deviceCount * 15);
+}
+
+TEST_F(SuplaDeviceReconnectTests, RegisteredDevicesDontReconnectTogether) {
+  const int deviceCount = 100;
+  const unsigned long restartAtMs = 30000;
+  const unsigned long restartDurationMs = 500;
+  const unsigned long durationMs = 60000;
+
+  std::vector<unsigned long> firstAfterRestart;
+  for (int id = 1; id <= deviceCount; id++) {
+    auto attempts =
+        simulateDevice(id, 0, durationMs, restartAtMs, restartDurationMs);
+    // registered at start, then reconnected after restart
+    ASSERT_GE(attempts.size(), 2);
+    EXPECT_EQ(attempts.front(), 0);
+    EXPECT_GE(attempts[1], restartAtMs);
+    firstAfterRestart.push_back(attempts[1]);
+  }
+
+  // each device waits random time (up to base delay) after connection is
+  // lost, instead of connecting right away
+  int immediate = std::count(
+      firstAfterRestart.begin(), firstAfterRestart.end(), restartAtMs);
+  std::sort(firstAfterRestart.begin(), firstAfterRestart.end());
+  unsigned long spreadMs = firstAfterRestart.back() - firstAfterRestart.front();
+
+  EXPECT_LT(immediate, deviceCount / 20);
+  EXPECT_GT(spreadMs, SUPLA_RECONNECT_BASE_MS / 2);
+  EXPECT_LE(firstAfterRestart.back(), restartAtMs + SUPLA_RECONNECT_BASE_MS);
+}
+
+TEST_F(SuplaDeviceReconnectTests, NetworkIsRestartedAfterMinuteOfFailures) {
+  std::vector<unsigned long> setups;
+  simulateDevice(1, 300000, 360000, 0, 0, &setups);
+
+  // setup in begin(), then after each minute of failed attempts, even though
+  // backoff limits their number. Restart waits for the end of current
+  // backoff delay.
+  ASSERT_GE(setups.size(), 3);
+  EXPECT_EQ(setups[0], 0);
+  for (size_t i = 1; i < setups.size(); i++) {
+    EXPECT_GT(setups[i] - setups[i - 1], SUPLA_NETWORK_RESTART_MS);
+    EXPECT_LE(setups[i] - setups[i - 1],
+              SUPLA_NETWORK_RESTART_MS + SUPLA_RECONNECT_CAP_MS);
+  }
+}
@@ -389,6 +389,7 @@ TEST_F(SuplaDeviceTests, TwoChannelElementsNoNetworkWithStorage) {
   EXPECT_CALL(el1, iterateAlways()).Times(2);
   EXPECT_CALL(el2, iterateAlways()).Times(2);
   EXPECT_CALL(net, isReady()).WillRepeatedly(Return(false));
+  EXPECT_CALL(net, iterate()).Times(2);
 
   EXPECT_CALL(storage, prepareState(false));
   EXPECT_CALL(el1, onSaveState());
@@ -398,6 +399,57 @@ TEST_F(SuplaDeviceTests, TwoChannelElementsNoNetworkWithStorage) {
   for (int i = 0; i < 2; i++) sd.iterate();
 }
 
+TEST_F(SuplaDeviceTests, StateSaveIsSplitBetweenIterations) {
+  SrpcMock srpc;
+  NetworkMock net;
+  StorageMock2 storage;
+  TimerMock timer;
+  TimeInterfaceStub time;
+  SuplaDeviceClass sd;
+  ElementMock el[SUPLA_STATE_SAVE_SLICE + 1];
+  int dummy;
+  EXPECT_CALL(storage, init());
+  EXPECT_CALL(storage, prepareState(true)).WillOnce(Return(true));
+  EXPECT_CALL(storage, finalizeSaveState()).WillOnce(Return(true));
+  EXPECT_CALL(storage, prepareState(false));
+  for (auto &element : el) {
+    EXPECT_CALL(element, onSaveState());
+    EXPECT_CALL(element, onLoadState());
+    EXPECT_CALL(element, onInit());
+  }
+
+  EXPECT_CALL(timer, initTimers());
+  EXPECT_CALL(net, setup());
+  EXPECT_CALL(srpc, srpc_params_init(_));
+  EXPECT_CALL(srpc, srpc_init(_)).WillOnce(Return(&dummy));
+  EXPECT_CALL(srpc, srpc_set_proto_version(&dummy, 12));
+
+  char GUID[SUPLA_GUID_SIZE] = {1};
+  char AUTHKEY[SUPLA_AUTHKEY_SIZE] = {2};
+  EXPECT_TRUE(sd.begin(GUID, "supla.rulez", "superman@supla.org", AUTHKEY));
+  ::testing::Mock::VerifyAndClearExpectations(&storage);
+  for (auto &element : el) {
+    ::testing::Mock::VerifyAndClearExpectations(&element);
+    EXPECT_CALL(element, iterateAlways()).Times(2);
+  }
+  EXPECT_CALL(net, isReady()).WillRepeatedly(Return(false));
+  EXPECT_CALL(net, iterate()).Times(2);
+
+  // first iteration saves state of SUPLA_STATE_SAVE_SLICE elements
+  EXPECT_CALL(storage, prepareState(false));
+  for (int i = 0; i < SUPLA_STATE_SAVE_SLICE; i++) {
+    EXPECT_CALL(el[i], onSaveState());
+  }
+  EXPECT_CALL(storage, finalizeSaveState()).Times(0);
+  sd.iterate();
+  EXPECT_EQ(sd.getTimeToNextWakeup(0), 0);
+  ::testing::Mock::VerifyAndClearExpectations(&storage);
+
+  EXPECT_CALL(el[SUPLA_STATE_SAVE_SLICE], onSaveState());
+  EXPECT_CALL(storage, finalizeSaveState()).WillOnce(Return(true));
+  sd.iterate();
+}
+
 TEST_F(SuplaDeviceTests, OnVersionErrorShouldCallDisconnect) {
   NetworkMock net;
   TimeInterfaceStub time;
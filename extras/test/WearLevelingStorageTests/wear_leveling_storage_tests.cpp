@@ -0,0 +1,160 @@
+/*
+ Copyright (C) AC SOFTWARE SP. Z O.O.
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+*/
+
+#include <gtest/gtest.h>
+#include <string.h>
+
+#include <supla/storage/wear_leveling_storage.h>
+
+namespace {
+
+const int kBlockSize = 256;
+const int kBlockCount = 4;
+
+// Flash simulation: erase sets bytes to 0xFF, write can only clear bits
+class FlashMedium {
+ public:
+  FlashMedium() {
+    memset(bytes, 0xFF, sizeof(bytes));
+    memset(erases, 0, sizeof(erases));
+  }
+
+  unsigned char bytes[kBlockSize * kBlockCount];
+  int erases[kBlockCount];
+};
+
+class SimulatedFlashStorage : public Supla::WearLevelingStorage {
+ public:
+  SimulatedFlashStorage(FlashMedium *medium, unsigned int size)
+      : Supla::WearLevelingStorage(size, kBlockSize, kBlockCount),
+        medium(medium) {
+  }
+
+  bool readMedium(uint32_t address, unsigned char *buf, int size) override {
+    memcpy(buf, medium->bytes + address, size);
+    return true;
+  }
+
+  bool writeMedium(uint32_t address,
+                   const unsigned char *buf,
+                   int size) override {
+    EXPECT_EQ(address % 4, 0);
+    EXPECT_EQ(size % 4, 0);
+    for (int i = 0; i < size; i++) {
+      medium->bytes[address + i] &= buf[i];
+    }
+    return true;
+  }
+
+  bool eraseBlock(int block) override {
+    memset(medium->bytes + block * kBlockSize, 0xFF, kBlockSize);
+    medium->erases[block]++;
+    return true;
+  }
+
+  FlashMedium *medium;
+};
+
+void saveCounter(uint32_t value) {
+  Supla::Storage::PrepareState();
+  Supla::Storage::WriteState(reinterpret_cast<unsigned char *>(&value),
+                             sizeof(value));
+  Supla::Storage::FinalizeSaveState();
+  Supla::Storage::Instance()->commit();
+}
+
+uint32_t loadCounter() {
+  uint32_t value = 0;
+  EXPECT_TRUE(Supla::Storage::PrepareState(true));
+  Supla::Storage::WriteState(reinterpret_cast<unsigned char *>(&value),
+                             sizeof(value));
+  EXPECT_TRUE(Supla::Storage::FinalizeSaveState());
+  Supla::Storage::PrepareState();
+  Supla::Storage::ReadState(reinterpret_cast<unsigned char *>(&value),
+                            sizeof(value));
+  return value;
+}
+
+}  // namespace
+
+TEST(WearLevelingStorageTests, NewestRecordIsLoaded) {
+  FlashMedium medium;
+  {
+    SimulatedFlashStorage storage(&medium, 60);
+    ASSERT_TRUE(storage.init());
+    for (uint32_t i = 1; i <= 10; i++) {
+      saveCounter(i);
+    }
+  }
+
+  SimulatedFlashStorage storage(&medium, 60);
+  ASSERT_TRUE(storage.init());
+  EXPECT_EQ(loadCounter(), 10);
+}
+
+TEST(WearLevelingStorageTests, ErasesAreSpreadOverBlocks) {
+  FlashMedium medium;
+  SimulatedFlashStorage storage(&medium, 60);
+  ASSERT_TRUE(storage.init());
+
+  // 3 records of 72 bytes fit in 256 byte block
+  for (uint32_t i = 1; i <= 120; i++) {
+    saveCounter(i);
+  }
+  for (int i = 0; i < kBlockCount; i++) {
+    EXPECT_GE(medium.erases[i], 9);
+    EXPECT_LE(medium.erases[i], 11);
+  }
+}
+
+TEST(WearLevelingStorageTests, CorruptedRecordIsSkipped) {
+  FlashMedium medium;
+  {
+    SimulatedFlashStorage storage(&medium, 60);
+    ASSERT_TRUE(storage.init());
+    saveCounter(1);
+    saveCounter(2);
+  }
+  // flip bit in data of the last record (3rd record, as Storage::init()
+  // commits the first one)
+  medium.bytes[2 * 72 + 40] ^= 0x01;
+
+  SimulatedFlashStorage storage(&medium, 60);
+  ASSERT_TRUE(storage.init());
+  EXPECT_EQ(loadCounter(), 1);
+}
+
+TEST(WearLevelingStorageTests, InterruptedWriteIsNotOverwritten) {
+  FlashMedium medium;
+  {
+    SimulatedFlashStorage storage(&medium, 60);
+    ASSERT_TRUE(storage.init());
+    saveCounter(1);
+  }
+  // data of next record was written without header before power loss
+  memset(medium.bytes + 2 * 72 + 20, 0x00, 8);
+
+  {
+    SimulatedFlashStorage storage(&medium, 60);
+    ASSERT_TRUE(storage.init());
+    EXPECT_EQ(loadCounter(), 1);
+    saveCounter(2);
+  }
+
+  SimulatedFlashStorage storage(&medium, 60);
+  ASSERT_TRUE(storage.init());
+  EXPECT_EQ(loadCounter(), 2);
+}
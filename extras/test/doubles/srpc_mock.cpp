@@ -72,6 +72,26 @@ char srpc_iterate(void *_srpc) {
   return SrpcInterface::instance->srpc_iterate(_srpc);
 }
 
+char srpc_input_dataexists(void *_srpc) {
+  assert(SrpcInterface::instance);
+  return SrpcInterface::instance->srpc_input_dataexists(_srpc);
+}
+
+char srpc_input_packet_available(void *_srpc) {
+  assert(SrpcInterface::instance);
+  return SrpcInterface::instance->srpc_input_packet_available(_srpc);
+}
+
+char srpc_output_dataexists(void *_srpc) {
+  assert(SrpcInterface::instance);
+  return SrpcInterface::instance->srpc_output_dataexists(_srpc);
+}
+
+unsigned char srpc_out_queue_item_count(void *srpc) {
+  assert(SrpcInterface::instance);
+  return SrpcInterface::instance->srpc_out_queue_item_count(srpc);
+}
+
 void srpc_set_proto_version(void *_srpc, unsigned char version) {
   assert(SrpcInterface::instance);
   SrpcInterface::instance->srpc_set_proto_version(_srpc, version);
@@ -43,6 +43,10 @@ class SrpcInterface {
   virtual void srpc_rd_free(TsrpcReceivedData *rd) = 0;
   virtual char srpc_getdata(void *_srpc, TsrpcReceivedData *rd, unsigned _supla_int_t rr_id) = 0;
   virtual char srpc_iterate(void *_srpc) = 0;
+  virtual char srpc_input_dataexists(void *_srpc) = 0;
+  virtual char srpc_input_packet_available(void *_srpc) = 0;
+  virtual char srpc_output_dataexists(void *_srpc) = 0;
+  virtual unsigned char srpc_out_queue_item_count(void *_srpc) = 0;
   virtual void srpc_set_proto_version(void *_srpc, unsigned char version) = 0;
   virtual _supla_int_t srpc_ds_async_registerdevice_e(void *_srpc, TDS_SuplaRegisterDevice_E *registerdevice) = 0;
   virtual _supla_int_t srpc_dcs_async_ping_server(void *_srpc) = 0;
@@ -70,6 +74,10 @@ class SrpcMock : public SrpcInterface {
   MOCK_METHOD(void, srpc_rd_free, (TsrpcReceivedData *), (override));
   MOCK_METHOD(char, srpc_getdata, (void *, TsrpcReceivedData *, unsigned _supla_int_t), (override));
   MOCK_METHOD(char, srpc_iterate, (void *), (override));
+  MOCK_METHOD(char, srpc_input_dataexists, (void *), (override));
+  MOCK_METHOD(char, srpc_input_packet_available, (void *), (override));
+  MOCK_METHOD(char, srpc_output_dataexists, (void *), (override));
+  MOCK_METHOD(unsigned char, srpc_out_queue_item_count, (void *), (override));
   MOCK_METHOD(void, srpc_set_proto_version, (void *, unsigned char), (override));
   MOCK_METHOD(_supla_int_t, srpc_ds_async_registerdevice_e, (void *, TDS_SuplaRegisterDevice_E *), (override));
   MOCK_METHOD(_supla_int_t, srpc_dcs_async_ping_server, (void *), (override));
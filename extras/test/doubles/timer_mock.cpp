@@ -32,3 +32,13 @@ void Supla::initTimers() {
   assert(timerInterfaceInstance);
   timerInterfaceInstance->initTimers();
 }
+
+void Supla::lightSleep(unsigned long ms) {
+  assert(timerInterfaceInstance);
+  timerInterfaceInstance->lightSleep(ms);
+}
+
+void Supla::enableLightSleep(bool enabled) {
+  assert(timerInterfaceInstance);
+  timerInterfaceInstance->enableLightSleep(enabled);
+}
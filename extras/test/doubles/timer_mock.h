@@ -22,11 +22,15 @@ class TimerInterface {
     TimerInterface();
     virtual ~TimerInterface();
     virtual void initTimers() = 0;
+    virtual void lightSleep(unsigned long ms) = 0;
+    virtual void enableLightSleep(bool enabled) = 0;
 };
 
 class TimerMock : public TimerInterface {
   public:
     MOCK_METHOD((void), initTimers, (), (override));
+    MOCK_METHOD((void), lightSleep, (unsigned long), (override));
+    MOCK_METHOD((void), enableLightSleep, (bool), (override));
 };
 
 
@@ -22,7 +22,10 @@
 #include "supla-common/log.h"
 #include "supla-common/srpc.h"
 #include "supla/channel.h"
+#include "supla/device_context.h"
 #include "supla/element.h"
+#include "supla/event_queue.h"
+#include "supla/scheduler.h"
 #include "supla/io.h"
 #include "supla/storage/storage.h"
 #include "supla/timer.h"
@@ -39,13 +42,22 @@ void SuplaDeviceClass::status(int newStatus, const char *msg, bool alwaysLog) {
   if (alwaysLog || showLog) supla_log(LOG_DEBUG, "Current status: [%d] %s", newStatus, msg);
 }
 
-SuplaDeviceClass::SuplaDeviceClass()
-    : port(-1),
+SuplaDeviceClass::SuplaDeviceClass(Supla::DeviceContext *context)
+    : context(context ? context : Supla::DeviceContext::defaultContext()),
+      port(-1),
       connectionFailCounter(0),
+      connectionFailStartMs(0),
       networkIsNotReadyCounter(0),
+      iterateConnectedStartIndex(0),
+      nextElementToSave(nullptr),
+      stateSaveInProgress(false),
+      lowPowerMode(false),
+      lowPowerMaxSleepMs(1000),
+      impl_arduino_status(nullptr),
       currentStatus(STATUS_UNKNOWN),
       clock(nullptr),
-      impl_arduino_status(nullptr) {
+      nextTimerDevice(nullptr),
+      isTimerDevice(false) {
   srpc = NULL;
   registered = 0;
   lastIterateTime = 0;
@@ -53,6 +65,76 @@ SuplaDeviceClass::SuplaDeviceClass()
 }
 
 SuplaDeviceClass::~SuplaDeviceClass() {
+  removeFromTimerDevices();
+}
+
+SuplaDeviceClass *SuplaDeviceClass::firstTimerDevice = nullptr;
+
+void SuplaDeviceClass::addToTimerDevices() {
+  if (isTimerDevice) {
+    return;
+  }
+  isTimerDevice = true;
+  nextTimerDevice = firstTimerDevice;
+  // List is traversed from timer callbacks. Device is published by single
+  // pointer write, after its own link is set.
+#if defined(ARDUINO_ARCH_AVR)
+  noInterrupts();
+  firstTimerDevice = this;
+  interrupts();
+#else
+  __sync_synchronize();
+  firstTimerDevice = this;
+#endif
+}
+
+void SuplaDeviceClass::removeFromTimerDevices() {
+  if (!isTimerDevice) {
+    return;
+  }
+  isTimerDevice = false;
+  SuplaDeviceClass **link = &firstTimerDevice;
+  while (*link != nullptr && *link != this) {
+    link = &((*link)->nextTimerDevice);
+  }
+  if (*link == this) {
+#if defined(ARDUINO_ARCH_AVR)
+    noInterrupts();
+    *link = nextTimerDevice;
+    interrupts();
+#else
+    *link = nextTimerDevice;
+#endif
+  }
+}
+
+void SuplaDeviceClass::OnTimer() {
+  for (auto device = firstTimerDevice; device != nullptr;
+       device = device->nextTimerDevice) {
+    device->onTimer();
+  }
+}
+
+void SuplaDeviceClass::OnFastTimer() {
+  for (auto device = firstTimerDevice; device != nullptr;
+       device = device->nextTimerDevice) {
+    device->onFastTimer();
+  }
+}
+
+bool SuplaDeviceClass::IsTimerHookUsed(Supla::ElementHook hook) {
+  for (auto device = firstTimerDevice; device != nullptr;
+       device = device->nextTimerDevice) {
+    Supla::DeviceContext::Scope scope(device->context);
+    if (Supla::Element::begin(hook) != nullptr) {
+      return true;
+    }
+  }
+  return false;
+}
+
+Supla::DeviceContext *SuplaDeviceClass::getContext() {
+  return context;
 }
 
 void SuplaDeviceClass::setStatusFuncImpl(
@@ -76,6 +158,7 @@ bool SuplaDeviceClass::begin(char GUID[SUPLA_GUID_SIZE],
                              const char *email,
                              char authkey[SUPLA_AUTHKEY_SIZE],
                              unsigned char version) {
+  Supla::DeviceContext::Scope scope(context);
   setGUID(GUID);
   setServer(Server);
   setEmail(email);
@@ -85,9 +168,13 @@ bool SuplaDeviceClass::begin(char GUID[SUPLA_GUID_SIZE],
 }
 
 bool SuplaDeviceClass::begin(unsigned char version) {
+  Supla::DeviceContext::Scope scope(context);
   if (isInitialized(true)) return false;
   supla_log(LOG_DEBUG, "Supla - starting initialization");
 
+  Supla::Element::buildChannelIndex();
+  Supla::Element::buildHookLists();
+
   Supla::Storage::Init();
 
   // Supla::Storage::LoadDeviceConfig();
@@ -98,9 +185,10 @@ bool SuplaDeviceClass::begin(unsigned char version) {
   if (Supla::Storage::PrepareState(true)) {
     Serial.println(F(
         "Validating storage state section with current device configuration"));
-    for (auto element = Supla::Element::begin(); element != nullptr;
-         element = element->next()) {
-      element->onSaveState();
+    for (auto element = Supla::Element::begin(Supla::HOOK_ON_SAVE_STATE);
+         element != nullptr;
+         element = element->next(Supla::HOOK_ON_SAVE_STATE)) {
+      Supla::Storage::SaveElementState(element);
       delay(0);
     }
     // If state storage validation was successful, perform read state
@@ -108,11 +196,13 @@ bool SuplaDeviceClass::begin(unsigned char version) {
       Serial.println(
           F("Storage state section validation completed. Loading elements "
             "state..."));
-      // Iterate all elements and load state
+      // Iterate elements which store state and load it in the same order as
+      // it was saved
       Supla::Storage::PrepareState();
-      for (auto element = Supla::Element::begin(); element != nullptr;
-           element = element->next()) {
-        element->onLoadState();
+      for (auto element = Supla::Element::begin(Supla::HOOK_ON_SAVE_STATE);
+           element != nullptr;
+           element = element->next(Supla::HOOK_ON_SAVE_STATE)) {
+        Supla::Storage::LoadElementState(element);
         delay(0);
       }
     }
@@ -128,6 +218,7 @@ bool SuplaDeviceClass::begin(unsigned char version) {
   }
 
   // Enable timers
+  addToTimerDevices();
   Supla::initTimers();
 
   if (Supla::Network::Instance() == NULL) {
@@ -137,7 +228,7 @@ bool SuplaDeviceClass::begin(unsigned char version) {
 
   bool emptyGuidDetected = true;
   for (int i = 0; i < SUPLA_GUID_SIZE; i++) {
-    if (Supla::Channel::reg_dev.GUID[i] != 0) {
+    if (context->regDev.GUID[i] != 0) {
       emptyGuidDetected = false;
     }
   }
@@ -145,20 +236,21 @@ bool SuplaDeviceClass::begin(unsigned char version) {
     status(STATUS_INVALID_GUID, "Missing GUID");
     return false;
   }
+  reconnectPolicy.seed(context->regDev.GUID, SUPLA_GUID_SIZE);
 
-  if (Supla::Channel::reg_dev.ServerName[0] == '\0') {
+  if (context->regDev.ServerName[0] == '\0') {
     status(STATUS_UNKNOWN_SERVER_ADDRESS, "Missing server address");
     return false;
   }
 
-  if (Supla::Channel::reg_dev.Email[0] == '\0') {
+  if (context->regDev.Email[0] == '\0') {
     status(STATUS_MISSING_CREDENTIALS, "Missing email address");
     return false;
   }
 
   bool emptyAuthKeyDetected = true;
   for (int i = 0; i < SUPLA_AUTHKEY_SIZE; i++) {
-    if (Supla::Channel::reg_dev.AuthKey[i] != 0) {
+    if (context->regDev.AuthKey[i] != 0) {
       emptyAuthKeyDetected = false;
       break;
     }
@@ -168,20 +260,20 @@ bool SuplaDeviceClass::begin(unsigned char version) {
     return false;
   }
 
-  if (strnlen(Supla::Channel::reg_dev.Name, SUPLA_DEVICE_NAME_MAXSIZE) == 0) {
+  if (strnlen(context->regDev.Name, SUPLA_DEVICE_NAME_MAXSIZE) == 0) {
 #if defined(ARDUINO_ARCH_ESP8266)
-    setString(
-        Supla::Channel::reg_dev.Name, "ESP8266", SUPLA_DEVICE_NAME_MAXSIZE);
+    setString(context->regDev.Name, "ESP8266", SUPLA_DEVICE_NAME_MAXSIZE);
 #elif defined(ARDUINO_ARCH_ESP32)
-    setString(Supla::Channel::reg_dev.Name, "ESP32", SUPLA_DEVICE_NAME_MAXSIZE);
+    setString(context->regDev.Name, "ESP32", SUPLA_DEVICE_NAME_MAXSIZE);
+#elif defined(SUPLA_LINUX)
+    setString(context->regDev.Name, "LINUX", SUPLA_DEVICE_NAME_MAXSIZE);
 #else
-    setString(
-        Supla::Channel::reg_dev.Name, "ARDUINO", SUPLA_DEVICE_NAME_MAXSIZE);
+    setString(context->regDev.Name, "ARDUINO", SUPLA_DEVICE_NAME_MAXSIZE);
 #endif
   }
 
-  if (strnlen(Supla::Channel::reg_dev.SoftVer, SUPLA_SOFTVER_MAXSIZE) == 0) {
-    setString(Supla::Channel::reg_dev.SoftVer,
+  if (strnlen(context->regDev.SoftVer, SUPLA_SOFTVER_MAXSIZE) == 0) {
+    setString(context->regDev.SoftVer,
               "User SW, lib 2.3.5",
               SUPLA_SOFTVER_MAXSIZE);
   }
@@ -193,6 +285,7 @@ bool SuplaDeviceClass::begin(unsigned char version) {
   srpc_params_init(&srpc_params);
   srpc_params.data_read = &Supla::data_read;
   srpc_params.data_write = &Supla::data_write;
+  srpc_params.data_writev = &Supla::data_writev;
   srpc_params.on_remote_call_received = &Supla::message_received;
   srpc_params.user_params = this;
 
@@ -209,7 +302,7 @@ bool SuplaDeviceClass::begin(unsigned char version) {
 
 void SuplaDeviceClass::setName(const char *Name) {
   if (isInitialized(true)) return;
-  setString(Supla::Channel::reg_dev.Name, Name, SUPLA_DEVICE_NAME_MAXSIZE);
+  setString(context->regDev.Name, Name, SUPLA_DEVICE_NAME_MAXSIZE);
 }
 
 void SuplaDeviceClass::setString(char *dst, const char *src, int max_size) {
@@ -226,47 +319,84 @@ void SuplaDeviceClass::setString(char *dst, const char *src, int max_size) {
 }
 
 void SuplaDeviceClass::onTimer(void) {
-  for (auto element = Supla::Element::begin(); element != nullptr;
-       element = element->next()) {
+  Supla::DeviceContext::Scope scope(context);
+  Supla::EventQueue::enterTimerContext();
+  for (auto element = Supla::Element::begin(Supla::HOOK_ON_TIMER);
+       element != nullptr;
+       element = element->next(Supla::HOOK_ON_TIMER)) {
     element->onTimer();
   }
+  Supla::EventQueue::leaveTimerContext();
 }
 
 void SuplaDeviceClass::onFastTimer(void) {
+  Supla::DeviceContext::Scope scope(context);
   // Iteration over all impulse counters will count incomming impulses. It is
   // after SuplaDevice initialization (because we have to read stored counter
   // values) and before any other operation like connection to Supla cloud
   // (because we want to count impulses even when we have connection issues.
-  for (auto element = Supla::Element::begin(); element != nullptr;
-       element = element->next()) {
+  Supla::EventQueue::enterTimerContext();
+  for (auto element = Supla::Element::begin(Supla::HOOK_ON_FAST_TIMER);
+       element != nullptr;
+       element = element->next(Supla::HOOK_ON_FAST_TIMER)) {
     element->onFastTimer();
   }
+  Supla::EventQueue::leaveTimerContext();
 }
 
 void SuplaDeviceClass::iterate(void) {
+  Supla::DeviceContext::Scope scope(context);
   if (!isInitialized(false)) return;
 
+  Supla::Element::updateHookLists();
+
+  if (lowPowerMode) {
+    unsigned long sleepMs = getTimeToNextWakeup(millis());
+    // Interface which can wait for data wakes up as soon as server sends
+    // something
+    if (sleepMs > 0 && !Supla::Network::WaitForData(sleepMs)) {
+      Supla::lightSleep(sleepMs);
+    }
+  }
+
   unsigned long _millis = millis();
   unsigned long timeDiff = _millis - lastIterateTime;
 
   uptime.iterate(_millis);
 
+  // Execute actions which were triggered from timer callbacks
+  Supla::EventQueue::dispatch();
+
+  // Execute scheduled tasks with reached deadline
+  Supla::Scheduler::runDueTasks(_millis);
+
   // Iterate all elements
-  for (auto element = Supla::Element::begin(); element != nullptr;
-       element = element->next()) {
+  for (auto element = Supla::Element::begin(Supla::HOOK_ITERATE_ALWAYS);
+       element != nullptr;
+       element = element->next(Supla::HOOK_ITERATE_ALWAYS)) {
     element->iterateAlways();
     delay(0);
   }
 
-  // Iterate all elements and saves state
-  if (Supla::Storage::SaveStateAllowed(_millis)) {
+  // Iterate elements and saves state. Save is split between iterations, so
+  // it doesn't block handling of other tasks. Copy of state is activated in
+  // FinalizeSaveState(), so interrupted save keeps previous state.
+  if (!stateSaveInProgress && Supla::Storage::SaveStateAllowed(_millis)) {
     Supla::Storage::PrepareState();
-    for (auto element = Supla::Element::begin(); element != nullptr;
-         element = element->next()) {
-      element->onSaveState();
+    nextElementToSave = Supla::Element::begin(Supla::HOOK_ON_SAVE_STATE);
+    stateSaveInProgress = true;
+  }
+  if (stateSaveInProgress) {
+    for (int i = 0; i < SUPLA_STATE_SAVE_SLICE && nextElementToSave != nullptr;
+         i++) {
+      Supla::Storage::SaveElementState(nextElementToSave);
+      nextElementToSave = nextElementToSave->next(Supla::HOOK_ON_SAVE_STATE);
       delay(0);
     }
-    Supla::Storage::FinalizeSaveState();
+    if (nextElementToSave == nullptr) {
+      Supla::Storage::FinalizeSaveState();
+      stateSaveInProgress = false;
+    }
   }
 
   if (waitForIterate != 0 && _millis < waitForIterate) {
@@ -275,8 +405,10 @@ void SuplaDeviceClass::iterate(void) {
     waitForIterate = 0;
   }
 
-  // Restart network after >1 min of failed connection attempts
-  if (connectionFailCounter > 30) {
+  // Restart network after >1 min of failed connection attempts. Attempts are
+  // delayed by reconnect backoff, so time is checked instead of their number.
+  if (connectionFailCounter > 0 &&
+      _millis - connectionFailStartMs > SUPLA_NETWORK_RESTART_MS) {
     connectionFailCounter = 0;
     supla_log(LOG_DEBUG,
               "Connection fail counter overflow. Trying to setup network "
@@ -285,6 +417,10 @@ void SuplaDeviceClass::iterate(void) {
     return;
   }
 
+  // Interface maintenance and bring up (i.e. DHCP), which is reported by
+  // IsReady()
+  Supla::Network::Iterate();
+
   if (!Supla::Network::IsReady()) {
     uptime.setConnectionLostCause(
         SUPLA_LASTCONNECTIONRESETCAUSE_WIFI_CONNECTION_LOST);
@@ -293,22 +429,37 @@ void SuplaDeviceClass::iterate(void) {
     networkIsNotReadyCounter++;
     if (networkIsNotReadyCounter > 20) {
       networkIsNotReadyCounter = 0;
-      connectionFailCounter++;
+      countConnectionFail(_millis);
     }
     return;
   }
   networkIsNotReadyCounter = 0;
 
-  if (!Supla::Network::Connected()) {
+  if (Supla::Network::IsConnecting() || !Supla::Network::Connected()) {
+    if (!Supla::Network::IsConnecting()) {
+      uptime.setConnectionLostCause(
+          SUPLA_LASTCONNECTIONRESETCAUSE_SERVER_CONNECTION_LOST);
+
+      if (registered == 1) {
+        // Connection of registered device was closed (i.e. server restarted
+        // or ping timed out). Devices which lost it at the same time wait
+        // random time, so they don't reconnect together.
+        registered = 0;
+        status(STATUS_SERVER_DISCONNECTED, "Not connected to Supla server");
+        waitBeforeReconnect(_millis);
+        return;
+      }
 
-    uptime.setConnectionLostCause(
-        SUPLA_LASTCONNECTIONRESETCAUSE_SERVER_CONNECTION_LOST);
+      registered = 0;
 
-    registered = 0;
+      Supla::Network::BeginConnect(context->regDev.ServerName, port);
+    }
 
-    int result =
-        Supla::Network::Connect(Supla::Channel::reg_dev.ServerName, port);
-    if (1 == result) {
+    // Connection is established in phases, elements are iterated between them
+    int result = Supla::Network::PollConnect(_millis);
+    if (0 == result) {
+      return;
+    } else if (1 == result) {
       uptime.resetConnectionUptime();
       connectionFailCounter = 0;
       supla_log(LOG_DEBUG, "Connected to Supla Server");
@@ -317,22 +468,22 @@ void SuplaDeviceClass::iterate(void) {
       supla_log(LOG_DEBUG,
                 "Connection fail (%d). Server: %s",
                 result,
-                Supla::Channel::reg_dev.ServerName);
+                context->regDev.ServerName);
 
       Supla::Network::Disconnect();
-      waitForIterate = _millis + 2000;
-      connectionFailCounter++;
+      waitBeforeReconnect(_millis);
+      countConnectionFail(_millis);
       return;
     }
   }
 
-  Supla::Network::Iterate();
-
-  if (srpc_iterate(srpc) == SUPLA_RESULT_FALSE) {
+  if (srpcNeedsService() && srpc_iterate(srpc) == SUPLA_RESULT_FALSE) {
     status(STATUS_ITERATE_FAIL, "Iterate fail");
     Supla::Network::Disconnect();
 
-    waitForIterate = _millis + 5000;
+    // reconnect is delayed here, not again when closed connection is found
+    registered = 0;
+    waitBeforeReconnect(_millis);
     return;
   }
 
@@ -341,7 +492,7 @@ void SuplaDeviceClass::iterate(void) {
     registered = -1;
     lastIterateTime = _millis;
     status(STATUS_REGISTER_IN_PROGRESS, "Register in progress");
-    if (!srpc_ds_async_registerdevice_e(srpc, &Supla::Channel::reg_dev)) {
+    if (!srpc_ds_async_registerdevice_e(srpc, &context->regDev)) {
       supla_log(LOG_DEBUG, "Fatal SRPC failure!");
     }
   } else if (registered == -1) {
@@ -351,8 +502,8 @@ void SuplaDeviceClass::iterate(void) {
       status(STATUS_SERVER_DISCONNECTED, "Not connected to Supla server");
       Supla::Network::Disconnect();
 
-      waitForIterate = _millis + 2000;
-      connectionFailCounter++;
+      waitBeforeReconnect(_millis);
+      countConnectionFail(_millis);
     }
 
   } else if (registered == 1) {
@@ -367,21 +518,69 @@ void SuplaDeviceClass::iterate(void) {
     }
 
     if (timeDiff > 0) {
-      // Iterate all elements
-      for (auto element = Supla::Element::begin(); element != nullptr;
-           element = element->next()) {
+      int budget = SUPLA_CHANNEL_SEND_BUDGET;
+
+      // Send all pending channel values in one burst. Bursts are sent not
+      // more often than every 100 ms
+      if (_millis - context->lastCommunicationTimeMs > 100) {
+        int sent = Supla::Channel::sendPendingUpdates(srpc, budget);
+        if (sent > 0) {
+          context->lastCommunicationTimeMs = _millis;
+          budget = sent < budget ? budget - sent : 0;
+        }
+      }
+
+      // Iterate elements which implement iterateConnected(), starting after
+      // the element which sent data in previous iteration. Each element which
+      // sent data uses one message from the budget.
+      int index = 0;
+      auto start = Supla::Element::begin(Supla::HOOK_ITERATE_CONNECTED);
+      while (start != nullptr && index < iterateConnectedStartIndex) {
+        start = start->next(Supla::HOOK_ITERATE_CONNECTED);
+        index++;
+      }
+      if (start == nullptr) {
+        start = Supla::Element::begin(Supla::HOOK_ITERATE_CONNECTED);
+        index = 0;
+      }
+      auto element = start;
+      while (element != nullptr && budget > 0) {
         if (!element->iterateConnected(srpc)) {
-          break;
+          budget--;
+          iterateConnectedStartIndex = index + 1;
         }
         delay(0);
+        element = element->next(Supla::HOOK_ITERATE_CONNECTED);
+        index++;
+        if (element == nullptr) {
+          element = Supla::Element::begin(Supla::HOOK_ITERATE_CONNECTED);
+          index = 0;
+        }
+        if (element == start) {
+          break;
+        }
       }
 
       lastIterateTime = _millis;
     }
   }
+
+  // Everything sent in this iteration leaves with one write
+  Supla::Network::Flush();
+}
+
+bool SuplaDeviceClass::srpcNeedsService() {
+  // Data waiting on network interface, complete packets left in SRPC input
+  // buffer (only one is processed per srpc_iterate() call) or queued output.
+  // Partial packet waits for the rest of its data on network interface.
+  return Supla::Network::HasData() ||
+         srpc_input_packet_available(srpc) == SUPLA_RESULT_TRUE ||
+         srpc_output_dataexists(srpc) == SUPLA_RESULT_TRUE ||
+         srpc_out_queue_item_count(srpc) > 0;
 }
 
 void SuplaDeviceClass::onVersionError(TSDC_SuplaVersionError *version_error) {
+  Supla::DeviceContext::Scope scope(context);
   status(STATUS_PROTOCOL_VERSION_ERROR, "Protocol version error");
   Serial.print(F("Protocol version error. Server min: "));
   Serial.print(version_error->server_version_min);
@@ -390,11 +589,12 @@ void SuplaDeviceClass::onVersionError(TSDC_SuplaVersionError *version_error) {
 
   Supla::Network::Disconnect();
 
-  waitForIterate = millis() + 5000;
+  waitBeforeReconnect(millis());
 }
 
 void SuplaDeviceClass::onRegisterResult(
     TSD_SuplaRegisterDeviceResult *register_device_result) {
+  Supla::DeviceContext::Scope scope(context);
   _supla_int_t activity_timeout = 0;
 
   switch (register_device_result->result_code) {
@@ -403,6 +603,7 @@ void SuplaDeviceClass::onRegisterResult(
       activity_timeout = register_device_result->activity_timeout;
       Supla::Network::Instance()->setActivityTimeout(activity_timeout);
       registered = 1;
+      reconnectPolicy.reset();
       supla_log(LOG_DEBUG,
                 "Device registered (activity timeout %d s, server version: %d, "
                 "server min version: %d)",
@@ -476,11 +677,12 @@ void SuplaDeviceClass::onRegisterResult(
   }
 
   Supla::Network::Disconnect();
-  waitForIterate = millis() + 5000;
+  waitBeforeReconnect(millis());
 }
 
 void SuplaDeviceClass::channelSetActivityTimeoutResult(
     TSDC_SuplaSetActivityTimeoutResult *result) {
+  Supla::DeviceContext::Scope scope(context);
   Supla::Network::Instance()->setActivityTimeout(result->activity_timeout);
   supla_log(
       LOG_DEBUG, "Activity timeout set to %d s", result->activity_timeout);
@@ -490,14 +692,106 @@ void SuplaDeviceClass::setServerPort(int value) {
   port = value;
 }
 
+void SuplaDeviceClass::setReconnectPolicy(unsigned long baseMs,
+                                          unsigned long capMs,
+                                          float multiplier) {
+  reconnectPolicy.configure(baseMs, capMs, multiplier);
+}
+
+void SuplaDeviceClass::countConnectionFail(unsigned long ms) {
+  if (connectionFailCounter == 0) {
+    connectionFailStartMs = ms;
+  }
+  connectionFailCounter++;
+}
+
+void SuplaDeviceClass::waitBeforeReconnect(unsigned long ms) {
+  unsigned long delayMs = reconnectPolicy.nextDelayMs();
+  supla_log(LOG_DEBUG, "Next connection attempt in %lu ms", delayMs);
+  // 0 means that iterate() is not paused
+  waitForIterate = ms + delayMs;
+  if (waitForIterate == 0) {
+    waitForIterate = 1;
+  }
+}
+
 void SuplaDeviceClass::setSwVersion(const char *swVersion) {
-  setString(Supla::Channel::reg_dev.SoftVer, swVersion, SUPLA_SOFTVER_MAXSIZE);
+  setString(context->regDev.SoftVer, swVersion, SUPLA_SOFTVER_MAXSIZE);
 }
 
 int SuplaDeviceClass::getCurrentStatus() {
   return currentStatus;
 }
 
+void SuplaDeviceClass::setLowPowerMode(bool enabled, unsigned long maxSleepMs) {
+  lowPowerMode = enabled;
+  lowPowerMaxSleepMs = maxSleepMs;
+  Supla::enableLightSleep(enabled);
+}
+
+unsigned long SuplaDeviceClass::getTimeToNextWakeup(unsigned long ms) {
+  Supla::DeviceContext::Scope scope(context);
+  if (!Supla::EventQueue::isEmpty() || stateSaveInProgress) {
+    return 0;
+  }
+
+  unsigned long result = lowPowerMaxSleepMs;
+  unsigned long delayMs = 0;
+
+  uint32_t taskDelayMs = 0;
+  if (Supla::Scheduler::getTimeToNextTask(ms, &taskDelayMs) &&
+      taskDelayMs < result) {
+    result = taskDelayMs;
+  }
+
+  if (Supla::Storage::TimeToNextSave(ms, &delayMs) && delayMs < result) {
+    result = delayMs;
+  }
+
+  if (Supla::Element::begin(Supla::HOOK_ITERATE_ALWAYS) != nullptr &&
+      result > LOW_POWER_ITERATE_ALWAYS_PERIOD_MS) {
+    result = LOW_POWER_ITERATE_ALWAYS_PERIOD_MS;
+  }
+
+  if (waitForIterate != 0) {
+    // network part of iterate() is paused until waitForIterate
+    if (ms >= waitForIterate) {
+      return 0;
+    }
+    if (waitForIterate - ms < result) {
+      result = waitForIterate - ms;
+    }
+    return result;
+  }
+
+  // Connection and registration are handled on each iteration
+  if (registered != 1) {
+    return 0;
+  }
+
+  // Packets already received are handled without delay
+  if (srpc_input_packet_available(srpc) == SUPLA_RESULT_TRUE) {
+    return 0;
+  }
+
+  if (Supla::Network::TimeToNextPing(ms, &delayMs) && delayMs < result) {
+    result = delayMs;
+  }
+
+  // Channel updates are sent with 100 ms interval
+  if (Supla::Channel::hasPendingUpdates()) {
+    unsigned long elapsed = ms - context->lastCommunicationTimeMs;
+    if (elapsed > 100) {
+      return 0;
+    }
+    if (101 - elapsed < result) {
+      result = 101 - elapsed;
+    }
+  }
+
+  return result;
+}
+
 void SuplaDeviceClass::fillStateData(TDSC_ChannelState &channelState) {
   channelState.Fields |= SUPLA_CHANNELSTATE_FIELD_UPTIME |
                          SUPLA_CHANNELSTATE_FIELD_CONNECTIONUPTIME;
@@ -511,20 +805,19 @@ void SuplaDeviceClass::fillStateData(TDSC_ChannelState &channelState) {
 }
 
 void SuplaDeviceClass::setGUID(char GUID[SUPLA_GUID_SIZE]) {
-  memcpy(Supla::Channel::reg_dev.GUID, GUID, SUPLA_GUID_SIZE);
+  memcpy(context->regDev.GUID, GUID, SUPLA_GUID_SIZE);
 }
 
 void SuplaDeviceClass::setAuthKey(char authkey[SUPLA_AUTHKEY_SIZE]) {
-  memcpy(Supla::Channel::reg_dev.AuthKey, authkey, SUPLA_AUTHKEY_SIZE);
+  memcpy(context->regDev.AuthKey, authkey, SUPLA_AUTHKEY_SIZE);
 }
 
 void SuplaDeviceClass::setEmail(const char *email) {
-  setString(Supla::Channel::reg_dev.Email, email, SUPLA_EMAIL_MAXSIZE);
+  setString(context->regDev.Email, email, SUPLA_EMAIL_MAXSIZE);
 }
 
 void SuplaDeviceClass::setServer(const char *server) {
-  setString(
-      Supla::Channel::reg_dev.ServerName, server, SUPLA_SERVER_NAME_MAXSIZE);
+  setString(context->regDev.ServerName, server, SUPLA_SERVER_NAME_MAXSIZE);
 }
 
 void SuplaDeviceClass::onGetUserLocaltimeResult(
@@ -18,12 +18,24 @@
 #define SUPLADEVICE_H
 
 #include "supla-common/proto.h"
+#include "supla/device_context.h"
 #include "supla/network/network.h"
+#include "supla/reconnect_policy.h"
 #include "supla/uptime.h"
 #include "supla/clock/clock.h"
 
 #define ACTIVITY_TIMEOUT 30
 
+// Maximum sleep time in low power mode when there are elements which
+// implement iterateAlways()
+#define LOW_POWER_ITERATE_ALWAYS_PERIOD_MS 10
+
+// Network interface is set up again when connection attempts fail for longer
+// than this time
+#ifndef SUPLA_NETWORK_RESTART_MS
+#define SUPLA_NETWORK_RESTART_MS 60000
+#endif
+
 #define STATUS_UNKNOWN                   -1
 #define STATUS_ALREADY_INITIALIZED       1
 #define STATUS_MISSING_NETWORK_INTERFACE 2
@@ -56,33 +68,67 @@
 
 typedef void (*_impl_arduino_status)(int status, const char *msg);
 
+namespace Supla {
+class Element;
+};  // namespace Supla
+
 class SuplaDeviceClass {
  protected:
+  Supla::DeviceContext *context;
   void *srpc;
   char registered;
   int port;
   int connectionFailCounter;
+  // Time of first failure counted in connectionFailCounter
+  unsigned long connectionFailStartMs;
   int networkIsNotReadyCounter;
 
   unsigned long lastIterateTime;
   unsigned long waitForIterate;
+  int iterateConnectedStartIndex;
+
+  // State save is split between iterations, next one continues from this
+  // element
+  Supla::Element *nextElementToSave;
+  bool stateSaveInProgress;
+
+  bool lowPowerMode;
+  unsigned long lowPowerMaxSleepMs;
 
   _impl_arduino_status impl_arduino_status;
   int currentStatus;
 
   Supla::Uptime uptime;
+  Supla::ReconnectPolicy reconnectPolicy;
   Supla::Clock *clock;
 
+  // Devices after begin(), which are driven by platform timers
+  static SuplaDeviceClass *firstTimerDevice;
+  SuplaDeviceClass *nextTimerDevice;
+  bool isTimerDevice;
+  void addToTimerDevices();
+  void removeFromTimerDevices();
+
   bool isInitialized(bool msg);
   void setString(char *dst, const char *src, int max_size);
+  // Pauses network part of iterate() before next reconnection attempt
+  void waitBeforeReconnect(unsigned long ms);
+  void countConnectionFail(unsigned long ms);
+  // Returns true when srpc_iterate() has anything to do
+  bool srpcNeedsService();
 
  private:
   void status(int status, const char *msg, bool alwaysLog = false);
 
  public:
-  SuplaDeviceClass();
+  // Device works on elements, channels, network interface and storage from
+  // given context (nullptr means default context). Public methods make it
+  // current for the time of call.
+  explicit SuplaDeviceClass(Supla::DeviceContext *context = nullptr);
   ~SuplaDeviceClass();
 
+  Supla::DeviceContext *getContext();
+
   void fillStateData(TDSC_ChannelState &channelState);
   void addClock(Supla::Clock *clock);
   Supla::Clock *getClock();
@@ -107,10 +153,23 @@ class SuplaDeviceClass {
   void onTimer(void);
   // TImer with 2000 Hz frequency (0.5 ms)
   void onFastTimer(void);
+  // Called by platform timers. Each device after begin() gets onTimer() and
+  // onFastTimer() calls, with its own context. Device which was started has
+  // to live as long as platform timers run (it is removed from the list in
+  // destructor, but callback may be in progress on other thread).
+  static void OnTimer();
+  static void OnFastTimer();
+  // Returns true when any device after begin() has element with given hook
+  static bool IsTimerHookUsed(Supla::ElementHook hook);
   void iterate(void);
 
   void setStatusFuncImpl(_impl_arduino_status impl_arduino_status);
   void setServerPort(int value);
+  // Delay before each reconnection attempt is random, up to baseMs after
+  // first failure, growing by multiplier after each next one, up to capMs
+  void setReconnectPolicy(unsigned long baseMs,
+                          unsigned long capMs,
+                          float multiplier = SUPLA_RECONNECT_MULTIPLIER);
 
   void onVersionError(TSDC_SuplaVersionError *version_error);
   void onRegisterResult(TSD_SuplaRegisterDeviceResult *register_device_result);
@@ -120,6 +179,13 @@ class SuplaDeviceClass {
 
   void setSwVersion(const char *);
   int getCurrentStatus();
+
+  // In low power mode iterate() puts CPU to light sleep until the earliest
+  // deadline of scheduled tasks, network keep alive and state save.
+  // maxSleepMs limits delay of handling messages received from server.
+  void setLowPowerMode(bool enabled, unsigned long maxSleepMs = 1000);
+  // Returns time for which device may sleep without missing any deadline
+  unsigned long getTimeToNextWakeup(unsigned long ms);
 };
 
 extern SuplaDeviceClass SuplaDevice;
@@ -17,7 +17,6 @@
  */
 
 #include "proto.h"
-#include <errno.h>
 #include <stdlib.h>
 #include <string.h>
 #include "log.h"
@@ -28,8 +27,9 @@
 #if !defined(ARDUINO_ARCH_ESP32)
 #include <osapi.h>
 #endif
-#define BUFFER_MIN_SIZE 512
-#define BUFFER_MAX_SIZE 2048
+#ifndef SPROTO_BUFFER_SIZE
+#define SPROTO_BUFFER_SIZE 2048
+#endif /*SPROTO_BUFFER_SIZE*/
 
 #if !defined(ARDUINO_ARCH_ESP8266) && !defined(ARDUINO_ARCH_ESP32)
 #include <user_interface.h>
@@ -38,44 +38,59 @@
 
 #elif defined(__AVR__)
 
-#define BUFFER_MIN_SIZE 32
-#define BUFFER_MAX_SIZE 1024
+// Same limit for received data as with previous dynamically grown buffer.
+// Boards with little RAM can lower it (i.e. -DSPROTO_BUFFER_SIZE=256), but
+// then packets longer than the buffer are rejected.
+#ifndef SPROTO_BUFFER_SIZE
+#define SPROTO_BUFFER_SIZE 1024
+#endif /*SPROTO_BUFFER_SIZE*/
 
 #endif /*ESP8266*/
 
-#ifndef BUFFER_MIN_SIZE
-#define BUFFER_MIN_SIZE 0
-#endif /*BUFFER_MIN_SIZE*/
+// Capacity of each of in/out circular buffers. It has to be a power of 2 and
+// it limits size of a single packet (header and data). Can be set with
+// compiler flag.
+#ifndef SPROTO_BUFFER_SIZE
+#define SPROTO_BUFFER_SIZE 32768
+#endif /*SPROTO_BUFFER_SIZE*/
 
-#ifndef BUFFER_MAX_SIZE
-#define BUFFER_MAX_SIZE 131072
-#endif /*BUFFER_MAX_SIZE*/
+#if (SPROTO_BUFFER_SIZE & (SPROTO_BUFFER_SIZE - 1)) != 0
+#error "SPROTO_BUFFER_SIZE has to be a power of 2"
+#endif
+
+#define SPROTO_BUFFER_MASK (SPROTO_BUFFER_SIZE - 1)
+
+// Empty buffer starts at this offset, so the payload of a packet which is
+// received into empty buffer is 4-byte aligned and can be used in place
+#define SPROTO_BUFFER_START                                   \
+  ((4 - (sizeof(TSuplaDataPacket) - SUPLA_MAX_DATA_SIZE) % 4) % 4)
 
 char sproto_tag[SUPLA_TAG_SIZE] = {'S', 'U', 'P', 'L', 'A'};
 
+// Fixed capacity circular buffer. Data starts at "begin" and may wrap around
+// the end of "buffer". Consumed data is dropped by moving "begin", so bytes
+// are never shifted and buffer is never reallocated.
 typedef struct {
-  unsigned char begin_tag;
-  unsigned _supla_int_t size;
+  unsigned _supla_int_t begin;
   unsigned _supla_int_t data_size;
 
-  char *buffer;
-} TSuplaProtoInBuffer;
+  char buffer[SPROTO_BUFFER_SIZE];
+} TSuplaProtoRingBuffer;
 
-#ifndef SPROTO_WITHOUT_OUT_BUFFER
 typedef struct {
-  unsigned _supla_int_t size;
-  unsigned _supla_int_t data_size;
-
-  char *buffer;
-} TSuplaProtoOutBuffer;
-#endif
+  unsigned char begin_tag;
+  // size of packet returned by sproto_peek_in_sdp(), which is still kept in
+  // the ring until sproto_release_in_sdp()
+  unsigned _supla_int_t peeked_size;
+  TSuplaProtoRingBuffer ring;
+} TSuplaProtoInBuffer;
 
 typedef struct {
   unsigned _supla_int_t next_rr_id;
   unsigned char version;
   TSuplaProtoInBuffer in;
 #ifndef SPROTO_WITHOUT_OUT_BUFFER
-  TSuplaProtoOutBuffer out;
+  TSuplaProtoRingBuffer out;
 #endif
 } TSuplaProtoData;
 
@@ -84,6 +99,10 @@ void *sproto_init(void) {
   if (spd) {
     memset(spd, 0, sizeof(TSuplaProtoData));
     spd->version = SUPLA_PROTO_VERSION;
+    spd->in.ring.begin = SPROTO_BUFFER_START;
+#ifndef SPROTO_WITHOUT_OUT_BUFFER
+    spd->out.begin = SPROTO_BUFFER_START;
+#endif /*SPROTO_WITHOUT_OUT_BUFFER*/
     return (spd);
   }
 
@@ -93,63 +112,105 @@ void *sproto_init(void) {
 void sproto_free(void *spd_ptr) {
   TSuplaProtoData *spd = (TSuplaProtoData *)spd_ptr;
   if (spd != NULL) {
-    if (spd->in.buffer != NULL) free(spd->in.buffer);
-#ifndef SPROTO_WITHOUT_OUT_BUFFER
-    if (spd->out.buffer != NULL) free(spd->out.buffer);
-#endif
-
     free(spd);
   }
 }
 
-unsigned char sproto_buffer_append(void *spd_ptr, char **buffer,
-                                   unsigned _supla_int_t *buffer_size,
-                                   unsigned _supla_int_t *buffer_data_size,
-                                   char *data,
-                                   unsigned _supla_int_t data_size) {
-  unsigned _supla_int_t size = *buffer_size;
+unsigned char sproto_ring_append(TSuplaProtoRingBuffer *ring, char *data,
+                                 unsigned _supla_int_t data_size) {
+  unsigned _supla_int_t end;
+  unsigned _supla_int_t tail_space;
 
-  if (size < BUFFER_MIN_SIZE) {
-    size = BUFFER_MIN_SIZE;
-  }
+  if (data_size > SPROTO_BUFFER_SIZE - ring->data_size)
+    return (SUPLA_RESULT_BUFFER_OVERFLOW);
+
+  end = (ring->begin + ring->data_size) & SPROTO_BUFFER_MASK;
+  tail_space = SPROTO_BUFFER_SIZE - end;
 
-  if (data_size > size - (*buffer_data_size)) {
-    size += data_size - (size - (*buffer_data_size));
+  if (data_size <= tail_space) {
+    memcpy(&ring->buffer[end], data, data_size);
+  } else {
+    memcpy(&ring->buffer[end], data, tail_space);
+    memcpy(ring->buffer, &data[tail_space], data_size - tail_space);
   }
 
-  if (size >= BUFFER_MAX_SIZE) return (SUPLA_RESULT_BUFFER_OVERFLOW);
+  ring->data_size += data_size;
+  return (SUPLA_RESULT_TRUE);
+}
 
-  if (size != (*buffer_size)) {
-    char *new_buffer = (char *)realloc(*buffer, size);
+// Copies "size" bytes starting at "offset" from the beginning of data
+void sproto_ring_peek(TSuplaProtoRingBuffer *ring, unsigned _supla_int_t offset,
+                      char *dest, unsigned _supla_int_t size) {
+  unsigned _supla_int_t pos = (ring->begin + offset) & SPROTO_BUFFER_MASK;
+  unsigned _supla_int_t tail_size = SPROTO_BUFFER_SIZE - pos;
 
-    if (size > 0 && new_buffer == NULL) {
-      return (SUPLA_RESULT_FALSE);
-    }
+  if (size <= tail_size) {
+    memcpy(dest, &ring->buffer[pos], size);
+  } else {
+    memcpy(dest, &ring->buffer[pos], tail_size);
+    memcpy(&dest[tail_size], ring->buffer, size - tail_size);
+  }
+}
 
-#ifndef ESP8266
-#ifndef ESP32
-#ifndef __AVR__
-    if (errno == ENOMEM) return (SUPLA_RESULT_FALSE);
-#endif
-#endif
-#endif
+// Returns pointer to "size" bytes starting at "offset". When data is stored
+// contiguously, pointer to ring's memory is returned. Otherwise data is
+// copied to "scratch", which has to have at least "size" bytes.
+char *sproto_ring_view(TSuplaProtoRingBuffer *ring,
+                       unsigned _supla_int_t offset, unsigned _supla_int_t size,
+                       char *scratch) {
+  unsigned _supla_int_t pos = (ring->begin + offset) & SPROTO_BUFFER_MASK;
 
-    *buffer = new_buffer;
+  if (size <= SPROTO_BUFFER_SIZE - pos) {
+    return &ring->buffer[pos];
   }
 
-  memcpy(&(*buffer)[(*buffer_data_size)], data, data_size);
+  sproto_ring_peek(ring, offset, scratch, size);
+  return scratch;
+}
 
-  (*buffer_size) = size;
-  (*buffer_data_size) += data_size;
+void sproto_ring_drop(TSuplaProtoRingBuffer *ring, unsigned _supla_int_t size) {
+  if (size >= ring->data_size) {
+    // empty buffer starts from the beginning, so the next packet is most
+    // likely stored contiguously
+    ring->begin = SPROTO_BUFFER_START;
+    ring->data_size = 0;
+    return;
+  }
 
-  return (SUPLA_RESULT_TRUE);
+  ring->begin = (ring->begin + size) & SPROTO_BUFFER_MASK;
+  ring->data_size -= size;
 }
 
 char sproto_in_buffer_append(void *spd_ptr, char *data,
                              unsigned _supla_int_t data_size) {
   TSuplaProtoData *spd = (TSuplaProtoData *)spd_ptr;
-  return sproto_buffer_append(spd_ptr, &spd->in.buffer, &spd->in.size,
-                              &spd->in.data_size, data, data_size);
+  return sproto_ring_append(&spd->in.ring, data, data_size);
+}
+
+char *sproto_in_buffer_reserve(void *spd_ptr, unsigned _supla_int_t *size) {
+  TSuplaProtoRingBuffer *ring = &((TSuplaProtoData *)spd_ptr)->in.ring;
+  unsigned _supla_int_t end = (ring->begin + ring->data_size) &
+                              SPROTO_BUFFER_MASK;
+
+  if (ring->data_size == SPROTO_BUFFER_SIZE) {
+    *size = 0;
+  } else if (end >= ring->begin) {
+    // free space wraps around, so only the part up to the end of buffer is
+    // contiguous
+    *size = SPROTO_BUFFER_SIZE - end;
+  } else {
+    *size = ring->begin - end;
+  }
+
+  return &ring->buffer[end];
+}
+
+void sproto_in_buffer_commit(void *spd_ptr, unsigned _supla_int_t size) {
+  TSuplaProtoRingBuffer *ring = &((TSuplaProtoData *)spd_ptr)->in.ring;
+  if (size > SPROTO_BUFFER_SIZE - ring->data_size) {
+    size = SPROTO_BUFFER_SIZE - ring->data_size;
+  }
+  ring->data_size += size;
 }
 
 #ifndef SPROTO_WITHOUT_OUT_BUFFER
@@ -161,57 +222,41 @@ char sproto_out_buffer_append(void *spd_ptr, TSuplaDataPacket *sdp) {
 
   if (packet_size > sdp_size) return SUPLA_RESULT_DATA_TOO_LARGE;
 
-  if (SUPLA_RESULT_TRUE ==
-      sproto_buffer_append(spd_ptr, &spd->out.buffer, &spd->out.size,
-                           &spd->out.data_size, (char *)sdp, packet_size)) {
-    return sproto_buffer_append(spd_ptr, &spd->out.buffer, &spd->out.size,
-                                &spd->out.data_size, sproto_tag,
-                                SUPLA_TAG_SIZE);
-  }
+  // packet and its closing tag are appended together or not at all
+  if (packet_size + SUPLA_TAG_SIZE > SPROTO_BUFFER_SIZE - spd->out.data_size)
+    return (SUPLA_RESULT_FALSE);
 
-  return (SUPLA_RESULT_FALSE);
+  sproto_ring_append(&spd->out, (char *)sdp, packet_size);
+  sproto_ring_append(&spd->out, sproto_tag, SUPLA_TAG_SIZE);
+
+  return (SUPLA_RESULT_TRUE);
 }
 
 unsigned _supla_int_t sproto_pop_out_data(void *spd_ptr, char *buffer,
                                           unsigned _supla_int_t buffer_size) {
-  unsigned _supla_int_t a;
-  unsigned _supla_int_t b;
-
   TSuplaProtoData *spd = (TSuplaProtoData *)spd_ptr;
 
   if (spd->out.data_size <= 0 || buffer_size == 0 || buffer == NULL) return (0);
 
   if (spd->out.data_size < buffer_size) buffer_size = spd->out.data_size;
 
-  memcpy(buffer, spd->out.buffer, buffer_size);
-
-  b = 0;
-
-  for (a = buffer_size; a < spd->out.data_size; a++) {
-    spd->out.buffer[b] = spd->out.buffer[a];
-    b++;
-  }
-
-  spd->out.data_size -= buffer_size;
+  sproto_ring_peek(&spd->out, 0, buffer, buffer_size);
+  sproto_ring_drop(&spd->out, buffer_size);
 
-  if (spd->out.data_size < spd->out.size) {
-    b = spd->out.size;
+  return (buffer_size);
+}
 
-    spd->out.size = spd->out.data_size;
-    if (spd->out.size < BUFFER_MIN_SIZE) spd->out.size = BUFFER_MIN_SIZE;
+char *sproto_out_buffer_view(void *spd_ptr, unsigned _supla_int_t *size) {
+  TSuplaProtoRingBuffer *ring = &((TSuplaProtoData *)spd_ptr)->out;
 
-    if (b != spd->out.size) {
-      char *new_out_buffer = (char *)realloc(spd->out.buffer, spd->out.size);
+  *size = SPROTO_BUFFER_SIZE - ring->begin;
+  if (*size > ring->data_size) *size = ring->data_size;
 
-      if (new_out_buffer == NULL && spd->out.size > 0) {
-        spd->out.size = b;
-      } else {
-        spd->out.buffer = new_out_buffer;
-      }
-    }
-  }
+  return &ring->buffer[ring->begin];
+}
 
-  return (buffer_size);
+void sproto_out_buffer_drop(void *spd_ptr, unsigned _supla_int_t size) {
+  sproto_ring_drop(&((TSuplaProtoData *)spd_ptr)->out, size);
 }
 #endif /*SPROTO_WITHOUT_OUT_BUFFER*/
 
@@ -225,93 +270,126 @@ char sproto_out_dataexists(void *spd_ptr) {
 }
 
 char sproto_in_dataexists(void *spd_ptr) {
-  return ((TSuplaProtoData *)spd_ptr)->in.data_size > 0 ? SUPLA_RESULT_TRUE
-                                                        : SUPLA_RESULT_FALSE;
+  TSuplaProtoInBuffer *in = &((TSuplaProtoData *)spd_ptr)->in;
+  // peeked packet is already taken by the caller
+  return in->ring.data_size > in->peeked_size ? SUPLA_RESULT_TRUE
+                                              : SUPLA_RESULT_FALSE;
 }
 
-void sproto_shrink_in_buffer(TSuplaProtoInBuffer *in,
-                             unsigned _supla_int_t size) {
-  unsigned _supla_int_t old_size = in->size;
-  _supla_int_t a, b;
-
-  in->begin_tag = 0;
-
-  if (size > in->data_size) size = in->data_size;
-
-  b = 0;
+char sproto_in_packet_available(void *spd_ptr) {
+  TSuplaProtoInBuffer *in = &((TSuplaProtoData *)spd_ptr)->in;
+  unsigned _supla_int_t header_size =
+      sizeof(TSuplaDataPacket) - SUPLA_MAX_DATA_SIZE;
+  unsigned _supla_int_t offset = in->peeked_size;
+  unsigned _supla_int_t available = in->ring.data_size - offset;
+  char header[sizeof(TSuplaDataPacket) - SUPLA_MAX_DATA_SIZE];
+  TSuplaDataPacket *_sdp;
 
-  for (a = size; a < in->data_size; a++) {
-    in->buffer[b] = in->buffer[a];
-    b++;
+  if (available < SUPLA_TAG_SIZE) {
+    return SUPLA_RESULT_FALSE;
   }
 
-  in->data_size -= size;
+  // data which sproto_peek_in_sdp() rejects has to be handled as well
+  if (memcmp(sproto_ring_view(&in->ring, offset, SUPLA_TAG_SIZE, header),
+             sproto_tag, SUPLA_TAG_SIZE) != 0) {
+    return SUPLA_RESULT_TRUE;
+  }
 
-  if (in->data_size < in->size) {
-    in->size = in->data_size;
+  if (available - SUPLA_TAG_SIZE < header_size) {
+    return SUPLA_RESULT_FALSE;
+  }
 
-    if (in->size < BUFFER_MIN_SIZE) in->size = BUFFER_MIN_SIZE;
+  _sdp = (TSuplaDataPacket *)sproto_ring_view(&in->ring, offset, header_size,
+                                              header);
+  if (_sdp->version > SUPLA_PROTO_VERSION ||
+      _sdp->version < SUPLA_PROTO_VERSION_MIN ||
+      header_size + _sdp->data_size > sizeof(TSuplaDataPacket) ||
+      header_size + _sdp->data_size + SUPLA_TAG_SIZE > SPROTO_BUFFER_SIZE) {
+    return SUPLA_RESULT_TRUE;
+  }
 
-    if (old_size != in->size) {
-      char *new_in_buffer = (char *)realloc(in->buffer, in->size);
+  return header_size + _sdp->data_size + SUPLA_TAG_SIZE <= available
+             ? SUPLA_RESULT_TRUE
+             : SUPLA_RESULT_FALSE;
+}
 
-      if (new_in_buffer == NULL && in->size > 0) {
-        in->size = old_size;
-      } else {
-        in->buffer = new_in_buffer;
-      }
-    }
-  }
+void sproto_shrink_in_buffer(TSuplaProtoInBuffer *in,
+                             unsigned _supla_int_t size) {
+  in->begin_tag = 0;
+  sproto_ring_drop(&in->ring, size);
 }
 
-char sproto_pop_in_sdp(void *spd_ptr, TSuplaDataPacket *sdp) {
+char sproto_peek_in_sdp(void *spd_ptr, TSuplaDataPacket **sdp,
+                        TSuplaDataPacket *scratch) {
   unsigned _supla_int_t header_size;
+  unsigned _supla_int_t data_size;
+  unsigned _supla_int_t pos;
   TSuplaDataPacket *_sdp;
+  char tag[SUPLA_TAG_SIZE];
 
   TSuplaProtoData *spd = (TSuplaProtoData *)spd_ptr;
+  TSuplaProtoInBuffer *in = &spd->in;
+
+  sproto_release_in_sdp(spd_ptr);
 
-  if (spd->in.begin_tag == 0 && spd->in.data_size >= SUPLA_TAG_SIZE) {
-    if (memcmp(spd->in.buffer, sproto_tag, SUPLA_TAG_SIZE) == 0) {
-      spd->in.begin_tag = 1;
+  if (in->begin_tag == 0 && in->ring.data_size >= SUPLA_TAG_SIZE) {
+    if (memcmp(sproto_ring_view(&in->ring, 0, SUPLA_TAG_SIZE, tag), sproto_tag,
+               SUPLA_TAG_SIZE) == 0) {
+      in->begin_tag = 1;
     } else {
-      sproto_shrink_in_buffer(&spd->in, spd->in.data_size);
+      sproto_shrink_in_buffer(in, in->ring.data_size);
       return SUPLA_RESULT_DATA_ERROR;
     }
   }
 
-  if (spd->in.begin_tag == 1) {
+  if (in->begin_tag == 1) {
     header_size = sizeof(TSuplaDataPacket) - SUPLA_MAX_DATA_SIZE;
-    if ((spd->in.data_size - SUPLA_TAG_SIZE) >= header_size) {
-      _sdp = (TSuplaDataPacket *)spd->in.buffer;
+    if ((in->ring.data_size - SUPLA_TAG_SIZE) >= header_size) {
+      // header is read in place, or copied to scratch when it wraps around
+      _sdp = (TSuplaDataPacket *)sproto_ring_view(&in->ring, 0, header_size,
+                                                  (char *)scratch);
+      data_size = _sdp->data_size;
 
       if (_sdp->version > SUPLA_PROTO_VERSION ||
           _sdp->version < SUPLA_PROTO_VERSION_MIN) {
-        sdp->version = _sdp->version;
-        sproto_shrink_in_buffer(&spd->in, spd->in.data_size);
+        scratch->version = _sdp->version;
+        sproto_shrink_in_buffer(in, in->ring.data_size);
 
         return SUPLA_RESULT_VERSION_ERROR;
       }
 
-      if ((header_size + _sdp->data_size) > sizeof(TSuplaDataPacket)) {
-        sproto_shrink_in_buffer(&spd->in, spd->in.data_size);
+      if ((header_size + data_size) > sizeof(TSuplaDataPacket)) {
+        sproto_shrink_in_buffer(in, in->ring.data_size);
         return SUPLA_RESULT_DATA_ERROR;
       }
 
-      if ((header_size + _sdp->data_size + SUPLA_TAG_SIZE) > spd->in.data_size)
+      // packet which doesn't fit in input buffer would never be completed
+      if ((header_size + data_size + SUPLA_TAG_SIZE) > SPROTO_BUFFER_SIZE) {
+        sproto_shrink_in_buffer(in, in->ring.data_size);
+        return SUPLA_RESULT_BUFFER_OVERFLOW;
+      }
+
+      if ((header_size + data_size + SUPLA_TAG_SIZE) > in->ring.data_size)
         return SUPLA_RESULT_FALSE;
 
-      if (header_size + _sdp->data_size >= spd->in.size ||
-          memcmp(&spd->in.buffer[header_size + _sdp->data_size], sproto_tag,
-                 SUPLA_TAG_SIZE) != 0) {
-        sproto_shrink_in_buffer(&spd->in, spd->in.data_size);
+      if (memcmp(sproto_ring_view(&in->ring, header_size + data_size,
+                                  SUPLA_TAG_SIZE, tag),
+                 sproto_tag, SUPLA_TAG_SIZE) != 0) {
+        sproto_shrink_in_buffer(in, in->ring.data_size);
 
         return SUPLA_RESULT_DATA_ERROR;
       }
 
-      memcpy(sdp, spd->in.buffer, header_size + _sdp->data_size);
-      sproto_shrink_in_buffer(&spd->in,
-                              header_size + _sdp->data_size + SUPLA_TAG_SIZE);
+      pos = in->ring.begin;
+      if (header_size + data_size <= SPROTO_BUFFER_SIZE - pos) {
+        *sdp = (TSuplaDataPacket *)&in->ring.buffer[pos];
+      } else {
+        sproto_ring_peek(&in->ring, 0, (char *)scratch,
+                         header_size + data_size);
+        *sdp = scratch;
+      }
 
+      in->peeked_size = header_size + data_size + SUPLA_TAG_SIZE;
       return (SUPLA_RESULT_TRUE);
     }
   }
@@ -319,6 +397,29 @@ char sproto_pop_in_sdp(void *spd_ptr, TSuplaDataPacket *sdp) {
   return (SUPLA_RESULT_FALSE);
 }
 
+void sproto_release_in_sdp(void *spd_ptr) {
+  TSuplaProtoInBuffer *in = &((TSuplaProtoData *)spd_ptr)->in;
+  if (in->peeked_size > 0) {
+    sproto_shrink_in_buffer(in, in->peeked_size);
+    in->peeked_size = 0;
+  }
+}
+
+char sproto_pop_in_sdp(void *spd_ptr, TSuplaDataPacket *sdp) {
+  TSuplaDataPacket *view = NULL;
+  char result = sproto_peek_in_sdp(spd_ptr, &view, sdp);
+
+  if (result == SUPLA_RESULT_TRUE) {
+    if (view != sdp) {
+      memcpy(sdp, view,
+             sizeof(TSuplaDataPacket) - SUPLA_MAX_DATA_SIZE + view->data_size);
+    }
+    sproto_release_in_sdp(spd_ptr);
+  }
+
+  return result;
+}
+
 void sproto_set_version(void *spd_ptr, unsigned char version) {
   if (version >= SUPLA_PROTO_VERSION_MIN && version <= SUPLA_PROTO_VERSION) {
     ((TSuplaProtoData *)spd_ptr)->version = version;
@@ -377,33 +478,37 @@ void sproto_log_summary(void *spd_ptr) {
   TSuplaProtoData *spd = (TSuplaProtoData *)spd_ptr;
 
   supla_log(LOG_DEBUG, "BUFFER IN");
-  supla_log(LOG_DEBUG, "         size: %i", spd->in.size);
-  supla_log(LOG_DEBUG, "    data_size: %i", spd->in.data_size);
+  supla_log(LOG_DEBUG, "         size: %i", SPROTO_BUFFER_SIZE);
+  supla_log(LOG_DEBUG, "        begin: %i", spd->in.ring.begin);
+  supla_log(LOG_DEBUG, "    data_size: %i", spd->in.ring.data_size);
   supla_log(LOG_DEBUG, "    begin_tag: %i", spd->in.begin_tag);
 #ifndef SPROTO_WITHOUT_OUT_BUFFER
   supla_log(LOG_DEBUG, "BUFFER OUT");
-  supla_log(LOG_DEBUG, "         size: %i", spd->out.size);
+  supla_log(LOG_DEBUG, "         size: %i", SPROTO_BUFFER_SIZE);
+  supla_log(LOG_DEBUG, "        begin: %i", spd->out.begin);
   supla_log(LOG_DEBUG, "    data_size: %i", spd->out.data_size);
 #endif /*SPROTO_WITHOUT_OUT_BUFFER*/
 }
 
 void sproto_buffer_dump(void *spd_ptr, unsigned char in) {
-  _supla_int_t a;
-  char *buffer = NULL;
-  _supla_int_t size = 0;
+  unsigned _supla_int_t a;
+  char c;
+  TSuplaProtoRingBuffer *ring = NULL;
 
   TSuplaProtoData *spd = (TSuplaProtoData *)spd_ptr;
 
   if (in != 0) {
-    buffer = spd->in.buffer;
-    size = spd->in.data_size;
+    ring = &spd->in.ring;
 #ifndef SPROTO_WITHOUT_OUT_BUFFER
   } else {
-    buffer = spd->out.buffer;
-    size = spd->out.data_size;
+    ring = &spd->out;
 #endif /*SPROTO_WITHOUT_OUT_BUFFER*/
   }
 
-  for (a = 0; a < size; a++)
-    supla_log(LOG_DEBUG, "%c [%i]", buffer[a], buffer[a]);
+  if (ring == NULL) return;
+
+  for (a = 0; a < ring->data_size; a++) {
+    c = ring->buffer[(ring->begin + a) & SPROTO_BUFFER_MASK];
+    supla_log(LOG_DEBUG, "%c [%i]", c, c);
+  }
 }
@@ -1649,13 +1649,33 @@ void sproto_free(void *spd_ptr);
 char sproto_out_buffer_append(void *spd_ptr, TSuplaDataPacket *sdp);
 unsigned _supla_int_t sproto_pop_out_data(void *spd_ptr, char *buffer,
                                           unsigned _supla_int_t buffer_size);
+// Returns pointer to contiguous part of output data and sets its size. Data
+// stays in the buffer until sproto_out_buffer_drop() is called.
+char *sproto_out_buffer_view(void *spd_ptr, unsigned _supla_int_t *size);
+void sproto_out_buffer_drop(void *spd_ptr, unsigned _supla_int_t size);
 #endif /*SPROTO_WITHOUT_OUT_BUFFER*/
 char sproto_out_dataexists(void *spd_ptr);
 char sproto_in_buffer_append(void *spd_ptr, char *data,
                              unsigned _supla_int_t data_size);
+// Returns pointer to contiguous free space in input buffer and sets its size.
+// Data written there (i.e. directly by socket read) is added to the buffer by
+// sproto_in_buffer_commit().
+char *sproto_in_buffer_reserve(void *spd_ptr, unsigned _supla_int_t *size);
+void sproto_in_buffer_commit(void *spd_ptr, unsigned _supla_int_t size);
 
 char sproto_pop_in_sdp(void *spd_ptr, TSuplaDataPacket *sdp);
+// Same as sproto_pop_in_sdp, but packet is not copied when it is stored
+// contiguously in input buffer. "sdp" is set to the packet in the buffer, or
+// to "scratch" with a copy of the packet. Packet stays valid until
+// sproto_release_in_sdp() or the next peek.
+char sproto_peek_in_sdp(void *spd_ptr, TSuplaDataPacket **sdp,
+                        TSuplaDataPacket *scratch);
+void sproto_release_in_sdp(void *spd_ptr);
 char sproto_in_dataexists(void *spd_ptr);
+// Returns SUPLA_RESULT_TRUE when input buffer holds a whole packet (or data
+// which is rejected by the next peek), so sproto_peek_in_sdp() won't wait
+// for more data. Peeked packet is not taken into account.
+char sproto_in_packet_available(void *spd_ptr);
 
 unsigned char sproto_get_version(void *spd_ptr);
 void sproto_set_version(void *spd_ptr, unsigned char version);
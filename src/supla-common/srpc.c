@@ -17,6 +17,7 @@
  */
 
 #include "srpc.h"
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 #include "lck.h"
@@ -48,15 +49,12 @@
 #define SRPC_QUEUE_SIZE 2
 #endif /*SRPC_QUEUE_SIZE*/
 
-#ifndef SRPC_QUEUE_MIN_ALLOC_COUNT
-#define SRPC_QUEUE_MIN_ALLOC_COUNT 2
-#endif /* SRPC_QUEUE_MIN_ALLOC_COUNT */
-
 #elif defined(__AVR__)
 
 #define SRPC_BUFFER_SIZE 32
 #define SRPC_QUEUE_SIZE 1
-#define SRPC_QUEUE_MIN_ALLOC_COUNT 1
+#define SRPC_QUEUE_BUFFER_SIZE sizeof(TSuplaDataPacket)
+#define SRPC_DATA_ALIGNMENT 1
 #define __EH_DISABLED
 
 #else
@@ -71,15 +69,78 @@
 #define SRPC_QUEUE_SIZE 10
 #endif /*SRPC_QUEUE_SIZE*/
 
-#ifndef SRPC_QUEUE_MIN_ALLOC_COUNT
-#define SRPC_QUEUE_MIN_ALLOC_COUNT 0
-#endif /*SRPC_QUEUE_MIN_ALLOC_COUNT*/
+// Size of buffer shared by packets waiting in queue. Packets take only
+// header and data_size bytes, so with smaller buffer queue still fits
+// SRPC_QUEUE_SIZE short packets, but fewer long ones.
+#ifndef SRPC_QUEUE_BUFFER_SIZE
+#define SRPC_QUEUE_BUFFER_SIZE (SRPC_QUEUE_SIZE * sizeof(TSuplaDataPacket))
+#endif /*SRPC_QUEUE_BUFFER_SIZE*/
+
+// Received structures are used directly from input buffer only when they are
+// aligned to SRPC_DATA_ALIGNMENT
+#ifndef SRPC_DATA_ALIGNMENT
+#define SRPC_DATA_ALIGNMENT 4
+#endif /*SRPC_DATA_ALIGNMENT*/
+
+#ifdef SRPC_WITHOUT_RD_MALLOC
+// Number of received structures which can be handled at the same time
+// without srpc_rd_free() call
+#ifndef SRPC_RD_ARENA_SLOT_COUNT
+#define SRPC_RD_ARENA_SLOT_COUNT 1
+#endif /*SRPC_RD_ARENA_SLOT_COUNT*/
+
+// Received structures which can't be used in place are copied to one of
+// arena slots. Slot fits every structure which is received by device.
+typedef union {
+  TSDC_SuplaGetVersionResult sdc_getversion_result;
+  TSDC_SuplaVersionError sdc_version_error;
+  TDCS_SuplaPingServer dcs_ping;
+  TSDC_SuplaPingServerResult sdc_ping_result;
+  TSDC_SuplaSetActivityTimeoutResult sdc_set_activity_timeout_result;
+  TSDC_RegistrationEnabled sdc_reg_enabled;
+  TSDC_UserLocalTimeResult sdc_user_localtime_result;
+  TCSD_ChannelStateRequest csd_channel_state_request;
+  TSD_SuplaRegisterDeviceResult sd_register_device_result;
+  TSD_SuplaChannelNewValue sd_channel_new_value;
+  TSD_SuplaChannelGroupNewValue sd_channelgroup_new_value;
+  TSD_FirmwareUpdate_UrlResult sc_firmware_update_url_result;
+  TSD_DeviceCalCfgRequest sd_device_calcfg_request;
+  TSD_ChannelFunctions sd_channel_functions;
+
+  // packed structures are copied to slot, so it is aligned like malloc()
+  long long align_ll;
+  double align_d;
+  void *align_ptr;
+} TsrpcReceivedDataSlotData;
+
+typedef struct {
+  // has to be the first member, srpc_rd_free() gets slot from data pointer
+  TsrpcReceivedDataSlotData data;
+  unsigned char used;
+} TsrpcReceivedDataSlot;
+#endif /*SRPC_WITHOUT_RD_MALLOC*/
 
+typedef struct {
+  unsigned _supla_int_t rr_id;
+  unsigned _supla_int_t offset;
+  unsigned _supla_int_t size;
+  // space taken in buffer, includes packets popped from behind this one
+  unsigned _supla_int_t span;
+} Tsrpc_QueueItem;
+
+// Packets are stored one after another in ring buffer, in the same order as
+// items. When item is popped from the middle, next items are moved back and
+// space of its packet is joined to the previous item, so it is released
+// together with that item.
 typedef struct {
   unsigned char item_count;
-  unsigned char alloc_count;
+  unsigned char first;
 
-  TSuplaDataPacket *item[SRPC_QUEUE_SIZE];
+  unsigned _supla_int_t data_begin;
+  unsigned _supla_int_t data_size;
+
+  Tsrpc_QueueItem item[SRPC_QUEUE_SIZE];
+  char buffer[SRPC_QUEUE_BUFFER_SIZE];
 } Tsrpc_Queue;
 
 typedef struct {
@@ -88,6 +149,10 @@ typedef struct {
 
   TSuplaDataPacket sdp;
 
+  // Received packet which is being processed. Points to the packet in proto
+  // input buffer or to sdp.
+  TSuplaDataPacket *in_sdp;
+
 #ifndef SRPC_WITHOUT_IN_QUEUE
   Tsrpc_Queue in_queue;
 #endif /*SRPC_WITHOUT_IN_QUEUE*/
@@ -96,6 +161,10 @@ typedef struct {
   Tsrpc_Queue out_queue;
 #endif /*SRPC_WITHOUT_OUT_QUEUE*/
 
+#ifdef SRPC_WITHOUT_RD_MALLOC
+  TsrpcReceivedDataSlot rd_arena[SRPC_RD_ARENA_SLOT_COUNT];
+#endif /*SRPC_WITHOUT_RD_MALLOC*/
+
   void *lck;
 } Tsrpc;
 
@@ -110,6 +179,7 @@ void *SRPC_ICACHE_FLASH srpc_init(TsrpcParams *params) {
 
   memset(srpc, 0, sizeof(Tsrpc));
   srpc->proto = sproto_init();
+  srpc->in_sdp = &srpc->sdp;
 
 #ifndef ESP8266
 #ifndef ESP32
@@ -129,15 +199,10 @@ void *SRPC_ICACHE_FLASH srpc_init(TsrpcParams *params) {
 }
 
 void SRPC_ICACHE_FLASH srpc_queue_free(Tsrpc_Queue *queue) {
-  _supla_int_t a;
-  for (a = 0; a < SRPC_QUEUE_SIZE; a++) {
-    if (queue->item[a] != NULL) {
-      free(queue->item[a]);
-    }
-  }
-
   queue->item_count = 0;
-  queue->alloc_count = 0;
+  queue->first = 0;
+  queue->data_begin = 0;
+  queue->data_size = 0;
 }
 
 void SRPC_ICACHE_FLASH srpc_free(void *_srpc) {
@@ -161,53 +226,92 @@ void SRPC_ICACHE_FLASH srpc_free(void *_srpc) {
 
 char SRPC_ICACHE_FLASH srpc_queue_push(Tsrpc_Queue *queue,
                                        TSuplaDataPacket *sdp) {
-  if (queue->item_count >= SRPC_QUEUE_SIZE) {
-    return SUPLA_RESULT_FALSE;
-  }
+  unsigned _supla_int_t size, offset, part;
+  unsigned char idx;
+  Tsrpc_QueueItem *item;
 
-  if (queue->item[queue->item_count] == NULL) {
-    queue->item[queue->item_count] =
-        (TSuplaDataPacket *)malloc(sizeof(TSuplaDataPacket));
+  if (queue->item_count >= SRPC_QUEUE_SIZE ||
+      sdp->data_size > SUPLA_MAX_DATA_SIZE) {
+    return SUPLA_RESULT_FALSE;
   }
 
-  if (queue->item[queue->item_count] == NULL) {
+  size = sizeof(TSuplaDataPacket) - SUPLA_MAX_DATA_SIZE + sdp->data_size;
+  if (size > SRPC_QUEUE_BUFFER_SIZE - queue->data_size) {
     return SUPLA_RESULT_FALSE;
-  } else {
-    queue->alloc_count++;
   }
 
-  memcpy(queue->item[queue->item_count], sdp, sizeof(TSuplaDataPacket));
+  offset = queue->data_begin + queue->data_size;
+  if (offset >= SRPC_QUEUE_BUFFER_SIZE) offset -= SRPC_QUEUE_BUFFER_SIZE;
+
+  part = SRPC_QUEUE_BUFFER_SIZE - offset;
+  if (part > size) part = size;
+
+  memcpy(&queue->buffer[offset], sdp, part);
+  memcpy(queue->buffer, (char *)sdp + part, size - part);
+
+  idx = (queue->first + queue->item_count) % SRPC_QUEUE_SIZE;
+  item = &queue->item[idx];
+  item->rr_id = sdp->rr_id;
+  item->offset = offset;
+  item->size = size;
+  item->span = size;
+
   queue->item_count++;
+  queue->data_size += size;
 
   return SUPLA_RESULT_TRUE;
 }
 
 char SRPC_ICACHE_FLASH srpc_queue_pop(Tsrpc_Queue *queue, TSuplaDataPacket *sdp,
                                       unsigned _supla_int_t rr_id) {
-  _supla_int_t a, b;
+  unsigned char a, b;
+  unsigned _supla_int_t part;
+  Tsrpc_QueueItem *item;
 
-  for (a = 0; a < queue->item_count; a++)
-    if (rr_id == 0 || queue->item[a]->rr_id == rr_id) {
-      memcpy(sdp, queue->item[a], sizeof(TSuplaDataPacket));
+  for (a = 0; a < queue->item_count; a++) {
+    item = &queue->item[(queue->first + a) % SRPC_QUEUE_SIZE];
 
-      if (queue->alloc_count > SRPC_QUEUE_MIN_ALLOC_COUNT) {
-        queue->alloc_count--;
-        free(queue->item[a]);
-        queue->item[a] = NULL;
-      }
+    if (rr_id != 0 && item->rr_id != rr_id) {
+      continue;
+    }
 
-      TSuplaDataPacket *item = queue->item[a];
+    part = SRPC_QUEUE_BUFFER_SIZE - item->offset;
+    if (part > item->size) part = item->size;
+
+    memcpy(sdp, &queue->buffer[item->offset], part);
+    memcpy((char *)sdp + part, queue->buffer, item->size - part);
+
+    if (a == 0) {
+      queue->data_begin = item->offset + item->span;
+      if (queue->data_begin >= SRPC_QUEUE_BUFFER_SIZE)
+        queue->data_begin -= SRPC_QUEUE_BUFFER_SIZE;
+      queue->data_size -= item->span;
+      queue->first = (queue->first + 1) % SRPC_QUEUE_SIZE;
+    } else {
+      if (a == queue->item_count - 1) {
+        // space at the end of data is free again
+        queue->data_size -= item->span;
+      } else {
+        queue->item[(queue->first + a - 1) % SRPC_QUEUE_SIZE].span +=
+            item->span;
+      }
 
       for (b = a; b < queue->item_count - 1; b++) {
-        queue->item[b] = queue->item[b + 1];
+        queue->item[(queue->first + b) % SRPC_QUEUE_SIZE] =
+            queue->item[(queue->first + b + 1) % SRPC_QUEUE_SIZE];
       }
+    }
 
-      queue->item_count--;
-      queue->item[queue->item_count] = item;
+    queue->item_count--;
 
-      return SUPLA_RESULT_TRUE;
+    if (queue->item_count == 0) {
+      queue->data_begin = 0;
+      queue->data_size = 0;
     }
 
+    return SUPLA_RESULT_TRUE;
+  }
+
   return SUPLA_RESULT_FALSE;
 }
 
@@ -216,7 +320,11 @@ char SRPC_ICACHE_FLASH srpc_in_queue_pop(Tsrpc *srpc, TSuplaDataPacket *sdp,
 #ifdef SRPC_WITHOUT_IN_QUEUE
   return 1;
 #else
-  return srpc_queue_pop(&srpc->in_queue, sdp, rr_id);
+  if (srpc_queue_pop(&srpc->in_queue, sdp, rr_id) == SUPLA_RESULT_TRUE) {
+    srpc->in_sdp = sdp;
+    return SUPLA_RESULT_TRUE;
+  }
+  return SUPLA_RESULT_FALSE;
 #endif /*SRPC_WITHOUT_IN_QUEUE*/
 }
 
@@ -232,6 +340,15 @@ char SRPC_ICACHE_FLASH srpc_out_queue_push(Tsrpc *srpc, TSuplaDataPacket *sdp) {
   if (sdp->data_size < SUPLA_MAX_DATA_SIZE) {
     data_size -= SUPLA_MAX_DATA_SIZE - sdp->data_size;
   }
+  if (srpc->params.data_writev) {
+    TsrpcDataVector vec[2];
+    vec[0].buf = sdp;
+    vec[0].count = data_size;
+    vec[1].buf = sproto_tag;
+    vec[1].count = SUPLA_TAG_SIZE;
+    srpc->params.data_writev(vec, 2, srpc->params.user_params);
+    return 1;
+  }
   srpc->params.data_write((char *)sdp, data_size, srpc->params.user_params);
   srpc->params.data_write(sproto_tag, SUPLA_TAG_SIZE, srpc->params.user_params);
   return 1;
@@ -263,6 +380,14 @@ char SRPC_ICACHE_FLASH srpc_input_dataexists(void *_srpc) {
   return lck_unlock_r(srpc->lck, result);
 }
 
+char SRPC_ICACHE_FLASH srpc_input_packet_available(void *_srpc) {
+  int result = SUPLA_RESULT_FALSE;
+  Tsrpc *srpc = (Tsrpc *)_srpc;
+  lck_lock(srpc->lck);
+  result = sproto_in_packet_available(srpc->proto);
+  return lck_unlock_r(srpc->lck, result);
+}
+
 char SRPC_ICACHE_FLASH srpc_output_dataexists(void *_srpc) {
   int result = SUPLA_RESULT_FALSE;
   Tsrpc *srpc = (Tsrpc *)_srpc;
@@ -273,31 +398,43 @@ char SRPC_ICACHE_FLASH srpc_output_dataexists(void *_srpc) {
 
 char SRPC_ICACHE_FLASH srpc_iterate(void *_srpc) {
   Tsrpc *srpc = (Tsrpc *)_srpc;
-  char data_buffer[SRPC_BUFFER_SIZE];
+  char *buffer;
+  unsigned _supla_int_t buffer_size = 0;
+  _supla_int_t data_size = -1;
   char result;
   unsigned char version;
+#ifndef SRPC_WITHOUT_IN_QUEUE
+  unsigned _supla_int_t rr_id;
+  unsigned _supla_int_t call_type;
+#endif /*SRPC_WITHOUT_IN_QUEUE*/
 #ifndef __EH_DISABLED
   unsigned char raise_event = 0;
 #endif /*__EH_DISABLED*/
 
   // --------- IN ---------------
-  _supla_int_t data_size = srpc->params.data_read(data_buffer, SRPC_BUFFER_SIZE,
-                                                  srpc->params.user_params);
+  // Data is read directly to free space in proto input buffer. When the
+  // buffer is full, packets which are already there are processed first.
+  lck_lock(srpc->lck);
+  buffer = sproto_in_buffer_reserve(srpc->proto, &buffer_size);
+  lck_unlock(srpc->lck);
+
+  if (buffer_size > SRPC_BUFFER_SIZE) buffer_size = SRPC_BUFFER_SIZE;
+
+  if (buffer_size > 0) {
+    data_size =
+        srpc->params.data_read(buffer, buffer_size, srpc->params.user_params);
 
-  if (data_size == 0) return SUPLA_RESULT_FALSE;
+    if (data_size == 0) return SUPLA_RESULT_FALSE;
+  }
 
   lck_lock(srpc->lck);
 
-  if (data_size > 0 &&
-      SUPLA_RESULT_TRUE != (result = sproto_in_buffer_append(
-                                srpc->proto, data_buffer, data_size))) {
-    supla_log(LOG_DEBUG, "sproto_in_buffer_append: %i, datasize: %i", result,
-              data_size);
-    return lck_unlock_r(srpc->lck, SUPLA_RESULT_FALSE);
+  if (data_size > 0) {
+    sproto_in_buffer_commit(srpc->proto, data_size);
   }
 
   if (SUPLA_RESULT_TRUE ==
-      (result = sproto_pop_in_sdp(srpc->proto, &srpc->sdp))) {
+      (result = sproto_peek_in_sdp(srpc->proto, &srpc->in_sdp, &srpc->sdp))) {
 #ifndef __EH_DISABLED
     raise_event = sproto_in_dataexists(srpc->proto) == 1 ? 1 : 0;
 #endif /*__EH_DISABLED*/
@@ -306,17 +443,27 @@ char SRPC_ICACHE_FLASH srpc_iterate(void *_srpc) {
     if (srpc->params.on_remote_call_received) {
       lck_unlock(srpc->lck);
       srpc->params.on_remote_call_received(
-          srpc, srpc->sdp.rr_id, srpc->sdp.call_type, srpc->params.user_params,
-          srpc->sdp.version);
+          srpc, srpc->in_sdp->rr_id, srpc->in_sdp->call_type,
+          srpc->params.user_params, srpc->in_sdp->version);
       lck_lock(srpc->lck);
     }
+    // packet is kept in input buffer until it is processed by srpc_getdata
+    // called from on_remote_call_received
+    sproto_release_in_sdp(srpc->proto);
+    srpc->in_sdp = &srpc->sdp;
 #else
-    if (SUPLA_RESULT_TRUE == srpc_in_queue_push(srpc, &srpc->sdp)) {
+    rr_id = srpc->in_sdp->rr_id;
+    call_type = srpc->in_sdp->call_type;
+    version = srpc->in_sdp->version;
+    result = srpc_in_queue_push(srpc, srpc->in_sdp);
+    sproto_release_in_sdp(srpc->proto);
+    srpc->in_sdp = &srpc->sdp;
+
+    if (SUPLA_RESULT_TRUE == result) {
       if (srpc->params.on_remote_call_received) {
         lck_unlock(srpc->lck);
         srpc->params.on_remote_call_received(
-            srpc, srpc->sdp.rr_id, srpc->sdp.call_type,
-            srpc->params.user_params, srpc->sdp.version);
+            srpc, rr_id, call_type, srpc->params.user_params, version);
         lck_lock(srpc->lck);
       }
 
@@ -336,7 +483,7 @@ char SRPC_ICACHE_FLASH srpc_iterate(void *_srpc) {
         return SUPLA_RESULT_FALSE;
       }
     } else {
-      supla_log(LOG_DEBUG, "sproto_pop_in_sdp error: %i", result);
+      supla_log(LOG_DEBUG, "sproto_peek_in_sdp error: %i", result);
     }
 
     return lck_unlock_r(srpc->lck, SUPLA_RESULT_FALSE);
@@ -352,12 +499,16 @@ char SRPC_ICACHE_FLASH srpc_iterate(void *_srpc) {
     return lck_unlock_r(srpc->lck, SUPLA_RESULT_FALSE);
   }
 
-  data_size = sproto_pop_out_data(srpc->proto, data_buffer, SRPC_BUFFER_SIZE);
+  // Data is written directly from proto output buffer. Only srpc_iterate
+  // appends to this buffer, so it is not modified while lock is released.
+  buffer = sproto_out_buffer_view(srpc->proto, &buffer_size);
+  if (buffer_size > SRPC_BUFFER_SIZE) buffer_size = SRPC_BUFFER_SIZE;
 
-  if (data_size != 0) {
+  if (buffer_size != 0) {
     lck_unlock(srpc->lck);
-    srpc->params.data_write(data_buffer, data_size, srpc->params.user_params);
+    srpc->params.data_write(buffer, buffer_size, srpc->params.user_params);
     lck_lock(srpc->lck);
+    sproto_out_buffer_drop(srpc->proto, buffer_size);
   }
 
 #ifndef __EH_DISABLED
@@ -395,14 +546,17 @@ void SRPC_ICACHE_FLASH srpc_getpack(
   _supla_int_t c_header_size = item_sizeof - caption_max_size;
   _supla_int_t a, count, size, offset, pack_size;
   void *pack = NULL;
+  TSuplaDataPacket *sdp = srpc->in_sdp;
+  // data_size is limited by SUPLA_MAX_DATA_SIZE, so it fits signed type
+  _supla_int_t data_size = (_supla_int_t)sdp->data_size;
 
-  if (srpc->sdp.data_size < header_size || srpc->sdp.data_size > pack_sizeof) {
+  if (data_size < header_size || data_size > (_supla_int_t)pack_sizeof) {
     return;
   }
 
-  count = pack_get_count(srpc->sdp.data);
+  count = pack_get_count(sdp->data);
 
-  if (count < 0 || count > pack_max_count) {
+  if (count < 0 || count > (_supla_int_t)pack_max_count) {
     return;
   }
 
@@ -412,18 +566,18 @@ void SRPC_ICACHE_FLASH srpc_getpack(
   if (pack == NULL) return;
 
   memset(pack, 0, pack_size);
-  memcpy(pack, srpc->sdp.data, header_size);
+  memcpy(pack, sdp->data, header_size);
 
   offset = header_size;
   pack_set_count(pack, 0, 0);
 
   for (a = 0; a < count; a++)
-    if (srpc->sdp.data_size - offset >= c_header_size) {
-      size = get_item_caption_size(&srpc->sdp.data[offset]);
+    if (data_size - offset >= c_header_size) {
+      size = get_item_caption_size(&sdp->data[offset]);
 
-      if (size >= 0 && size <= caption_max_size &&
-          srpc->sdp.data_size - offset >= c_header_size + size) {
-        memcpy(get_item_ptr(pack, a), &srpc->sdp.data[offset],
+      if (size >= 0 && size <= (_supla_int_t)caption_max_size &&
+          data_size - offset >= c_header_size + size) {
+        memcpy(get_item_ptr(pack, a), &sdp->data[offset],
                c_header_size + size);
         offset += c_header_size + size;
         pack_set_count(pack, 1, 1);
@@ -434,7 +588,7 @@ void SRPC_ICACHE_FLASH srpc_getpack(
     }
 
   if (count == pack_get_count(pack)) {
-    srpc->sdp.data_size = 0;
+    sdp->data_size = 0;
     // dcs_ping is 1st variable in union
     rd->data.dcs_ping = pack;
 
@@ -631,22 +785,70 @@ void SRPC_ICACHE_FLASH srpc_getlocationpack(Tsrpc *srpc,
       &srpc_locationpack_get_item_caption_size);
 }
 
+// Returns memory for received structure of given size, which is not shared
+// with received packet. Without malloc, free arena slot is used.
+void *SRPC_ICACHE_FLASH srpc_rd_alloc_copy(Tsrpc *srpc, TsrpcReceivedData *rd,
+                                           unsigned _supla_int_t size) {
+#ifdef SRPC_WITHOUT_RD_MALLOC
+  int a;
+
+  if (size <= sizeof(TsrpcReceivedDataSlotData)) {
+    for (a = 0; a < SRPC_RD_ARENA_SLOT_COUNT; a++) {
+      if (!srpc->rd_arena[a].used) {
+        srpc->rd_arena[a].used = 1;
+        rd->data_source = SRPC_RD_DATA_ARENA;
+        return &srpc->rd_arena[a].data;
+      }
+    }
+  }
+
+  supla_log(LOG_DEBUG, "srpc: no arena slot for %i bytes", (int)size);
+  return NULL;
+#else
+  (void)(srpc);
+  (void)(rd);
+  return malloc(size);
+#endif /*SRPC_WITHOUT_RD_MALLOC*/
+}
+
+// Returns memory for received structure of given size. When payload of
+// received packet is aligned and the structure can be read directly from
+// input buffer, payload is returned and nothing is allocated or copied.
+void *SRPC_ICACHE_FLASH srpc_rd_alloc(Tsrpc *srpc, TsrpcReceivedData *rd,
+                                      unsigned _supla_int_t size) {
+  char *data = srpc->in_sdp->data;
+
+  // srpc->sdp is reused by async calls made while received data is handled,
+  // so only packets kept in input buffer are used in place. Shorter payloads
+  // are copied, because bytes after them belong to the next packet.
+  if (srpc->in_sdp != &srpc->sdp && size <= srpc->in_sdp->data_size &&
+      ((uintptr_t)data) % SRPC_DATA_ALIGNMENT == 0) {
+    rd->data_source = SRPC_RD_DATA_IN_PLACE;
+    return data;
+  }
+
+  return srpc_rd_alloc_copy(srpc, rd, size);
+}
+
 char SRPC_ICACHE_FLASH srpc_getdata(void *_srpc, TsrpcReceivedData *rd,
                                     unsigned _supla_int_t rr_id) {
   Tsrpc *srpc = (Tsrpc *)_srpc;
+  TSuplaDataPacket *sdp;
   char call_with_no_data = 0;
   rd->call_type = 0;
+  rd->data_source = SRPC_RD_DATA_HEAP;
 
   lck_lock(srpc->lck);
 
   if (SUPLA_RESULT_TRUE == srpc_in_queue_pop(srpc, &srpc->sdp, rr_id)) {
-    rd->call_type = srpc->sdp.call_type;
-    rd->rr_id = srpc->sdp.rr_id;
+    sdp = srpc->in_sdp;
+    rd->call_type = sdp->call_type;
+    rd->rr_id = sdp->rr_id;
 
     // first one
     rd->data.dcs_ping = NULL;
 
-    switch (srpc->sdp.call_type) {
+    switch (sdp->call_type) {
       case SUPLA_DCS_CALL_GETVERSION:
       case SUPLA_CS_CALL_GET_NEXT:
       case SUPLA_DCS_CALL_GET_REGISTRATION_ENABLED:
@@ -655,31 +857,33 @@ char SRPC_ICACHE_FLASH srpc_getdata(void *_srpc, TsrpcReceivedData *rd,
 
       case SUPLA_SDC_CALL_GETVERSION_RESULT:
 
-        if (srpc->sdp.data_size == sizeof(TSDC_SuplaGetVersionResult))
-          rd->data.sdc_getversion_result = (TSDC_SuplaGetVersionResult *)malloc(
-              sizeof(TSDC_SuplaGetVersionResult));
+        if (sdp->data_size == sizeof(TSDC_SuplaGetVersionResult))
+          rd->data.sdc_getversion_result =
+              (TSDC_SuplaGetVersionResult *)srpc_rd_alloc(
+                  srpc, rd, sizeof(TSDC_SuplaGetVersionResult));
 
         break;
 
       case SUPLA_SDC_CALL_VERSIONERROR:
 
-        if (srpc->sdp.data_size == sizeof(TSDC_SuplaVersionError))
-          rd->data.sdc_version_error =
-              (TSDC_SuplaVersionError *)malloc(sizeof(TSDC_SuplaVersionError));
+        if (sdp->data_size == sizeof(TSDC_SuplaVersionError))
+          rd->data.sdc_version_error = (TSDC_SuplaVersionError *)srpc_rd_alloc(
+              srpc, rd, sizeof(TSDC_SuplaVersionError));
 
         break;
 
       case SUPLA_DCS_CALL_PING_SERVER:
 
-        if (srpc->sdp.data_size == sizeof(TDCS_SuplaPingServer) ||
-            srpc->sdp.data_size == sizeof(TDCS_SuplaPingServer_COMPAT)) {
-          rd->data.dcs_ping =
-              (TDCS_SuplaPingServer *)malloc(sizeof(TDCS_SuplaPingServer));
+        if (sdp->data_size == sizeof(TDCS_SuplaPingServer) ||
+            sdp->data_size == sizeof(TDCS_SuplaPingServer_COMPAT)) {
+          // compat version is converted, so it is never used in place
+          rd->data.dcs_ping = (TDCS_SuplaPingServer *)srpc_rd_alloc_copy(
+              srpc, rd, sizeof(TDCS_SuplaPingServer));
 
 #ifndef __AVR__
-          if (srpc->sdp.data_size == sizeof(TDCS_SuplaPingServer_COMPAT)) {
+          if (sdp->data_size == sizeof(TDCS_SuplaPingServer_COMPAT)) {
             TDCS_SuplaPingServer_COMPAT *compat =
-                (TDCS_SuplaPingServer_COMPAT *)srpc->sdp.data;
+                (TDCS_SuplaPingServer_COMPAT *)sdp->data;
 
             rd->data.dcs_ping->now.tv_sec = compat->now.tv_sec;
             rd->data.dcs_ping->now.tv_usec = compat->now.tv_usec;
@@ -691,247 +895,256 @@ char SRPC_ICACHE_FLASH srpc_getdata(void *_srpc, TsrpcReceivedData *rd,
 
       case SUPLA_SDC_CALL_PING_SERVER_RESULT:
 
-        if (srpc->sdp.data_size == sizeof(TSDC_SuplaPingServerResult))
-          rd->data.sdc_ping_result = (TSDC_SuplaPingServerResult *)malloc(
-              sizeof(TSDC_SuplaPingServerResult));
+        if (sdp->data_size == sizeof(TSDC_SuplaPingServerResult))
+          rd->data.sdc_ping_result =
+              (TSDC_SuplaPingServerResult *)srpc_rd_alloc(
+                  srpc, rd, sizeof(TSDC_SuplaPingServerResult));
 
         break;
 
       case SUPLA_DCS_CALL_SET_ACTIVITY_TIMEOUT:
 
-        if (srpc->sdp.data_size == sizeof(TDCS_SuplaSetActivityTimeout))
+        if (sdp->data_size == sizeof(TDCS_SuplaSetActivityTimeout))
           rd->data.dcs_set_activity_timeout =
-              (TDCS_SuplaSetActivityTimeout *)malloc(
-                  sizeof(TDCS_SuplaSetActivityTimeout));
+              (TDCS_SuplaSetActivityTimeout *)srpc_rd_alloc(
+                  srpc, rd, sizeof(TDCS_SuplaSetActivityTimeout));
 
         break;
 
       case SUPLA_SDC_CALL_SET_ACTIVITY_TIMEOUT_RESULT:
 
-        if (srpc->sdp.data_size == sizeof(TSDC_SuplaSetActivityTimeoutResult))
+        if (sdp->data_size == sizeof(TSDC_SuplaSetActivityTimeoutResult))
           rd->data.sdc_set_activity_timeout_result =
-              (TSDC_SuplaSetActivityTimeoutResult *)malloc(
-                  sizeof(TSDC_SuplaSetActivityTimeoutResult));
+              (TSDC_SuplaSetActivityTimeoutResult *)srpc_rd_alloc(
+                  srpc, rd, sizeof(TSDC_SuplaSetActivityTimeoutResult));
 
         break;
 
       case SUPLA_SDC_CALL_GET_REGISTRATION_ENABLED_RESULT:
 
-        if (srpc->sdp.data_size == sizeof(TSDC_RegistrationEnabled))
-          rd->data.sdc_reg_enabled = (TSDC_RegistrationEnabled *)malloc(
-              sizeof(TSDC_RegistrationEnabled));
+        if (sdp->data_size == sizeof(TSDC_RegistrationEnabled))
+          rd->data.sdc_reg_enabled = (TSDC_RegistrationEnabled *)srpc_rd_alloc(
+              srpc, rd, sizeof(TSDC_RegistrationEnabled));
 
         break;
       case SUPLA_DCS_CALL_GET_USER_LOCALTIME:
         call_with_no_data = 1;
         break;
       case SUPLA_DCS_CALL_GET_USER_LOCALTIME_RESULT:
-        if (srpc->sdp.data_size <= sizeof(TSDC_UserLocalTimeResult) &&
-            srpc->sdp.data_size >=
+        if (sdp->data_size <= sizeof(TSDC_UserLocalTimeResult) &&
+            sdp->data_size >=
                 (sizeof(TSDC_UserLocalTimeResult) - SUPLA_TIMEZONE_MAXSIZE)) {
           rd->data.sdc_user_localtime_result =
-              (TSDC_UserLocalTimeResult *)malloc(
-                  sizeof(TSDC_UserLocalTimeResult));
+              (TSDC_UserLocalTimeResult *)srpc_rd_alloc(
+                  srpc, rd, sizeof(TSDC_UserLocalTimeResult));
         }
 
         break;
 
       case SUPLA_CSD_CALL_GET_CHANNEL_STATE:
-        if (srpc->sdp.data_size == sizeof(TCSD_ChannelStateRequest))
+        if (sdp->data_size == sizeof(TCSD_ChannelStateRequest))
           rd->data.csd_channel_state_request =
-              (TCSD_ChannelStateRequest *)malloc(
-                  sizeof(TCSD_ChannelStateRequest));
+              (TCSD_ChannelStateRequest *)srpc_rd_alloc(
+                  srpc, rd, sizeof(TCSD_ChannelStateRequest));
         break;
       case SUPLA_DSC_CALL_CHANNEL_STATE_RESULT:
-        if (srpc->sdp.data_size == sizeof(TDSC_ChannelState))
-          rd->data.dsc_channel_state =
-              (TDSC_ChannelState *)malloc(sizeof(TDSC_ChannelState));
+        if (sdp->data_size == sizeof(TDSC_ChannelState))
+          rd->data.dsc_channel_state = (TDSC_ChannelState *)srpc_rd_alloc(
+              srpc, rd, sizeof(TDSC_ChannelState));
         break;
 
 #ifndef SRPC_EXCLUDE_DEVICE
       case SUPLA_DS_CALL_REGISTER_DEVICE:
 
-        if (srpc->sdp.data_size >=
+        if (sdp->data_size >=
                 (sizeof(TDS_SuplaRegisterDevice) -
                  (sizeof(TDS_SuplaDeviceChannel) * SUPLA_CHANNELMAXCOUNT)) &&
-            srpc->sdp.data_size <= sizeof(TDS_SuplaRegisterDevice)) {
-          rd->data.ds_register_device = (TDS_SuplaRegisterDevice *)malloc(
-              sizeof(TDS_SuplaRegisterDevice));
+            sdp->data_size <= sizeof(TDS_SuplaRegisterDevice)) {
+          rd->data.ds_register_device =
+              (TDS_SuplaRegisterDevice *)srpc_rd_alloc(
+                  srpc, rd, sizeof(TDS_SuplaRegisterDevice));
         }
 
         break;
 
       case SUPLA_DS_CALL_REGISTER_DEVICE_B:  // ver. >= 2
 
-        if (srpc->sdp.data_size >=
+        if (sdp->data_size >=
                 (sizeof(TDS_SuplaRegisterDevice_B) -
                  (sizeof(TDS_SuplaDeviceChannel_B) * SUPLA_CHANNELMAXCOUNT)) &&
-            srpc->sdp.data_size <= sizeof(TDS_SuplaRegisterDevice_B)) {
-          rd->data.ds_register_device_b = (TDS_SuplaRegisterDevice_B *)malloc(
-              sizeof(TDS_SuplaRegisterDevice_B));
+            sdp->data_size <= sizeof(TDS_SuplaRegisterDevice_B)) {
+          rd->data.ds_register_device_b =
+              (TDS_SuplaRegisterDevice_B *)srpc_rd_alloc(
+                  srpc, rd, sizeof(TDS_SuplaRegisterDevice_B));
         }
 
         break;
 
       case SUPLA_DS_CALL_REGISTER_DEVICE_C:  // ver. >= 6
 
-        if (srpc->sdp.data_size >=
+        if (sdp->data_size >=
                 (sizeof(TDS_SuplaRegisterDevice_C) -
                  (sizeof(TDS_SuplaDeviceChannel_B) * SUPLA_CHANNELMAXCOUNT)) &&
-            srpc->sdp.data_size <= sizeof(TDS_SuplaRegisterDevice_C)) {
-          rd->data.ds_register_device_c = (TDS_SuplaRegisterDevice_C *)malloc(
-              sizeof(TDS_SuplaRegisterDevice_C));
+            sdp->data_size <= sizeof(TDS_SuplaRegisterDevice_C)) {
+          rd->data.ds_register_device_c =
+              (TDS_SuplaRegisterDevice_C *)srpc_rd_alloc(
+                  srpc, rd, sizeof(TDS_SuplaRegisterDevice_C));
         }
 
         break;
 
       case SUPLA_DS_CALL_REGISTER_DEVICE_D:  // ver. >= 7
 
-        if (srpc->sdp.data_size >=
+        if (sdp->data_size >=
                 (sizeof(TDS_SuplaRegisterDevice_D) -
                  (sizeof(TDS_SuplaDeviceChannel_B) * SUPLA_CHANNELMAXCOUNT)) &&
-            srpc->sdp.data_size <= sizeof(TDS_SuplaRegisterDevice_D)) {
-          rd->data.ds_register_device_d = (TDS_SuplaRegisterDevice_D *)malloc(
-              sizeof(TDS_SuplaRegisterDevice_D));
+            sdp->data_size <= sizeof(TDS_SuplaRegisterDevice_D)) {
+          rd->data.ds_register_device_d =
+              (TDS_SuplaRegisterDevice_D *)srpc_rd_alloc(
+                  srpc, rd, sizeof(TDS_SuplaRegisterDevice_D));
         }
 
         break;
 
       case SUPLA_DS_CALL_REGISTER_DEVICE_E:  // ver. >= 10
 
-        if (srpc->sdp.data_size >=
+        if (sdp->data_size >=
                 (sizeof(TDS_SuplaRegisterDevice_E) -
                  (sizeof(TDS_SuplaDeviceChannel_C) * SUPLA_CHANNELMAXCOUNT)) &&
-            srpc->sdp.data_size <= sizeof(TDS_SuplaRegisterDevice_E)) {
-          rd->data.ds_register_device_e = (TDS_SuplaRegisterDevice_E *)malloc(
-              sizeof(TDS_SuplaRegisterDevice_E));
+            sdp->data_size <= sizeof(TDS_SuplaRegisterDevice_E)) {
+          rd->data.ds_register_device_e =
+              (TDS_SuplaRegisterDevice_E *)srpc_rd_alloc(
+                  srpc, rd, sizeof(TDS_SuplaRegisterDevice_E));
         }
 
         break;
 
       case SUPLA_SD_CALL_REGISTER_DEVICE_RESULT:
 
-        if (srpc->sdp.data_size == sizeof(TSD_SuplaRegisterDeviceResult))
+        if (sdp->data_size == sizeof(TSD_SuplaRegisterDeviceResult))
           rd->data.sd_register_device_result =
-              (TSD_SuplaRegisterDeviceResult *)malloc(
-                  sizeof(TSD_SuplaRegisterDeviceResult));
+              (TSD_SuplaRegisterDeviceResult *)srpc_rd_alloc(
+                  srpc, rd, sizeof(TSD_SuplaRegisterDeviceResult));
         break;
 
       case SUPLA_DS_CALL_DEVICE_CHANNEL_VALUE_CHANGED:
 
-        if (srpc->sdp.data_size == sizeof(TDS_SuplaDeviceChannelValue))
+        if (sdp->data_size == sizeof(TDS_SuplaDeviceChannelValue))
           rd->data.ds_device_channel_value =
-              (TDS_SuplaDeviceChannelValue *)malloc(
-                  sizeof(TDS_SuplaDeviceChannelValue));
+              (TDS_SuplaDeviceChannelValue *)srpc_rd_alloc(
+                  srpc, rd, sizeof(TDS_SuplaDeviceChannelValue));
 
         break;
 
       case SUPLA_DS_CALL_DEVICE_CHANNEL_VALUE_CHANGED_B:
 
-        if (srpc->sdp.data_size == sizeof(TDS_SuplaDeviceChannelValue_B))
+        if (sdp->data_size == sizeof(TDS_SuplaDeviceChannelValue_B))
           rd->data.ds_device_channel_value_b =
-              (TDS_SuplaDeviceChannelValue_B *)malloc(
-                  sizeof(TDS_SuplaDeviceChannelValue_B));
+              (TDS_SuplaDeviceChannelValue_B *)srpc_rd_alloc(
+                  srpc, rd, sizeof(TDS_SuplaDeviceChannelValue_B));
 
         break;
 
       case SUPLA_DS_CALL_DEVICE_CHANNEL_VALUE_CHANGED_C:
 
-        if (srpc->sdp.data_size == sizeof(TDS_SuplaDeviceChannelValue_C))
+        if (sdp->data_size == sizeof(TDS_SuplaDeviceChannelValue_C))
           rd->data.ds_device_channel_value_c =
-              (TDS_SuplaDeviceChannelValue_C *)malloc(
-                  sizeof(TDS_SuplaDeviceChannelValue_C));
+              (TDS_SuplaDeviceChannelValue_C *)srpc_rd_alloc(
+                  srpc, rd, sizeof(TDS_SuplaDeviceChannelValue_C));
 
         break;
 
       case SUPLA_DS_CALL_DEVICE_CHANNEL_EXTENDEDVALUE_CHANGED:
 
-        if (srpc->sdp.data_size <=
+        if (sdp->data_size <=
                 sizeof(TDS_SuplaDeviceChannelExtendedValue) &&
-            srpc->sdp.data_size >=
+            sdp->data_size >=
                 (sizeof(TDS_SuplaDeviceChannelExtendedValue) -
                  SUPLA_CHANNELEXTENDEDVALUE_SIZE))
           rd->data.ds_device_channel_extendedvalue =
-              (TDS_SuplaDeviceChannelExtendedValue *)malloc(
-                  sizeof(TDS_SuplaDeviceChannelExtendedValue));
+              (TDS_SuplaDeviceChannelExtendedValue *)srpc_rd_alloc(
+                  srpc, rd, sizeof(TDS_SuplaDeviceChannelExtendedValue));
 
         break;
 
       case SUPLA_SD_CALL_CHANNEL_SET_VALUE:
 
-        if (srpc->sdp.data_size == sizeof(TSD_SuplaChannelNewValue))
-          rd->data.sd_channel_new_value = (TSD_SuplaChannelNewValue *)malloc(
-              sizeof(TSD_SuplaChannelNewValue));
+        if (sdp->data_size == sizeof(TSD_SuplaChannelNewValue))
+          rd->data.sd_channel_new_value =
+              (TSD_SuplaChannelNewValue *)srpc_rd_alloc(
+                  srpc, rd, sizeof(TSD_SuplaChannelNewValue));
 
         break;
 
       case SUPLA_SD_CALL_CHANNELGROUP_SET_VALUE:
 
-        if (srpc->sdp.data_size == sizeof(TSD_SuplaChannelGroupNewValue))
+        if (sdp->data_size == sizeof(TSD_SuplaChannelGroupNewValue))
           rd->data.sd_channelgroup_new_value =
-              (TSD_SuplaChannelGroupNewValue *)malloc(
-                  sizeof(TSD_SuplaChannelGroupNewValue));
+              (TSD_SuplaChannelGroupNewValue *)srpc_rd_alloc(
+                  srpc, rd, sizeof(TSD_SuplaChannelGroupNewValue));
 
         break;
 
       case SUPLA_DS_CALL_CHANNEL_SET_VALUE_RESULT:
 
-        if (srpc->sdp.data_size == sizeof(TDS_SuplaChannelNewValueResult))
+        if (sdp->data_size == sizeof(TDS_SuplaChannelNewValueResult))
           rd->data.ds_channel_new_value_result =
-              (TDS_SuplaChannelNewValueResult *)malloc(
-                  sizeof(TDS_SuplaChannelNewValueResult));
+              (TDS_SuplaChannelNewValueResult *)srpc_rd_alloc(
+                  srpc, rd, sizeof(TDS_SuplaChannelNewValueResult));
 
         break;
 
       case SUPLA_DS_CALL_GET_FIRMWARE_UPDATE_URL:
 
-        if (srpc->sdp.data_size == sizeof(TDS_FirmwareUpdateParams))
+        if (sdp->data_size == sizeof(TDS_FirmwareUpdateParams))
           rd->data.ds_firmware_update_params =
-              (TDS_FirmwareUpdateParams *)malloc(
-                  sizeof(TDS_FirmwareUpdateParams));
+              (TDS_FirmwareUpdateParams *)srpc_rd_alloc(
+                  srpc, rd, sizeof(TDS_FirmwareUpdateParams));
 
         break;
 
       case SUPLA_SD_CALL_GET_FIRMWARE_UPDATE_URL_RESULT:
 
-        if (srpc->sdp.data_size == sizeof(TSD_FirmwareUpdate_UrlResult) ||
-            srpc->sdp.data_size == sizeof(char)) {
+        if (sdp->data_size == sizeof(TSD_FirmwareUpdate_UrlResult) ||
+            sdp->data_size == sizeof(char)) {
           rd->data.sc_firmware_update_url_result =
-              (TSD_FirmwareUpdate_UrlResult *)malloc(
-                  sizeof(TSD_FirmwareUpdate_UrlResult));
+              (TSD_FirmwareUpdate_UrlResult *)srpc_rd_alloc(
+                  srpc, rd, sizeof(TSD_FirmwareUpdate_UrlResult));
 
-          if (srpc->sdp.data_size == sizeof(char) &&
+          if (sdp->data_size == sizeof(char) &&
               rd->data.sc_firmware_update_url_result != NULL)
             memset(rd->data.sc_firmware_update_url_result, 0,
                    sizeof(TSD_FirmwareUpdate_UrlResult));
         }
         break;
       case SUPLA_SD_CALL_DEVICE_CALCFG_REQUEST:
-        if (srpc->sdp.data_size <= sizeof(TSD_DeviceCalCfgRequest) &&
-            srpc->sdp.data_size >=
+        if (sdp->data_size <= sizeof(TSD_DeviceCalCfgRequest) &&
+            sdp->data_size >=
                 (sizeof(TSD_DeviceCalCfgRequest) - SUPLA_CALCFG_DATA_MAXSIZE)) {
-          rd->data.sd_device_calcfg_request = (TSD_DeviceCalCfgRequest *)malloc(
-              sizeof(TSD_DeviceCalCfgRequest));
+          rd->data.sd_device_calcfg_request =
+              (TSD_DeviceCalCfgRequest *)srpc_rd_alloc(
+                  srpc, rd, sizeof(TSD_DeviceCalCfgRequest));
         }
         break;
       case SUPLA_DS_CALL_DEVICE_CALCFG_RESULT:
-        if (srpc->sdp.data_size <= sizeof(TDS_DeviceCalCfgResult) &&
-            srpc->sdp.data_size >=
+        if (sdp->data_size <= sizeof(TDS_DeviceCalCfgResult) &&
+            sdp->data_size >=
                 (sizeof(TDS_DeviceCalCfgResult) - SUPLA_CALCFG_DATA_MAXSIZE)) {
           rd->data.ds_device_calcfg_result =
-              (TDS_DeviceCalCfgResult *)malloc(sizeof(TDS_DeviceCalCfgResult));
+              (TDS_DeviceCalCfgResult *)srpc_rd_alloc(
+                  srpc, rd, sizeof(TDS_DeviceCalCfgResult));
         }
         break;
       case SUPLA_DS_CALL_GET_CHANNEL_FUNCTIONS:
         call_with_no_data = 1;
         break;
       case SUPLA_SD_CALL_GET_CHANNEL_FUNCTIONS_RESULT:
-        if (srpc->sdp.data_size <= sizeof(TSD_ChannelFunctions) &&
-            srpc->sdp.data_size >=
+        if (sdp->data_size <= sizeof(TSD_ChannelFunctions) &&
+            sdp->data_size >=
                 (sizeof(TSD_ChannelFunctions) -
                  sizeof(_supla_int_t) * SUPLA_CHANNELMAXCOUNT)) {
-          rd->data.sd_channel_functions =
-              (TSD_ChannelFunctions *)malloc(sizeof(TSD_ChannelFunctions));
+          rd->data.sd_channel_functions = (TSD_ChannelFunctions *)srpc_rd_alloc(
+              srpc, rd, sizeof(TSD_ChannelFunctions));
         }
         break;
 #endif /*#ifndef SRPC_EXCLUDE_DEVICE*/
@@ -939,61 +1152,65 @@ char SRPC_ICACHE_FLASH srpc_getdata(void *_srpc, TsrpcReceivedData *rd,
 #ifndef SRPC_EXCLUDE_CLIENT
       case SUPLA_CS_CALL_REGISTER_CLIENT:
 
-        if (srpc->sdp.data_size == sizeof(TCS_SuplaRegisterClient))
-          rd->data.cs_register_client = (TCS_SuplaRegisterClient *)malloc(
-              sizeof(TCS_SuplaRegisterClient));
+        if (sdp->data_size == sizeof(TCS_SuplaRegisterClient))
+          rd->data.cs_register_client =
+              (TCS_SuplaRegisterClient *)srpc_rd_alloc(
+                  srpc, rd, sizeof(TCS_SuplaRegisterClient));
 
         break;
 
       case SUPLA_CS_CALL_REGISTER_CLIENT_B:  // ver. >= 6
 
-        if (srpc->sdp.data_size == sizeof(TCS_SuplaRegisterClient_B))
-          rd->data.cs_register_client_b = (TCS_SuplaRegisterClient_B *)malloc(
-              sizeof(TCS_SuplaRegisterClient_B));
+        if (sdp->data_size == sizeof(TCS_SuplaRegisterClient_B))
+          rd->data.cs_register_client_b =
+              (TCS_SuplaRegisterClient_B *)srpc_rd_alloc(
+                  srpc, rd, sizeof(TCS_SuplaRegisterClient_B));
 
         break;
 
       case SUPLA_CS_CALL_REGISTER_CLIENT_C:  // ver. >= 7
 
-        if (srpc->sdp.data_size == sizeof(TCS_SuplaRegisterClient_C))
-          rd->data.cs_register_client_c = (TCS_SuplaRegisterClient_C *)malloc(
-              sizeof(TCS_SuplaRegisterClient_C));
+        if (sdp->data_size == sizeof(TCS_SuplaRegisterClient_C))
+          rd->data.cs_register_client_c =
+              (TCS_SuplaRegisterClient_C *)srpc_rd_alloc(
+                  srpc, rd, sizeof(TCS_SuplaRegisterClient_C));
 
         break;
 
       case SUPLA_CS_CALL_REGISTER_CLIENT_D:  // ver. >= 12
 
-        if (srpc->sdp.data_size == sizeof(TCS_SuplaRegisterClient_D))
-          rd->data.cs_register_client_d = (TCS_SuplaRegisterClient_D *)malloc(
-              sizeof(TCS_SuplaRegisterClient_D));
+        if (sdp->data_size == sizeof(TCS_SuplaRegisterClient_D))
+          rd->data.cs_register_client_d =
+              (TCS_SuplaRegisterClient_D *)srpc_rd_alloc(
+                  srpc, rd, sizeof(TCS_SuplaRegisterClient_D));
 
         break;
 
       case SUPLA_SC_CALL_REGISTER_CLIENT_RESULT:
 
-        if (srpc->sdp.data_size == sizeof(TSC_SuplaRegisterClientResult))
+        if (sdp->data_size == sizeof(TSC_SuplaRegisterClientResult))
           rd->data.sc_register_client_result =
-              (TSC_SuplaRegisterClientResult *)malloc(
-                  sizeof(TSC_SuplaRegisterClientResult));
+              (TSC_SuplaRegisterClientResult *)srpc_rd_alloc(
+                  srpc, rd, sizeof(TSC_SuplaRegisterClientResult));
 
         break;
 
       case SUPLA_SC_CALL_REGISTER_CLIENT_RESULT_B:
 
-        if (srpc->sdp.data_size == sizeof(TSC_SuplaRegisterClientResult_B))
+        if (sdp->data_size == sizeof(TSC_SuplaRegisterClientResult_B))
           rd->data.sc_register_client_result_b =
-              (TSC_SuplaRegisterClientResult_B *)malloc(
-                  sizeof(TSC_SuplaRegisterClientResult_B));
+              (TSC_SuplaRegisterClientResult_B *)srpc_rd_alloc(
+                  srpc, rd, sizeof(TSC_SuplaRegisterClientResult_B));
 
         break;
 
       case SUPLA_SC_CALL_LOCATION_UPDATE:
 
-        if (srpc->sdp.data_size >=
+        if (sdp->data_size >=
                 (sizeof(TSC_SuplaLocation) - SUPLA_LOCATION_CAPTION_MAXSIZE) &&
-            srpc->sdp.data_size <= sizeof(TSC_SuplaLocation)) {
-          rd->data.sc_location =
-              (TSC_SuplaLocation *)malloc(sizeof(TSC_SuplaLocation));
+            sdp->data_size <= sizeof(TSC_SuplaLocation)) {
+          rd->data.sc_location = (TSC_SuplaLocation *)srpc_rd_alloc(
+              srpc, rd, sizeof(TSC_SuplaLocation));
         }
 
         break;
@@ -1004,33 +1221,33 @@ char SRPC_ICACHE_FLASH srpc_getdata(void *_srpc, TsrpcReceivedData *rd,
 
       case SUPLA_SC_CALL_CHANNEL_UPDATE:
 
-        if (srpc->sdp.data_size >=
+        if (sdp->data_size >=
                 (sizeof(TSC_SuplaChannel) - SUPLA_CHANNEL_CAPTION_MAXSIZE) &&
-            srpc->sdp.data_size <= sizeof(TSC_SuplaChannel)) {
-          rd->data.sc_channel =
-              (TSC_SuplaChannel *)malloc(sizeof(TSC_SuplaChannel));
+            sdp->data_size <= sizeof(TSC_SuplaChannel)) {
+          rd->data.sc_channel = (TSC_SuplaChannel *)srpc_rd_alloc(
+              srpc, rd, sizeof(TSC_SuplaChannel));
         }
 
         break;
 
       case SUPLA_SC_CALL_CHANNEL_UPDATE_B:
 
-        if (srpc->sdp.data_size >=
+        if (sdp->data_size >=
                 (sizeof(TSC_SuplaChannel_B) - SUPLA_CHANNEL_CAPTION_MAXSIZE) &&
-            srpc->sdp.data_size <= sizeof(TSC_SuplaChannel_B)) {
-          rd->data.sc_channel_b =
-              (TSC_SuplaChannel_B *)malloc(sizeof(TSC_SuplaChannel_B));
+            sdp->data_size <= sizeof(TSC_SuplaChannel_B)) {
+          rd->data.sc_channel_b = (TSC_SuplaChannel_B *)srpc_rd_alloc(
+              srpc, rd, sizeof(TSC_SuplaChannel_B));
         }
 
         break;
 
       case SUPLA_SC_CALL_CHANNEL_UPDATE_C:
 
-        if (srpc->sdp.data_size >=
+        if (sdp->data_size >=
                 (sizeof(TSC_SuplaChannel_C) - SUPLA_CHANNEL_CAPTION_MAXSIZE) &&
-            srpc->sdp.data_size <= sizeof(TSC_SuplaChannel_C)) {
-          rd->data.sc_channel_c =
-              (TSC_SuplaChannel_C *)malloc(sizeof(TSC_SuplaChannel_C));
+            sdp->data_size <= sizeof(TSC_SuplaChannel_C)) {
+          rd->data.sc_channel_c = (TSC_SuplaChannel_C *)srpc_rd_alloc(
+              srpc, rd, sizeof(TSC_SuplaChannel_C));
         }
 
         break;
@@ -1049,9 +1266,9 @@ char SRPC_ICACHE_FLASH srpc_getdata(void *_srpc, TsrpcReceivedData *rd,
 
       case SUPLA_SC_CALL_CHANNEL_VALUE_UPDATE:
 
-        if (srpc->sdp.data_size == sizeof(TSC_SuplaChannelValue))
-          rd->data.sc_channel_value =
-              (TSC_SuplaChannelValue *)malloc(sizeof(TSC_SuplaChannelValue));
+        if (sdp->data_size == sizeof(TSC_SuplaChannelValue))
+          rd->data.sc_channel_value = (TSC_SuplaChannelValue *)srpc_rd_alloc(
+              srpc, rd, sizeof(TSC_SuplaChannelValue));
 
         break;
 
@@ -1064,69 +1281,72 @@ char SRPC_ICACHE_FLASH srpc_getdata(void *_srpc, TsrpcReceivedData *rd,
         break;
 
       case SUPLA_SC_CALL_CHANNELGROUP_RELATION_PACK_UPDATE:
-        if (srpc->sdp.data_size <= sizeof(TSC_SuplaChannelGroupRelationPack) &&
-            srpc->sdp.data_size >=
+        if (sdp->data_size <= sizeof(TSC_SuplaChannelGroupRelationPack) &&
+            sdp->data_size >=
                 (sizeof(TSC_SuplaChannelGroupRelationPack) -
                  (sizeof(TSC_SuplaChannelGroupRelation) *
                   SUPLA_CHANNELGROUP_RELATION_PACK_MAXCOUNT))) {
           rd->data.sc_channelgroup_relation_pack =
-              (TSC_SuplaChannelGroupRelationPack *)malloc(
-                  sizeof(TSC_SuplaChannelGroupRelationPack));
+              (TSC_SuplaChannelGroupRelationPack *)srpc_rd_alloc(
+                  srpc, rd, sizeof(TSC_SuplaChannelGroupRelationPack));
         }
         break;
 
       case SUPLA_SC_CALL_CHANNELVALUE_PACK_UPDATE:
-        if (srpc->sdp.data_size <= sizeof(TSC_SuplaChannelValuePack) &&
-            srpc->sdp.data_size >= (sizeof(TSC_SuplaChannelValuePack) -
+        if (sdp->data_size <= sizeof(TSC_SuplaChannelValuePack) &&
+            sdp->data_size >= (sizeof(TSC_SuplaChannelValuePack) -
                                     (sizeof(TSC_SuplaChannelValue) *
                                      SUPLA_CHANNELVALUE_PACK_MAXCOUNT))) {
-          rd->data.sc_channelvalue_pack = (TSC_SuplaChannelValuePack *)malloc(
-              sizeof(TSC_SuplaChannelValuePack));
+          rd->data.sc_channelvalue_pack =
+              (TSC_SuplaChannelValuePack *)srpc_rd_alloc(
+                  srpc, rd, sizeof(TSC_SuplaChannelValuePack));
         }
         break;
 
       case SUPLA_SC_CALL_CHANNELEXTENDEDVALUE_PACK_UPDATE:
-        if (srpc->sdp.data_size <= sizeof(TSC_SuplaChannelExtendedValuePack) &&
-            srpc->sdp.data_size >=
+        if (sdp->data_size <= sizeof(TSC_SuplaChannelExtendedValuePack) &&
+            sdp->data_size >=
                 (sizeof(TSC_SuplaChannelExtendedValuePack) -
                  SUPLA_CHANNELEXTENDEDVALUE_PACK_MAXDATASIZE)) {
           rd->data.sc_channelextendedvalue_pack =
-              (TSC_SuplaChannelExtendedValuePack *)malloc(
-                  sizeof(TSC_SuplaChannelExtendedValuePack));
+              (TSC_SuplaChannelExtendedValuePack *)srpc_rd_alloc(
+                  srpc, rd, sizeof(TSC_SuplaChannelExtendedValuePack));
         }
         break;
 
       case SUPLA_CS_CALL_CHANNEL_SET_VALUE:
 
-        if (srpc->sdp.data_size == sizeof(TCS_SuplaChannelNewValue))
-          rd->data.cs_channel_new_value = (TCS_SuplaChannelNewValue *)malloc(
-              sizeof(TCS_SuplaChannelNewValue));
+        if (sdp->data_size == sizeof(TCS_SuplaChannelNewValue))
+          rd->data.cs_channel_new_value =
+              (TCS_SuplaChannelNewValue *)srpc_rd_alloc(
+                  srpc, rd, sizeof(TCS_SuplaChannelNewValue));
 
         break;
 
       case SUPLA_CS_CALL_SET_VALUE:
 
-        if (srpc->sdp.data_size == sizeof(TCS_SuplaNewValue))
-          rd->data.cs_new_value =
-              (TCS_SuplaNewValue *)malloc(sizeof(TCS_SuplaNewValue));
+        if (sdp->data_size == sizeof(TCS_SuplaNewValue))
+          rd->data.cs_new_value = (TCS_SuplaNewValue *)srpc_rd_alloc(
+              srpc, rd, sizeof(TCS_SuplaNewValue));
 
         break;
 
       case SUPLA_CS_CALL_CHANNEL_SET_VALUE_B:
 
-        if (srpc->sdp.data_size == sizeof(TCS_SuplaChannelNewValue_B))
+        if (sdp->data_size == sizeof(TCS_SuplaChannelNewValue_B))
           rd->data.cs_channel_new_value_b =
-              (TCS_SuplaChannelNewValue_B *)malloc(
-                  sizeof(TCS_SuplaChannelNewValue_B));
+              (TCS_SuplaChannelNewValue_B *)srpc_rd_alloc(
+                  srpc, rd, sizeof(TCS_SuplaChannelNewValue_B));
 
         break;
 
       case SUPLA_SC_CALL_EVENT:
 
-        if (srpc->sdp.data_size >=
+        if (sdp->data_size >=
                 (sizeof(TSC_SuplaEvent) - SUPLA_SENDER_NAME_MAXSIZE) &&
-            srpc->sdp.data_size <= sizeof(TSC_SuplaEvent)) {
-          rd->data.sc_event = (TSC_SuplaEvent *)malloc(sizeof(TSC_SuplaEvent));
+            sdp->data_size <= sizeof(TSC_SuplaEvent)) {
+          rd->data.sc_event =
+              (TSC_SuplaEvent *)srpc_rd_alloc(srpc, rd, sizeof(TSC_SuplaEvent));
         }
 
         break;
@@ -1136,97 +1356,101 @@ char SRPC_ICACHE_FLASH srpc_getdata(void *_srpc, TsrpcReceivedData *rd,
         break;
 
       case SUPLA_SC_CALL_OAUTH_TOKEN_REQUEST_RESULT:
-        if (srpc->sdp.data_size >= (sizeof(TSC_OAuthTokenRequestResult) -
+        if (sdp->data_size >= (sizeof(TSC_OAuthTokenRequestResult) -
                                     SUPLA_OAUTH_TOKEN_MAXSIZE) &&
-            srpc->sdp.data_size <= sizeof(TSC_OAuthTokenRequestResult)) {
+            sdp->data_size <= sizeof(TSC_OAuthTokenRequestResult)) {
           rd->data.sc_oauth_tokenrequest_result =
-              (TSC_OAuthTokenRequestResult *)malloc(
-                  sizeof(TSC_OAuthTokenRequestResult));
+              (TSC_OAuthTokenRequestResult *)srpc_rd_alloc(
+                  srpc, rd, sizeof(TSC_OAuthTokenRequestResult));
         }
         break;
       case SUPLA_CS_CALL_SUPERUSER_AUTHORIZATION_REQUEST:
-        if (srpc->sdp.data_size == sizeof(TCS_SuperUserAuthorizationRequest))
+        if (sdp->data_size == sizeof(TCS_SuperUserAuthorizationRequest))
           rd->data.cs_superuser_authorization_request =
-              (TCS_SuperUserAuthorizationRequest *)malloc(
-                  sizeof(TCS_SuperUserAuthorizationRequest));
+              (TCS_SuperUserAuthorizationRequest *)srpc_rd_alloc(
+                  srpc, rd, sizeof(TCS_SuperUserAuthorizationRequest));
         break;
       case SUPLA_CS_CALL_GET_SUPERUSER_AUTHORIZATION_RESULT:
         call_with_no_data = 1;
         break;
       case SUPLA_SC_CALL_SUPERUSER_AUTHORIZATION_RESULT:
-        if (srpc->sdp.data_size == sizeof(TSC_SuperUserAuthorizationResult))
+        if (sdp->data_size == sizeof(TSC_SuperUserAuthorizationResult))
           rd->data.sc_superuser_authorization_result =
-              (TSC_SuperUserAuthorizationResult *)malloc(
-                  sizeof(TSC_SuperUserAuthorizationResult));
+              (TSC_SuperUserAuthorizationResult *)srpc_rd_alloc(
+                  srpc, rd, sizeof(TSC_SuperUserAuthorizationResult));
         break;
       case SUPLA_CS_CALL_DEVICE_CALCFG_REQUEST:
-        if (srpc->sdp.data_size <= sizeof(TCS_DeviceCalCfgRequest) &&
-            srpc->sdp.data_size >=
+        if (sdp->data_size <= sizeof(TCS_DeviceCalCfgRequest) &&
+            sdp->data_size >=
                 (sizeof(TCS_DeviceCalCfgRequest) - SUPLA_CALCFG_DATA_MAXSIZE)) {
-          rd->data.cs_device_calcfg_request = (TCS_DeviceCalCfgRequest *)malloc(
-              sizeof(TCS_DeviceCalCfgRequest));
+          rd->data.cs_device_calcfg_request =
+              (TCS_DeviceCalCfgRequest *)srpc_rd_alloc(
+                  srpc, rd, sizeof(TCS_DeviceCalCfgRequest));
         }
         break;
       case SUPLA_CS_CALL_DEVICE_CALCFG_REQUEST_B:
-        if (srpc->sdp.data_size <= sizeof(TCS_DeviceCalCfgRequest_B) &&
-            srpc->sdp.data_size >= (sizeof(TCS_DeviceCalCfgRequest_B) -
+        if (sdp->data_size <= sizeof(TCS_DeviceCalCfgRequest_B) &&
+            sdp->data_size >= (sizeof(TCS_DeviceCalCfgRequest_B) -
                                     SUPLA_CALCFG_DATA_MAXSIZE)) {
           rd->data.cs_device_calcfg_request_b =
-              (TCS_DeviceCalCfgRequest_B *)malloc(
-                  sizeof(TCS_DeviceCalCfgRequest_B));
+              (TCS_DeviceCalCfgRequest_B *)srpc_rd_alloc(
+                  srpc, rd, sizeof(TCS_DeviceCalCfgRequest_B));
         }
         break;
       case SUPLA_SC_CALL_DEVICE_CALCFG_RESULT:
-        if (srpc->sdp.data_size <= sizeof(TSC_DeviceCalCfgResult) &&
-            srpc->sdp.data_size >=
+        if (sdp->data_size <= sizeof(TSC_DeviceCalCfgResult) &&
+            sdp->data_size >=
                 (sizeof(TSC_DeviceCalCfgResult) - SUPLA_CALCFG_DATA_MAXSIZE)) {
           rd->data.sc_device_calcfg_result =
-              (TSC_DeviceCalCfgResult *)malloc(sizeof(TSC_DeviceCalCfgResult));
+              (TSC_DeviceCalCfgResult *)srpc_rd_alloc(
+                  srpc, rd, sizeof(TSC_DeviceCalCfgResult));
         }
         break;
 
       case SUPLA_CS_CALL_GET_CHANNEL_BASIC_CFG:
-        if (srpc->sdp.data_size == sizeof(TCS_ChannelBasicCfgRequest))
+        if (sdp->data_size == sizeof(TCS_ChannelBasicCfgRequest))
           rd->data.cs_channel_basic_cfg_request =
-              (TCS_ChannelBasicCfgRequest *)malloc(
-                  sizeof(TCS_ChannelBasicCfgRequest));
+              (TCS_ChannelBasicCfgRequest *)srpc_rd_alloc(
+                  srpc, rd, sizeof(TCS_ChannelBasicCfgRequest));
         break;
       case SUPLA_SC_CALL_CHANNEL_BASIC_CFG_RESULT:
-        if (srpc->sdp.data_size >=
+        if (sdp->data_size >=
                 (sizeof(TSC_ChannelBasicCfg) - SUPLA_CHANNEL_CAPTION_MAXSIZE) &&
-            srpc->sdp.data_size <= sizeof(TSC_ChannelBasicCfg))
-          rd->data.sc_channel_basic_cfg =
-              (TSC_ChannelBasicCfg *)malloc(sizeof(TSC_ChannelBasicCfg));
+            sdp->data_size <= sizeof(TSC_ChannelBasicCfg))
+          rd->data.sc_channel_basic_cfg = (TSC_ChannelBasicCfg *)srpc_rd_alloc(
+              srpc, rd, sizeof(TSC_ChannelBasicCfg));
         break;
 
       case SUPLA_CS_CALL_SET_CHANNEL_FUNCTION:
-        if (srpc->sdp.data_size == sizeof(TCS_SetChannelFunction))
+        if (sdp->data_size == sizeof(TCS_SetChannelFunction))
           rd->data.cs_set_channel_function =
-              (TCS_SetChannelFunction *)malloc(sizeof(TCS_SetChannelFunction));
+              (TCS_SetChannelFunction *)srpc_rd_alloc(
+                  srpc, rd, sizeof(TCS_SetChannelFunction));
         break;
 
       case SUPLA_SC_CALL_SET_CHANNEL_FUNCTION_RESULT:
-        if (srpc->sdp.data_size == sizeof(TSC_SetChannelFunctionResult))
+        if (sdp->data_size == sizeof(TSC_SetChannelFunctionResult))
           rd->data.sc_set_channel_function_result =
-              (TSC_SetChannelFunctionResult *)malloc(
-                  sizeof(TSC_SetChannelFunctionResult));
+              (TSC_SetChannelFunctionResult *)srpc_rd_alloc(
+                  srpc, rd, sizeof(TSC_SetChannelFunctionResult));
         break;
 
       case SUPLA_CS_CALL_SET_CHANNEL_CAPTION:
-        if (srpc->sdp.data_size >= (sizeof(TCS_SetChannelCaption) -
+        if (sdp->data_size >= (sizeof(TCS_SetChannelCaption) -
                                     SUPLA_CHANNEL_CAPTION_MAXSIZE) &&
-            srpc->sdp.data_size <= sizeof(TCS_SetChannelCaption))
+            sdp->data_size <= sizeof(TCS_SetChannelCaption))
           rd->data.cs_set_channel_caption =
-              (TCS_SetChannelCaption *)malloc(sizeof(TCS_SetChannelCaption));
+              (TCS_SetChannelCaption *)srpc_rd_alloc(
+                  srpc, rd, sizeof(TCS_SetChannelCaption));
         break;
 
       case SUPLA_SC_CALL_SET_CHANNEL_CAPTION_RESULT:
-        if (srpc->sdp.data_size >= (sizeof(TSC_SetChannelCaptionResult) -
+        if (sdp->data_size >= (sizeof(TSC_SetChannelCaptionResult) -
                                     SUPLA_CHANNEL_CAPTION_MAXSIZE) &&
-            srpc->sdp.data_size <= sizeof(TSC_SetChannelCaptionResult))
+            sdp->data_size <= sizeof(TSC_SetChannelCaptionResult))
           rd->data.sc_set_channel_caption_result =
-              (TSC_SetChannelCaptionResult *)malloc(
-                  sizeof(TSC_SetChannelCaptionResult));
+              (TSC_SetChannelCaptionResult *)srpc_rd_alloc(
+                  srpc, rd, sizeof(TSC_SetChannelCaptionResult));
         break;
 
       case SUPLA_CS_CALL_CLIENTS_RECONNECT_REQUEST:
@@ -1234,37 +1458,37 @@ char SRPC_ICACHE_FLASH srpc_getdata(void *_srpc, TsrpcReceivedData *rd,
         break;
 
       case SUPLA_SC_CALL_CLIENTS_RECONNECT_REQUEST_RESULT:
-        if (srpc->sdp.data_size == sizeof(TSC_ClientsReconnectRequestResult))
+        if (sdp->data_size == sizeof(TSC_ClientsReconnectRequestResult))
           rd->data.sc_clients_reconnect_result =
-              (TSC_ClientsReconnectRequestResult *)malloc(
-                  sizeof(TSC_ClientsReconnectRequestResult));
+              (TSC_ClientsReconnectRequestResult *)srpc_rd_alloc(
+                  srpc, rd, sizeof(TSC_ClientsReconnectRequestResult));
         break;
 
       case SUPLA_CS_CALL_SET_REGISTRATION_ENABLED:
-        if (srpc->sdp.data_size == sizeof(TCS_SetRegistrationEnabled))
+        if (sdp->data_size == sizeof(TCS_SetRegistrationEnabled))
           rd->data.cs_set_registration_enabled =
-              (TCS_SetRegistrationEnabled *)malloc(
-                  sizeof(TCS_SetRegistrationEnabled));
+              (TCS_SetRegistrationEnabled *)srpc_rd_alloc(
+                  srpc, rd, sizeof(TCS_SetRegistrationEnabled));
         break;
 
       case SUPLA_SC_CALL_SET_REGISTRATION_ENABLED_RESULT:
-        if (srpc->sdp.data_size == sizeof(TSC_SetRegistrationEnabledResult))
+        if (sdp->data_size == sizeof(TSC_SetRegistrationEnabledResult))
           rd->data.sc_set_registration_enabled_result =
-              (TSC_SetRegistrationEnabledResult *)malloc(
-                  sizeof(TSC_SetRegistrationEnabledResult));
+              (TSC_SetRegistrationEnabledResult *)srpc_rd_alloc(
+                  srpc, rd, sizeof(TSC_SetRegistrationEnabledResult));
         break;
 
       case SUPLA_CS_CALL_DEVICE_RECONNECT_REQUEST:
-        if (srpc->sdp.data_size == sizeof(TCS_DeviceReconnectRequest))
+        if (sdp->data_size == sizeof(TCS_DeviceReconnectRequest))
           rd->data.cs_device_reconnect_request =
-              (TCS_DeviceReconnectRequest *)malloc(
-                  sizeof(TCS_DeviceReconnectRequest));
+              (TCS_DeviceReconnectRequest *)srpc_rd_alloc(
+                  srpc, rd, sizeof(TCS_DeviceReconnectRequest));
         break;
       case SUPLA_SC_CALL_DEVICE_RECONNECT_REQUEST_RESULT:
-        if (srpc->sdp.data_size == sizeof(TSC_DeviceReconnectRequestResult))
+        if (sdp->data_size == sizeof(TSC_DeviceReconnectRequestResult))
           rd->data.sc_device_reconnect_request_result =
-              (TSC_DeviceReconnectRequestResult *)malloc(
-                  sizeof(TSC_DeviceReconnectRequestResult));
+              (TSC_DeviceReconnectRequestResult *)srpc_rd_alloc(
+                  srpc, rd, sizeof(TSC_DeviceReconnectRequestResult));
         break;
 
 #endif /*#ifndef SRPC_EXCLUDE_CLIENT*/
@@ -1275,8 +1499,8 @@ char SRPC_ICACHE_FLASH srpc_getdata(void *_srpc, TsrpcReceivedData *rd,
     }
 
     if (rd->data.dcs_ping != NULL) {
-      if (srpc->sdp.data_size > 0) {
-        memcpy(rd->data.dcs_ping, srpc->sdp.data, srpc->sdp.data_size);
+      if (sdp->data_size > 0 && rd->data_source != SRPC_RD_DATA_IN_PLACE) {
+        memcpy(rd->data.dcs_ping, sdp->data, sdp->data_size);
       }
 
       return lck_unlock_r(srpc->lck, SUPLA_RESULT_TRUE);
@@ -1292,7 +1516,14 @@ void SRPC_ICACHE_FLASH srpc_rd_free(TsrpcReceivedData *rd) {
   if (rd->call_type > 0) {
     // first one
 
-    if (rd->data.dcs_ping != NULL) free(rd->data.dcs_ping);
+    if (rd->data.dcs_ping != NULL) {
+#ifdef SRPC_WITHOUT_RD_MALLOC
+      if (rd->data_source == SRPC_RD_DATA_ARENA)
+        ((TsrpcReceivedDataSlot *)rd->data.dcs_ping)->used = 0;
+#else
+      if (rd->data_source == SRPC_RD_DATA_HEAP) free(rd->data.dcs_ping);
+#endif /*SRPC_WITHOUT_RD_MALLOC*/
+    }
 
     rd->call_type = 0;
   }
@@ -35,6 +35,7 @@
 #if defined(ARDUINO_ARCH_ESP8266) || defined(ARDUINO_ARCH_ESP32)
 #define SRPC_WITHOUT_OUT_QUEUE
 #define SRPC_WITHOUT_IN_QUEUE
+#define SRPC_WITHOUT_RD_MALLOC
 #endif /* defined(ARDUINO_ARCH_ESP8266) || defined(ARDUINO_ARCH_ESP32) */
 
 #define SRPC_EXCLUDE_CLIENT
@@ -52,6 +53,7 @@
 #define SRPC_EXCLUDE_CLIENT
 #define SRPC_WITHOUT_OUT_QUEUE
 #define SRPC_WITHOUT_IN_QUEUE
+#define SRPC_WITHOUT_RD_MALLOC
 #endif /*__AVR__*/
 
 #ifdef __cplusplus
@@ -60,6 +62,15 @@ extern "C" {
 
 typedef _supla_int_t (*_func_srpc_DataRW)(void *buf, _supla_int_t count,
                                           void *user_params);
+
+typedef struct {
+  void *buf;
+  _supla_int_t count;
+} TsrpcDataVector;
+
+typedef _supla_int_t (*_func_srpc_DataWV)(TsrpcDataVector *vec,
+                                          _supla_int_t vec_count,
+                                          void *user_params);
 typedef void (*_func_srpc_event_OnRemoteCallReceived)(
     void *_srpc, unsigned _supla_int_t rr_id, unsigned _supla_int_t call_type,
     void *user_params, unsigned char proto_version);
@@ -76,6 +87,8 @@ typedef void (*_func_srpc_event_OnMinVersionRequired)(
 typedef struct {
   _func_srpc_DataRW data_read;
   _func_srpc_DataRW data_write;
+  // Optional. When set, packet and its tag are written with one call.
+  _func_srpc_DataWV data_writev;
   _func_srpc_event_OnRemoteCallReceived on_remote_call_received;
   _func_srpc_event_OnVersionError on_version_error;
   _func_srpc_event_BeforeCall before_async_call;
@@ -158,11 +171,18 @@ union TsrpcDataPacketData {
   TSD_ChannelFunctions *sd_channel_functions;
 };
 
+#define SRPC_RD_DATA_HEAP 0
+#define SRPC_RD_DATA_IN_PLACE 1
+#define SRPC_RD_DATA_ARENA 2
+
 typedef struct {
   unsigned _supla_int_t call_type;
   unsigned _supla_int_t rr_id;
 
   union TsrpcDataPacketData data;
+  // One of SRPC_RD_DATA_*. Data which is in place points to received packet
+  // and is valid until srpc_rd_free() or the next srpc_iterate() call.
+  unsigned char data_source;
 } TsrpcReceivedData;
 
 void SRPC_ICACHE_FLASH srpc_params_init(TsrpcParams *params);
@@ -171,6 +191,10 @@ void *SRPC_ICACHE_FLASH srpc_init(TsrpcParams *params);
 void SRPC_ICACHE_FLASH srpc_free(void *_srpc);
 
 char SRPC_ICACHE_FLASH srpc_input_dataexists(void *_srpc);
+// Returns SUPLA_RESULT_TRUE when the next srpc_iterate() call can process
+// a packet without reading more data. Unlike srpc_input_dataexists(), it is
+// false for a partially received packet.
+char SRPC_ICACHE_FLASH srpc_input_packet_available(void *_srpc);
 char SRPC_ICACHE_FLASH srpc_output_dataexists(void *_srpc);
 unsigned char SRPC_ICACHE_FLASH srpc_out_queue_item_count(void *srpc);
 
@@ -16,26 +16,73 @@
 
 #include <string.h>
 
+#if defined(ARDUINO_ARCH_AVR)
+#include <util/atomic.h>
+#elif defined(ARDUINO_ARCH_ESP8266)
+#include <Arduino.h>
+#endif
+
 #include "supla/channel.h"
+#include "supla/device_context.h"
 #include "supla-common/log.h"
 #include "supla-common/srpc.h"
 #include "tools.h"
 #include "events.h"
 #include "correction.h"
 
-namespace Supla {
-
-unsigned long Channel::lastCommunicationTimeMs = 0;
-TDS_SuplaRegisterDevice_E Channel::reg_dev;
-
-Channel::Channel() : validityTimeSec(0), channelNumber(-1), valueChanged(false) {
-  if (reg_dev.channel_count < SUPLA_CHANNELMAXCOUNT) {
-    channelNumber = reg_dev.channel_count;
+namespace {
+// Bits are set from timer callbacks (i.e. RollerShutter::onTimer()) and
+// cleared from loop(), so read-modify-write of bitmap word has to be atomic
+void setDirtyBit(uint32_t *word, uint32_t bit) {
+#if defined(ARDUINO_ARCH_AVR)
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    *word |= bit;
+  }
+#elif defined(ARDUINO_ARCH_ESP8266)
+  uint32_t savedPS = xt_rsil(15);
+  *word |= bit;
+  xt_wsr_ps(savedPS);
+#else
+  __atomic_fetch_or(word, bit, __ATOMIC_RELAXED);
+#endif
+}
+
+void clearDirtyBit(uint32_t *word, uint32_t bit) {
+#if defined(ARDUINO_ARCH_AVR)
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    *word &= ~bit;
+  }
+#elif defined(ARDUINO_ARCH_ESP8266)
+  uint32_t savedPS = xt_rsil(15);
+  *word &= ~bit;
+  xt_wsr_ps(savedPS);
+#else
+  __atomic_fetch_and(word, ~bit, __ATOMIC_RELAXED);
+#endif
+}
+};  // namespace
 
-    memset(&reg_dev.channels[channelNumber], 0, sizeof(reg_dev.channels[channelNumber]));
-    reg_dev.channels[channelNumber].Number = channelNumber;
+namespace Supla {
 
-    reg_dev.channel_count++;
+unsigned long &Channel::lastCommunicationTimeMs =
+    DeviceContext::defaultInstance.lastCommunicationTimeMs;
+TDS_SuplaRegisterDevice_E &Channel::reg_dev =
+    DeviceContext::defaultInstance.regDev;
+
+Channel::Channel()
+    : context(DeviceContext::current()),
+      valueChanged(false),
+      channelNumber(-1),
+      validityTimeSec(0) {
+  TDS_SuplaRegisterDevice_E &regDev = context->regDev;
+  if (regDev.channel_count < SUPLA_CHANNELMAXCOUNT) {
+    channelNumber = regDev.channel_count;
+
+    memset(&regDev.channels[channelNumber], 0, sizeof(regDev.channels[channelNumber]));
+    regDev.channels[channelNumber].Number = channelNumber;
+    context->channels[channelNumber] = this;
+
+    regDev.channel_count++;
   } else {
 // TODO: add status CHANNEL_LIMIT_EXCEEDED
   }
@@ -44,7 +91,81 @@ Channel::Channel() : validityTimeSec(0), channelNumber(-1), valueChanged(false)
 }
 
 Channel::~Channel() {
-  reg_dev.channel_count--;
+  if (channelNumber >= 0 && context->channels[channelNumber] == this) {
+    context->channels[channelNumber] = nullptr;
+    clearDirtyBit(&context->dirtyChannels[channelNumber / 32],
+                  1UL << (channelNumber % 32));
+  }
+  context->regDev.channel_count--;
+}
+
+Channel *Channel::getChannelByNumber(int channelNumber) {
+  if (channelNumber < 0 || channelNumber >= SUPLA_CHANNELMAXCOUNT) {
+    return nullptr;
+  }
+  return DeviceContext::current()->channels[channelNumber];
+}
+
+bool Channel::hasPendingUpdates() {
+  DeviceContext *current = DeviceContext::current();
+  for (int i = 0; i < CHANNEL_DIRTY_WORDS; i++) {
+    if (current->dirtyChannels[i]) {
+      return true;
+    }
+  }
+  return false;
+}
+
+int Channel::findDirtyChannel(DeviceContext *context, int from, int count) {
+  if (from < 0 || from >= count) {
+    from = 0;
+  }
+  // scan [from, count) and then wrap around to [0, from)
+  for (int pass = 0; pass < 2; pass++) {
+    int first = pass == 0 ? from : 0;
+    int last = pass == 0 ? count : from;
+    for (int word = first / 32; word * 32 < last; word++) {
+      uint32_t bits = context->dirtyChannels[word];
+      if (word == first / 32) {
+        bits &= ~((1UL << (first % 32)) - 1);
+      }
+      if (bits) {
+        int number = word * 32 + __builtin_ctzl(bits);
+        if (number < last) {
+          return number;
+        }
+        break;
+      }
+    }
+  }
+  return -1;
+}
+
+int Channel::sendPendingUpdates(void *srpc, int budget) {
+  DeviceContext *current = DeviceContext::current();
+  int count = current->regDev.channel_count;
+  int sent = 0;
+  while (sent < budget) {
+    int number = findDirtyChannel(current, current->nextChannelToSend, count);
+    if (number < 0) {
+      break;
+    }
+    Channel *channel = current->channels[number];
+    // extended channel sends two messages, so it waits for next burst when
+    // only one is left in the budget. Budget is exceeded when nothing was
+    // sent yet, so it isn't blocked with budget set to 1.
+    if (channel && channel->isExtended() && budget - sent < 2 && sent > 0) {
+      break;
+    }
+    current->nextChannelToSend = (number + 1) % count;
+    if (channel) {
+      sent += channel->sendUpdate(srpc);
+    } else {
+      clearDirtyBit(&current->dirtyChannels[number / 32],
+                    1UL << (number % 32));
+    }
+  }
+  return sent;
 }
 
 void Channel::setNewValue(double dbl) {
@@ -164,7 +285,7 @@ void Channel::setNewValue(TElectricityMeter_ExtendedValue_V2 &emValue) {
       }
     }
 
-    memcpy(reg_dev.channels[channelNumber].value,
+    memcpy(context->regDev.channels[channelNumber].value,
            &v,
            sizeof(TElectricityMeter_Value));
     setUpdateReady();
@@ -172,8 +293,8 @@ void Channel::setNewValue(TElectricityMeter_ExtendedValue_V2 &emValue) {
 }
 
 bool Channel::setNewValue(char *newValue) {
-  if (memcmp(newValue, reg_dev.channels[channelNumber].value, 8) != 0) {
-    memcpy(reg_dev.channels[channelNumber].value, newValue, 8);
+  if (memcmp(newValue, context->regDev.channels[channelNumber].value, 8) != 0) {
+    memcpy(context->regDev.channels[channelNumber].value, newValue, 8);
     setUpdateReady();
     return true;
   }
@@ -182,31 +303,31 @@ bool Channel::setNewValue(char *newValue) {
 
 void Channel::setType(_supla_int_t type) {
   if (channelNumber >= 0) {
-    reg_dev.channels[channelNumber].Type = type;
+    context->regDev.channels[channelNumber].Type = type;
   }
 }
 
 void Channel::setDefault(_supla_int_t value) {
   if (channelNumber >= 0) {
-    reg_dev.channels[channelNumber].Default = value;
+    context->regDev.channels[channelNumber].Default = value;
   }
 }
 
 void Channel::setFlag(_supla_int_t flag) {
   if (channelNumber >= 0) {
-    reg_dev.channels[channelNumber].Flags |= flag;
+    context->regDev.channels[channelNumber].Flags |= flag;
   }
 }
 
 void Channel::unsetFlag(_supla_int_t flag) {
   if (channelNumber >= 0) {
-    reg_dev.channels[channelNumber].Flags &= ~flag;
+    context->regDev.channels[channelNumber].Flags &= ~flag;
   }
 }
 
 void Channel::setFuncList(_supla_int_t functions) {
   if (channelNumber >= 0) {
-    reg_dev.channels[channelNumber].FuncList = functions;
+    context->regDev.channels[channelNumber].FuncList = functions;
   }
 }
 
@@ -216,20 +337,26 @@ int Channel::getChannelNumber() {
 
 void Channel::clearUpdateReady() {
   valueChanged = false;
+  if (channelNumber >= 0) {
+    clearDirtyBit(&context->dirtyChannels[channelNumber / 32],
+                  1UL << (channelNumber % 32));
+  }
 };
 
-void Channel::sendUpdate(void *srpc) {
+int Channel::sendUpdate(void *srpc) {
+  int sent = 1;
   clearUpdateReady();
   srpc_ds_async_channel_value_changed_c(
-      srpc, channelNumber, reg_dev.channels[channelNumber].value,
+      srpc, channelNumber, context->regDev.channels[channelNumber].value,
       0, validityTimeSec);
 
   // returns null for non-extended channels
   TSuplaChannelExtendedValue *extValue = getExtValue();
   if (extValue) {
     srpc_ds_async_channel_extendedvalue_changed(srpc, channelNumber, extValue);
+    sent++;
   }
-
+  return sent;
 }
 
 TSuplaChannelExtendedValue *Channel::getExtValue() {
@@ -238,6 +365,10 @@ TSuplaChannelExtendedValue *Channel::getExtValue() {
 
 void Channel::setUpdateReady() {
   valueChanged = true;
+  if (channelNumber >= 0) {
+    setDirtyBit(&context->dirtyChannels[channelNumber / 32],
+                1UL << (channelNumber % 32));
+  }
 };
 
 bool Channel::isUpdateReady() {
@@ -269,7 +400,7 @@ void Channel::setNewValue(uint8_t red,
 
 _supla_int_t Channel::getChannelType() {
   if (channelNumber >= 0) {
-    return reg_dev.channels[channelNumber].Type;
+    return context->regDev.channels[channelNumber].Type;
   }
   return -1;
 }
@@ -277,9 +408,10 @@ _supla_int_t Channel::getChannelType() {
 double Channel::getValueDouble() {
   double value;
   if (sizeof(double) == 8) {
-    memcpy(&value, reg_dev.channels[channelNumber].value, 8);
+    memcpy(&value, context->regDev.channels[channelNumber].value, 8);
   } else if (sizeof(double) == 4) {
-    value = doublePacked2float((uint8_t *)(reg_dev.channels[channelNumber].value));
+    value = doublePacked2float(
+        (uint8_t *)(context->regDev.channels[channelNumber].value));
   }
   
   return value;
@@ -287,52 +419,52 @@ double Channel::getValueDouble() {
 
 double Channel::getValueDoubleFirst() { 
   _supla_int_t value;
-  memcpy(&value, reg_dev.channels[channelNumber].value, 4);
+  memcpy(&value, context->regDev.channels[channelNumber].value, 4);
 
   return value / 1000.0;
 }
 
 double Channel::getValueDoubleSecond() {
   _supla_int_t value;
-  memcpy(&value, &(reg_dev.channels[channelNumber].value[4]), 4);
+  memcpy(&value, &(context->regDev.channels[channelNumber].value[4]), 4);
 
   return value / 1000.0;
 }
 
 _supla_int_t Channel::getValueInt32() {
   _supla_int_t value;
-  memcpy(&value, reg_dev.channels[channelNumber].value, sizeof(value));
+  memcpy(&value, context->regDev.channels[channelNumber].value, sizeof(value));
   return value;
 }
  
 unsigned _supla_int64_t Channel::getValueInt64() {
   unsigned _supla_int64_t value;
-  memcpy(&value, reg_dev.channels[channelNumber].value, sizeof(value));
+  memcpy(&value, context->regDev.channels[channelNumber].value, sizeof(value));
   return value;
 }
 
 bool Channel::getValueBool() {
-  return reg_dev.channels[channelNumber].value[0];
+  return context->regDev.channels[channelNumber].value[0];
 }
 
 uint8_t Channel::getValueRed() {
-  return reg_dev.channels[channelNumber].value[4];
+  return context->regDev.channels[channelNumber].value[4];
 }
 
 uint8_t Channel::getValueGreen() {
-  return reg_dev.channels[channelNumber].value[3];
+  return context->regDev.channels[channelNumber].value[3];
 }
 
 uint8_t Channel::getValueBlue() {
-  return reg_dev.channels[channelNumber].value[2];
+  return context->regDev.channels[channelNumber].value[2];
 }
 
 uint8_t Channel::getValueColorBrightness() {
-  return reg_dev.channels[channelNumber].value[1];
+  return context->regDev.channels[channelNumber].value[1];
 }
 
 uint8_t Channel::getValueBrightness() {
-  return reg_dev.channels[channelNumber].value[0];
+  return context->regDev.channels[channelNumber].value[0];
 }
 
 void Channel::setValidityTimeSec(unsigned _supla_int_t timeSec) {
@@ -21,9 +21,21 @@
 
 #include "supla-common/proto.h"
 #include "local_action.h"
+#include "supla_lib_config.h"
+
+// Max number of messages with channel values sent to server in one burst
+#ifndef SUPLA_CHANNEL_SEND_BUDGET
+#define SUPLA_CHANNEL_SEND_BUDGET 8
+#endif
+
+#define CHANNEL_DIRTY_WORDS ((SUPLA_CHANNELMAXCOUNT + 31) / 32)
 
 namespace Supla {
 
+class DeviceContext;
+
+// Channel is registered in DeviceContext which is current when it is
+// created. Static methods work on current context.
 class Channel : public LocalAction {
  public:
   Channel();
@@ -66,16 +78,34 @@ class Channel : public LocalAction {
   void setFuncList(_supla_int_t functions);
   void setValidityTimeSec(unsigned _supla_int_t);
   void clearUpdateReady();
-  void sendUpdate(void *srpc);
+  // Returns number of sent messages
+  int sendUpdate(void *srpc);
   virtual TSuplaChannelExtendedValue *getExtValue();
   void setCorrection(double correction, bool forSecondaryValue = false);
 
-  static unsigned long lastCommunicationTimeMs;
-  static TDS_SuplaRegisterDevice_E reg_dev;
+  static Channel *getChannelByNumber(int channelNumber);
+  // Sends values of channels with pending updates, up to "budget" messages.
+  // Next call starts from the channel after the last one which was sent, so
+  // all channels are served in round-robin order. Returns number of sent
+  // messages.
+  static int sendPendingUpdates(void *srpc, int budget);
+  // Returns true when any channel has value waiting to be sent
+  static bool hasPendingUpdates();
+
+  // Data of default context, kept for sketches and tests which access them
+  // directly
+  static unsigned long &lastCommunicationTimeMs;
+  static TDS_SuplaRegisterDevice_E &reg_dev;
 
  protected:
+  // Returns number of first channel with pending update in given context,
+  // starting from "from" and wrapping around at "count", or -1 when there
+  // is none
+  static int findDirtyChannel(DeviceContext *context, int from, int count);
+
   void setUpdateReady();
 
+  DeviceContext *context;
   bool valueChanged;
   int channelNumber;
   unsigned _supla_int_t validityTimeSec;
@@ -20,7 +20,10 @@
 
 using namespace Supla;
 
-Clock::Clock() : localtime(0), lastServerUpdate(0), lastMillis(0), isClockReady(false) {};
+Clock::Clock() : localtime(0), lastServerUpdate(0), lastMillis(0), isClockReady(false) {
+  declareHook(HOOK_ON_TIMER);
+  declareHook(HOOK_ITERATE_CONNECTED);
+};
 
 bool Clock::isReady() { 
   return isClockReady;
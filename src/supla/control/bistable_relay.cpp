@@ -21,6 +21,11 @@ using namespace Control;
 
 #define STATE_ON_INIT_KEEP 2
 
+// Length of impulse on relay's coil
+#define BISTABLE_RELAY_PULSE_MS 200
+// Status pin read interval
+#define BISTABLE_RELAY_STATUS_READ_MS 100
+
 BistableRelay::BistableRelay(int pin,
                              int statusPin,
                              bool statusPullUp,
@@ -57,19 +62,60 @@ void BistableRelay::onInit() {
   }
 
   Supla::Io::pinMode(channel.getChannelNumber(), pin, OUTPUT);
+
+  lastReadTime = millis();
+  scheduleNextTask();
 }
 
-void BistableRelay::iterateAlways() {
-  Relay::iterateAlways();
+void BistableRelay::runTask() {
+  // impulse ends first, so relay is not busy when duration expires
+  if (busy && millis() - disarmTimeMs > BISTABLE_RELAY_PULSE_MS) {
+    busy = false;
+    Supla::Io::digitalWrite(channel.getChannelNumber(), pin, pinOffValue());
+  }
+
+  if (durationMs && millis() - durationTimestamp > durationMs) {
+    toggle();
+  }
 
-  if (statusPin >= 0 && (millis() - lastReadTime > 100)) {
+  if (statusPin >= 0) {
     lastReadTime = millis();
-    channel.setNewValue(isOn());
+    bool on = isOn();
+    if (on != channel.getValueBool()) {
+      markStateChanged();
+    }
+    channel.setNewValue(on);
   }
 
-  if (busy && millis() - disarmTimeMs > 200) {
-    busy = false;
-    Supla::Io::digitalWrite(channel.getChannelNumber(), pin, pinOffValue());
+  scheduleNextTask();
+}
+
+void BistableRelay::scheduleNextTask() {
+  uint32_t deadline = 0;
+  bool pending = false;
+  if (busy) {
+    deadline = disarmTimeMs + BISTABLE_RELAY_PULSE_MS + 1;
+    pending = true;
+  }
+  if (durationMs) {
+    uint32_t durationDeadline = durationTimestamp + durationMs + 1;
+    if (!pending || static_cast<int32_t>(durationDeadline - deadline) < 0) {
+      deadline = durationDeadline;
+    }
+    pending = true;
+  }
+  if (statusPin >= 0) {
+    uint32_t readDeadline = lastReadTime + BISTABLE_RELAY_STATUS_READ_MS;
+    if (!pending || static_cast<int32_t>(readDeadline - deadline) < 0) {
+      deadline = readDeadline;
+    }
+    pending = true;
+  }
+
+  if (pending) {
+    scheduleTaskAt(deadline);
+  } else {
+    cancelTask();
   }
 }
 
@@ -105,6 +151,7 @@ void BistableRelay::turnOn(_supla_int_t duration) {
   if (isStatusUnknown() || !isOn()) {
     internalToggle();
   }
+  scheduleNextTask();
 }
 
 void BistableRelay::turnOff(_supla_int_t duration) {
@@ -120,6 +167,7 @@ void BistableRelay::turnOff(_supla_int_t duration) {
   } else if (isOn()) {
     internalToggle();
   }
+  scheduleNextTask();
 }
 
 bool BistableRelay::isOn() {
@@ -139,8 +187,10 @@ void BistableRelay::internalToggle() {
   disarmTimeMs = millis();
   Supla::Io::digitalWrite(channel.getChannelNumber(), pin, pinOnValue());
 
+  markStateChanged();
   // Schedule save in 5 s after state change
   Supla::Storage::ScheduleSave(5000);
+  scheduleNextTask();
 }
 
 void BistableRelay::toggle(_supla_int_t duration) {
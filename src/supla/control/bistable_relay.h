@@ -41,7 +41,9 @@ class BistableRelay : public Relay {
                 _supla_int_t functions =
                     (0xFF ^ SUPLA_BIT_FUNC_CONTROLLINGTHEROLLERSHUTTER));
   void onInit();
-  void iterateAlways();
+  // Called by scheduler at the end of impulse or turn on duration, and every
+  // 100 ms when status pin is used
+  void runTask();
   int handleNewValueFromServer(TSD_SuplaChannelNewValue *newValue);
   void turnOn(_supla_int_t duration = 0);
   void turnOff(_supla_int_t duration = 0);
@@ -52,6 +54,9 @@ class BistableRelay : public Relay {
 
  protected:
   void internalToggle();
+  // Schedules runTask() at the nearest of its deadlines. Has to be called
+  // after busy, durationMs or lastReadTime are changed.
+  void scheduleNextTask();
 
   int statusPin;
   bool statusPullUp;
@@ -34,6 +34,7 @@ void BistableRollerShutter::stopMovement() {
   }
   currentDirection = STOP_DIR;
   doNothingTime = millis();
+  markStateChanged();
   // Schedule save in 5 s after stop movement of roller shutter
   Supla::Storage::ScheduleSave(5000);
 }
@@ -20,6 +20,7 @@
 Supla::Control::DimmerBase::DimmerBase() {
   channel.setType(SUPLA_CHANNELTYPE_DIMMER);
   channel.setDefault(SUPLA_CHANNELFNC_DIMMER);
+  enableStateChangeTracking();
 }
 
 void Supla::Control::DimmerBase::setRGBW(int red,
@@ -26,6 +26,7 @@ Supla::Control::InternalPinOutput::InternalPinOutput(int pin, bool highIsOn)
       storedTurnOnDurationMs(0),
       durationTimestamp(0),
       durationMs(0) {
+  declareHook(HOOK_ITERATE_ALWAYS);
 }
 
 Supla::Control::InternalPinOutput &
@@ -33,6 +33,10 @@ LightRelay::LightRelay(int pin, bool highIsOn)
       lifespan(10000),
       turnOnSecondsCumulative(0) {
   channel.setFlag(SUPLA_CHANNEL_FLAG_LIGHTSOURCELIFESPAN_SETTABLE);
+  declareHook(HOOK_ITERATE_ALWAYS);
+  // lifespan and operating time are marked as changed in calcfg and
+  // iterateAlways()
+  enableStateChangeTracking();
 }
 
 void LightRelay::handleGetChannelState(TDSC_ChannelState &channelState) {
@@ -55,6 +59,7 @@ int LightRelay::handleCalcfgFromServer(TSD_DeviceCalCfgRequest *request) {
       if (config->ResetCounter) {
         turnOnSecondsCumulative = 0;
       }
+      markStateChanged();
 
       return SUPLA_CALCFG_RESULT_DONE;
     }
@@ -102,8 +107,7 @@ void LightRelay::iterateAlways() {
       turnOnTimestamp =
           currentMillis - ((currentMillis - turnOnTimestamp) % 1000);
       turnOnSecondsCumulative += seconds;
+      markStateChanged();
     }
   }
-
-  Relay::iterateAlways();
 }
@@ -23,6 +23,7 @@ Supla::Control::PinStatusLed::PinStatusLed(uint8_t srcPin,
                                            uint8_t outPin,
                                            bool invert)
     : srcPin(srcPin), outPin(outPin), invert(invert) {
+  declareHook(HOOK_ITERATE_ALWAYS);
 }
 
 void Supla::Control::PinStatusLed::onInit() {
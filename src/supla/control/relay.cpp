@@ -39,6 +39,8 @@ Relay::Relay(int pin, bool highIsOn, _supla_int_t functions)
       keepTurnOnDurationMs(false) {
   channel.setType(SUPLA_CHANNELTYPE_RELAY);
   channel.setFuncList(functions);
+  declareHook(HOOK_ON_SAVE_STATE);
+  enableStateChangeTracking();
 }
 
 uint8_t Relay::pinOnValue() {
@@ -61,17 +63,29 @@ void Relay::onInit() {
                          // avoid problems with LOW trigger relays
 }
 
-void Relay::iterateAlways() {
-  if (durationMs && millis() - durationTimestamp > durationMs) {
+void Relay::runTask() {
+  if (durationMs) {
     toggle();
   }
 }
 
+void Relay::scheduleDurationTask() {
+  if (durationMs) {
+    scheduleTaskAt(durationTimestamp + durationMs + 1);
+  } else {
+    cancelTask();
+  }
+}
+
 int Relay::handleNewValueFromServer(TSD_SuplaChannelNewValue *newValue) {
   int result = -1;
   if (newValue->value[0] == 1) {
-    if (keepTurnOnDurationMs) {
+    if (keepTurnOnDurationMs &&
+        storedTurnOnDurationMs != newValue->DurationMS) {
       storedTurnOnDurationMs = newValue->DurationMS;
+      // turnOn() of subclass may not mark state changed i.e. when relay is
+      // already on
+      markStateChanged();
     }
     turnOn(newValue->DurationMS);
     result = 1;
@@ -91,10 +105,12 @@ void Relay::turnOn(_supla_int_t duration) {
   if (keepTurnOnDurationMs) {
     durationMs = storedTurnOnDurationMs;
   }
+  scheduleDurationTask();
   Supla::Io::digitalWrite(channel.getChannelNumber(), pin, pinOnValue());
 
   channel.setNewValue(true);
 
+  markStateChanged();
   // Schedule save in 5 s after state change
   Supla::Storage::ScheduleSave(5000);
 }
@@ -102,10 +118,12 @@ void Relay::turnOn(_supla_int_t duration) {
 void Relay::turnOff(_supla_int_t duration) {
   durationMs = duration;
   durationTimestamp = millis();
+  scheduleDurationTask();
   Supla::Io::digitalWrite(channel.getChannelNumber(), pin, pinOffValue());
 
   channel.setNewValue(false);
 
+  markStateChanged();
   // Schedule save in 5 s after state change
   Supla::Storage::ScheduleSave(5000);
 }
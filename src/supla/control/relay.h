@@ -30,6 +30,7 @@
 #include "../storage/storage.h"
 #include "../action_handler.h"
 #include "../local_action.h"
+#include "../scheduler.h"
 
 #define STATE_ON_INIT_RESTORED_OFF -3
 #define STATE_ON_INIT_RESTORED_ON -2
@@ -39,7 +40,9 @@
 
 namespace Supla {
 namespace Control {
-class Relay : public ChannelElement, public ActionHandler {
+class Relay : public ChannelElement,
+              public ActionHandler,
+              public ScheduledTask {
  public:
   Relay(int pin,
         bool highIsOn = true,
@@ -63,11 +66,16 @@ class Relay : public ChannelElement, public ActionHandler {
   void onInit();
   void onLoadState();
   void onSaveState();
-  void iterateAlways();
+  // Called by scheduler when turn on/off duration expires
+  void runTask();
   int handleNewValueFromServer(TSD_SuplaChannelNewValue *newValue);
   unsigned _supla_int_t getStoredTurnOnDurationMs();
 
  protected:
+  // Schedules runTask() at the end of durationMs counted from
+  // durationTimestamp. Has to be called after those values are changed.
+  void scheduleDurationTask();
+
   int pin;
   bool highIsOn;
 
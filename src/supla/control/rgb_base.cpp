@@ -20,6 +20,7 @@
 Supla::Control::RGBBase::RGBBase() {
   channel.setType(SUPLA_CHANNELTYPE_RGBLEDCONTROLLER);
   channel.setDefault(SUPLA_CHANNELFNC_RGBLIGHTING);
+  enableStateChangeTracking();
 }
 
 void Supla::Control::RGBBase::setRGBW(int red,
@@ -56,6 +56,10 @@ RGBWBase::RGBWBase()
       minIterationBrightness(5) {
   channel.setType(SUPLA_CHANNELTYPE_DIMMERANDRGBLED);
   channel.setDefault(SUPLA_CHANNELFNC_DIMMERANDRGBLIGHTING);
+  declareHook(HOOK_ITERATE_ALWAYS);
+  declareHook(HOOK_ON_TIMER);
+  declareHook(HOOK_ON_SAVE_STATE);
+  enableStateChangeTracking();
 }
 
 void RGBWBase::setRGBW(int red,
@@ -99,6 +103,7 @@ void RGBWBase::setRGBW(int red,
     curBrightness = brightness;
   }
 
+  markStateChanged();
   // Schedule save in 5 s after state change
   Supla::Storage::ScheduleSave(5000);
 }
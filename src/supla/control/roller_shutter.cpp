@@ -51,6 +51,9 @@ RollerShutter::RollerShutter(int pinUp, int pinDown, bool highIsOn)
   channel.setType(SUPLA_CHANNELTYPE_RELAY);
   channel.setDefault(SUPLA_CHANNELFNC_CONTROLLINGTHEROLLERSHUTTER);
   channel.setFuncList(SUPLA_BIT_FUNC_CONTROLLINGTHEROLLERSHUTTER);
+  declareHook(HOOK_ON_TIMER);
+  declareHook(HOOK_ON_SAVE_STATE);
+  enableStateChangeTracking();
 }
 
 void RollerShutter::onInit() {
@@ -117,6 +120,7 @@ void RollerShutter::setOpenCloseTime(uint32_t newClosingTimeMs,
     openingTimeMs = newOpeningTimeMs;
     calibrate = true;
     currentPosition = UNKNOWN_POSITION;
+    markStateChanged();
     Serial.print(F("RollerShutter["));
     Serial.print(channel.getChannelNumber());
     Serial.print(F("] new time settings received. Opening time: "));
@@ -271,6 +275,7 @@ void RollerShutter::stopMovement() {
   switchOffRelays();
   currentDirection = STOP_DIR;
   doNothingTime = millis();
+  markStateChanged();
   // Schedule save in 5 s after stop movement of roller shutter
   Supla::Storage::ScheduleSave(5000);
 }
@@ -423,6 +428,7 @@ void RollerShutter::onTimer() {
     } else if (currentPosition < 0) {
       currentPosition = 0;
     }
+    markStateChanged();
 
   } else if (newTargetPositionAvailable && targetPosition != STOP_POSITION) {
     // new target state was set, let's handle it
@@ -65,6 +65,7 @@ int Supla::Control::ButtonState::update() {
 
 Supla::Control::SimpleButton::SimpleButton(int pin, bool pullUp, bool invertLogic)
     : state(pin, pullUp, invertLogic) {
+  declareHook(HOOK_ON_TIMER);
 }
 
 void Supla::Control::SimpleButton::onTimer() {
@@ -35,9 +35,11 @@ void Supla::Control::VirtualRelay::turnOn(_supla_int_t duration) {
   if (keepTurnOnDurationMs) {
     durationMs = storedTurnOnDurationMs;
   }
+  scheduleDurationTask();
   state = true;
 
   channel.setNewValue(state);
+  markStateChanged();
   // Schedule save in 5 s after state change
   Supla::Storage::ScheduleSave(5000);
 }
@@ -45,9 +47,11 @@ void Supla::Control::VirtualRelay::turnOn(_supla_int_t duration) {
 void Supla::Control::VirtualRelay::turnOff(_supla_int_t duration) {
   durationMs = duration;
   durationTimestamp = millis();
+  scheduleDurationTask();
   state = false;
 
   channel.setNewValue(state);
+  markStateChanged();
   // Schedule save in 5 s after state change
   Supla::Storage::ScheduleSave(5000);
 }
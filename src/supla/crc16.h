@@ -1,14 +1,34 @@
+/*
+ Copyright (C) AC SOFTWARE SP. Z O.O.
 
-uint16_t crc16_update(uint16_t crc, uint8_t a) {
-  int i;
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+*/
 
-  crc ^= a;
-  for (i = 0; i < 8; ++i) {
-    if (crc & 1)
-      crc = (crc >> 1) ^ 0xA001;
-    else
-      crc = (crc >> 1);
-  }
 
-  return crc;
-}
+#ifndef _supla_crc16_h
+#define _supla_crc16_h
+
+#include <stddef.h>
+#include <stdint.h>
+
+// CRC-16 with reflected 0x8005 polynomial (0xA001), as used by Modbus when
+// started with 0xFFFF.
+
+// Bit by bit update with single byte
+uint16_t crc16_update(uint16_t crc, uint8_t a);
+
+// Table driven update with buffer of size bytes. Gives the same result as
+// crc16_update() called for each byte.
+uint16_t crc16_update_block(uint16_t crc, const void *buf, size_t size);
+
+#endif
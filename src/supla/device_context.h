@@ -0,0 +1,126 @@
+/*
+ Copyright (C) AC SOFTWARE SP. Z O.O.
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+*/
+
+
+#ifndef _supla_device_context_h
+#define _supla_device_context_h
+
+#include <stdint.h>
+
+#include "channel.h"
+#include "element.h"
+#include "event_queue.h"
+#include "supla-common/proto.h"
+
+// On hosts each thread has its own current context, so i.e. tests with
+// separate devices can run in parallel
+#if defined(ARDUINO_ARCH_AVR) || defined(ARDUINO_ARCH_ESP8266) || \
+    defined(ARDUINO_ARCH_ESP32)
+#define SUPLA_CONTEXT_THREAD_LOCAL
+#else
+#define SUPLA_CONTEXT_THREAD_LOCAL thread_local
+#endif
+
+namespace Supla {
+
+class Network;
+class Storage;
+class Io;
+class ScheduledTask;
+
+// State of a single device: elements and channels with registration data,
+// network interface, storage, IO override, scheduled tasks and event queue.
+// Static methods of Element, Channel, Network, Storage, Io, Scheduler and
+// EventQueue work on current context. Objects of those classes are added to
+// the context which is current when they are created.
+//
+// Arduino sketches use only default context, together with global
+// SuplaDevice. To simulate more devices in one process, create context for
+// each one, create its network interface and elements with
+// DeviceContext::Scope active, and pass context to SuplaDeviceClass
+// constructor. SuplaDeviceClass methods make their context current.
+class DeviceContext {
+ public:
+  DeviceContext() = default;
+  DeviceContext(const DeviceContext &) = delete;
+  DeviceContext &operator=(const DeviceContext &) = delete;
+
+  static DeviceContext *current() {
+    return currentContext;
+  }
+  static DeviceContext *defaultContext() {
+    return &defaultInstance;
+  }
+  // nullptr restores default context
+  static void setCurrent(DeviceContext *context) {
+    currentContext = context ? context : &defaultInstance;
+  }
+
+  // Makes given context current until end of scope
+  class Scope {
+   public:
+    explicit Scope(DeviceContext *context) : previous(currentContext) {
+      setCurrent(context);
+    }
+    ~Scope() {
+      currentContext = previous;
+    }
+
+   protected:
+    DeviceContext *previous;
+  };
+
+  // Element list and lookup tables (see Element)
+  Element *firstElement = nullptr;
+  Element *lastElement = nullptr;
+  Element *channelIndex[SUPLA_CHANNELMAXCOUNT] = {};
+  bool channelIndexValid = false;
+  Element *hookFirstElement[HOOK_COUNT] = {};
+  bool hookListsBuilt = false;
+  // element was created after hook lists were built
+  bool hookListsPending = false;
+
+  // Registration data and channels (see Channel)
+  TDS_SuplaRegisterDevice_E regDev = {};
+  Channel *channels[SUPLA_CHANNELMAXCOUNT] = {};
+  uint32_t dirtyChannels[CHANNEL_DIRTY_WORDS] = {};
+  int nextChannelToSend = 0;
+  unsigned long lastCommunicationTimeMs = 0;
+
+  Network *network = nullptr;
+  Storage *storage = nullptr;
+  Io *io = nullptr;
+
+  // Scheduler
+  ScheduledTask *firstTask = nullptr;
+  uint32_t schedulerRunningNow = 0;
+  bool schedulerRunning = false;
+
+  // EventQueue. head is modified only by producer, tail only by consumer.
+  EventQueue::Item eventItems[SUPLA_EVENT_QUEUE_SIZE] = {};
+  volatile uint8_t eventHead = 0;
+  volatile uint8_t eventTail = 0;
+  volatile uint16_t eventOverflowCount = 0;
+
+  static DeviceContext defaultInstance;
+
+ protected:
+  static SUPLA_CONTEXT_THREAD_LOCAL DeviceContext *currentContext;
+};
+
+};  // namespace Supla
+
+#endif
@@ -15,47 +15,84 @@
 */
 
 #include <Arduino.h>
+#include <string.h>
 
+#include "supla/device_context.h"
 #include "supla/element.h"
 
+#ifdef SUPLA_ELEMENT_OVERRIDE_DETECTION
+// Bound member function is converted to implementation called for element
+#pragma GCC diagnostic ignored "-Wpmf-conversions"
+typedef void (*ElementMethod)(Supla::Element *);
+typedef bool (*IterateConnectedMethod)(Supla::Element *, void *);
+#endif
+
 namespace Supla {
-Element *Element::firstPtr = nullptr;
 
-Element::Element() : nextPtr(nullptr) {
-  if (firstPtr == nullptr) {
-    firstPtr = this;
+Element::Element()
+    : context(DeviceContext::current()),
+      nextPtr(nullptr),
+      hooks(0xFF),
+      hooksDeclared(false),
+      hookListed(false),
+      stateOffset(0),
+      stateSize(0),
+      stateChangeTracking(false) {
+  stateChanged[0] = true;
+  stateChanged[1] = true;
+#ifdef SUPLA_ELEMENT_OVERRIDE_DETECTION
+  trackedSaveState = nullptr;
+#endif
+  memset(hookNextPtr, 0, sizeof(hookNextPtr));
+  if (context->firstElement == nullptr) {
+    context->firstElement = this;
   } else {
-    last()->nextPtr = this;
+    context->lastElement->nextPtr = this;
   }
+  context->lastElement = this;
+  context->channelIndexValid = false;
+  // element is added to hook lists in next iteration, when it is fully
+  // constructed
+  context->hookListsPending = context->hookListsBuilt;
 }
 
 Element::~Element() {
-  if (begin() == this) {
-    firstPtr = next();
+  context->channelIndexValid = false;
+  removeFromHookLists();
+  if (context->firstElement == this) {
+    context->firstElement = next();
+    if (context->lastElement == this) {
+      context->lastElement = nullptr;
+    }
     return;
   }
 
-  auto ptr = begin();
+  auto ptr = context->firstElement;
   while (ptr->next() != this) {
     ptr = ptr->next();
   }
 
   ptr->nextPtr = ptr->next()->next();
+  if (context->lastElement == this) {
+    context->lastElement = ptr;
+  }
 }
 
 Element *Element::begin() {
-  return firstPtr;
+  return DeviceContext::current()->firstElement;
 }
 
 Element *Element::last() {
-  Element *ptr = firstPtr;
-  while (ptr && ptr->nextPtr) {
-    ptr = ptr->nextPtr;
-  }
-  return ptr;
+  return DeviceContext::current()->lastElement;
 }
 
 Element *Element::getElementByChannelNumber(int channelNumber) {
+  DeviceContext *current = DeviceContext::current();
+  if (current->channelIndexValid && channelNumber >= 0 &&
+      channelNumber < SUPLA_CHANNELMAXCOUNT) {
+    return current->channelIndex[channelNumber];
+  }
+
   Element *element = begin();
   while (element != nullptr && element->getChannelNumber() != channelNumber) {
     element = element->next();
@@ -64,16 +101,188 @@ Element *Element::getElementByChannelNumber(int channelNumber) {
   return element;
 }
 
+void Element::buildChannelIndex() {
+  DeviceContext *current = DeviceContext::current();
+  memset(current->channelIndex, 0, sizeof(current->channelIndex));
+  for (auto element = begin(); element != nullptr; element = element->next()) {
+    int channelNumber = element->getChannelNumber();
+    if (channelNumber >= 0 && channelNumber < SUPLA_CHANNELMAXCOUNT &&
+        current->channelIndex[channelNumber] == nullptr) {
+      current->channelIndex[channelNumber] = element;
+    }
+  }
+  current->channelIndexValid = true;
+}
+
 Element *Element::next() {
   return nextPtr;
 }
 
+Element *Element::begin(ElementHook hook) {
+  return DeviceContext::current()->hookFirstElement[hook];
+}
+
+Element *Element::next(ElementHook hook) {
+  return hookNextPtr[hook];
+}
+
+void Element::declareHook(ElementHook hook) {
+  if (!hooksDeclared) {
+    hooksDeclared = true;
+    hooks = 0;
+  }
+  if (hook < HOOK_COUNT) {
+    hooks |= (1 << hook);
+  }
+}
+
+bool Element::isHookDeclared(ElementHook hook) {
+  return hooks & (1 << hook);
+}
+
+bool Element::isHookOverridden(ElementHook hook) {
+#ifdef SUPLA_ELEMENT_OVERRIDE_DETECTION
+  switch (hook) {
+    case HOOK_ON_TIMER:
+      return (ElementMethod)(this->*(&Element::onTimer)) !=
+             (ElementMethod)(&Element::onTimer);
+    case HOOK_ON_FAST_TIMER:
+      return (ElementMethod)(this->*(&Element::onFastTimer)) !=
+             (ElementMethod)(&Element::onFastTimer);
+    case HOOK_ITERATE_ALWAYS:
+      return (ElementMethod)(this->*(&Element::iterateAlways)) !=
+             (ElementMethod)(&Element::iterateAlways);
+    case HOOK_ON_SAVE_STATE:
+      return (ElementMethod)(this->*(&Element::onSaveState)) !=
+             (ElementMethod)(&Element::onSaveState);
+    case HOOK_ITERATE_CONNECTED:
+      return (IterateConnectedMethod)(this->*(&Element::iterateConnected)) !=
+             (IterateConnectedMethod)(&Element::iterateConnected);
+    default:
+      return false;
+  }
+#else
+  // subclass may implement any hook
+  (void)(hook);
+  return true;
+#endif
+}
+
+void Element::buildHookLists() {
+  DeviceContext *current = DeviceContext::current();
+  Element *hookLastPtr[HOOK_COUNT] = {};
+  Element **hookFirstPtr = current->hookFirstElement;
+  memset(hookFirstPtr, 0, sizeof(Element *) * HOOK_COUNT);
+  for (auto element = begin(); element != nullptr; element = element->next()) {
+    element->hookListed = true;
+    for (int hook = 0; hook < HOOK_COUNT; hook++) {
+      element->hookNextPtr[hook] = nullptr;
+      if (!element->isHookDeclared(static_cast<ElementHook>(hook)) &&
+          !element->isHookOverridden(static_cast<ElementHook>(hook))) {
+        continue;
+      }
+      if (hookLastPtr[hook] == nullptr) {
+        hookFirstPtr[hook] = element;
+      } else {
+        hookLastPtr[hook]->hookNextPtr[hook] = element;
+      }
+      hookLastPtr[hook] = element;
+    }
+  }
+  current->hookListsBuilt = true;
+  current->hookListsPending = false;
+}
+
+void Element::updateHookLists() {
+  DeviceContext *current = DeviceContext::current();
+  if (!current->hookListsPending) {
+    return;
+  }
+  current->hookListsPending = false;
+  for (auto element = begin(); element != nullptr; element = element->next()) {
+    if (!element->hookListed) {
+      element->addToHookLists();
+    }
+  }
+}
+
+void Element::addToHookLists() {
+  hookListed = true;
+  Element **hookFirstPtr = context->hookFirstElement;
+  for (int hook = 0; hook < HOOK_COUNT; hook++) {
+    if (!isHookDeclared(static_cast<ElementHook>(hook)) &&
+        !isHookOverridden(static_cast<ElementHook>(hook))) {
+      continue;
+    }
+    Element **link = &hookFirstPtr[hook];
+    while (*link != nullptr) {
+      link = &((*link)->hookNextPtr[hook]);
+    }
+    // Lists are traversed from timer callbacks. Element is published by
+    // single pointer write, after its own links are set.
+#if defined(ARDUINO_ARCH_AVR)
+    noInterrupts();
+    *link = this;
+    interrupts();
+#else
+    __sync_synchronize();
+    *link = this;
+#endif
+  }
+}
+
+void Element::removeFromHookLists() {
+  Element **hookFirstPtr = context->hookFirstElement;
+  for (int hook = 0; hook < HOOK_COUNT; hook++) {
+    if (hookFirstPtr[hook] == this) {
+      hookFirstPtr[hook] = hookNextPtr[hook];
+      continue;
+    }
+    for (auto ptr = hookFirstPtr[hook]; ptr != nullptr;
+         ptr = ptr->hookNextPtr[hook]) {
+      if (ptr->hookNextPtr[hook] == this) {
+        ptr->hookNextPtr[hook] = hookNextPtr[hook];
+        break;
+      }
+    }
+  }
+}
+
 void Element::onInit(){};
 
 void Element::onLoadState(){};
 
 void Element::onSaveState(){};
 
+void Element::enableStateChangeTracking() {
+  stateChangeTracking = true;
+#ifdef SUPLA_ELEMENT_OVERRIDE_DETECTION
+  // called from constructor, so it is onSaveState() of constructed class
+  trackedSaveState = (ElementMethod)(this->*(&Element::onSaveState));
+#endif
+}
+
+bool Element::isStateChangeTracked() {
+#ifdef SUPLA_ELEMENT_OVERRIDE_DETECTION
+  // onSaveState() overridden in subclass may write data which doesn't call
+  // markStateChanged()
+  return stateChangeTracking &&
+         (ElementMethod)(this->*(&Element::onSaveState)) == trackedSaveState;
+#else
+  // onSaveState() may be overridden in subclass
+  return false;
+#endif
+}
+
+void Element::markStateChanged() {
+  stateChanged[0] = true;
+  stateChanged[1] = true;
+}
+
+bool Element::isStateChanged() {
+  return !isStateChangeTracked() || stateChanged[0] || stateChanged[1];
+}
+
 void Element::iterateAlways(){};
 
 bool Element::iterateConnected(void *srpc) {
@@ -81,16 +290,16 @@ bool Element::iterateConnected(void *srpc) {
   unsigned long timestamp = millis();
   Channel *secondaryChannel = getSecondaryChannel();
   if (secondaryChannel && secondaryChannel->isUpdateReady() &&
-      timestamp - secondaryChannel->lastCommunicationTimeMs > 100) {
-    secondaryChannel->lastCommunicationTimeMs = timestamp;
+      timestamp - context->lastCommunicationTimeMs > 100) {
+    context->lastCommunicationTimeMs = timestamp;
     secondaryChannel->sendUpdate(srpc);
     response = false;
   }
 
   Channel *channel = getChannel();
   if (channel && channel->isUpdateReady() &&
-      timestamp - channel->lastCommunicationTimeMs > 100) {
-    channel->lastCommunicationTimeMs = timestamp;
+      timestamp - context->lastCommunicationTimeMs > 100) {
+    context->lastCommunicationTimeMs = timestamp;
     channel->sendUpdate(srpc);
     response = false;
   }
@@ -22,8 +22,35 @@
 #endif
 #include "channel.h"
 
+// GCC can tell which implementation of virtual method would be called for
+// an object, so methods overridden in subclasses (i.e. in user's sketch) are
+// detected at runtime. Other compilers don't allow it, so there hooks declared
+// by library classes and their state change tracking are ignored: each
+// element is on all hook lists and its state is written on each save.
+#if defined(__GNUC__) && !defined(__clang__)
+#define SUPLA_ELEMENT_OVERRIDE_DETECTION
+#endif
+
 namespace Supla {
 
+class DeviceContext;
+
+// Hooks which are called from SuplaDevice on a subset of elements. Each hook
+// has its own element list, so i.e. fast timer interrupt iterates only over
+// elements which really implement onFastTimer().
+enum ElementHook {
+  HOOK_ON_TIMER,
+  HOOK_ON_FAST_TIMER,
+  HOOK_ITERATE_ALWAYS,
+  HOOK_ON_SAVE_STATE,
+  // pending channel values are sent by SuplaDevice, so only elements which
+  // send something else when connected declare this hook
+  HOOK_ITERATE_CONNECTED,
+  HOOK_COUNT,
+  // declared by elements which don't implement any of above hooks
+  HOOK_NONE = HOOK_COUNT
+};
+
 class Element {
  public:
   Element();
@@ -31,8 +58,27 @@ class Element {
   static Element *begin();
   static Element *last();
   static Element *getElementByChannelNumber(int channelNumber);
+  // Fills channel number to element lookup table used by
+  // getElementByChannelNumber(). It is called in SuplaDevice.begin(). Table
+  // is invalidated when element is created or removed and then lookup falls
+  // back to iteration over all elements.
+  static void buildChannelIndex();
   Element *next();
 
+  // Elements registered for given hook, in order of creation. Lists are
+  // filled by buildHookLists() in SuplaDevice.begin(). Elements created later
+  // are appended by updateHookLists(), which SuplaDevice.iterate() calls.
+  // Element is on the list when it declared the hook (or didn't declare any)
+  // or when it overrides method of the hook.
+  static Element *begin(ElementHook hook);
+  Element *next(ElementHook hook);
+  static void buildHookLists();
+  static void updateHookLists();
+  bool isHookDeclared(ElementHook hook);
+  // Returns true when element's class overrides method called for given
+  // hook. Always true when SUPLA_ELEMENT_OVERRIDE_DETECTION is not defined.
+  bool isHookOverridden(ElementHook hook);
+
   // method called during SuplaDevice initialization. I.e. load initial state,
   // initialize pins etc.
   virtual void onInit();
@@ -45,6 +91,16 @@ class Element {
   // Called only if Storage class is configured
   virtual void onSaveState();
 
+  // Marks that data written by onSaveState() changed, so element state will
+  // be written in next state save. Can be called from timer callbacks.
+  void markStateChanged();
+  // Returns true when changed element state wasn't written yet to both
+  // copies of state section. Always true for elements which don't track state
+  // changes.
+  bool isStateChanged();
+  // Returns true when state is written only after markStateChanged()
+  bool isStateChangeTracked();
+
   // method called on each SuplaDevice iteration (before Network layer
   // iteration). When Device is connected, both iterateAlways() and
   // iterateConnected() are called.
@@ -83,8 +139,46 @@ class Element {
   Element &disableChannelState();
 
  protected:
-  static Element *firstPtr;
+  // Declares that element overrides method for given hook. Element which
+  // doesn't declare any hook is called for all of them (default for elements
+  // defined in user's sketch). Library classes declare hooks in constructors.
+  // Subclass which overrides method of another hook is added to its list as
+  // well, as override is detected. Without override detection declared hooks
+  // are ignored, so subclass is never left out of a hook list.
+  void declareHook(ElementHook hook);
+  void removeFromHookLists();
+  void addToHookLists();
+  // Declares that element calls markStateChanged() on each change of data
+  // written by onSaveState(). State of other elements (default for elements
+  // defined in user's sketch) is written on each state save. Library classes
+  // enable it in constructors. Tracking applies to onSaveState() of the class
+  // which enabled it, so it is disabled for subclass which overrides
+  // onSaveState(). Without override detection such subclass can't be
+  // recognized, so tracking is always disabled.
+  void enableStateChangeTracking();
+
+  // Context in which element was created
+  DeviceContext *context;
   Element *nextPtr;
+  Element *hookNextPtr[HOOK_COUNT];
+  uint8_t hooks;
+  bool hooksDeclared;
+  bool hookListed;
+
+  // Range of data written by onSaveState() in storage state section, set by
+  // Storage
+  uint16_t stateOffset;
+  uint16_t stateSize;
+  bool stateChangeTracking;
+  // Change flag for each of two copies of state section, as state has to be
+  // written to both of them
+  volatile bool stateChanged[2];
+#ifdef SUPLA_ELEMENT_OVERRIDE_DETECTION
+  // onSaveState() of class which enabled state change tracking
+  void (*trackedSaveState)(Element *);
+#endif
+
+  friend class Storage;
 };
 
 };  // namespace Supla
@@ -0,0 +1,145 @@
+/*
+ Copyright (C) AC SOFTWARE SP. Z O.O.
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+*/
+
+#include <Arduino.h>
+
+#if defined(SUPLA_LINUX)
+#include <pthread.h>
+#endif
+
+#include "device_context.h"
+#include "event_queue.h"
+#include "local_action.h"
+
+#if (SUPLA_EVENT_QUEUE_SIZE & (SUPLA_EVENT_QUEUE_SIZE - 1)) != 0 || \
+    SUPLA_EVENT_QUEUE_SIZE > 128
+#error "SUPLA_EVENT_QUEUE_SIZE has to be a power of 2, not bigger than 128"
+#endif
+
+#define EVENT_QUEUE_MASK (SUPLA_EVENT_QUEUE_SIZE - 1)
+
+namespace {
+#if defined(ARDUINO_ARCH_ESP32)
+// On ESP32 timer callbacks run in a separate task, so producer side is
+// protected in case runAction is called from loop while timer is active
+portMUX_TYPE eventQueueMux = portMUX_INITIALIZER_UNLOCKED;
+#elif defined(SUPLA_LINUX)
+// Same for timer thread on Linux
+pthread_mutex_t eventQueueMutex = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+// Depth of timer callbacks on current thread
+#if defined(ARDUINO_ARCH_AVR) || defined(ARDUINO_ARCH_ESP8266)
+volatile uint8_t timerContextDepth = 0;
+#else
+thread_local uint8_t timerContextDepth = 0;
+#endif
+
+inline void memoryBarrier() {
+#if defined(__AVR__)
+  __asm__ __volatile__("" ::: "memory");
+#else
+  __sync_synchronize();
+#endif
+}
+};  // namespace
+
+using namespace Supla;
+
+bool EventQueue::post(LocalAction *trigger, uint8_t event) {
+  bool result = false;
+#if defined(ARDUINO_ARCH_ESP32)
+  portENTER_CRITICAL(&eventQueueMux);
+#elif defined(SUPLA_LINUX)
+  pthread_mutex_lock(&eventQueueMutex);
+#endif
+  DeviceContext *context = DeviceContext::current();
+  uint8_t currentHead = context->eventHead;
+  if (static_cast<uint8_t>(currentHead - context->eventTail) <
+      SUPLA_EVENT_QUEUE_SIZE) {
+    Item &item = context->eventItems[currentHead & EVENT_QUEUE_MASK];
+    item.trigger = trigger;
+    item.event = event;
+    // item has to be stored before it is published to consumer
+    memoryBarrier();
+    context->eventHead = currentHead + 1;
+    result = true;
+  } else {
+    context->eventOverflowCount = context->eventOverflowCount + 1;
+  }
+#if defined(ARDUINO_ARCH_ESP32)
+  portEXIT_CRITICAL(&eventQueueMux);
+#elif defined(SUPLA_LINUX)
+  pthread_mutex_unlock(&eventQueueMutex);
+#endif
+  return result;
+}
+
+void EventQueue::dispatch() {
+  DeviceContext *context = DeviceContext::current();
+  uint8_t currentHead = context->eventHead;
+  memoryBarrier();
+  while (context->eventTail != currentHead) {
+    Item item = context->eventItems[context->eventTail & EVENT_QUEUE_MASK];
+    memoryBarrier();
+    context->eventTail = context->eventTail + 1;
+    if (item.trigger) {
+      item.trigger->runAction(item.event);
+    }
+  }
+}
+
+bool EventQueue::isEmpty() {
+  DeviceContext *context = DeviceContext::current();
+  return context->eventHead == context->eventTail;
+}
+
+void EventQueue::clear() {
+  DeviceContext *context = DeviceContext::current();
+  context->eventTail = context->eventHead;
+}
+
+void EventQueue::remove(LocalAction *trigger) {
+  DeviceContext *context = DeviceContext::current();
+  // Called from loop(), like dispatch(). Producer only writes items at and
+  // after head, so pending items can be changed without locking.
+  uint8_t currentHead = context->eventHead;
+  memoryBarrier();
+  for (uint8_t i = context->eventTail; i != currentHead; i++) {
+    Item &item = context->eventItems[i & EVENT_QUEUE_MASK];
+    if (item.trigger == trigger) {
+      item.trigger = nullptr;
+    }
+  }
+}
+
+uint16_t EventQueue::getOverflowCount() {
+  return DeviceContext::current()->eventOverflowCount;
+}
+
+void EventQueue::enterTimerContext() {
+  timerContextDepth = timerContextDepth + 1;
+}
+
+void EventQueue::leaveTimerContext() {
+  if (timerContextDepth > 0) {
+    timerContextDepth = timerContextDepth - 1;
+  }
+}
+
+bool EventQueue::isTimerContext() {
+  return timerContextDepth > 0;
+}
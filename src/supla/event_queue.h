@@ -0,0 +1,70 @@
+/*
+ Copyright (C) AC SOFTWARE SP. Z O.O.
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+*/
+
+#ifndef _event_queue_h
+#define _event_queue_h
+
+#include <stdint.h>
+
+#include "supla_lib_config.h"
+
+// Number of events that can wait for dispatch. Has to be a power of 2 and
+// not bigger than 128.
+#ifndef SUPLA_EVENT_QUEUE_SIZE
+#define SUPLA_EVENT_QUEUE_SIZE 16
+#endif
+
+namespace Supla {
+
+class LocalAction;
+
+// Single producer, single consumer ring of (trigger, event) pairs.
+// Actions raised from timer callbacks (SuplaDeviceClass::onTimer() and
+// onFastTimer()) are posted here and executed later from
+// SuplaDeviceClass::iterate(), so relay switching, logging and storage
+// scheduling don't run in interrupt context.
+// Queue is kept in current DeviceContext.
+class EventQueue {
+ public:
+  struct Item {
+    LocalAction *trigger;
+    uint8_t event;
+  };
+
+  // Called from timer context. Returns false when queue is full, in which
+  // case event is dropped and counted in getOverflowCount().
+  static bool post(LocalAction *trigger, uint8_t event);
+  // Called from SuplaDeviceClass::iterate(). Executes all events which were
+  // posted before the call.
+  static void dispatch();
+  static bool isEmpty();
+  static void clear();
+  // Drops pending events of trigger. Called when trigger is destroyed.
+  static void remove(LocalAction *trigger);
+  // Number of events dropped because queue was full
+  static uint16_t getOverflowCount();
+
+  // Timer context is tracked per thread, so calls made from loop() while
+  // timer task (ESP32) or timer thread (Linux) is in onTimer() are not
+  // deferred.
+  static void enterTimerContext();
+  static void leaveTimerContext();
+  static bool isTimerContext();
+};
+
+};  // namespace Supla
+
+#endif
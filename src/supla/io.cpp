@@ -18,6 +18,8 @@
 
 #include <Arduino.h>
 
+#include "device_context.h"
+
 namespace Supla {
 void Io::pinMode(uint8_t pin, uint8_t mode) {
   return pinMode(-1, pin, mode);
@@ -32,6 +34,7 @@ void Io::digitalWrite(uint8_t pin, uint8_t val) {
 }
 
 void Io::pinMode(int channelNumber, uint8_t pin, uint8_t mode) {
+  Io *ioInstance = Instance();
   if (ioInstance) {
     ioInstance->customPinMode(channelNumber, pin, mode);
   } else { 
@@ -40,6 +43,7 @@ void Io::pinMode(int channelNumber, uint8_t pin, uint8_t mode) {
 }
 
 int Io::digitalRead(int channelNumber, uint8_t pin) {
+  Io *ioInstance = Instance();
   if (ioInstance) {
     return ioInstance->customDigitalRead(channelNumber, pin);
   }
@@ -53,6 +57,7 @@ void Io::digitalWrite(int channelNumber, uint8_t pin, uint8_t val) {
   Serial.print(pin);
   Serial.print("; value: ");
   Serial.println(val);
+  Io *ioInstance = Instance();
   if (ioInstance) {
     ioInstance->customDigitalWrite(channelNumber, pin, val);
     return;
@@ -60,14 +65,18 @@ void Io::digitalWrite(int channelNumber, uint8_t pin, uint8_t val) {
   ::digitalWrite(pin, val);
 }
 
-Io *Io::ioInstance = 0;
+Io *Io::Instance() {
+  return DeviceContext::current()->io;
+}
 
-Io::Io() {
-  ioInstance = this;
+Io::Io() : context(DeviceContext::current()) {
+  context->io = this;
 }
 
 Io::~Io() {
-  ioInstance = nullptr;
+  if (context->io == this) {
+    context->io = nullptr;
+  }
 }
 
 int Io::customDigitalRead(int channelNumber, uint8_t pin) {
@@ -20,11 +20,15 @@
 #include <stdint.h>
 
 namespace Supla {
+
+class DeviceContext;
+
 // This class can be used to override digitalRead and digitalWrite methods.
 // If you want to add custom behavior i.e. during read/write from some
 // digital pin, you can inherit from Supla::Io class, implement your
 // own customDigitalRead and customDigitalWrite methods and create instance
-// of this class. It will automatically register and SuplaDevice will use it.
+// of this class. It will automatically register in current DeviceContext
+// and SuplaDevice will use it.
 //
 // Example use: implement some additional logic, when relay state is
 // changed.
@@ -37,13 +41,17 @@ class Io {
   static int digitalRead(int channelNumber, uint8_t pin);
   static void digitalWrite(int channelNumber, uint8_t pin, uint8_t val);
 
-  static Io *ioInstance;
+  // Returns Io registered in current context or nullptr
+  static Io *Instance();
 
   Io();
   virtual ~Io();
   virtual void customPinMode(int channelNumber, uint8_t pin, uint8_t mode);
   virtual int customDigitalRead(int channelNumber, uint8_t pin);
   virtual void customDigitalWrite(int channelNumber, uint8_t pin, uint8_t val);
+
+ protected:
+  DeviceContext *context;
 };
 };  // namespace Supla
 
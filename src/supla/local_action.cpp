@@ -15,6 +15,7 @@
 */
 
 #include "supla/local_action.h"
+#include "supla/event_queue.h"
 
 namespace Supla {
 
@@ -28,29 +29,11 @@ class ActionHandlerClient {
         next(nullptr),
         onEvent(0),
         action(0) {
-    if (begin == nullptr) {
-      begin = this;
-    } else {
-      auto ptr = begin;
-      while (ptr->next) {
-        ptr = ptr->next;
-      }
-      ptr->next = this;
-    }
+    count++;
   }
 
   ~ActionHandlerClient() {
-    if (begin == this) {
-      begin = next;
-      return;
-    }
-
-    auto ptr = begin;
-    while (ptr->next != this) {
-      ptr = ptr->next;
-    }
-
-    ptr->next = ptr->next->next;
+    count--;
   }
 
   LocalAction *trigger;
@@ -58,24 +41,34 @@ class ActionHandlerClient {
   ActionHandlerClient *next;
   uint8_t onEvent;
   uint8_t action;
-  static ActionHandlerClient *begin;
+  static int count;
 };
 
-ActionHandlerClient *ActionHandlerClient::begin = nullptr;
+int ActionHandlerClient::count = 0;
+
+static uint32_t eventBit(int event) {
+  if (event >= 0 && event < 31) {
+    return (1UL << event);
+  }
+  return (1UL << 31);
+}
+
+LocalAction::LocalAction()
+    : clientList(nullptr), eventMask(0), immediateDispatch(false) {
+}
 
 LocalAction::~LocalAction() {
-  auto ptr = ActionHandlerClient::begin;
+  EventQueue::remove(this);
+  auto ptr = clientList;
+  clientList = nullptr;
+  eventMask = 0;
   while (ptr) {
-    if (ptr->trigger == this) {
-      auto tbdptr = ptr;
-      ptr = ptr->next;
-      if (tbdptr->client->deleteClient()) {
-        delete tbdptr->client;
-      }
-      delete tbdptr;
-    } else {
-      ptr = ptr->next;
+    auto tbdptr = ptr;
+    ptr = ptr->next;
+    if (tbdptr->client->deleteClient()) {
+      delete tbdptr->client;
     }
+    delete tbdptr;
   }
 }
 
@@ -85,6 +78,31 @@ void LocalAction::addAction(int action, ActionHandler &client, int event) {
   ptr->client = &client;
   ptr->onEvent = event;
   ptr->action = action;
+
+  // New client is added after the last client registered for the same event
+  // (or at the end of the list), so clients of one event stay grouped and
+  // are called in the order in which they were added
+  ActionHandlerClient *prev = nullptr;
+  ActionHandlerClient *cur = clientList;
+  bool eventGroupFound = false;
+  while (cur) {
+    if (cur->onEvent == ptr->onEvent) {
+      eventGroupFound = true;
+    } else if (eventGroupFound) {
+      break;
+    }
+    prev = cur;
+    cur = cur->next;
+  }
+
+  ptr->next = cur;
+  if (prev) {
+    prev->next = ptr;
+  } else {
+    clientList = ptr;
+  }
+
+  eventMask |= eventBit(event);
 }
 
 void LocalAction::addAction(int action, ActionHandler *client, int event) {
@@ -92,17 +110,33 @@ void LocalAction::addAction(int action, ActionHandler *client, int event) {
 }
 
 void LocalAction::runAction(int event) {
-  auto ptr = ActionHandlerClient::begin;
-  while (ptr) {
-    if (ptr->trigger == this && ptr->onEvent == event) {
-      ptr->client->handleAction(event, ptr->action);
-    }
+  if ((eventMask & eventBit(event)) == 0) {
+    return;
+  }
+
+  if (!immediateDispatch && EventQueue::isTimerContext()) {
+    // When queue is full, event is dropped (and counted by EventQueue).
+    // Handlers are never called from timer context.
+    EventQueue::post(this, event);
+    return;
+  }
+
+  auto ptr = clientList;
+  while (ptr && ptr->onEvent != event) {
+    ptr = ptr->next;
+  }
+  while (ptr && ptr->onEvent == event) {
+    ptr->client->handleAction(event, ptr->action);
     ptr = ptr->next;
   }
 }
 
-ActionHandlerClient *LocalAction::getClientListPtr() {
-  return ActionHandlerClient::begin;
+void LocalAction::setImmediateDispatch(bool immediate) {
+  immediateDispatch = immediate;
+}
+
+int LocalAction::getClientCount() {
+  return ActionHandlerClient::count;
 }
 
 };  // namespace Supla
@@ -26,13 +26,31 @@ class ActionHandlerClient;
 
 class LocalAction {
  public:
+  LocalAction();
   virtual ~LocalAction();
   virtual void addAction(int action, ActionHandler &client, int event);
   virtual void addAction(int action, ActionHandler *client, int event);
 
+  // When called from timer context (SuplaDeviceClass::onTimer() or
+  // onFastTimer()), event is posted to EventQueue and clients are called later
+  // from SuplaDeviceClass::iterate(), unless immediate dispatch is enabled.
   virtual void runAction(int event);
 
-  static ActionHandlerClient *getClientListPtr();
+  // Enables calling action clients directly from timer context. Use it only
+  // when all clients of this trigger are short and safe to run in interrupt.
+  void setImmediateDispatch(bool immediate);
+
+  // Returns number of action handler clients registered on all triggers
+  static int getClientCount();
+
+ protected:
+  // Each trigger keeps its own list of clients, grouped by event. eventMask
+  // has a bit set for each event that has at least one client, so runAction
+  // on event without subscribers ends on a single bit test. Events >= 31
+  // share the last bit.
+  ActionHandlerClient *clientList;
+  uint32_t eventMask;
+  bool immediateDispatch;
 };
 
 };  // namespace Supla
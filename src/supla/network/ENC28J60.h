@@ -52,6 +52,10 @@ class ENC28J60 : public Supla::Network {
     return -1;
   }
 
+  bool hasData() {
+    return client.available() > 0;
+  }
+
   int write(void *buf, int count) {
 #ifdef SUPLA_COMM_DEBUG
     Serial.print(F("Sending: ["));
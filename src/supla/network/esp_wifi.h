@@ -76,6 +76,10 @@ class ESPWifi : public Supla::Network {
     return -1;
   }
 
+  bool hasData() {
+    return client != nullptr && client->available() > 0;
+  }
+
   int write(void *buf, int count) {
 #ifdef SUPLA_COMM_DEBUG
     Serial.print(F("Sending: ["));
@@ -91,6 +95,20 @@ class ESPWifi : public Supla::Network {
   }
 
   int connect(const char *server, int port = -1) {
+    prepareClient(server, port);
+    bool result = client->connect(server, getConnectionPort(port));
+
+    return result;
+  }
+
+  int getConnectionPort(int port) {
+    if (port != -1) {
+      return port;
+    }
+    return isSecured ? 2016 : 2015;
+  }
+
+  void prepareClient(const char *server, int port) {
     String message;
     if (client == NULL) {
       if (isSecured) {
@@ -114,20 +132,11 @@ class ESPWifi : public Supla::Network {
       }
     }
 
-    int connectionPort = (isSecured ? 2016 : 2015);
-    if (port != -1) {
-      connectionPort = port;
-    }
-
     supla_log(LOG_DEBUG,
               "Establishing %s with: %s (port: %d)",
               message.c_str(),
               server,
-              connectionPort);
-
-    bool result = client->connect(server, connectionPort);
-
-    return result;
+              getConnectionPort(port));
   }
 
   bool connected() {
@@ -251,7 +260,60 @@ class ESPWifi : public Supla::Network {
   }
 
  protected:
+  ConnectPhaseResult runConnectPhase(ConnectPhase phase) {
+    int port = getConnectionPort(connectPort);
+    switch (phase) {
+      case CONNECT_DNS: {
+        prepareClient(connectServer, connectPort);
+#ifdef ARDUINO_ARCH_ESP8266
+        int result = WiFi.hostByName(
+            connectServer, serverIp, SUPLA_CONNECT_DNS_TIMEOUT_MS);
+#else
+        int result = WiFi.hostByName(connectServer, serverIp);
+#endif
+        if (result != 1) {
+          supla_log(LOG_DEBUG, "DNS lookup failed: %s", connectServer);
+          return CONNECT_PHASE_FAILED;
+        }
+        return CONNECT_PHASE_DONE;
+      }
+
+      case CONNECT_TCP:
+        if (isSecured) {
+          // WiFiClientSecure makes TCP connection and TLS handshake together
+          return CONNECT_PHASE_NEXT;
+        }
+#ifdef ARDUINO_ARCH_ESP8266
+        client->setTimeout(SUPLA_CONNECT_TCP_TIMEOUT_MS);
+        if (!client->connect(serverIp, port)) {
+#else
+        if (!client->connect(serverIp, port, SUPLA_CONNECT_TCP_TIMEOUT_MS)) {
+#endif
+          return CONNECT_PHASE_FAILED;
+        }
+        return CONNECT_PHASE_DONE;
+
+      case CONNECT_TLS:
+        if (!isSecured) {
+          return CONNECT_PHASE_NEXT;
+        }
+#ifdef ARDUINO_ARCH_ESP8266
+        client->setTimeout(SUPLA_CONNECT_TLS_TIMEOUT_MS);
+#endif
+        // server name is used for SNI. It was resolved in DNS phase, so
+        // lookup is answered from cache.
+        if (!client->connect(connectServer, port)) {
+          return CONNECT_PHASE_FAILED;
+        }
+        return CONNECT_PHASE_DONE;
+
+      default:
+        return CONNECT_PHASE_NEXT;
+    }
+  }
+
   WiFiClient *client = NULL;
+  IPAddress serverIp;
   bool isSecured;
   bool wifiConfigured;
   String fingerprint;
@@ -18,17 +18,40 @@
 #define ethernet_shield_h__
 
 #include <Arduino.h>
+#include <Dns.h>
 #include <Ethernet.h>
 
 #include "../supla_lib_config.h"
 #include "network.h"
 
+// DHCP lease is requested with short attempts repeated from iterate(),
+// instead of one long blocking call. Each failed attempt doubles the time to
+// the next one (up to SUPLA_ETHERNET_DHCP_MAX_RETRY_MS), so without DHCP
+// server iterate() is blocked only for a small part of the time.
+#ifndef SUPLA_ETHERNET_DHCP_TIMEOUT_MS
+#define SUPLA_ETHERNET_DHCP_TIMEOUT_MS 1500
+#endif
+#ifndef SUPLA_ETHERNET_DHCP_RESPONSE_TIMEOUT_MS
+#define SUPLA_ETHERNET_DHCP_RESPONSE_TIMEOUT_MS 750
+#endif
+#ifndef SUPLA_ETHERNET_DHCP_RETRY_MS
+#define SUPLA_ETHERNET_DHCP_RETRY_MS 1000
+#endif
+#ifndef SUPLA_ETHERNET_DHCP_MAX_RETRY_MS
+#define SUPLA_ETHERNET_DHCP_MAX_RETRY_MS 30000
+#endif
+
 // TODO: change logs to supla_log
 
 namespace Supla {
 class EthernetShield : public Supla::Network {
  public:
-  EthernetShield(uint8_t mac[6], unsigned char *ip = NULL) : Network(ip), isDeviceReady(false) {
+  EthernetShield(uint8_t mac[6], unsigned char *ip = NULL)
+      : Network(ip),
+        isDeviceReady(false),
+        dhcpInProgress(false),
+        nextDhcpAttemptMs(0),
+        dhcpRetryMs(SUPLA_ETHERNET_DHCP_RETRY_MS) {
     memcpy(this->mac, mac, 6);
   }
 
@@ -51,6 +74,10 @@ class EthernetShield : public Supla::Network {
     return -1;
   }
 
+  bool hasData() {
+    return client.available() > 0;
+  }
+
   int write(void *buf, int count) {
 #ifdef SUPLA_COMM_DEBUG
     Serial.print(F("Sending: ["));
@@ -86,17 +113,58 @@ class EthernetShield : public Supla::Network {
 
   void setup() {
     Serial.println(F("Connecting to network..."));
+    isDeviceReady = false;
     if (useLocalIp) {
       Ethernet.begin(mac, localIp);
       isDeviceReady = true;
+      printNetworkInfo();
     } else {
-      int result = false;
-      result = Ethernet.begin(mac, 10000, 4000);
+      // lease is requested from iterate()
+      dhcpInProgress = true;
+      nextDhcpAttemptMs = millis();
+      dhcpRetryMs = SUPLA_ETHERNET_DHCP_RETRY_MS;
+    }
+  }
+
+  bool iterate() {
+    if (dhcpInProgress) {
+      if (static_cast<long>(millis() - nextDhcpAttemptMs) < 0) {
+        return true;
+      }
+      if (Ethernet.linkStatus() == LinkOFF) {
+        // nothing was sent, so link is checked again without backoff and
+        // lease is requested quickly after cable is connected
+        dhcpRetryMs = SUPLA_ETHERNET_DHCP_RETRY_MS;
+        nextDhcpAttemptMs = millis() + dhcpRetryMs;
+        return true;
+      }
+      int result = Ethernet.begin(mac,
+                                  SUPLA_ETHERNET_DHCP_TIMEOUT_MS,
+                                  SUPLA_ETHERNET_DHCP_RESPONSE_TIMEOUT_MS);
       Serial.print(F("DHCP connection result: "));
       Serial.println(result);
-      isDeviceReady = result == 1 ? true : false;
+      if (result == 1) {
+        dhcpInProgress = false;
+        isDeviceReady = true;
+        printNetworkInfo();
+        return true;
+      }
+      nextDhcpAttemptMs = millis() + dhcpRetryMs;
+      if (dhcpRetryMs < SUPLA_ETHERNET_DHCP_MAX_RETRY_MS / 2) {
+        dhcpRetryMs *= 2;
+      } else {
+        dhcpRetryMs = SUPLA_ETHERNET_DHCP_MAX_RETRY_MS;
+      }
+      return true;
     }
 
+    if (isDeviceReady) {
+      Ethernet.maintain();
+    }
+    return true;
+  }
+
+  void printNetworkInfo() {
     Serial.print(F("localIP: "));
     Serial.println(Ethernet.localIP());
     Serial.print(F("subnetMask: "));
@@ -107,11 +175,6 @@ class EthernetShield : public Supla::Network {
     Serial.println(Ethernet.dnsServerIP());
   }
 
-  bool iterate() {
-    Ethernet.maintain();
-    return true;
-  }
-
   void fillStateData(TDSC_ChannelState &channelState) {
     channelState.Fields |= SUPLA_CHANNELSTATE_FIELD_IPV4 |
                            SUPLA_CHANNELSTATE_FIELD_MAC;
@@ -120,9 +183,43 @@ class EthernetShield : public Supla::Network {
   }
   
  protected:
+  ConnectPhaseResult runConnectPhase(ConnectPhase phase) {
+    switch (phase) {
+      case CONNECT_DNS: {
+        supla_log(LOG_DEBUG,
+                  "Establishing connection with: %s (port: %d)",
+                  connectServer,
+                  connectPort == -1 ? 2015 : connectPort);
+        DNSClient dns;
+        dns.begin(Ethernet.dnsServerIP());
+        if (dns.getHostByName(
+                connectServer, serverIp, SUPLA_CONNECT_DNS_TIMEOUT_MS) != 1) {
+          supla_log(LOG_DEBUG, "DNS lookup failed: %s", connectServer);
+          return CONNECT_PHASE_FAILED;
+        }
+        return CONNECT_PHASE_DONE;
+      }
+
+      case CONNECT_TCP:
+        client.setConnectionTimeout(SUPLA_CONNECT_TCP_TIMEOUT_MS);
+        if (client.connect(serverIp, connectPort == -1 ? 2015 : connectPort) !=
+            1) {
+          return CONNECT_PHASE_FAILED;
+        }
+        return CONNECT_PHASE_DONE;
+
+      default:
+        return CONNECT_PHASE_NEXT;
+    }
+  }
+
   EthernetClient client;
+  IPAddress serverIp;
   uint8_t mac[6];
   bool isDeviceReady;
+  bool dhcpInProgress;
+  unsigned long nextDhcpAttemptMs;
+  unsigned long dhcpRetryMs;
 };
 
 };  // namespace Supla
@@ -0,0 +1,433 @@
+/*
+ Copyright (C) AC SOFTWARE SP. Z O.O.
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+*/
+
+
+#ifndef _linux_network_h
+#define _linux_network_h
+
+#include <Arduino.h>
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#ifdef SUPLA_LINUX_OPENSSL
+#include <openssl/err.h>
+#include <openssl/ssl.h>
+#endif
+
+#include "network.h"
+
+// Time limit for sending data when socket send buffer is full
+#ifndef SUPLA_LINUX_WRITE_TIMEOUT_MS
+#define SUPLA_LINUX_WRITE_TIMEOUT_MS 1000
+#endif
+
+namespace Supla {
+
+// Network interface for native Linux builds. It uses non-blocking BSD socket,
+// so TCP connect and TLS handshake (when built with SUPLA_LINUX_OPENSSL) are
+// driven by pollConnect() calls from SuplaDeviceClass::iterate(). Only DNS
+// lookup (getaddrinfo) is blocking. Socket readiness is checked with poll(),
+// so SRPC is processed only when server sent data and low power mode sleeps
+// waiting on socket instead of fixed delay.
+class LinuxNetwork : public Supla::Network {
+ public:
+  explicit LinuxNetwork(unsigned char *ip = nullptr)
+      : Network(ip),
+        sockFd(-1),
+#ifdef SUPLA_LINUX_OPENSSL
+        isSecured(true),
+        sslCtx(nullptr),
+        ssl(nullptr),
+#else
+        isSecured(false),
+#endif
+        caFile(nullptr),
+        serverAddrLen(0) {
+    memset(&serverAddr, 0, sizeof(serverAddr));
+  }
+
+  ~LinuxNetwork() {
+    closeSocket();
+#ifdef SUPLA_LINUX_OPENSSL
+    if (sslCtx) {
+      SSL_CTX_free(sslCtx);
+    }
+#endif
+  }
+
+  int read(void *buf, int count) {
+    if (sockFd < 0) {
+      return -1;
+    }
+#ifdef SUPLA_LINUX_OPENSSL
+    if (ssl) {
+      int size = SSL_read(ssl, buf, count);
+      if (size <= 0) {
+        int error = SSL_get_error(ssl, size);
+        if (error != SSL_ERROR_WANT_READ && error != SSL_ERROR_WANT_WRITE) {
+          supla_log(LOG_DEBUG, "TLS connection closed (%d)", error);
+          closeSocket();
+        }
+        return -1;
+      }
+      return size;
+    }
+#endif
+    ssize_t size = recv(sockFd, buf, count, 0);
+    if (size > 0) {
+      return size;
+    }
+    if (size == 0 || (errno != EAGAIN && errno != EWOULDBLOCK &&
+                      errno != EINTR)) {
+      supla_log(LOG_DEBUG,
+                "Connection closed: %s",
+                size == 0 ? "by server" : strerror(errno));
+      closeSocket();
+    }
+    return -1;
+  }
+
+  int write(void *buf, int count) {
+    const char *data = static_cast<const char *>(buf);
+    int sent = 0;
+    while (sockFd >= 0 && sent < count) {
+      int size;
+      bool wantRead = false;
+#ifdef SUPLA_LINUX_OPENSSL
+      if (ssl) {
+        size = SSL_write(ssl, data + sent, count - sent);
+        if (size <= 0) {
+          int error = SSL_get_error(ssl, size);
+          if (error != SSL_ERROR_WANT_READ && error != SSL_ERROR_WANT_WRITE) {
+            closeSocket();
+            return -1;
+          }
+          wantRead = error == SSL_ERROR_WANT_READ;
+          size = 0;
+        }
+      } else  // NOLINT
+#endif
+      {
+        size = send(sockFd, data + sent, count - sent, MSG_NOSIGNAL);
+        if (size < 0) {
+          if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+            supla_log(LOG_DEBUG, "Send failed: %s", strerror(errno));
+            closeSocket();
+            return -1;
+          }
+          size = 0;
+        }
+      }
+      sent += size;
+      if (sent < count && !waitForSocket(wantRead ? POLLIN : POLLOUT,
+                                         SUPLA_LINUX_WRITE_TIMEOUT_MS)) {
+        supla_log(LOG_DEBUG, "Send timeout");
+        closeSocket();
+        return -1;
+      }
+    }
+    return sockFd >= 0 ? sent : -1;
+  }
+
+  // Blocking connect, which runs all connection phases at once
+  int connect(const char *server, int port = -1) {
+    beginConnect(server, port);
+    int result = 0;
+    while ((result = pollConnect(millis())) == 0) {
+      waitForSocket(POLLIN | POLLOUT, 10);
+    }
+    return result == 1 ? 1 : 0;
+  }
+
+  void beginConnect(const char *server, int port = -1) {
+    closeSocket();
+    Network::beginConnect(server, port);
+  }
+
+  bool connected() {
+    return sockFd >= 0 && connectPhase == CONNECT_IDLE;
+  }
+
+  bool isReady() {
+    return true;
+  }
+
+  bool hasData() {
+    if (!connected()) {
+      return false;
+    }
+#ifdef SUPLA_LINUX_OPENSSL
+    // data already decrypted by OpenSSL isn't visible on socket
+    if (ssl && SSL_pending(ssl) > 0) {
+      return true;
+    }
+#endif
+    // connection closed by server is also reported, so read() can handle it
+    return waitForSocket(POLLIN, 0);
+  }
+
+  bool waitForData(unsigned long timeoutMs) {
+    if (!connected()) {
+      return false;
+    }
+#ifdef SUPLA_LINUX_OPENSSL
+    if (ssl && SSL_pending(ssl) > 0) {
+      return true;
+    }
+#endif
+    waitForSocket(POLLIN,
+                  timeoutMs > INT_MAX ? INT_MAX : static_cast<int>(timeoutMs));
+    return true;
+  }
+
+  void disconnect() {
+    closeSocket();
+  }
+
+  void setup() {
+    // SSL_write may write to closed socket, which shouldn't kill the process
+    signal(SIGPIPE, SIG_IGN);
+  }
+
+  void enableSSL(bool value) {
+#ifdef SUPLA_LINUX_OPENSSL
+    isSecured = value;
+#else
+    if (value) {
+      supla_log(LOG_DEBUG, "Built without OpenSSL. SSL is not available");
+    }
+#endif
+  }
+
+  // Enables verification of server certificate with CA certificates from
+  // given PEM file. Without it, encrypted connection is not authenticated.
+  void setCaCertFile(const char *path) {
+    caFile = path;
+  }
+
+  void fillStateData(TDSC_ChannelState &channelState) {
+    struct sockaddr_in local;
+    socklen_t len = sizeof(local);
+    if (sockFd >= 0 &&
+        getsockname(sockFd, reinterpret_cast<sockaddr *>(&local), &len) == 0 &&
+        local.sin_family == AF_INET) {
+      channelState.Fields |= SUPLA_CHANNELSTATE_FIELD_IPV4;
+      channelState.IPv4 = local.sin_addr.s_addr;
+    }
+  }
+
+  int getSocket() {
+    return sockFd;
+  }
+
+ protected:
+  int getConnectionPort(int port) {
+    if (port != -1) {
+      return port;
+    }
+    return isSecured ? 2016 : 2015;
+  }
+
+  ConnectPhaseResult runConnectPhase(ConnectPhase phase) {
+    switch (phase) {
+      case CONNECT_DNS:
+        return resolveServer() ? CONNECT_PHASE_DONE : CONNECT_PHASE_FAILED;
+      case CONNECT_TCP:
+        return connectSocket();
+      case CONNECT_TLS:
+        if (!isSecured) {
+          return CONNECT_PHASE_NEXT;
+        }
+        return handshake();
+      default:
+        return CONNECT_PHASE_NEXT;
+    }
+  }
+
+  bool resolveServer() {
+    supla_log(LOG_DEBUG,
+              "Establishing %s connection with: %s (port: %d)",
+              isSecured ? "encrypted" : "unencrypted",
+              connectServer,
+              getConnectionPort(connectPort));
+
+    struct addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+
+    char port[8];
+    snprintf(port, sizeof(port), "%d", getConnectionPort(connectPort));
+
+    struct addrinfo *result = nullptr;
+    int error = getaddrinfo(connectServer, port, &hints, &result);
+    if (error != 0 || result == nullptr) {
+      supla_log(LOG_DEBUG,
+                "DNS lookup failed: %s (%s)",
+                connectServer,
+                gai_strerror(error));
+      return false;
+    }
+    memcpy(&serverAddr, result->ai_addr, result->ai_addrlen);
+    serverAddrLen = result->ai_addrlen;
+    freeaddrinfo(result);
+    return true;
+  }
+
+  ConnectPhaseResult connectSocket() {
+    if (sockFd < 0) {
+      sockFd = socket(serverAddr.ss_family,
+                      SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC,
+                      0);
+      if (sockFd < 0) {
+        supla_log(LOG_DEBUG, "Socket creation failed: %s", strerror(errno));
+        return CONNECT_PHASE_FAILED;
+      }
+      // Packets are already gathered by Network::flush()
+      int noDelay = 1;
+      setsockopt(sockFd, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+
+      if (::connect(sockFd,
+                    reinterpret_cast<sockaddr *>(&serverAddr),
+                    serverAddrLen) == 0) {
+        return CONNECT_PHASE_DONE;
+      }
+      if (errno != EINPROGRESS) {
+        supla_log(LOG_DEBUG, "Connect failed: %s", strerror(errno));
+        closeSocket();
+        return CONNECT_PHASE_FAILED;
+      }
+      return CONNECT_PHASE_IN_PROGRESS;
+    }
+
+    if (!waitForSocket(POLLOUT, 0)) {
+      return CONNECT_PHASE_IN_PROGRESS;
+    }
+    int error = 0;
+    socklen_t len = sizeof(error);
+    if (getsockopt(sockFd, SOL_SOCKET, SO_ERROR, &error, &len) != 0 ||
+        error != 0) {
+      supla_log(LOG_DEBUG, "Connect failed: %s", strerror(error));
+      closeSocket();
+      return CONNECT_PHASE_FAILED;
+    }
+    return CONNECT_PHASE_DONE;
+  }
+
+  ConnectPhaseResult handshake() {
+#ifdef SUPLA_LINUX_OPENSSL
+    if (ssl == nullptr) {
+      if (sslCtx == nullptr && !initSslContext()) {
+        return CONNECT_PHASE_FAILED;
+      }
+      ssl = SSL_new(sslCtx);
+      if (ssl == nullptr) {
+        return CONNECT_PHASE_FAILED;
+      }
+      SSL_set_fd(ssl, sockFd);
+      SSL_set_tlsext_host_name(ssl, connectServer);
+      if (caFile) {
+        SSL_set1_host(ssl, connectServer);
+      }
+    }
+
+    int result = SSL_connect(ssl);
+    if (result == 1) {
+      return CONNECT_PHASE_DONE;
+    }
+    int error = SSL_get_error(ssl, result);
+    if (error == SSL_ERROR_WANT_READ || error == SSL_ERROR_WANT_WRITE) {
+      return CONNECT_PHASE_IN_PROGRESS;
+    }
+    supla_log(LOG_DEBUG,
+              "TLS handshake failed: %s",
+              ERR_error_string(ERR_get_error(), nullptr));
+    closeSocket();
+#endif
+    return CONNECT_PHASE_FAILED;
+  }
+
+#ifdef SUPLA_LINUX_OPENSSL
+  bool initSslContext() {
+    sslCtx = SSL_CTX_new(TLS_client_method());
+    if (sslCtx == nullptr) {
+      return false;
+    }
+    if (caFile) {
+      if (SSL_CTX_load_verify_locations(sslCtx, caFile, nullptr) != 1) {
+        supla_log(LOG_DEBUG, "Can't load CA certificates: %s", caFile);
+        SSL_CTX_free(sslCtx);
+        sslCtx = nullptr;
+        return false;
+      }
+      SSL_CTX_set_verify(sslCtx, SSL_VERIFY_PEER, nullptr);
+    } else {
+      supla_log(LOG_DEBUG, "Server certificate is not verified");
+      SSL_CTX_set_verify(sslCtx, SSL_VERIFY_NONE, nullptr);
+    }
+    return true;
+  }
+#endif
+
+  bool waitForSocket(int events, int timeoutMs) {
+    if (sockFd < 0) {
+      return false;
+    }
+    struct pollfd pfd;
+    pfd.fd = sockFd;
+    pfd.events = events;
+    pfd.revents = 0;
+    return poll(&pfd, 1, timeoutMs) > 0;
+  }
+
+  void closeSocket() {
+#ifdef SUPLA_LINUX_OPENSSL
+    if (ssl) {
+      SSL_free(ssl);
+      ssl = nullptr;
+    }
+#endif
+    if (sockFd >= 0) {
+      close(sockFd);
+      sockFd = -1;
+    }
+  }
+
+  int sockFd;
+  bool isSecured;
+#ifdef SUPLA_LINUX_OPENSSL
+  SSL_CTX *sslCtx;
+  SSL *ssl;
+#endif
+  const char *caFile;
+  struct sockaddr_storage serverAddr;
+  socklen_t serverAddrLen;
+};
+
+};  // namespace Supla
+
+#endif
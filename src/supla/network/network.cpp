@@ -24,8 +24,6 @@
 
 namespace Supla {
 
-Network *Network::netIntf = NULL;
-
 _supla_int_t data_read(void *buf, _supla_int_t count, void *userParams) {
   (void)(userParams);
   return Supla::Network::Read(buf, count);
@@ -40,6 +38,17 @@ _supla_int_t data_write(void *buf, _supla_int_t count, void *userParams) {
   return r;
 }
 
+_supla_int_t data_writev(TsrpcDataVector *vec,
+                         _supla_int_t vecCount,
+                         void *userParams) {
+  (void)(userParams);
+  _supla_int_t r = Supla::Network::WriteV(vec, vecCount);
+  if (r > 0) {
+    Network::Instance()->updateLastSent();
+  }
+  return r;
+}
+
 void message_received(void *_srpc,
                       unsigned _supla_int_t rr_id,
                       unsigned _supla_int_t call_type,
@@ -151,8 +160,16 @@ Network::Network(unsigned char *ip) {
   lastPingTimeMs = 0;
   serverActivityTimeoutS = 30;
   lastResponseMs = 0;
+  txBufferSize = 0;
+  connectPhase = CONNECT_IDLE;
+  connectPhaseStarted = false;
+  connectPhaseStartMs = 0;
+  connectServer = nullptr;
+  connectPort = -1;
+  connectResult = 0;
 
-  netIntf = this;
+  context = DeviceContext::current();
+  context->network = this;
 
   if (ip == NULL) {
     useLocalIp = false;
@@ -163,13 +180,24 @@ Network::Network(unsigned char *ip) {
 }
 
 Network::~Network() {
-  netIntf = nullptr;
+  if (context->network == this) {
+    context->network = nullptr;
+  }
 }
 
 bool Network::iterate() {
   return false;
 }
 
+bool Network::hasData() {
+  return true;
+}
+
+bool Network::waitForData(unsigned long timeoutMs) {
+  (void)(timeoutMs);
+  return false;
+}
+
 void Network::updateLastSent() {
   lastSentMs = millis();
 }
@@ -194,6 +222,28 @@ bool Network::ping(void *srpc) {
   return true;
 }
 
+unsigned long Network::timeToNextPing(unsigned long ms) {
+  _supla_int64_t _millis = ms;
+  _supla_int64_t pingThresholdMs = (serverActivityTimeoutS - 5) * 1000;
+  _supla_int64_t lastActivityMs =
+      lastResponseMs < lastSentMs ? lastResponseMs : lastSentMs;
+
+  _supla_int64_t nextPingMs = lastActivityMs + pingThresholdMs;
+  if (nextPingMs < lastPingTimeMs + 5000) {
+    nextPingMs = lastPingTimeMs + 5000;
+  }
+  _supla_int64_t timeoutMs =
+      lastResponseMs + (serverActivityTimeoutS + 10) * 1000;
+  if (timeoutMs < nextPingMs) {
+    nextPingMs = timeoutMs;
+  }
+
+  if (nextPingMs <= _millis) {
+    return 0;
+  }
+  return nextPingMs - _millis;
+}
+
 void Network::clearTimeCounters() {
   _supla_int64_t currentTime = millis();
   lastSentMs = currentTime;
@@ -210,6 +260,127 @@ void Network::setTimeout(int timeoutMs) {
   supla_log(LOG_DEBUG, "setTimeout is not implemented for this interface");
 }
 
+int Network::writev(TsrpcDataVector *vec, int vecCount) {
+  int totalSize = 0;
+  for (int i = 0; i < vecCount; i++) {
+    totalSize += vec[i].count;
+  }
+
+  if (totalSize > SUPLA_NETWORK_TX_BUFFER_SIZE - txBufferSize) {
+    if (flush() < 0) {
+      return -1;
+    }
+  }
+
+  if (totalSize > SUPLA_NETWORK_TX_BUFFER_SIZE) {
+    for (int i = 0; i < vecCount; i++) {
+      if (write(vec[i].buf, vec[i].count) < 0) {
+        return -1;
+      }
+    }
+    return totalSize;
+  }
+
+  for (int i = 0; i < vecCount; i++) {
+    memcpy(txBuffer + txBufferSize, vec[i].buf, vec[i].count);
+    txBufferSize += vec[i].count;
+  }
+  return totalSize;
+}
+
+int Network::flush() {
+  if (txBufferSize == 0) {
+    return 0;
+  }
+  int size = txBufferSize;
+  txBufferSize = 0;
+  return write(txBuffer, size);
+}
+
+void Network::clearTxBuffer() {
+  txBufferSize = 0;
+}
+
+void Network::beginConnect(const char *server, int port) {
+  connectServer = server;
+  connectPort = port;
+  connectResult = 0;
+  connectPhase = CONNECT_DNS;
+  connectPhaseStarted = false;
+}
+
+int Network::pollConnect(unsigned long ms) {
+  while (connectPhase != CONNECT_IDLE && connectPhase != CONNECT_DONE) {
+    if (!connectPhaseStarted) {
+      connectPhaseStarted = true;
+      connectPhaseStartMs = ms;
+    }
+
+    ConnectPhaseResult result = runConnectPhase(connectPhase);
+
+    if (result == CONNECT_PHASE_IN_PROGRESS) {
+      if (ms - connectPhaseStartMs >= connectPhaseTimeoutMs(connectPhase)) {
+        supla_log(LOG_DEBUG, "Connection phase %d timeout", connectPhase);
+        connectPhase = CONNECT_IDLE;
+        abortConnect();
+        return -1;
+      }
+      return 0;
+    }
+
+    if (result == CONNECT_PHASE_FAILED) {
+      supla_log(LOG_DEBUG, "Connection phase %d failed", connectPhase);
+      connectPhase = CONNECT_IDLE;
+      abortConnect();
+      return connectResult < 0 ? connectResult : -1;
+    }
+
+    connectPhase = static_cast<ConnectPhase>(connectPhase + 1);
+    connectPhaseStarted = false;
+
+    if (result == CONNECT_PHASE_DONE && connectPhase != CONNECT_DONE) {
+      return 0;
+    }
+  }
+
+  if (connectPhase == CONNECT_DONE) {
+    connectPhase = CONNECT_IDLE;
+    return 1;
+  }
+  return -1;
+}
+
+bool Network::isConnecting() {
+  return connectPhase != CONNECT_IDLE;
+}
+
+ConnectPhaseResult Network::runConnectPhase(ConnectPhase phase) {
+  if (phase == CONNECT_TCP) {
+    connectResult = connect(connectServer, connectPort);
+    if (connectResult != 1) {
+      return CONNECT_PHASE_FAILED;
+    }
+  }
+  return CONNECT_PHASE_NEXT;
+}
+
+void Network::abortConnect() {
+  disconnect();
+}
+
+unsigned long Network::connectPhaseTimeoutMs(ConnectPhase phase) {
+  switch (phase) {
+    case CONNECT_DNS:
+      return SUPLA_CONNECT_DNS_TIMEOUT_MS;
+    case CONNECT_TCP:
+      return SUPLA_CONNECT_TCP_TIMEOUT_MS;
+    case CONNECT_TLS:
+      return SUPLA_CONNECT_TLS_TIMEOUT_MS;
+    default:
+      return 0;
+  }
+}
+
 void Network::fillStateData(TDSC_ChannelState &channelState) {
   (void)(channelState);
   supla_log(LOG_DEBUG, "fillStateData is not implemented for this interface");
@@ -19,12 +19,58 @@
 
 #include "supla-common/log.h"
 #include "supla-common/proto.h"
+#include "supla-common/srpc.h"
+#include "supla/device_context.h"
+
+// Outgoing data is gathered in transmit buffer and sent with one write() call
+// per SuplaDeviceClass::iterate()
+#ifndef SUPLA_NETWORK_TX_BUFFER_SIZE
+#if defined(ARDUINO_ARCH_AVR)
+#define SUPLA_NETWORK_TX_BUFFER_SIZE 64
+#else
+#define SUPLA_NETWORK_TX_BUFFER_SIZE 1024
+#endif
+#endif
+
+// Time limits for each phase of connection to server
+#ifndef SUPLA_CONNECT_DNS_TIMEOUT_MS
+#define SUPLA_CONNECT_DNS_TIMEOUT_MS 4000
+#endif
+#ifndef SUPLA_CONNECT_TCP_TIMEOUT_MS
+#define SUPLA_CONNECT_TCP_TIMEOUT_MS 5000
+#endif
+#ifndef SUPLA_CONNECT_TLS_TIMEOUT_MS
+#define SUPLA_CONNECT_TLS_TIMEOUT_MS 10000
+#endif
 
 namespace Supla {
+
+// Phases of connection started by Network::beginConnect()
+enum ConnectPhase {
+  CONNECT_IDLE,
+  CONNECT_DNS,
+  CONNECT_TCP,
+  CONNECT_TLS,
+  CONNECT_DONE
+};
+
+// Results of Network::connectPhase()
+enum ConnectPhaseResult {
+  CONNECT_PHASE_FAILED = -1,
+  // phase is not finished, connectPhase() will be called again
+  CONNECT_PHASE_IN_PROGRESS = 0,
+  // phase is finished, next phase is started in next iteration
+  CONNECT_PHASE_DONE = 1,
+  // phase is finished or not used, next phase is started immediately
+  CONNECT_PHASE_NEXT = 2
+};
+
+// Network interface registers itself in DeviceContext which is current when
+// it is created. Static methods use interface of current context.
 class Network {
  public:
   static Network *Instance() {
-    return netIntf;
+    return DeviceContext::current()->network;
   }
 
   static bool Connected() {
@@ -43,7 +89,24 @@ class Network {
 
   static int Write(void *buf, int count) {
     if (Instance() != NULL) {
-      return Instance()->write(buf, count);
+      TsrpcDataVector vec;
+      vec.buf = buf;
+      vec.count = count;
+      return Instance()->writev(&vec, 1);
+    }
+    return -1;
+  }
+
+  static int WriteV(TsrpcDataVector *vec, int vecCount) {
+    if (Instance() != NULL) {
+      return Instance()->writev(vec, vecCount);
+    }
+    return -1;
+  }
+
+  static int Flush() {
+    if (Instance() != NULL) {
+      return Instance()->flush();
     }
     return -1;
   }
@@ -51,13 +114,38 @@ class Network {
   static int Connect(const char *server, int port = -1) {
     if (Instance() != NULL) {
       Instance()->clearTimeCounters();
+      Instance()->clearTxBuffer();
       return Instance()->connect(server, port);
     }
     return 0;
   }
 
+  static void BeginConnect(const char *server, int port = -1) {
+    if (Instance() != NULL) {
+      Instance()->clearTimeCounters();
+      Instance()->clearTxBuffer();
+      Instance()->beginConnect(server, port);
+    }
+  }
+
+  static int PollConnect(unsigned long ms) {
+    if (Instance() != NULL) {
+      return Instance()->pollConnect(ms);
+    }
+    return -1;
+  }
+
+  static bool IsConnecting() {
+    if (Instance() != NULL) {
+      return Instance()->isConnecting();
+    }
+    return false;
+  }
+
   static void Disconnect() {
     if (Instance() != NULL) {
+      Instance()->clearTxBuffer();
+      Instance()->connectPhase = CONNECT_IDLE;
       return Instance()->disconnect();
     }
     return;
@@ -97,6 +185,28 @@ class Network {
     return false;
   }
 
+  static bool HasData() {
+    if (Instance() != NULL) {
+      return Instance()->hasData();
+    }
+    return false;
+  }
+
+  static bool WaitForData(unsigned long timeoutMs) {
+    if (Instance() != NULL) {
+      return Instance()->waitForData(timeoutMs);
+    }
+    return false;
+  }
+
+  static bool TimeToNextPing(unsigned long ms, unsigned long *delayMs) {
+    if (Instance() != NULL) {
+      *delayMs = Instance()->timeToNextPing(ms);
+      return true;
+    }
+    return false;
+  }
+
   Network(uint8_t ip[4]);
   virtual ~Network();
   virtual int read(void *buf, int count) = 0;
@@ -109,10 +219,38 @@ class Network {
 
   virtual bool isReady() = 0;
   virtual bool iterate();
+  // Returns true when data received from server may be waiting to be read.
+  // SRPC input is processed only then. Interfaces which can't check it
+  // return true, so SRPC is polled on each iteration.
+  virtual bool hasData();
+  // Blocks for up to timeoutMs until data from server is available. Returns
+  // false when interface can't wait for data, so caller has to sleep in other
+  // way.
+  virtual bool waitForData(unsigned long timeoutMs);
   virtual bool ping(void *);
+  // Returns time left until ping() has to be called again to send keep alive
+  // message or to detect activity timeout
+  virtual unsigned long timeToNextPing(unsigned long ms);
 
   virtual void fillStateData(TDSC_ChannelState &channelState);
 
+  // Starts connection to server, which is then established by pollConnect()
+  // calls, one phase at a time, so main loop isn't blocked for DNS, TCP and
+  // TLS handshake at once.
+  virtual void beginConnect(const char *server, int port = -1);
+  // Returns 1 when connected, 0 when connection is in progress and value
+  // lower than 0 on failure or timeout. ms is current time, phase timeout is
+  // counted from the first call in that phase.
+  virtual int pollConnect(unsigned long ms);
+  bool isConnecting();
+
+  // Copies all buffers to transmit buffer. Data which doesn't fit in empty
+  // transmit buffer is written directly after buffered data is flushed.
+  virtual int writev(TsrpcDataVector *vec, int vecCount);
+  // Sends transmit buffer content with one write() call
+  virtual int flush();
+  void clearTxBuffer();
+
   void setSrpc(void *_srpc);
   void updateLastSent();
   void updateLastResponse();
@@ -120,21 +258,44 @@ class Network {
   void setActivityTimeout(_supla_int_t activityTimeoutSec);
 
  protected:
-  static Network *netIntf;
+  DeviceContext *context;
   _supla_int64_t lastSentMs;
   _supla_int64_t lastResponseMs;
   _supla_int64_t lastPingTimeMs;
   _supla_int_t serverActivityTimeoutS;
   void *srpc;
 
+  // Executes (part of) given connection phase. Default implementation calls
+  // blocking connect() in CONNECT_TCP phase and skips other phases.
+  virtual ConnectPhaseResult runConnectPhase(ConnectPhase phase);
+  // Called when connection phase fails or times out, to close partially
+  // established connection (i.e. socket with pending connect). Default
+  // implementation calls disconnect().
+  virtual void abortConnect();
+  unsigned long connectPhaseTimeoutMs(ConnectPhase phase);
+
+  ConnectPhase connectPhase;
+  bool connectPhaseStarted;
+  unsigned long connectPhaseStartMs;
+  const char *connectServer;
+  int connectPort;
+  int connectResult;
+
   bool useLocalIp;
   unsigned char localIp[4];
+
+  int txBufferSize;
+  char txBuffer[SUPLA_NETWORK_TX_BUFFER_SIZE];
 };
 
 // Method passed to SRPC as a callback to read raw data from network interface
 _supla_int_t data_read(void *buf, _supla_int_t count, void *sdc);
 // Method passed to SRPC as a callback to write raw data to network interface
 _supla_int_t data_write(void *buf, _supla_int_t count, void *sdc);
+// Method passed to SRPC as a callback to write packet with its tag
+_supla_int_t data_writev(TsrpcDataVector *vec,
+                         _supla_int_t vecCount,
+                         void *sdc);
 // Method passed to SRPC as a callback to handle response from Supla server
 void message_received(void *_srpc,
                       unsigned _supla_int_t rr_id,
@@ -33,6 +33,11 @@ Afore::Afore(IPAddress ip, int port, const char *loginAndPass)
       dataFetchInProgress(false),
       connectionTimeoutMs(0) {
   refreshRateSec = 15;
+  // Data is fetched by iterateAlways(), so periodic read task from
+  // ElectricityMeter is not used
+  cancelTask();
+  declareHook(HOOK_ITERATE_ALWAYS);
+  declareHook(HOOK_ITERATE_CONNECTED);
   int len = strlen(loginAndPass);
   if (len > LOGIN_AND_PASSOWORD_MAX_LENGTH) {
     len = LOGIN_AND_PASSOWORD_MAX_LENGTH;
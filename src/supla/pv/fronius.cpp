@@ -39,6 +39,11 @@ Fronius::Fronius(IPAddress ip, int port, int deviceId)
       dataFetchInProgress(false),
       connectionTimeoutMs(0) {
   refreshRateSec = 15;
+  // Data is fetched by iterateAlways(), so periodic read task from
+  // ElectricityMeter is not used
+  cancelTask();
+  declareHook(HOOK_ITERATE_ALWAYS);
+  declareHook(HOOK_ITERATE_CONNECTED);
 }
 
 void Fronius::iterateAlways() {
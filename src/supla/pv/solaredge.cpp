@@ -47,6 +47,11 @@ SolarEdge::SolarEdge(const char *apiKeyValue, const char *siteIdValue, const cha
 {
   // SolarEdge api allows 300 requests daily, so it is one request per almost 5 min
   refreshRateSec = 6*60; // refresh every 6 min
+  // Data is fetched by iterateAlways(), so periodic read task from
+  // ElectricityMeter is not used
+  cancelTask();
+  declareHook(HOOK_ITERATE_ALWAYS);
+  declareHook(HOOK_ITERATE_CONNECTED);
 
   int len = strlen(apiKeyValue);
   if (len > APIKEY_MAX_LENGTH) {
@@ -0,0 +1,78 @@
+/*
+ Copyright (C) AC SOFTWARE SP. Z O.O.
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+*/
+
+#include "reconnect_policy.h"
+
+namespace Supla {
+
+ReconnectPolicy::ReconnectPolicy()
+    : baseMs(SUPLA_RECONNECT_BASE_MS),
+      capMs(SUPLA_RECONNECT_CAP_MS),
+      multiplier(SUPLA_RECONNECT_MULTIPLIER),
+      ceilingMs(SUPLA_RECONNECT_BASE_MS),
+      failedAttempts(0),
+      randomState(1) {
+}
+
+void ReconnectPolicy::configure(unsigned long baseMs,
+                                unsigned long capMs,
+                                float multiplier) {
+  this->baseMs = baseMs;
+  this->capMs = capMs < baseMs ? baseMs : capMs;
+  this->multiplier = multiplier < 1 ? 1 : multiplier;
+  reset();
+}
+
+void ReconnectPolicy::seed(const char *data, int size) {
+  // FNV-1a
+  uint32_t hash = 2166136261u;
+  for (int i = 0; i < size; i++) {
+    hash ^= static_cast<uint8_t>(data[i]);
+    hash *= 16777619u;
+  }
+  // xorshift state can't be 0
+  randomState = hash != 0 ? hash : 1;
+}
+
+unsigned long ReconnectPolicy::nextDelayMs() {
+  unsigned long delayMs = nextRandom() % (ceilingMs + 1);
+
+  failedAttempts++;
+  if (ceilingMs < capMs) {
+    float next = ceilingMs * multiplier;
+    ceilingMs = next < capMs ? static_cast<unsigned long>(next) : capMs;
+  }
+  return delayMs;
+}
+
+void ReconnectPolicy::reset() {
+  ceilingMs = baseMs;
+  failedAttempts = 0;
+}
+
+int ReconnectPolicy::getFailedAttempts() {
+  return failedAttempts;
+}
+
+uint32_t ReconnectPolicy::nextRandom() {
+  // xorshift32
+  randomState ^= randomState << 13;
+  randomState ^= randomState >> 17;
+  randomState ^= randomState << 5;
+  return randomState;
+}
+
+};  // namespace Supla
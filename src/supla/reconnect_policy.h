@@ -0,0 +1,66 @@
+/*
+ Copyright (C) AC SOFTWARE SP. Z O.O.
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+*/
+
+#ifndef _reconnect_policy_h
+#define _reconnect_policy_h
+
+#include <stdint.h>
+
+#ifndef SUPLA_RECONNECT_BASE_MS
+#define SUPLA_RECONNECT_BASE_MS 2000
+#endif
+
+#ifndef SUPLA_RECONNECT_CAP_MS
+#define SUPLA_RECONNECT_CAP_MS 60000
+#endif
+
+#ifndef SUPLA_RECONNECT_MULTIPLIER
+#define SUPLA_RECONNECT_MULTIPLIER 2.0
+#endif
+
+namespace Supla {
+
+// Exponential backoff with full jitter for reconnection to server. Delay
+// before each attempt is drawn from [0, min(cap, base * multiplier^n)], where
+// n is number of failed attempts since last reset(). Random generator is
+// seeded from device GUID, so devices which lost connection at the same time
+// don't reconnect in lockstep.
+class ReconnectPolicy {
+ public:
+  ReconnectPolicy();
+
+  void configure(unsigned long baseMs, unsigned long capMs, float multiplier);
+  void seed(const char *data, int size);
+  // Returns delay before next attempt and increases backoff
+  unsigned long nextDelayMs();
+  // Called after successful registration
+  void reset();
+  int getFailedAttempts();
+
+ protected:
+  uint32_t nextRandom();
+
+  unsigned long baseMs;
+  unsigned long capMs;
+  float multiplier;
+  unsigned long ceilingMs;
+  int failedAttempts;
+  uint32_t randomState;
+};
+
+};  // namespace Supla
+
+#endif
@@ -0,0 +1,149 @@
+/*
+ Copyright (C) AC SOFTWARE SP. Z O.O.
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+*/
+
+#include <Arduino.h>
+
+#include "device_context.h"
+#include "scheduler.h"
+
+namespace {
+// millis() overflows, so deadlines are compared by signed difference
+inline bool isBefore(uint32_t a, uint32_t b) {
+  return static_cast<int32_t>(a - b) < 0;
+}
+};  // namespace
+
+namespace Supla {
+
+ScheduledTask::ScheduledTask()
+    : taskContext(DeviceContext::current()),
+      nextTaskPtr(nullptr),
+      taskDeadline(0),
+      taskPeriodMs(0),
+      taskScheduled(false) {
+}
+
+ScheduledTask::~ScheduledTask() {
+  cancelTask();
+}
+
+void ScheduledTask::scheduleTask(uint32_t delayMs, uint32_t periodMs) {
+  scheduleTaskAt(millis() + delayMs, periodMs);
+}
+
+void ScheduledTask::scheduleTaskAt(uint32_t deadlineMs, uint32_t periodMs) {
+  cancelTask();
+  taskDeadline = deadlineMs;
+  taskPeriodMs = periodMs;
+  Scheduler::add(this);
+}
+
+void ScheduledTask::cancelTask() {
+  if (taskScheduled) {
+    Scheduler::remove(this);
+  }
+}
+
+bool ScheduledTask::isTaskScheduled() {
+  return taskScheduled;
+}
+
+uint32_t ScheduledTask::getTaskDeadline() {
+  return taskDeadline;
+}
+
+void Scheduler::add(ScheduledTask *task) {
+  DeviceContext *context = task->taskContext;
+  // Task scheduled again from runTask() for "now" will be executed in next
+  // iteration, so runDueTasks() always ends
+  if (context->schedulerRunning &&
+      !isBefore(context->schedulerRunningNow, task->taskDeadline)) {
+    task->taskDeadline = context->schedulerRunningNow + 1;
+  }
+  // tasks with equal deadline are executed in order of adding
+  ScheduledTask *&firstPtr = context->firstTask;
+  if (firstPtr == nullptr ||
+      isBefore(task->taskDeadline, firstPtr->taskDeadline)) {
+    task->nextTaskPtr = firstPtr;
+    firstPtr = task;
+  } else {
+    auto ptr = firstPtr;
+    while (ptr->nextTaskPtr != nullptr &&
+           !isBefore(task->taskDeadline, ptr->nextTaskPtr->taskDeadline)) {
+      ptr = ptr->nextTaskPtr;
+    }
+    task->nextTaskPtr = ptr->nextTaskPtr;
+    ptr->nextTaskPtr = task;
+  }
+  task->taskScheduled = true;
+}
+
+void Scheduler::remove(ScheduledTask *task) {
+  ScheduledTask *&firstPtr = task->taskContext->firstTask;
+  if (firstPtr == task) {
+    firstPtr = task->nextTaskPtr;
+  } else {
+    for (auto ptr = firstPtr; ptr != nullptr; ptr = ptr->nextTaskPtr) {
+      if (ptr->nextTaskPtr == task) {
+        ptr->nextTaskPtr = task->nextTaskPtr;
+        break;
+      }
+    }
+  }
+  task->nextTaskPtr = nullptr;
+  task->taskScheduled = false;
+}
+
+ScheduledTask *Scheduler::first() {
+  return DeviceContext::current()->firstTask;
+}
+
+void Scheduler::runDueTasks(uint32_t now) {
+  DeviceContext *context = DeviceContext::current();
+  ScheduledTask *&firstPtr = context->firstTask;
+  context->schedulerRunningNow = now;
+  context->schedulerRunning = true;
+  while (firstPtr != nullptr && !isBefore(now, firstPtr->taskDeadline)) {
+    auto task = firstPtr;
+    remove(task);
+    if (task->taskPeriodMs > 0) {
+      task->taskDeadline += task->taskPeriodMs;
+      // don't try to catch up with missed executions
+      if (!isBefore(now, task->taskDeadline)) {
+        task->taskDeadline = now + task->taskPeriodMs;
+      }
+      add(task);
+    }
+    task->runTask();
+    delay(0);
+  }
+  context->schedulerRunning = false;
+}
+
+bool Scheduler::getTimeToNextTask(uint32_t now, uint32_t *delayMs) {
+  ScheduledTask *firstPtr = DeviceContext::current()->firstTask;
+  if (firstPtr == nullptr) {
+    return false;
+  }
+  if (isBefore(now, firstPtr->taskDeadline)) {
+    *delayMs = firstPtr->taskDeadline - now;
+  } else {
+    *delayMs = 0;
+  }
+  return true;
+}
+
+};  // namespace Supla
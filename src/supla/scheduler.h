@@ -0,0 +1,78 @@
+/*
+ Copyright (C) AC SOFTWARE SP. Z O.O.
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+*/
+
+#ifndef _scheduler_h
+#define _scheduler_h
+
+#include <stdint.h>
+
+namespace Supla {
+
+class DeviceContext;
+
+// Task executed by Scheduler from SuplaDeviceClass::iterate() when its
+// deadline is reached. Periodic tasks are rescheduled automatically before
+// runTask() is called, so runTask() may reschedule or cancel its own task.
+// Tasks should be scheduled only from main loop context (not from timer
+// callbacks). Task is scheduled in DeviceContext which was current when it
+// was created.
+class ScheduledTask {
+ public:
+  ScheduledTask();
+  virtual ~ScheduledTask();
+
+  // Schedules task to be run after delayMs from now. periodMs == 0 means
+  // one-shot task.
+  void scheduleTask(uint32_t delayMs, uint32_t periodMs = 0);
+  // Schedules task at absolute millis() time
+  void scheduleTaskAt(uint32_t deadlineMs, uint32_t periodMs = 0);
+  void cancelTask();
+  bool isTaskScheduled();
+  uint32_t getTaskDeadline();
+
+  virtual void runTask() = 0;
+
+ protected:
+  DeviceContext *taskContext;
+  ScheduledTask *nextTaskPtr;
+  uint32_t taskDeadline;
+  uint32_t taskPeriodMs;
+  bool taskScheduled;
+
+  friend class Scheduler;
+};
+
+// List of scheduled tasks sorted by deadline. Only tasks at the beginning of
+// the list are visited during iteration. List is kept in DeviceContext of
+// the task; first(), runDueTasks() and getTimeToNextTask() use current
+// context.
+class Scheduler {
+ public:
+  static void add(ScheduledTask *task);
+  static void remove(ScheduledTask *task);
+  static ScheduledTask *first();
+
+  // Runs all tasks with deadline before or equal to "now"
+  static void runDueTasks(uint32_t now);
+
+  // Returns false when there is no scheduled task. Otherwise delayMs is set
+  // to time left until next deadline (0 when some task is overdue).
+  static bool getTimeToNextTask(uint32_t now, uint32_t *delayMs);
+};
+
+};  // namespace Supla
+
+#endif
@@ -78,13 +78,6 @@ class DHT: public ThermHygroMeter {
       return value;
     }
 
-    void iterateAlways() {
-      if (lastReadTime + 10000 < millis()) {
-        lastReadTime = millis();
-        channel.setNewValue(getTemp(), getHumi());
-      }
-    }
-
     void onInit() {
       channel.setNewValue(getTemp(), getHumi());
     }
@@ -137,18 +137,28 @@ class DS18B20 : public Thermometer {
     } else {
       memcpy(address, deviceAddress, 8);
     }
+    // runTask() reschedules itself on request/read phases of the bus
+    scheduleTask(10000);
   }
 
-  void iterateAlways() {
-    if (myBus->lastReadTime + 10000 < millis()) {
+  // Conversion is requested every 10 s (once for all sensors on the same bus)
+  // and temperature is read 5 s after the request
+  void runTask() {
+    unsigned long now = millis();
+    if (now - myBus->lastReadTime >= 10000) {
       myBus->sensors.requestTemperatures();
-      myBus->lastReadTime = millis();
+      myBus->lastReadTime = now;
     }
-    if (myBus->lastReadTime + 5000 < millis() &&
-        (lastReadTime != myBus->lastReadTime)) {
+    if (lastReadTime != myBus->lastReadTime &&
+        now - myBus->lastReadTime >= 5000) {
       channel.setNewValue(getValue());
       lastReadTime = myBus->lastReadTime;
     }
+    if (lastReadTime != myBus->lastReadTime) {
+      scheduleTaskAt(myBus->lastReadTime + 5000);
+    } else {
+      scheduleTaskAt(myBus->lastReadTime + 10000);
+    }
   }
 
   double getValue() {
@@ -45,12 +45,10 @@ class SHT3x : public ThermHygroMeter {
   }
 
  private:
-  void iterateAlways() {
-    if (millis() - lastReadTime > 10000) {
-      lastReadTime = millis();
-      readValuesFromDevice();
-      channel.setNewValue(getTemp(), getHumi());
-    }
+  void runTask() {
+    lastReadTime = millis();
+    readValuesFromDevice();
+    channel.setNewValue(getTemp(), getHumi());
   }
 
   void onInit() {
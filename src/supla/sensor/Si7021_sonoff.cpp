@@ -33,12 +33,10 @@ double Si7021Sonoff::getHumi() {
   return humidity;
 }
 
-void Si7021Sonoff::iterateAlways() {
-  if (millis() - lastReadTime > 10000) {
-    lastReadTime = millis();
-    read();
-    channel.setNewValue(getTemp(), getHumi());
-  }
+void Si7021Sonoff::runTask() {
+  lastReadTime = millis();
+  read();
+  channel.setNewValue(getTemp(), getHumi());
 }
 
 void Si7021Sonoff::onInit() {
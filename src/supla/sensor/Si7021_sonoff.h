@@ -30,7 +30,7 @@ class Si7021Sonoff : public ThermHygroMeter {
   double getHumi();
 
  private:
-  void iterateAlways();
+  void runTask();
   void onInit();
   double readTemp(uint8_t* data);
   double readHumi(uint8_t* data);
@@ -20,6 +20,8 @@
 Supla::Sensor::Binary::Binary(int pin, bool pullUp = false)
     : pin(pin), pullUp(pullUp), lastReadTime(0) {
   channel.setType(SUPLA_CHANNELTYPE_SENSORNO);
+  declareHook(HOOK_NONE);
+  scheduleTask(100, 100);
 }
 
 bool Supla::Sensor::Binary::getValue() {
@@ -27,11 +29,9 @@ bool Supla::Sensor::Binary::getValue() {
                                                                         : true;
 }
 
-void Supla::Sensor::Binary::iterateAlways() {
-  if (lastReadTime + 100 < millis()) {
-    lastReadTime = millis();
-    channel.setNewValue(getValue());
-  }
+void Supla::Sensor::Binary::runTask() {
+  lastReadTime = millis();
+  channel.setNewValue(getValue());
 }
 
 void Supla::Sensor::Binary::onInit() {
@@ -20,14 +20,15 @@
 #include <Arduino.h>
 
 #include "../channel_element.h"
+#include "../scheduler.h"
 
 namespace Supla {
 namespace Sensor {
-class Binary : public ChannelElement {
+class Binary : public ChannelElement, public ScheduledTask {
  public:
   Binary(int pin, bool pullUp);
   bool getValue();
-  void iterateAlways();
+  void runTask();
   void onInit();
 
  protected:
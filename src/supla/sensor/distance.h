@@ -18,28 +18,29 @@
 #define _distance_h
 
 #include "supla/channel_element.h"
+#include "supla/scheduler.h"
 
 #define DISTANCE_NOT_AVAILABLE -1.0
 
 namespace Supla {
 namespace Sensor {
-class Distance : public ChannelElement {
+class Distance : public ChannelElement, public ScheduledTask {
  public:
   Distance() : lastReadTime(0) {
     channel.setType(SUPLA_CHANNELTYPE_DISTANCESENSOR);
     channel.setDefault(SUPLA_CHANNELFNC_DISTANCESENSOR);
     channel.setNewValue(DISTANCE_NOT_AVAILABLE);
+    declareHook(HOOK_NONE);
+    scheduleTask(100, 100);
   }
 
   virtual double getValue() {
     return DISTANCE_NOT_AVAILABLE;
   }
 
-  void iterateAlways() {
-    if (lastReadTime + 100 < millis()) {
-      lastReadTime = millis();
-      channel.setNewValue(getValue());
-    }
+  void runTask() {
+    lastReadTime = millis();
+    channel.setNewValue(getValue());
   }
 
  protected:
@@ -24,6 +24,8 @@ Supla::Sensor::ElectricityMeter::ElectricityMeter()
   extChannel.setDefault(SUPLA_CHANNELFNC_ELECTRICITY_METER);
   memset(&emValue, 0, sizeof(emValue));
   emValue.period = 5;
+  declareHook(HOOK_NONE);
+  scheduleTask(refreshRateSec * 1000, refreshRateSec * 1000);
   for (int i = 0; i < MAX_PHASES; i++) {
     rawCurrent[i] = 0;
   }
@@ -233,12 +235,10 @@ void Supla::Sensor::ElectricityMeter::readValuesFromDevice() {
 void Supla::Sensor::ElectricityMeter::onInit() {
 }
 
-void Supla::Sensor::ElectricityMeter::iterateAlways() {
-  if (millis() - lastReadTime > refreshRateSec*1000) {
-    lastReadTime = millis();
-    readValuesFromDevice();
-    updateChannelValues();
-  }
+void Supla::Sensor::ElectricityMeter::runTask() {
+  lastReadTime = millis();
+  readValuesFromDevice();
+  updateChannelValues();
 }
 
 // Implement this method to reset stored energy value (i.e. to set energy
@@ -255,6 +255,12 @@ void Supla::Sensor::ElectricityMeter::setResreshRate(unsigned int sec) {
   if (refreshRateSec == 0) {
     refreshRateSec = 1;
   }
+  if (isTaskScheduled()) {
+    // new period is counted from last read
+    uint32_t periodMs = refreshRateSec * 1000;
+    uint32_t elapsedMs = millis() - lastReadTime;
+    scheduleTask(elapsedMs < periodMs ? periodMs - elapsedMs : 0, periodMs);
+  }
 }
 
 
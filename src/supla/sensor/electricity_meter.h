@@ -21,13 +21,14 @@
 
 #include "../channel_extended.h"
 #include "../element.h"
+#include "../scheduler.h"
 #include <supla-common/srpc.h>
 
 #define MAX_PHASES 3
 
 namespace Supla {
 namespace Sensor {
-class ElectricityMeter : public Element {
+class ElectricityMeter : public Element, public ScheduledTask {
  public:
   ElectricityMeter();
 
@@ -72,7 +73,7 @@ class ElectricityMeter : public Element {
   void resetReadParameters();
 
   // Please implement this class for reading value from elecricity meter device.
-  // It will be called every 5 s. Use set methods defined above in order to
+  // It will be called every refreshRateSec (5 s by default). Use set methods defined above in order to
   // set values on channel. Don't use any other method to modify channel values.
   virtual void readValuesFromDevice();
 
@@ -84,7 +85,8 @@ class ElectricityMeter : public Element {
   // updateChannelValues();
   void onInit();
 
-  void iterateAlways();
+  // Called by scheduler every refreshRateSec
+  void runTask();
 
   // Implement this method to reset stored energy value (i.e. to set energy
   // counter back to 0 kWh
@@ -18,22 +18,24 @@
 #define _general_purpose_measurement_h
 
 #include "supla/channel_element.h"
+#include "supla/scheduler.h"
 
 namespace Supla {
 namespace Sensor {
-class GeneralPurposeMeasurementBase : public ChannelElement {
+class GeneralPurposeMeasurementBase : public ChannelElement,
+                                      public ScheduledTask {
  public:
    GeneralPurposeMeasurementBase() : lastReadTime(0) {
      channel.setType(SUPLA_CHANNELTYPE_GENERAL_PURPOSE_MEASUREMENT);
+     declareHook(HOOK_NONE);
+     scheduleTask(1000, 1000);
    }
 
   virtual double getValue() = 0;
 
-  void iterateAlways() {
-    if (lastReadTime + 1000 < millis()) {
-      lastReadTime = millis();
-      channel.setNewValue(getValue());
-    }
+  void runTask() {
+    lastReadTime = millis();
+    channel.setNewValue(getValue());
   }
 
  protected:
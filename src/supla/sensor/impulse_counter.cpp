@@ -35,6 +35,9 @@ ImpulseCounter::ImpulseCounter(int _impulsePin,
       inputPullup(_inputPullup),
       counter(0) {
   channel.setType(SUPLA_CHANNELTYPE_IMPULSE_COUNTER);
+  declareHook(HOOK_ON_FAST_TIMER);
+  declareHook(HOOK_ON_SAVE_STATE);
+  enableStateChangeTracking();
 
   prevState = (detectLowToHigh == true ? LOW : HIGH);
 
@@ -76,6 +79,7 @@ void ImpulseCounter::onLoadState() {
 void ImpulseCounter::setCounter(unsigned _supla_int64_t value) {
   counter = value;
   channel.setNewValue(value);
+  markStateChanged();
   supla_log(LOG_DEBUG,
             "ImpulseCounter[%d] - set counter to %d",
             channel.getChannelNumber(),
@@ -85,6 +89,7 @@ void ImpulseCounter::setCounter(unsigned _supla_int64_t value) {
 void ImpulseCounter::incCounter() {
   counter++;
   channel.setNewValue(getCounter());
+  markStateChanged();
 }
 
 void ImpulseCounter::onFastTimer() {
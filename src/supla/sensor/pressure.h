@@ -18,28 +18,29 @@
 #define _pressure_h
 
 #include "supla/channel_element.h"
+#include "supla/scheduler.h"
 
 #define PRESSURE_NOT_AVAILABLE -1
 
 namespace Supla {
 namespace Sensor {
-class Pressure : public ChannelElement {
+class Pressure : public ChannelElement, public ScheduledTask {
  public:
   Pressure() : lastReadTime(0) {
     channel.setType(SUPLA_CHANNELTYPE_PRESSURESENSOR);
     channel.setDefault(SUPLA_CHANNELFNC_PRESSURESENSOR);
     channel.setNewValue(PRESSURE_NOT_AVAILABLE);
+    declareHook(HOOK_NONE);
+    scheduleTask(10000, 10000);
   }
 
   virtual double getValue() {
     return PRESSURE_NOT_AVAILABLE;
   }
 
-  void iterateAlways() {
-    if (lastReadTime + 10000 < millis()) {
-      lastReadTime = millis();
-      channel.setNewValue(getValue());
-    }
+  void runTask() {
+    lastReadTime = millis();
+    channel.setNewValue(getValue());
   }
 
  protected:
@@ -18,28 +18,29 @@
 #define _rain_h
 
 #include "supla/channel_element.h"
+#include "supla/scheduler.h"
 
 #define RAIN_NOT_AVAILABLE -1
 
 namespace Supla {
 namespace Sensor {
-class Rain: public ChannelElement {
+class Rain: public ChannelElement, public ScheduledTask {
  public:
   Rain() : lastReadTime(0) {
     channel.setType(SUPLA_CHANNELTYPE_RAINSENSOR);
     channel.setDefault(SUPLA_CHANNELFNC_RAINSENSOR);
     channel.setNewValue(RAIN_NOT_AVAILABLE);
+    declareHook(HOOK_NONE);
+    scheduleTask(10000, 10000);
   }
 
   virtual double getValue() {
     return RAIN_NOT_AVAILABLE;
   }
 
-  void iterateAlways() {
-    if (lastReadTime + 10000 < millis()) {
-      lastReadTime = millis();
-      channel.setNewValue(getValue());
-    }
+  void runTask() {
+    lastReadTime = millis();
+    channel.setNewValue(getValue());
   }
 
  protected:
@@ -29,9 +29,7 @@ double Supla::Sensor::ThermHygroMeter::getHumi() {
   return HUMIDITY_NOT_AVAILABLE;
 }
 
-void Supla::Sensor::ThermHygroMeter::iterateAlways() {
-  if (millis() - lastReadTime > 10000) {
-    lastReadTime = millis();
-    channel.setNewValue(getTemp(), getHumi());
-  }
+void Supla::Sensor::ThermHygroMeter::runTask() {
+  lastReadTime = millis();
+  channel.setNewValue(getTemp(), getHumi());
 }
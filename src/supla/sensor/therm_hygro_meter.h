@@ -28,7 +28,7 @@ class ThermHygroMeter : public Thermometer {
   ThermHygroMeter();
   virtual double getTemp();
   virtual double getHumi();
-  void iterateAlways();
+  void runTask();
 
 };
 
@@ -27,26 +27,9 @@ double Supla::Sensor::ThermHygroPressMeter::getPressure() {
   return PRESSURE_NOT_AVAILABLE;
 }
 
-void Supla::Sensor::ThermHygroPressMeter::iterateAlways() {
-  if (millis() - lastReadTime > 10000) {
-    pressureChannel.setNewValue(getPressure());
-  }
-  ThermHygroMeter::iterateAlways();
-}
-
-bool Supla::Sensor::ThermHygroPressMeter::iterateConnected(void *srpc) {
-  bool response = true;
-  if (pressureChannel.isUpdateReady() &&
-      millis() - pressureChannel.lastCommunicationTimeMs > 100) {
-    pressureChannel.lastCommunicationTimeMs = millis();
-    pressureChannel.sendUpdate(srpc);
-    response = false;
-  }
-
-  if (!Element::iterateConnected(srpc)) {
-    response = false;
-  }
-  return response;
+void Supla::Sensor::ThermHygroPressMeter::runTask() {
+  pressureChannel.setNewValue(getPressure());
+  ThermHygroMeter::runTask();
 }
 
 Supla::Element &Supla::Sensor::ThermHygroPressMeter::disableChannelState() {
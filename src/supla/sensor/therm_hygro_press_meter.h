@@ -27,8 +27,7 @@ class ThermHygroPressMeter : public ThermHygroMeter {
  public:
   ThermHygroPressMeter();
   virtual double getPressure();
-  void iterateAlways();
-  bool iterateConnected(void *srpc);
+  void runTask();
   Element &disableChannelState();
   Channel *getSecondaryChannel();
 
@@ -19,16 +19,16 @@
 Supla::Sensor::Thermometer::Thermometer() : lastReadTime(0) {
   channel.setType(SUPLA_CHANNELTYPE_THERMOMETER);
   channel.setDefault(SUPLA_CHANNELFNC_THERMOMETER);
+  declareHook(HOOK_NONE);
+  scheduleTask(10000, 10000);
 }
 
 double Supla::Sensor::Thermometer::getValue() {
   return TEMPERATURE_NOT_AVAILABLE;
 }
 
-void Supla::Sensor::Thermometer::iterateAlways() {
-  if (millis() - lastReadTime > 10000) {
-    lastReadTime = millis();
-    channel.setNewValue(getValue());
-  }
+void Supla::Sensor::Thermometer::runTask() {
+  lastReadTime = millis();
+  channel.setNewValue(getValue());
 }
 
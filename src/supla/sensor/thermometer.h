@@ -19,16 +19,19 @@
 
 #include <Arduino.h>
 #include "supla/channel_element.h"
+#include "supla/scheduler.h"
 
 #define TEMPERATURE_NOT_AVAILABLE -275
 
 namespace Supla {
 namespace Sensor {
-class Thermometer : public ChannelElement {
+// Value is read every 10 s by scheduler. Derived classes which need
+// different read procedure should override runTask().
+class Thermometer : public ChannelElement, public ScheduledTask {
  public:
   Thermometer();
   virtual double getValue();
-  void iterateAlways();
+  void runTask();
 
  protected:
   unsigned long lastReadTime;
@@ -21,17 +21,17 @@ namespace Sensor {
 
 VirtualBinary::VirtualBinary() : state(false), lastReadTime(0) {
   channel.setType(SUPLA_CHANNELTYPE_SENSORNO);
+  declareHook(HOOK_NONE);
+  scheduleTask(100, 100);
 }
 
 bool VirtualBinary::getValue() {
   return state;
 }
 
-void VirtualBinary::iterateAlways() {
-  if (millis() - lastReadTime > 100) {
-    lastReadTime = millis();
-    channel.setNewValue(getValue());
-  }
+void VirtualBinary::runTask() {
+  lastReadTime = millis();
+  channel.setNewValue(getValue());
 }
 
 void VirtualBinary::onInit() {
@@ -22,14 +22,17 @@
 #include "../channel_element.h"
 #include "../action_handler.h"
 #include "../actions.h"
+#include "../scheduler.h"
 
 namespace Supla {
 namespace Sensor {
-class VirtualBinary : public ChannelElement, public ActionHandler {
+class VirtualBinary : public ChannelElement,
+                      public ActionHandler,
+                      public ScheduledTask {
  public:
   VirtualBinary();
   bool getValue();
-  void iterateAlways();
+  void runTask();
   void onInit();
   void handleAction(int event, int action);
 
@@ -18,29 +18,30 @@
 #define _weight_h
 
 #include "supla/channel_element.h"
+#include "supla/scheduler.h"
 #include "supla/element.h"
 
 #define WEIGHT_NOT_AVAILABLE -1
 
 namespace Supla {
 namespace Sensor {
-class Weight : public ChannelElement {
+class Weight : public ChannelElement, public ScheduledTask {
  public:
   Weight() : lastReadTime(0) {
     channel.setType(SUPLA_CHANNELTYPE_WEIGHTSENSOR);
     channel.setDefault(SUPLA_CHANNELFNC_WEIGHTSENSOR);
     channel.setNewValue(WEIGHT_NOT_AVAILABLE);
+    declareHook(HOOK_NONE);
+    scheduleTask(10000, 10000);
   }
 
   virtual double getValue() {
     return WEIGHT_NOT_AVAILABLE;
   }
 
-  void iterateAlways() {
-    if (lastReadTime + 10000 < millis()) {
-      lastReadTime = millis();
-      channel.setNewValue(getValue());
-    }
+  void runTask() {
+    lastReadTime = millis();
+    channel.setNewValue(getValue());
   }
 
  protected:
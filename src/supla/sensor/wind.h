@@ -18,28 +18,29 @@
 #define _wind_h
 
 #include "supla/channel_element.h"
+#include "supla/scheduler.h"
 
 #define WIND_NOT_AVAILABLE -1
 
 namespace Supla {
 namespace Sensor {
-class Wind: public ChannelElement {
+class Wind: public ChannelElement, public ScheduledTask {
  public:
   Wind() : lastReadTime(0) {
     channel.setType(SUPLA_CHANNELTYPE_WINDSENSOR);
     channel.setDefault(SUPLA_CHANNELFNC_WINDSENSOR);
     channel.setNewValue(WIND_NOT_AVAILABLE);
+    declareHook(HOOK_NONE);
+    scheduleTask(10000, 10000);
   }
 
   virtual double getValue() {
     return WIND_NOT_AVAILABLE;
   }
 
-  void iterateAlways() {
-    if (lastReadTime + 10000 < millis()) {
-      lastReadTime = millis();
-      channel.setNewValue(getValue());
-    }
+  void runTask() {
+    lastReadTime = millis();
+    channel.setNewValue(getValue());
   }
 
  protected:
@@ -16,9 +16,22 @@
 
 #include <Arduino.h>
 #include <EEPROM.h>
+#include <string.h>
+
+#if defined(__AVR__)
+#include <avr/eeprom.h>
+#endif
 
 #include "eeprom.h"
 
+#if defined(ARDUINO_ARCH_ESP8266)
+#define EEPROM_CONST_DATA_PTR() EEPROM.getConstDataPtr()
+#elif defined(ARDUINO_ARCH_ESP32)
+// getDataPtr() marks EEPROM as dirty, but commit() is called only after
+// content was changed
+#define EEPROM_CONST_DATA_PTR() EEPROM.getDataPtr()
+#endif
+
 using namespace Supla;
 
 // By default, write to EEPROM every 3 min
@@ -47,34 +60,73 @@ bool Eeprom::init() {
   return Storage::init();
 }
 
-int Eeprom::readStorage(unsigned int offset, unsigned char *buf, int size, bool logs) {
+int Eeprom::readStorage(unsigned int offset,
+                        unsigned char *buf,
+                        int size,
+                        bool logs) {
+#if defined(ARDUINO_ARCH_ESP8266) || defined(ARDUINO_ARCH_ESP32)
+  // EEPROM library keeps whole content in RAM, so it is copied directly
+  if (offset + size > EEPROM.length()) {
+    // callers don't check result, so they get zeros instead of stale data
+    memset(buf, 0, size);
+    return 0;
+  }
+  memcpy(buf, EEPROM_CONST_DATA_PTR() + offset, size);
+#elif defined(__AVR__)
+  eeprom_read_block(buf, reinterpret_cast<const void *>(offset), size);
+#else
+  for (int i = 0; i < size; i++) {
+    buf[i] = EEPROM.read(offset + i);
+  }
+#endif
+
+#ifdef SUPLA_STORAGE_DEBUG
   if (logs) {
     Serial.print(F("readStorage: "));
     Serial.print(size);
     Serial.print(F("; Read: ["));
-  }
-  for (int i = 0; i < size; i++) {
-    buf[i] = EEPROM.read(offset + i);
-    if (logs) {
-      Serial.print(static_cast<unsigned char *>(buf)[i], HEX);
+    for (int i = 0; i < size; i++) {
+      Serial.print(buf[i], HEX);
       Serial.print(F(" "));
     }
-  }
-  if (logs) {
     Serial.println(F("]"));
   }
+#else
+  (void)(logs);
+#endif
   return size;
 }
 
-int Eeprom::writeStorage(unsigned int offset, const unsigned char *buf, int size) {
+int Eeprom::writeStorage(unsigned int offset,
+                         const unsigned char *buf,
+                         int size) {
+#if defined(ARDUINO_ARCH_ESP8266) || defined(ARDUINO_ARCH_ESP32)
+  if (offset + size > EEPROM.length()) {
+    return 0;
+  }
+  // commit() rewrites whole flash sector, so it is done only when content
+  // was really changed
+  if (memcmp(EEPROM_CONST_DATA_PTR() + offset, buf, size) != 0) {
+    memcpy(EEPROM.getDataPtr() + offset, buf, size);
+    dataChanged = true;
+  }
+#elif defined(__AVR__)
+  // only bytes with different value are written
+  eeprom_update_block(buf, reinterpret_cast<void *>(offset), size);
   dataChanged = true;
+#else
   for (int i = 0; i < size; i++) {
     EEPROM.write(offset + i, buf[i]);
   }
+  dataChanged = true;
+#endif
+
+#ifdef SUPLA_STORAGE_DEBUG
   Serial.print(F("Wrote "));
   Serial.print(size);
   Serial.print(F(" bytes to storage at "));
   Serial.println(offset);
+#endif
   return size;
 }
 
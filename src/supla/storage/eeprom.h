@@ -17,6 +17,7 @@
 #ifndef _supla_eeprom_h
 #define _supla_eeprom_h
 
+#include "../supla_lib_config.h"
 #include "storage.h"
 
 namespace Supla {
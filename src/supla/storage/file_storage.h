@@ -0,0 +1,139 @@
+/*
+ Copyright (C) AC SOFTWARE SP. Z O.O.
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+*/
+
+
+#ifndef _supla_file_storage_h
+#define _supla_file_storage_h
+
+#include <Arduino.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "supla-common/log.h"
+#include "storage.h"
+
+#define SUPLA_FILE_STORAGE_SIZE 4096
+#define SUPLA_FILE_STORAGE_WRITING_PERIOD 1000
+
+namespace Supla {
+
+// Storage for native Linux builds. File is mapped to memory, so reads and
+// writes are plain memory copies and commit() flushes changed pages to disk.
+class FileStorage : public Storage {
+ public:
+  explicit FileStorage(const char *path,
+                       unsigned int size = SUPLA_FILE_STORAGE_SIZE,
+                       unsigned int storageStartingOffset = 0)
+      : Storage(storageStartingOffset),
+        path(path),
+        size(size),
+        data(nullptr),
+        dataChanged(false) {
+    setStateSavePeriod(SUPLA_FILE_STORAGE_WRITING_PERIOD);
+  }
+
+  ~FileStorage() {
+    if (data) {
+      commit();
+      munmap(data, size);
+    }
+  }
+
+  bool init() {
+    if (data == nullptr) {
+      int fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+      if (fd < 0) {
+        supla_log(LOG_DEBUG, "Storage: can't open %s (%s)", path,
+                  strerror(errno));
+        return false;
+      }
+      // New file is filled with zeros, so it doesn't contain valid preamble
+      struct stat fileStat;
+      if (fstat(fd, &fileStat) != 0 ||
+          (fileStat.st_size < static_cast<off_t>(size) &&
+           ftruncate(fd, size) != 0)) {
+        supla_log(LOG_DEBUG, "Storage: can't resize %s", path);
+        close(fd);
+        return false;
+      }
+      void *mapped =
+          mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+      close(fd);
+      if (mapped == MAP_FAILED) {
+        supla_log(LOG_DEBUG, "Storage: mmap failed (%s)", strerror(errno));
+        return false;
+      }
+      data = static_cast<unsigned char *>(mapped);
+      supla_log(LOG_DEBUG, "Storage: using file %s", path);
+    }
+
+    return Storage::init();
+  }
+
+  void commit() {
+    if (data && dataChanged) {
+      msync(data, size, MS_SYNC);
+    }
+    dataChanged = false;
+  }
+
+ protected:
+  int readStorage(unsigned int offset,
+                  unsigned char *buf,
+                  int count,
+                  bool logs) {
+    (void)(logs);
+    if (!isInRange(offset, count)) {
+      return 0;
+    }
+    memcpy(buf, data + offset, count);
+    return count;
+  }
+
+  int writeStorage(unsigned int offset, const unsigned char *buf, int count) {
+    if (!isInRange(offset, count)) {
+      return 0;
+    }
+    memcpy(data + offset, buf, count);
+    dataChanged = true;
+    return count;
+  }
+
+  bool isInRange(unsigned int offset, int count) {
+    if (data == nullptr || count < 0 || offset > size ||
+        static_cast<unsigned int>(count) > size - offset) {
+      supla_log(LOG_DEBUG,
+                "Storage: access out of range (offset %u, size %d)",
+                offset,
+                count);
+      return false;
+    }
+    return true;
+  }
+
+  const char *path;
+  unsigned int size;
+  unsigned char *data;
+  bool dataChanged;
+};
+
+};  // namespace Supla
+
+#endif
@@ -0,0 +1,69 @@
+/*
+ Copyright (C) AC SOFTWARE SP. Z O.O.
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+*/
+
+
+#ifndef _supla_flash_storage_h
+#define _supla_flash_storage_h
+
+#if defined(ARDUINO_ARCH_ESP8266) || defined(ARDUINO_ARCH_ESP32)
+
+#include <Arduino.h>
+
+#include "wear_leveling_storage.h"
+
+namespace Supla {
+
+// Wear leveled storage in raw flash sectors of ESP8266/ESP32. Unlike EEPROM
+// emulation, which erases the same sector on each commit, records are
+// appended in sectorCount sectors starting at flashAddress. Flash area has
+// to be reserved for this purpose (not used by sketch, OTA or file system).
+class FlashStorage : public WearLevelingStorage {
+ public:
+  FlashStorage(uint32_t flashAddress,
+               int sectorCount,
+               unsigned int size = 512,
+               unsigned int storageStartingOffset = 0)
+      : WearLevelingStorage(
+            size, SPI_FLASH_SEC_SIZE, sectorCount, storageStartingOffset),
+        flashAddress(flashAddress) {
+  }
+
+ protected:
+  bool readMedium(uint32_t address, unsigned char *buf, int size) {
+    return ESP.flashRead(flashAddress + address,
+                         reinterpret_cast<uint32_t *>(buf),
+                         size);
+  }
+
+  bool writeMedium(uint32_t address, const unsigned char *buf, int size) {
+    return ESP.flashWrite(
+        flashAddress + address,
+        reinterpret_cast<uint32_t *>(const_cast<unsigned char *>(buf)),
+        size);
+  }
+
+  bool eraseBlock(int block) {
+    return ESP.flashEraseSector(flashAddress / SPI_FLASH_SEC_SIZE + block);
+  }
+
+  uint32_t flashAddress;
+};
+
+};  // namespace Supla
+
+#endif
+
+#endif
@@ -22,9 +22,11 @@
 #ifndef _supla_fram_spi_h
 #define _supla_fram_spi_h
 
+#include <Arduino.h>
 #include <SPI.h>
 
 #include "Adafruit_FRAM_SPI.h"
+#include "../supla_lib_config.h"
 #include "storage.h"
 
 #define SUPLA_FRAM_WRITING_PERIOD 1000
@@ -62,21 +64,24 @@ class FramSpi : public Storage {
 
  protected:
   int readStorage(unsigned int offset, unsigned char *buf, int size, bool logs) {
+    // Sequential read of whole buffer in one SPI transaction
+    if (!fram.read(offset, buf, size)) {
+      return 0;
+    }
+#ifdef SUPLA_STORAGE_DEBUG
     if (logs) {
       Serial.print(F("readStorage: "));
       Serial.print(size);
       Serial.print(F("; Read: ["));
-    }
-    for (int i = 0; i < size; i++) {
-      buf[i] = fram.read8(offset + i);
-      if (logs) {
-        Serial.print(static_cast<unsigned char *>(buf)[i], HEX);
+      for (int i = 0; i < size; i++) {
+        Serial.print(buf[i], HEX);
         Serial.print(F(" "));
       }
-    }
-    if (logs) {
       Serial.println(F("]"));
     }
+#else
+    (void)(logs);
+#endif
     return size;
   }
 
@@ -84,10 +89,12 @@ class FramSpi : public Storage {
     fram.writeEnable(true);
     fram.write(offset, const_cast<uint8_t *>(buf), size);
     fram.writeEnable(false);
+#ifdef SUPLA_STORAGE_DEBUG
     Serial.print(F("Wrote "));
     Serial.print(size);
     Serial.print(F(" bytes to storage at "));
     Serial.println(offset);
+#endif
     return size;
   }
 
@@ -15,18 +15,20 @@
 */
 
 #include <Arduino.h>
+#include <stddef.h>
 #include <string.h>
 
 #include "storage.h"
+#include "supla/crc16.h"
+#include "supla/device_context.h"
+#include "supla/element.h"
 
 #define SUPLA_STORAGE_VERSION 1
 
 using namespace Supla;
 
-Storage *Storage::instance = nullptr;
-
 Storage *Storage::Instance() {
-  return instance;
+  return DeviceContext::current()->storage;
 }
 
 bool Storage::Init() {
@@ -78,6 +80,18 @@ bool Storage::FinalizeSaveState() {
   return false;
 }
 
+void Storage::SaveElementState(Element *element) {
+  if (Instance()) {
+    Instance()->saveElementState(element);
+  }
+}
+
+void Storage::LoadElementState(Element *element) {
+  if (Instance()) {
+    Instance()->loadElementState(element);
+  }
+}
+
 bool Storage::SaveStateAllowed(unsigned long ms) {
   if (Instance()) {
     return Instance()->saveStateAllowed(ms);
@@ -91,6 +105,14 @@ void Storage::ScheduleSave(unsigned long delayMs) {
   }
 }
 
+bool Storage::TimeToNextSave(unsigned long ms, unsigned long *delayMs) {
+  if (Instance()) {
+    *delayMs = Instance()->timeToNextSave(ms);
+    return true;
+  }
+  return false;
+}
+
 Storage::Storage(unsigned int storageStartingOffset)
     : storageStartingOffset(storageStartingOffset),
       deviceConfigOffset(0),
@@ -103,48 +125,131 @@ Storage::Storage(unsigned int storageStartingOffset)
       newSectionSize(0),
       sectionsCount(0),
       dryRun(false),
-      saveStatePeriod(1000), 
-      lastWriteTimestamp(0) {
-  instance = this;
+      stateLayoutKnown(false),
+      incrementalSave(false),
+      untrackedWrite(false),
+      stateWritten(false),
+      stateCrcOnly(false),
+      savedElement(nullptr),
+      stateCrc(0xFFFF),
+      stateSectionAB(false),
+      activeCopy(0),
+      saveCopy(0),
+      activeGeneration(0),
+      stateBase(0),
+      currentReadOffset(0),
+      saveStatePeriod(1000),
+      lastWriteTimestamp(0),
+      context(DeviceContext::current()) {
+  copyComplete[0] = false;
+  copyComplete[1] = false;
+  context->storage = this;
 }
 
 Storage::~Storage() {
-  instance = nullptr;
+  if (context->storage == this) {
+    context->storage = nullptr;
+  }
 }
 
 bool Storage::prepareState(bool performDryRun) {
   dryRun = performDryRun;
   newSectionSize = 0;
-  currentStateOffset = elementStateOffset + sizeof(SectionPreamble);
+  untrackedWrite = false;
+  stateWritten = false;
+  stateCrc = 0xFFFF;
+
+  if (stateSectionAB) {
+    currentReadOffset = stateCopyDataOffset(activeCopy);
+    saveCopy = activeGeneration == 0 ? activeCopy : 1 - activeCopy;
+  } else {
+    currentReadOffset = elementStateOffset + sizeof(SectionPreamble);
+    // Legacy section is converted by writing the second copy, which doesn't
+    // overlap with its data. New section starts with the first copy, as its
+    // offset doesn't depend on section size.
+    saveCopy = elementStateOffset != 0 ? 1 : 0;
+  }
+  stateBase = stateCopyDataOffset(saveCopy);
+  currentStateOffset = stateBase;
+
+  incrementalSave = !dryRun && stateLayoutKnown && stateSectionAB &&
+                    copyComplete[saveCopy] && elementStateOffset != 0;
   return true;
 }
 
+void Storage::saveElementState(Element *element) {
+  if (!incrementalSave) {
+    unsigned int start = newSectionSize;
+    if (!dryRun) {
+      element->stateChanged[saveCopy] = false;
+    }
+    savedElement = element;
+    element->onSaveState();
+    savedElement = nullptr;
+    element->stateOffset = start;
+    element->stateSize = newSectionSize - start;
+    return;
+  }
+
+  // Data of unchanged element is already in storage. It is collected only
+  // to calculate CRC of the whole copy, without reading it back.
+  bool changed =
+      !element->isStateChangeTracked() || element->stateChanged[saveCopy];
+  if (changed) {
+    // flag is cleared before data is collected, so change made meanwhile
+    // from timer callback is written in next save
+    element->stateChanged[saveCopy] = false;
+  }
+  currentStateOffset = stateBase + element->stateOffset;
+  unsigned int start = newSectionSize;
+  stateCrcOnly = !changed;
+  savedElement = element;
+  element->onSaveState();
+  savedElement = nullptr;
+  stateCrcOnly = false;
+  if (newSectionSize - start != element->stateSize) {
+    Serial.println(F("Warning! Element state size changed. Rewriting state"));
+    stateLayoutKnown = false;
+  }
+}
+
+void Storage::loadElementState(Element *element) {
+  element->onLoadState();
+  element->stateChanged[activeCopy] = false;
+}
+
 bool Storage::readState(unsigned char *buf, int size) {
-  if (elementStateOffset + sizeof(SectionPreamble) + elementStateSize <
-      currentStateOffset + size) {
+  unsigned int dataOffset = stateSectionAB
+                                ? stateCopyDataOffset(activeCopy)
+                                : elementStateOffset + sizeof(SectionPreamble);
+  if (dataOffset + elementStateSize < currentReadOffset + size) {
     Serial.println(F("Warning! Attempt to read state outside of section size"));
     return false;
   }
-  currentStateOffset += readStorage(currentStateOffset, buf, size);
+  currentReadOffset += readStorage(currentReadOffset, buf, size);
   return true;
 }
 
 bool Storage::writeState(const unsigned char *buf, int size) {
   newSectionSize += size;
+  if (savedElement == nullptr) {
+    untrackedWrite = true;
+  }
 
   if (size == 0) {
     return true;
   }
 
   if (elementStateSize > 0 &&
-      elementStateOffset + sizeof(SectionPreamble) + elementStateSize <
-          currentStateOffset + size) {
+      stateBase + elementStateSize < currentStateOffset + size) {
     Serial.println(
         F("Warning! Attempt to write state outside of section size."));
     Serial.println(
         F("Storage: rewriting element state section. All data will be lost."));
     elementStateSize = 0;
     elementStateOffset = 0;
+    stateSectionAB = false;
+    stateLayoutKnown = false;
     return false;
   }
 
@@ -153,6 +258,14 @@ bool Storage::writeState(const unsigned char *buf, int size) {
     return true;
   }
 
+  // CRC of copy is calculated from data in RAM. Elements are saved in the
+  // same order in which their data is stored.
+  stateCrc = crc16_update_block(stateCrc, buf, size);
+  if (stateCrcOnly) {
+    currentStateOffset += size;
+    return true;
+  }
+
   // Calculation of offset for section data - in case sector is missing
   if (elementStateOffset == 0) {
     Serial.print(F("Initialization of elementStateOffset: "));
@@ -165,7 +278,13 @@ bool Storage::writeState(const unsigned char *buf, int size) {
     }
     Serial.println(elementStateOffset);
 
-    currentStateOffset = elementStateOffset + sizeof(SectionPreamble);
+    stateSectionAB = false;
+    activeGeneration = 0;
+    copyComplete[0] = false;
+    copyComplete[1] = false;
+    saveCopy = 0;
+    stateBase = stateCopyDataOffset(saveCopy);
+    currentStateOffset = stateBase;
 
     sectionsCount++;
 
@@ -181,7 +300,14 @@ bool Storage::writeState(const unsigned char *buf, int size) {
         storageStartingOffset, (unsigned char *)&preamble, sizeof(preamble));
   }
 
-  currentStateOffset += updateStorage(currentStateOffset, buf, size);
+  if (incrementalSave) {
+    // Only changed elements are written, so there is no need to compare
+    // with current storage content
+    currentStateOffset += writeStorage(currentStateOffset, buf, size);
+  } else {
+    currentStateOffset += updateStorage(currentStateOffset, buf, size);
+  }
+  stateWritten = true;
 
   return true;
 }
@@ -193,27 +319,119 @@ bool Storage::finalizeSaveState() {
       Serial.println(
           F("Element state section size doesn't match current device "
             "configuration"));
-      elementStateOffset = 0;
-      elementStateSize = 0;
-      return false;
+    } else if (stateSectionAB && activeGeneration == 0) {
+      Serial.println(F("Element state section has no valid copy"));
+    } else {
+      stateLayoutKnown = !untrackedWrite;
+      // active copy matches current layout and is loaded to elements
+      copyComplete[activeCopy] = stateSectionAB;
+      return true;
     }
+    elementStateOffset = 0;
+    elementStateSize = 0;
+    stateSectionAB = false;
+    stateLayoutKnown = false;
+    return false;
+  }
+
+  if (elementStateOffset == 0) {
+    // nothing was written
     return true;
   }
 
-  SectionPreamble preamble;
-  preamble.type = STORAGE_SECTION_TYPE_ELEMENT_STATE;
-  preamble.size = newSectionSize;
-  preamble.crc1 = 0;
-  preamble.crc2 = 0;
-  // TODO add crc calculation
+  uint32_t generation = activeGeneration + 1;
+  if (generation == 0) {
+    generation = 1;
+  }
+
+  if (incrementalSave) {
+    incrementalSave = false;
+    if (untrackedWrite) {
+      stateLayoutKnown = false;
+    }
+    if (!stateLayoutKnown) {
+      // copy may be inconsistent, so it stays inactive until full save
+      copyComplete[saveCopy] = false;
+      return true;
+    }
+    if (stateWritten) {
+      writeStateCopyHeader(saveCopy, generation, stateCrc);
+      commit();
+      activeCopy = saveCopy;
+      activeGeneration = generation;
+    }
+    return true;
+  }
 
-  updateStorage(
-      elementStateOffset, (unsigned char *)&preamble, sizeof(preamble));
+  if (stateSectionAB && newSectionSize != elementStateSize) {
+    Serial.println(F("Warning! Element state size changed. Rewriting state"));
+    elementStateOffset = 0;
+    elementStateSize = 0;
+    stateSectionAB = false;
+    stateLayoutKnown = false;
+    return false;
+  }
+
+  elementStateSize = newSectionSize;
+  if (!stateSectionAB && saveCopy == 0) {
+    // second copy of new section is not valid yet
+    writeStateCopyHeader(1, 0, 0);
+  }
+  writeStateCopyHeader(saveCopy, generation, stateCrc);
+
+  if (!stateSectionAB) {
+    SectionPreamble preamble;
+    preamble.type = STORAGE_SECTION_TYPE_ELEMENT_STATE_AB;
+    preamble.size = 2 * (sizeof(StateCopyHeader) + elementStateSize);
+    // each copy has its own CRC
+    preamble.crc1 = 0;
+    preamble.crc2 = 0;
+    updateStorage(
+        elementStateOffset, (unsigned char *)&preamble, sizeof(preamble));
+    if (saveCopy == 1) {
+      // header of the first copy overlaps with data of legacy section
+      writeStateCopyHeader(0, 0, 0);
+    }
+    stateSectionAB = true;
+  }
 
   commit();
+  activeCopy = saveCopy;
+  activeGeneration = generation;
+  copyComplete[saveCopy] = true;
+  stateLayoutKnown = !untrackedWrite;
   return true;
 }
 
+unsigned int Storage::stateCopyDataOffset(int copy) {
+  return elementStateOffset + sizeof(SectionPreamble) +
+         sizeof(StateCopyHeader) +
+         copy * (sizeof(StateCopyHeader) + elementStateSize);
+}
+
+void Storage::writeStateCopyHeader(int copy,
+                                   uint32_t generation,
+                                   uint16_t crc) {
+  StateCopyHeader header;
+  header.generation = generation;
+  header.crc = crc;
+  writeStorage(stateCopyDataOffset(copy) - sizeof(StateCopyHeader),
+               reinterpret_cast<unsigned char *>(&header),
+               sizeof(header));
+}
+
+bool Storage::readStateCopyHeader(int copy, uint32_t *generation) {
+  StateCopyHeader header;
+  readStorage(stateCopyDataOffset(copy) - sizeof(StateCopyHeader),
+              reinterpret_cast<unsigned char *>(&header),
+              sizeof(header),
+              false);
+  *generation = header.generation;
+  return header.generation != 0 &&
+         calculateCrc(stateCopyDataOffset(copy), elementStateSize) ==
+             header.crc;
+}
+
 bool Storage::init() {
   Serial.println(F("Storage initialization"));
   unsigned int currentOffset = storageStartingOffset;
@@ -267,6 +485,17 @@ bool Storage::init() {
             "storage hardware"));
     }
 
+    // Sections written by previous versions have zeroed CRC fields. Copies in
+    // A/B state section are validated separately.
+    if (section.type != STORAGE_SECTION_TYPE_ELEMENT_STATE_AB &&
+        (section.crc1 != 0 || section.crc2 != 0) &&
+        calculateCrc(currentOffset, section.size) != section.crc1) {
+      Serial.println(
+          F("Warning! Section CRC doesn't match. Default values are used"));
+      currentOffset += section.size;
+      continue;
+    }
+
     switch (section.type) {
       case STORAGE_SECTION_TYPE_DEVICE_CONFIG: {
         deviceConfigOffset = sectionOffset;
@@ -281,6 +510,27 @@ bool Storage::init() {
       case STORAGE_SECTION_TYPE_ELEMENT_STATE: {
         elementStateOffset = sectionOffset;
         elementStateSize = section.size;
+        stateSectionAB = false;
+        break;
+      }
+      case STORAGE_SECTION_TYPE_ELEMENT_STATE_AB: {
+        elementStateOffset = sectionOffset;
+        elementStateSize = section.size / 2 - sizeof(StateCopyHeader);
+        stateSectionAB = true;
+        activeGeneration = 0;
+        for (int copy = 0; copy < 2; copy++) {
+          uint32_t generation = 0;
+          if (readStateCopyHeader(copy, &generation) &&
+              (activeGeneration == 0 ||
+               static_cast<int32_t>(generation - activeGeneration) > 0)) {
+            activeCopy = copy;
+            activeGeneration = generation;
+          }
+        }
+        Serial.print(F("Element state copy: "));
+        Serial.print(activeCopy);
+        Serial.print(F("; generation: "));
+        Serial.println(activeGeneration);
         break;
       }
       default: {
@@ -302,6 +552,19 @@ bool Storage::loadElementConfig() {
   return true;
 }
 
+uint16_t Storage::calculateCrc(unsigned int offset, unsigned int size) {
+  uint16_t crc = 0xFFFF;
+  unsigned char buf[32];
+  while (size > 0) {
+    int chunkSize = size > sizeof(buf) ? sizeof(buf) : size;
+    readStorage(offset, buf, chunkSize, false);
+    crc = crc16_update_block(crc, buf, chunkSize);
+    offset += chunkSize;
+    size -= chunkSize;
+  }
+  return crc;
+}
+
 int Storage::updateStorage(unsigned int offset, const unsigned char *buf, int size) {
   if (offset < storageStartingOffset) {
     return 0;
@@ -340,3 +603,12 @@ void Storage::scheduleSave(unsigned long delayMs) {
     lastWriteTimestamp = newTimestamp;
   }
 }
+
+unsigned long Storage::timeToNextSave(unsigned long ms) {
+  // state is saved when more than saveStatePeriod passed since last write
+  unsigned long elapsed = ms - lastWriteTimestamp;
+  if (elapsed > saveStatePeriod) {
+    return 0;
+  }
+  return saveStatePeriod - elapsed + 1;
+}
@@ -22,9 +22,21 @@
 #define STORAGE_SECTION_TYPE_DEVICE_CONFIG  1
 #define STORAGE_SECTION_TYPE_ELEMENT_CONFIG 2
 #define STORAGE_SECTION_TYPE_ELEMENT_STATE  3
+// Element state kept in two copies (A/B), each with its own header
+#define STORAGE_SECTION_TYPE_ELEMENT_STATE_AB 4
+
+// Max number of elements which save state in one iteration
+#ifndef SUPLA_STATE_SAVE_SLICE
+#define SUPLA_STATE_SAVE_SLICE 4
+#endif
 
 namespace Supla {
 
+class DeviceContext;
+class Element;
+
+// Storage registers itself in DeviceContext which is current when it is
+// created. Static methods use storage of current context.
 class Storage {
  public:
   static Storage *Instance();
@@ -35,8 +47,20 @@ class Storage {
   static bool LoadElementConfig();
   static bool PrepareState(bool dryRun = false);
   static bool FinalizeSaveState();
+  // Calls onSaveState() of element between PrepareState() and
+  // FinalizeSaveState() and records range of its data in state section.
+  // When all ranges are known and section is valid, only elements with
+  // changed state are written, directly at their offsets. Data of other
+  // elements is used only for CRC of the copy.
+  static void SaveElementState(Element *element);
+  // Calls onLoadState() of element. Loaded state matches storage content, so
+  // element is marked as not changed.
+  static void LoadElementState(Element *element);
   static bool SaveStateAllowed(unsigned long);
   static void ScheduleSave(unsigned long delayMs);
+  // Returns false when storage is not used. Otherwise delayMs is set to time
+  // left until next state save.
+  static bool TimeToNextSave(unsigned long ms, unsigned long *delayMs);
 
   Storage(unsigned int storageStartingOffset = 0);
   virtual ~Storage();
@@ -52,8 +76,11 @@ class Storage {
   virtual bool loadElementConfig();
   virtual bool prepareState(bool performDryRun);
   virtual bool finalizeSaveState();
+  virtual void saveElementState(Element *element);
+  virtual void loadElementState(Element *element);
   virtual bool saveStateAllowed(unsigned long);
   virtual void scheduleSave(unsigned long delayMs);
+  virtual unsigned long timeToNextSave(unsigned long ms);
 
   virtual void commit() = 0;
 
@@ -61,6 +88,12 @@ class Storage {
   virtual int readStorage(unsigned int, unsigned char *, int, bool = true) = 0;
   virtual int writeStorage(unsigned int, const unsigned char *, int) = 0;
   virtual int updateStorage(unsigned int, const unsigned char *, int);
+  // Calculates CRC of size bytes in storage starting at offset
+  uint16_t calculateCrc(unsigned int offset, unsigned int size);
+  // Offset of data of given copy in A/B element state section
+  unsigned int stateCopyDataOffset(int copy);
+  void writeStateCopyHeader(int copy, uint32_t generation, uint16_t crc);
+  bool readStateCopyHeader(int copy, uint32_t *generation);
 
   unsigned int storageStartingOffset;
   unsigned int deviceConfigOffset;
@@ -77,10 +110,39 @@ class Storage {
   int sectionsCount;
   bool dryRun;
 
+  // Element ranges recorded during last full save (or dry run) match state
+  // section, so changed elements can be written separately
+  bool stateLayoutKnown;
+  // State save in which only changed elements are written
+  bool incrementalSave;
+  // Set when state was written outside of saveElementState(), so element
+  // ranges are not known
+  bool untrackedWrite;
+  bool stateWritten;
+  // Element data is passed only to CRC calculation, as it is already stored
+  bool stateCrcOnly;
+  Element *savedElement;
+  // CRC of data saved in current copy, calculated from elements' data
+  uint16_t stateCrc;
+
+  // Element state is kept in two copies. Save writes the copy which is not
+  // active and its header is written last, so interrupted save leaves
+  // previous copy valid.
+  bool stateSectionAB;
+  uint8_t activeCopy;
+  uint8_t saveCopy;
+  // Generation of active copy, 0 when there is no valid copy
+  uint32_t activeGeneration;
+  // Copy was fully written with current layout, so only changed elements
+  // have to be written to it
+  bool copyComplete[2];
+  unsigned int stateBase;
+  unsigned int currentReadOffset;
+
   unsigned long saveStatePeriod;
   unsigned long lastWriteTimestamp;
 
-  static Storage *instance;
+  DeviceContext *context;
 };
 
 #pragma pack(push, 1)
@@ -96,6 +158,11 @@ struct SectionPreamble {
   uint16_t crc1;
   uint16_t crc2;
 };
+
+struct StateCopyHeader {
+  uint32_t generation;
+  uint16_t crc;
+};
 #pragma pack(pop)
 
 };  // namespace Supla
@@ -0,0 +1,241 @@
+/*
+ Copyright (C) AC SOFTWARE SP. Z O.O.
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+*/
+
+
+#include <Arduino.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "supla/crc16.h"
+#include "wear_leveling_storage.h"
+
+// By default, write to flash every 1 min
+#define SUPLA_WEAR_LEVELING_WRITING_PERIOD 60 * 1000
+
+#define WEAR_LEVELING_RECORD_MAGIC 0x5357
+
+using namespace Supla;
+
+WearLevelingStorage::WearLevelingStorage(unsigned int size,
+                                         unsigned int blockSize,
+                                         int blockCount,
+                                         unsigned int storageStartingOffset)
+    : Storage(storageStartingOffset),
+      data(nullptr),
+      size((size + 3) & ~3u),
+      blockSize(blockSize),
+      blockCount(blockCount),
+      currentBlock(0),
+      currentOffset(0),
+      sequence(0),
+      positionVerified(false),
+      dataChanged(false) {
+  data = new uint32_t[this->size / 4];
+  memset(data, 0, this->size);
+  setStateSavePeriod((unsigned long)SUPLA_WEAR_LEVELING_WRITING_PERIOD);
+}
+
+WearLevelingStorage::~WearLevelingStorage() {
+  delete[] data;
+}
+
+unsigned int WearLevelingStorage::recordSize() const {
+  return sizeof(RecordHeader) + size;
+}
+
+uint16_t WearLevelingStorage::calculateCrc(const RecordHeader &header,
+                                           uint32_t address,
+                                           bool fromMedium) {
+  uint16_t crc =
+      crc16_update_block(0xFFFF, &header, offsetof(RecordHeader, crc));
+
+  if (!fromMedium) {
+    return crc16_update_block(crc, data, size);
+  }
+
+  uint32_t chunk[8];
+  for (unsigned int i = 0; i < size; i += sizeof(chunk)) {
+    int chunkSize = size - i;
+    if (chunkSize > static_cast<int>(sizeof(chunk))) {
+      chunkSize = sizeof(chunk);
+    }
+    unsigned char *bytes = reinterpret_cast<unsigned char *>(chunk);
+    if (!readMedium(address + i, bytes, chunkSize)) {
+      // value which is different than CRC stored in header
+      return ~header.crc;
+    }
+    crc = crc16_update_block(crc, bytes, chunkSize);
+  }
+  return crc;
+}
+
+bool WearLevelingStorage::isErased(uint32_t address, int size) {
+  uint32_t chunk[8];
+  for (int i = 0; i < size; i += sizeof(chunk)) {
+    int chunkSize = size - i;
+    if (chunkSize > static_cast<int>(sizeof(chunk))) {
+      chunkSize = sizeof(chunk);
+    }
+    if (!readMedium(address + i,
+                    reinterpret_cast<unsigned char *>(chunk),
+                    chunkSize)) {
+      return false;
+    }
+    for (int j = 0; j < chunkSize / 4; j++) {
+      if (chunk[j] != 0xFFFFFFFF) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+void WearLevelingStorage::moveToNextBlock() {
+  currentBlock = (currentBlock + 1) % blockCount;
+  currentOffset = 0;
+}
+
+bool WearLevelingStorage::init() {
+  unsigned int length = recordSize();
+  if (blockCount < 2 || length > blockSize) {
+    Serial.println(F("Storage: invalid wear leveling configuration"));
+    return false;
+  }
+
+  bool found = false;
+  int bestBlock = 0;
+  unsigned int bestOffset = 0;
+  for (int block = 0; block < blockCount; block++) {
+    for (unsigned int offset = 0; offset + length <= blockSize;
+         offset += length) {
+      uint32_t address = block * blockSize + offset;
+      RecordHeader header;
+      if (!readMedium(address,
+                      reinterpret_cast<unsigned char *>(&header),
+                      sizeof(header)) ||
+          header.magic != WEAR_LEVELING_RECORD_MAGIC || header.size != size) {
+        // rest of block is empty
+        break;
+      }
+      if (calculateCrc(header, address + sizeof(header), true) != header.crc) {
+        Serial.print(F("Storage: invalid record CRC at "));
+        Serial.println(address);
+        continue;
+      }
+      if (!found || static_cast<int32_t>(header.sequence - sequence) > 0) {
+        found = true;
+        sequence = header.sequence;
+        bestBlock = block;
+        bestOffset = offset;
+      }
+    }
+  }
+
+  positionVerified = false;
+  dataChanged = false;
+  if (found) {
+    readMedium(bestBlock * blockSize + bestOffset + sizeof(RecordHeader),
+               reinterpret_cast<unsigned char *>(data),
+               size);
+    currentBlock = bestBlock;
+    currentOffset = bestOffset + length;
+    Serial.print(F("Storage: loaded record "));
+    Serial.print(sequence);
+    Serial.print(F(" from block "));
+    Serial.println(bestBlock);
+  } else {
+    Serial.println(F("Storage: no valid record found"));
+    sequence = 0;
+    currentBlock = 0;
+    currentOffset = 0;
+  }
+
+  return Storage::init();
+}
+
+int WearLevelingStorage::readStorage(unsigned int offset,
+                                     unsigned char *buf,
+                                     int size,
+                                     bool logs) {
+  (void)(logs);
+  if (offset + size > this->size) {
+    Serial.println(F("Storage: read outside of storage size"));
+    return 0;
+  }
+  memcpy(buf, reinterpret_cast<unsigned char *>(data) + offset, size);
+  return size;
+}
+
+int WearLevelingStorage::writeStorage(unsigned int offset,
+                                      const unsigned char *buf,
+                                      int size) {
+  if (offset + size > this->size) {
+    Serial.println(F("Storage: write outside of storage size"));
+    return 0;
+  }
+  memcpy(reinterpret_cast<unsigned char *>(data) + offset, buf, size);
+  dataChanged = true;
+  return size;
+}
+
+void WearLevelingStorage::commit() {
+  if (!dataChanged) {
+    return;
+  }
+
+  unsigned int length = recordSize();
+  if (currentOffset + length > blockSize) {
+    moveToNextBlock();
+  } else if (!positionVerified && currentOffset != 0 &&
+             !isErased(currentBlock * blockSize + currentOffset, length)) {
+    // record written before power loss may be left after the newest valid
+    // one, and flash can't be written without erase
+    moveToNextBlock();
+  }
+  positionVerified = true;
+
+  if (currentOffset == 0 && !eraseBlock(currentBlock)) {
+    Serial.println(F("Storage: block erase failed"));
+    moveToNextBlock();
+    return;
+  }
+
+  RecordHeader header = {};
+  header.magic = WEAR_LEVELING_RECORD_MAGIC;
+  header.size = size;
+  header.sequence = sequence + 1;
+  header.reserved = 0xFFFF;
+  header.crc = calculateCrc(header, 0, false);
+
+  // header is written last, so interrupted record is not recognized
+  uint32_t address = currentBlock * blockSize + currentOffset;
+  if (!writeMedium(address + sizeof(header),
+                   reinterpret_cast<unsigned char *>(data),
+                   size) ||
+      !writeMedium(address,
+                   reinterpret_cast<unsigned char *>(&header),
+                   sizeof(header))) {
+    Serial.println(F("Storage: record write failed"));
+    moveToNextBlock();
+    return;
+  }
+
+  sequence = header.sequence;
+  currentOffset += length;
+  dataChanged = false;
+  Serial.print(F("Storage: commit record "));
+  Serial.println(sequence);
+}
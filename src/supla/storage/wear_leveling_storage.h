@@ -0,0 +1,88 @@
+/*
+ Copyright (C) AC SOFTWARE SP. Z O.O.
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+*/
+
+
+#ifndef _supla_wear_leveling_storage_h
+#define _supla_wear_leveling_storage_h
+
+#include <stdint.h>
+
+#include "storage.h"
+
+namespace Supla {
+
+// Storage kept in RAM and written to flash as a log of records. Each commit()
+// appends record with whole storage content, sequence number and CRC after
+// the previous one. When block is full, next block is erased and used, so
+// erase cycles are spread over all blocks. On init() the newest record with
+// valid CRC is loaded, so record interrupted by power loss is skipped.
+//
+// Derived class provides access to medium: blockCount blocks of blockSize
+// bytes, where erased byte has 0xFF value and writes can only clear bits.
+// Addresses, sizes and buffers passed to it are aligned to 4 bytes.
+class WearLevelingStorage : public Storage {
+ public:
+  struct RecordHeader {
+    uint16_t magic;
+    uint16_t size;
+    uint32_t sequence;
+    uint16_t crc;
+    uint16_t reserved;
+  };
+
+  // size - size of storage content (rounded up to multiple of 4). Block has
+  // to fit at least one record and at least 2 blocks are required.
+  WearLevelingStorage(unsigned int size,
+                      unsigned int blockSize,
+                      int blockCount,
+                      unsigned int storageStartingOffset = 0);
+  ~WearLevelingStorage();
+
+  bool init();
+  void commit();
+
+ protected:
+  int readStorage(unsigned int, unsigned char *, int, bool);
+  int writeStorage(unsigned int, const unsigned char *, int);
+
+  virtual bool readMedium(uint32_t address, unsigned char *buf, int size) = 0;
+  virtual bool writeMedium(uint32_t address,
+                           const unsigned char *buf,
+                           int size) = 0;
+  virtual bool eraseBlock(int block) = 0;
+
+  unsigned int recordSize() const;
+  uint16_t calculateCrc(const RecordHeader &header,
+                        uint32_t address,
+                        bool fromMedium);
+  bool isErased(uint32_t address, int size);
+  void moveToNextBlock();
+
+  uint32_t *data;
+  unsigned int size;
+  unsigned int blockSize;
+  int blockCount;
+
+  int currentBlock;
+  unsigned int currentOffset;
+  uint32_t sequence;
+  bool positionVerified;
+  bool dataChanged;
+};
+
+};  // namespace Supla
+
+#endif
@@ -2,6 +2,14 @@
  * Put here all custom defines to customize library functionality
  * Supported defines:
  * SUPLA_COMM_DEBUG - enables logging of send and received data to/from server
+ * SUPLA_STORAGE_DEBUG - enables logging of data read from and written to
+ *                       storage (Eeprom, FramSpi)
+ * SUPLA_EVENT_QUEUE_SIZE - number of events raised from timer callbacks which
+ *                          can wait for execution in iterate() (power of 2)
+ * SUPLA_CHANNEL_SEND_BUDGET - max number of messages with channel values sent
+ *                             to server in one iteration (default 8)
+ * SUPLA_STATE_SAVE_SLICE - max number of elements which save state in one
+ *                          iteration (default 4)
  *
  */
 #ifndef supla_lib_config_h_
@@ -17,6 +17,8 @@
 #include <Arduino.h>
 #include <SuplaDevice.h>
 
+#include "element.h"
+#include "event_queue.h"
 #include "timer.h"
 
 #if defined(ARDUINO_ARCH_ESP32)
@@ -25,87 +27,195 @@
 
 #ifdef ARDUINO_ARCH_ESP8266
 #include <os_type.h>
+#include <user_interface.h>
+#endif
+
+#if defined(SUPLA_LINUX)
+#include <pthread.h>
+#include <time.h>
+#elif !defined(ARDUINO_ARCH_ESP8266) && !defined(ARDUINO_ARCH_ESP32)
+#include <avr/sleep.h>
 #endif
 
 namespace {
 #if defined(ARDUINO_ARCH_ESP8266)
 ETSTimer supla_esp_timer;
 ETSTimer supla_esp_fastTimer;
+bool supla_esp_lightSleepEnabled = false;
+sleep_type supla_esp_previousSleepType = MODEM_SLEEP_T;
 
 void esp_timer_cb(void *timer_arg) {
   (void)(timer_arg);
-  SuplaDevice.onTimer();
+  SuplaDeviceClass::OnTimer();
 }
 
 void esp_fastTimer_cb(void *timer_arg) {
   (void)(timer_arg);
-  SuplaDevice.onFastTimer();
+  SuplaDeviceClass::OnFastTimer();
 }
 #elif defined(ARDUINO_ARCH_ESP32)
 Ticker supla_esp_timer;
 Ticker supla_esp_fastTimer;
 
 void esp_timer_cb() {
-  SuplaDevice.onTimer();
+  SuplaDeviceClass::OnTimer();
 }
 
 void esp_fastTimer_cb() {
-  SuplaDevice.onFastTimer();
+  SuplaDeviceClass::OnFastTimer();
+}
+#elif defined(SUPLA_LINUX)
+// Timer callbacks are called from separate thread, as on ESP32 where Ticker
+// runs in its own task
+pthread_t supla_linux_timer_thread;
+bool supla_linux_timer_started = false;
+bool supla_linux_timer_used = false;
+bool supla_linux_fastTimer_used = false;
+
+void *linux_timer_thread(void *arg) {
+  (void)(arg);
+  struct timespec next;
+  clock_gettime(CLOCK_MONOTONIC, &next);
+  for (unsigned int tick = 1;; tick++) {
+    // absolute deadlines, so callback execution time doesn't add up
+    next.tv_nsec += 1000000;
+    if (next.tv_nsec >= 1000000000) {
+      next.tv_nsec -= 1000000000;
+      next.tv_sec++;
+    }
+    clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, nullptr);
+    if (supla_linux_fastTimer_used) {
+      SuplaDeviceClass::OnFastTimer();
+    }
+    if (supla_linux_timer_used && tick % 10 == 0) {
+      SuplaDeviceClass::OnTimer();
+    }
+  }
+  return nullptr;
 }
 #else
 ISR(TIMER1_COMPA_vect) {
-  SuplaDevice.onTimer();
+  SuplaDeviceClass::OnTimer();
 }
 ISR(TIMER2_COMPA_vect) {
-  SuplaDevice.onFastTimer();
+  SuplaDeviceClass::OnFastTimer();
 }
 #endif
 };  // namespace
 
 namespace Supla {
 void initTimers() {
+  bool timerUsed = SuplaDeviceClass::IsTimerHookUsed(Supla::HOOK_ON_TIMER);
+  bool fastTimerUsed =
+      SuplaDeviceClass::IsTimerHookUsed(Supla::HOOK_ON_FAST_TIMER);
+
 #if defined(ARDUINO_ARCH_ESP8266)
 
   os_timer_disarm(&supla_esp_timer);
-  os_timer_setfn(&supla_esp_timer, (os_timer_func_t *)esp_timer_cb, NULL);
-  os_timer_arm(&supla_esp_timer, 10, 1);
+  if (timerUsed) {
+    os_timer_setfn(&supla_esp_timer, (os_timer_func_t *)esp_timer_cb, NULL);
+    os_timer_arm(&supla_esp_timer, 10, 1);
+  }
 
   os_timer_disarm(&supla_esp_fastTimer);
-  os_timer_setfn(&supla_esp_fastTimer, (os_timer_func_t *)esp_fastTimer_cb, NULL);
-  os_timer_arm(&supla_esp_fastTimer, 1, 1);
+  if (fastTimerUsed) {
+    os_timer_setfn(
+        &supla_esp_fastTimer, (os_timer_func_t *)esp_fastTimer_cb, NULL);
+    os_timer_arm(&supla_esp_fastTimer, 1, 1);
+  }
 
 #elif defined(ARDUINO_ARCH_ESP32)
-  supla_esp_timer.attach_ms(10, esp_timer_cb);
-  supla_esp_fastTimer.attach_ms(1, esp_fastTimer_cb);
+  if (timerUsed) {
+    supla_esp_timer.attach_ms(10, esp_timer_cb);
+  }
+  if (fastTimerUsed) {
+    supla_esp_fastTimer.attach_ms(1, esp_fastTimer_cb);
+  }
+#elif defined(SUPLA_LINUX)
+  supla_linux_timer_used = timerUsed;
+  supla_linux_fastTimer_used = fastTimerUsed;
+  if ((timerUsed || fastTimerUsed) && !supla_linux_timer_started) {
+    supla_linux_timer_started =
+        pthread_create(
+            &supla_linux_timer_thread, nullptr, linux_timer_thread, nullptr) ==
+        0;
+  }
+#else
+  if (timerUsed) {
+    // Timer 1 for interrupt frequency 100 Hz (10 ms)
+    TCCR1A = 0;  // set entire TCCR1A register to 0
+    TCCR1B = 0;  // same for TCCR1B
+    TCNT1 = 0;   // initialize counter value to 0
+    // set compare match register for 1hz increments
+    OCR1A = 155;  // (16*10^6) / (100*1024) - 1 (must be <65536) == 155.25
+    // turn on CTC mode
+    TCCR1B |= (1 << WGM12);
+    // Set CS12 and CS10 bits for 1024 prescaler
+    TCCR1B |= (1 << CS12) | (1 << CS10);
+    // enable timer compare interrupt
+    TIMSK1 |= (1 << OCIE1A);
+    sei();  // enable interrupts
+  }
+
+  if (fastTimerUsed) {
+    // TIMER 2 for interrupt frequency 2000 Hz (0.5 ms)
+    cli();       // stop interrupts
+    TCCR2A = 0;  // set entire TCCR2A register to 0
+    TCCR2B = 0;  // same for TCCR2B
+    TCNT2 = 0;   // initialize counter value to 0
+    // set compare match register for 2000 Hz increments
+    OCR2A = 249;  // = 16000000 / (32 * 2000) - 1 (must be <256)
+    // turn on CTC mode
+    TCCR2B |= (1 << WGM21);
+    // Set CS22, CS21 and CS20 bits for 32 prescaler
+    TCCR2B |= (0 << CS22) | (1 << CS21) | (1 << CS20);
+    // enable timer compare interrupt
+    TIMSK2 |= (1 << OCIE2A);
+    sei();  // allow interrupts
+  }
+#endif
+}
+
+void lightSleep(unsigned long ms) {
+#if defined(ARDUINO_ARCH_ESP8266) || defined(ARDUINO_ARCH_ESP32) || \
+    defined(SUPLA_LINUX)
+  // ESP8266: with light sleep type selected, SDK puts CPU and modem to sleep
+  // during delay() while WiFi connection is kept (woken up on DTIM beacons).
+  // ESP32: idle task enters automatic light sleep when power management is
+  // enabled and WiFi works in modem sleep mode.
+  // Delay is split into slices, so events posted by timer callbacks are
+  // handled without waiting for the end of sleep.
+  while (ms > 0 && Supla::EventQueue::isEmpty()) {
+    unsigned long slice =
+        ms < SUPLA_LIGHT_SLEEP_SLICE_MS ? ms : SUPLA_LIGHT_SLEEP_SLICE_MS;
+    delay(slice);
+    ms -= slice;
+  }
+#else
+  // Idle mode keeps timers running, so CPU is woken up at least every 1 ms by
+  // millis() timer
+  unsigned long start = millis();
+  set_sleep_mode(SLEEP_MODE_IDLE);
+  while (millis() - start < ms && Supla::EventQueue::isEmpty()) {
+    sleep_mode();
+  }
+#endif
+}
+
+void enableLightSleep(bool enabled) {
+#if defined(ARDUINO_ARCH_ESP8266)
+  if (enabled == supla_esp_lightSleepEnabled) {
+    return;
+  }
+  supla_esp_lightSleepEnabled = enabled;
+  if (enabled) {
+    supla_esp_previousSleepType = wifi_get_sleep_type();
+    wifi_set_sleep_type(LIGHT_SLEEP_T);
+  } else {
+    wifi_set_sleep_type(supla_esp_previousSleepType);
+  }
 #else
-  // Timer 1 for interrupt frequency 100 Hz (10 ms)
-  TCCR1A = 0;  // set entire TCCR1A register to 0
-  TCCR1B = 0;  // same for TCCR1B
-  TCNT1 = 0;   // initialize counter value to 0
-  // set compare match register for 1hz increments
-  OCR1A = 155;  // (16*10^6) / (100*1024) - 1 (must be <65536) == 155.25
-  // turn on CTC mode
-  TCCR1B |= (1 << WGM12);
-  // Set CS12 and CS10 bits for 1024 prescaler
-  TCCR1B |= (1 << CS12) | (1 << CS10);
-  // enable timer compare interrupt
-  TIMSK1 |= (1 << OCIE1A);
-  sei();  // enable interrupts
-
-  // TIMER 2 for interrupt frequency 2000 Hz (0.5 ms)
-  cli();       // stop interrupts
-  TCCR2A = 0;  // set entire TCCR2A register to 0
-  TCCR2B = 0;  // same for TCCR2B
-  TCNT2 = 0;   // initialize counter value to 0
-  // set compare match register for 2000 Hz increments
-  OCR2A = 249;  // = 16000000 / (32 * 2000) - 1 (must be <256)
-  // turn on CTC mode
-  TCCR2B |= (1 << WGM21);
-  // Set CS22, CS21 and CS20 bits for 32 prescaler
-  TCCR2B |= (0 << CS22) | (1 << CS21) | (1 << CS20);
-  // enable timer compare interrupt
-  TIMSK2 |= (1 << OCIE2A);
-  sei();  // allow interrupts
+  (void)(enabled);
 #endif
 }
 
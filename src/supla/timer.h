@@ -17,8 +17,24 @@
 #ifndef _supla_timer_h
 #define _supla_timer_h
 
+// Max time of single sleep on ESP and Linux, after which EventQueue is
+// checked for events posted by timer callbacks
+#ifndef SUPLA_LIGHT_SLEEP_SLICE_MS
+#define SUPLA_LIGHT_SLEEP_SLICE_MS 20
+#endif
+
 namespace Supla {
+  // Timers are armed only if there are elements which implement onTimer() or
+  // onFastTimer() hook, in any of devices after begin(). Called from each
+  // SuplaDeviceClass::begin().
   void initTimers();
+  // Puts CPU to light sleep (or to idle on AVR) for given time. Timers and
+  // network interface stay active. Sleep ends earlier when timer callback
+  // posts an event (i.e. button press) to EventQueue.
+  void lightSleep(unsigned long ms);
+  // Prepares platform for lightSleep() calls (ESP8266 WiFi sleep type) and
+  // restores previous settings when low power mode is disabled
+  void enableLightSleep(bool enabled);
 };
 
 #endif